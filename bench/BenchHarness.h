@@ -0,0 +1,180 @@
+#pragma once
+
+// 自带的微基准测试框架：不依赖 Google Benchmark
+//
+// 每个用例自动调整迭代次数直到单轮耗时超过 minTime，重复 repetitions 轮取中位数，
+// 同时统计每次操作的 CPU 周期数 (x86 下用 rdtsc) 和堆分配次数，结果输出为 JSON，
+// 方便不同提交之间 diff。
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+namespace http
+{
+namespace bench
+{
+
+// 由 MicroBench.cpp 里重载的全局 operator new 累加
+extern std::atomic<uint64_t> g_allocations;
+extern std::atomic<uint64_t> g_allocatedBytes;
+
+// 阻止编译器把基准测试的结果优化掉
+template <typename T>
+inline void doNotOptimize(const T& value)
+{
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+inline uint64_t readCycles()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+struct BenchResult
+{
+    std::string name;
+    uint64_t    iterations;
+    double      nsPerOp;
+    double      cyclesPerOp;
+    double      allocsPerOp;
+    double      bytesAllocatedPerOp;
+};
+
+class BenchRunner
+{
+public:
+    // 用例函数：执行 iterations 次被测操作
+    using BenchFunc = std::function<void(uint64_t iterations)>;
+
+    BenchRunner()
+        : minTime_(0.2)
+        , repetitions_(5)
+    {}
+
+    void setMinTime(double seconds) { minTime_ = seconds; }
+    void setRepetitions(int n) { repetitions_ = std::max(1, n); }
+    void setFilter(const std::string& filter) { filter_ = filter; }
+
+    void add(const std::string& name, const BenchFunc& func)
+    {
+        cases_.push_back(std::make_pair(name, func));
+    }
+
+    std::vector<BenchResult> runAll()
+    {
+        std::vector<BenchResult> results;
+        for (auto& c : cases_)
+        {
+            if (!filter_.empty() && c.first.find(filter_) == std::string::npos)
+            {
+                continue;
+            }
+            results.push_back(run(c.first, c.second));
+            const BenchResult& r = results.back();
+            fprintf(stderr, "%-48s %12.1f ns/op %10.1f cycles/op %8.2f allocs/op\n",
+                    r.name.c_str(), r.nsPerOp, r.cyclesPerOp, r.allocsPerOp);
+        }
+        return results;
+    }
+
+    static void writeJson(FILE* out, const std::vector<BenchResult>& results, const std::string& label)
+    {
+        fprintf(out, "{\n  \"label\": \"%s\",\n  \"benchmarks\": [\n", label.c_str());
+        for (size_t i = 0; i < results.size(); ++i)
+        {
+            const BenchResult& r = results[i];
+            fprintf(out,
+                    "    {\"name\": \"%s\", \"iterations\": %llu, \"ns_per_op\": %.2f, "
+                    "\"cycles_per_op\": %.2f, \"allocs_per_op\": %.3f, \"alloc_bytes_per_op\": %.1f}%s\n",
+                    r.name.c_str(), static_cast<unsigned long long>(r.iterations), r.nsPerOp,
+                    r.cyclesPerOp, r.allocsPerOp, r.bytesAllocatedPerOp,
+                    i + 1 == results.size() ? "" : ",");
+        }
+        fprintf(out, "  ]\n}\n");
+    }
+
+private:
+    struct Sample
+    {
+        double ns;
+        double cycles;
+        double allocs;
+        double bytes;
+    };
+
+    Sample measure(const BenchFunc& func, uint64_t iterations)
+    {
+        uint64_t allocs = g_allocations.load(std::memory_order_relaxed);
+        uint64_t bytes = g_allocatedBytes.load(std::memory_order_relaxed);
+        auto start = std::chrono::steady_clock::now();
+        uint64_t cycles = readCycles();
+        func(iterations);
+        cycles = readCycles() - cycles;
+        auto elapsed = std::chrono::steady_clock::now() - start;
+
+        Sample s;
+        s.ns = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+        s.cycles = static_cast<double>(cycles);
+        s.allocs = static_cast<double>(g_allocations.load(std::memory_order_relaxed) - allocs);
+        s.bytes = static_cast<double>(g_allocatedBytes.load(std::memory_order_relaxed) - bytes);
+        return s;
+    }
+
+    BenchResult run(const std::string& name, const BenchFunc& func)
+    {
+        // 1. 标定：迭代次数翻倍，直到单轮耗时超过 minTime
+        uint64_t iterations = 1;
+        while (true)
+        {
+            Sample s = measure(func, iterations);
+            if (s.ns >= minTime_ * 1e9 || iterations >= (1ULL << 40))
+            {
+                break;
+            }
+            double scale = s.ns > 0 ? (minTime_ * 1e9 * 1.2) / s.ns : 10.0;
+            iterations = static_cast<uint64_t>(iterations * std::min(std::max(scale, 2.0), 100.0));
+        }
+
+        // 2. 正式测量：重复多轮取中位数，降低噪声
+        std::vector<Sample> samples;
+        for (int i = 0; i < repetitions_; ++i)
+        {
+            samples.push_back(measure(func, iterations));
+        }
+        std::sort(samples.begin(), samples.end(),
+                  [](const Sample& a, const Sample& b) { return a.ns < b.ns; });
+        const Sample& median = samples[samples.size() / 2];
+
+        BenchResult r;
+        r.name = name;
+        r.iterations = iterations;
+        r.nsPerOp = median.ns / iterations;
+        r.cyclesPerOp = median.cycles / iterations;
+        r.allocsPerOp = median.allocs / iterations;
+        r.bytesAllocatedPerOp = median.bytes / iterations;
+        return r;
+    }
+
+private:
+    double                                         minTime_;
+    int                                            repetitions_;
+    std::string                                    filter_;
+    std::vector<std::pair<std::string, BenchFunc>> cases_;
+};
+
+} // namespace bench
+} // namespace http
@@ -0,0 +1,197 @@
+// SmartSentinel 密码哈希基准：每组 scrypt 成本参数下一次校验的耗时、内存，以及每个核每秒能处理多少次登录
+//
+// 一次登录 = 一次 PasswordHasher::verify (和登录接口里的 KDF 开销相同)。
+// --threads 个线程同时校验 --seconds 秒，每核吞吐 = 总次数 / min(线程数, CPU 数) / 秒数。
+//
+// 用法：
+//   sentinel_kdfbench [--costs 12,8,1:14,8,1:15,8,1] [--threads 1] [--seconds 2] [--json]
+// --costs 里每组是 ln,r,p (N = 2^ln)，组之间用 ':' 分隔
+
+#include <muduo/base/Logging.h>
+
+#include "auth/PasswordHasher.h"
+
+#include <atomic>
+#include <chrono>
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+using namespace muduo;
+using http::auth::PasswordHasher;
+
+namespace
+{
+
+struct Options
+{
+    std::vector<PasswordHasher::Params> costs;
+    int    threads = 1;
+    double seconds = 2;
+    bool   json = false;
+};
+
+struct Result
+{
+    PasswordHasher::Params params;
+    uint64_t               verifies;
+    double                 elapsed;       // 秒
+    double                 msPerVerify;   // 单次校验的平均耗时 (单线程视角)
+    double                 perCore;       // 每核每秒登录数
+    double                 memoryMb;      // 一次 KDF 的内存 (128 * r * N)
+};
+
+bool parseCosts(const std::string& text, std::vector<PasswordHasher::Params>* costs)
+{
+    costs->clear();
+    size_t start = 0;
+    while (start <= text.size())
+    {
+        size_t end = text.find(':', start);
+        if (end == std::string::npos)
+        {
+            end = text.size();
+        }
+        PasswordHasher::Params params;
+        if (::sscanf(text.substr(start, end - start).c_str(), "%d,%d,%d", &params.logN, &params.r, &params.p) != 3)
+        {
+            return false;
+        }
+        costs->push_back(params);
+        start = end + 1;
+    }
+    return !costs->empty();
+}
+
+Result run(const PasswordHasher::Params& params, const Options& options)
+{
+    PasswordHasher hasher(params);
+    std::string stored = hasher.hash("correct horse battery staple");
+
+    std::atomic<bool> stop(false);
+    std::atomic<uint64_t> verifies(0);
+    std::vector<std::thread> threads;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < options.threads; ++i)
+    {
+        threads.emplace_back([&]
+        {
+            uint64_t n = 0;
+            while (!stop.load(std::memory_order_relaxed))
+            {
+                if (!hasher.verify("correct horse battery staple", stored))
+                {
+                    fprintf(stderr, "verify failed\n");
+                    ::exit(2);
+                }
+                ++n;
+            }
+            verifies.fetch_add(n);
+        });
+    }
+    std::this_thread::sleep_for(std::chrono::duration<double>(options.seconds));
+    stop = true;
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    int cores = std::max(1, std::min(options.threads, static_cast<int>(::sysconf(_SC_NPROCESSORS_ONLN))));
+    Result result;
+    result.params = params;
+    result.verifies = verifies.load();
+    result.elapsed = elapsed;
+    result.msPerVerify = result.verifies > 0 ? elapsed * 1000 * options.threads / result.verifies : 0;
+    result.perCore = result.verifies / elapsed / cores;
+    result.memoryMb = 128.0 * params.r * (1ULL << params.logN) / (1024 * 1024);
+    return result;
+}
+
+void usage(const char* prog)
+{
+    fprintf(stderr,
+            "Usage: %s [options]\n"
+            "  --costs LN,R,P[:LN,R,P...]  scrypt settings to measure (default 12,8,1:13,8,1:14,8,1:15,8,1:16,8,1)\n"
+            "  --threads N                 concurrent verifying threads (default 1)\n"
+            "  --seconds S                 measuring time per setting (default 2)\n"
+            "  --json                      print the report as JSON\n",
+            prog);
+}
+
+bool parseOptions(int argc, char* argv[], Options* options)
+{
+    static const struct option longOptions[] = {
+        { "costs", required_argument, nullptr, 'c' },
+        { "threads", required_argument, nullptr, 't' },
+        { "seconds", required_argument, nullptr, 's' },
+        { "json", no_argument, nullptr, 'j' },
+        { nullptr, 0, nullptr, 0 },
+    };
+
+    parseCosts("12,8,1:13,8,1:14,8,1:15,8,1:16,8,1", &options->costs);
+    int opt;
+    while ((opt = getopt_long(argc, argv, "c:t:s:j", longOptions, nullptr)) != -1)
+    {
+        switch (opt)
+        {
+        case 'c':
+            if (!parseCosts(optarg, &options->costs))
+            {
+                return false;
+            }
+            break;
+        case 't': options->threads = atoi(optarg); break;
+        case 's': options->seconds = atof(optarg); break;
+        case 'j': options->json = true; break;
+        default: return false;
+        }
+    }
+    return options->threads > 0 && options->seconds > 0;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    Logger::setLogLevel(Logger::WARN);
+
+    Options options;
+    if (!parseOptions(argc, argv, &options))
+    {
+        usage(argv[0]);
+        return 1;
+    }
+
+    std::vector<Result> results;
+    for (const PasswordHasher::Params& params : options.costs)
+    {
+        results.push_back(run(params, options));
+        const Result& r = results.back();
+        if (!options.json)
+        {
+            printf("scrypt ln=%-2d r=%-2d p=%-2d  %7.1f MB  %8.2f ms/login  %8.1f logins/s/core  (%d threads)\n",
+                   r.params.logN, r.params.r, r.params.p, r.memoryMb, r.msPerVerify, r.perCore,
+                   options.threads);
+        }
+    }
+
+    if (options.json)
+    {
+        printf("{\"threads\":%d,\"results\":[", options.threads);
+        for (size_t i = 0; i < results.size(); ++i)
+        {
+            const Result& r = results[i];
+            printf("%s{\"ln\":%d,\"r\":%d,\"p\":%d,\"memory_mb\":%.1f,\"verifies\":%llu,"
+                   "\"ms_per_login\":%.3f,\"logins_per_sec_per_core\":%.1f}",
+                   i == 0 ? "" : ",", r.params.logN, r.params.r, r.params.p, r.memoryMb,
+                   static_cast<unsigned long long>(r.verifies), r.msPerVerify, r.perCore);
+        }
+        printf("]}\n");
+    }
+    return 0;
+}
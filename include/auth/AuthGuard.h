@@ -0,0 +1,48 @@
+#pragma once
+
+#include "../http/HttpRequest.h"
+#include "../http/HttpResponse.h"
+#include "../http/Router.h"
+#include "SessionStore.h"
+#include "TokenService.h"
+
+#include <functional>
+
+namespace http
+{
+namespace auth
+{
+
+/**
+ * @brief 需要登录的路由：校验 "Authorization: Bearer <令牌>" 后再调用业务处理函数
+ *
+ * 只做签名、有效期和吊销检查，不查数据库；令牌缺失或无效回 401，业务函数拿到的是令牌里的身份信息。
+ * 配置了 SessionStore 时，没有 Bearer 令牌的请求按 Cookie 里的会话 id 认证 (claims.sessionId 非空)。
+ * tokens、sessions 的生命周期由调用方保证，都可以为空。
+ */
+class AuthGuard
+{
+public:
+    using AuthedHandler = std::function<void (const HttpRequest&, const TokenClaims&, HttpResponse*)>;
+
+    explicit AuthGuard(const TokenService* tokens, SessionStore* sessions = nullptr)
+        : tokens_(tokens)
+        , sessions_(sessions)
+    {
+    }
+
+    // 包装成普通的路由处理函数，直接交给 Router::addRoute
+    Router::HttpHandler protect(const AuthedHandler& handler) const;
+
+    // 从请求头里取出令牌，没有 Bearer 令牌返回 false
+    static bool bearerToken(const HttpRequest& req, std::string* token);
+    // 从 Cookie 头里取出会话 id，没有返回 false
+    static bool sessionCookie(const HttpRequest& req, std::string* sessionId);
+
+private:
+    const TokenService* tokens_;
+    SessionStore*       sessions_;
+};
+
+} // namespace auth
+} // namespace http
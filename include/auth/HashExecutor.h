@@ -0,0 +1,100 @@
+#pragma once
+
+#include <muduo/base/noncopyable.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdint.h>
+#include <thread>
+#include <vector>
+
+namespace http
+{
+namespace auth
+{
+
+/**
+ * @brief 密码哈希专用线程池：KDF 不在 muduo 的 I/O 线程里算
+ *
+ * 线程数就是同时计算的 KDF 个数上限 (每个 scrypt 要十几 MB 内存和几十毫秒 CPU)，
+ * 排队的任务数也有上限，满了直接拒绝 (调用方回 503)，不让撞库流量把内存和延迟堆上去。
+ * 排队时间和计算时间记到 MetricsRegistry 的直方图里。
+ *
+ * 提交是异步的，调用方 (I/O 线程) 不等结果：任务算完后在工作线程里回调 done，
+ * 由 done 把结果投递回 I/O 线程 (HttpResponse::defer 拿到的 Completion)。
+ * 截止时间过了还没轮到的任务不再计算，直接按超时回调；任务只能按值捕获，不能引用调用方的局部变量。
+ */
+class HashExecutor : muduo::noncopyable
+{
+public:
+    using Task = std::function<void ()>;
+    using Deadline = std::chrono::steady_clock::time_point;
+
+    struct Options
+    {
+        int    threads = 2;       // 同时计算的 KDF 个数
+        size_t maxQueueSize = 64; // 排队的任务数上限
+    };
+
+    enum Result
+    {
+        kDone,     // 任务已完成
+        kRejected, // 队列满了，任务没有提交
+        kTimedOut, // 截止时间前没轮到 (或者线程池停止了)，任务没有计算
+        kFailed,   // 任务抛了异常，结果不能用
+    };
+
+    using Done = std::function<void (Result)>;
+
+    explicit HashExecutor(const Options& options);
+    ~HashExecutor();
+
+    void start();
+    void stop();
+
+    /**
+     * @brief 提交任务，不等它完成；done 只调用一次
+     * 队列满了在调用线程里立即回调 kRejected；其余情况在工作线程里回调 kDone、kTimedOut 或 kFailed
+     * @param deadline 轮到这个任务时已经过了截止时间就不算了 (time_point::max() 表示不限)
+     */
+    void submit(const Task& task, Deadline deadline, const Done& done);
+
+    int queued() const { return queued_.load(std::memory_order_relaxed); }
+    uint64_t completed() const { return completed_.load(std::memory_order_relaxed); }
+    uint64_t rejected() const { return rejected_.load(std::memory_order_relaxed); }
+    uint64_t timedOut() const { return timedOut_.load(std::memory_order_relaxed); }
+    uint64_t failed() const { return failed_.load(std::memory_order_relaxed); }
+
+private:
+    struct Job
+    {
+        Task     task;
+        Done     done;
+        Deadline deadline;
+        int64_t  enqueuedUs = 0;
+    };
+
+    void workerLoop();
+
+private:
+    Options                          options_;
+    std::vector<std::thread>         threads_;
+    std::mutex                       mutex_;
+    std::condition_variable          notEmpty_;
+    std::deque<Job>                  queue_;
+    bool                             running_;
+
+    std::atomic<int>      queued_;
+    std::atomic<uint64_t> completed_;
+    std::atomic<uint64_t> rejected_;
+    std::atomic<uint64_t> timedOut_;
+    std::atomic<uint64_t> failed_;
+};
+
+} // namespace auth
+} // namespace http
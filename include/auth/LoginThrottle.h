@@ -0,0 +1,81 @@
+#pragma once
+
+#include <muduo/base/noncopyable.h>
+#include <muduo/net/InetAddress.h>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <stdint.h>
+#include <string>
+
+namespace http
+{
+namespace auth
+{
+
+/**
+ * @brief 登录失败计数：同一个用户名、同一个客户端 IP 在滑动窗口内失败太多次就直接挡掉，不再查数据库
+ *
+ * 用户名的上限防针对单个账号的暴力破解 (换 IP 也没用)，IP 的上限防撞库 (一个 IP 试大量账号)。
+ * 滑动窗口用两个相邻固定窗口近似：估计值 = 本窗口计数 + 上个窗口计数 * 上个窗口还落在滑动窗口里的比例。
+ *
+ * 计数放在固定大小的组相联表里，和 RateLimiter 一样每个槽两个 64 位原子量 (key 的哈希, 窗口编号+两个计数)，
+ * 读写都是无锁的，内存固定 (每个 key 16 字节)。组满时先替换窗口已经过期的槽，
+ * 再替换估计值最小的槽，大量一次性的 key 挤不掉正在被攻击的账号的计数。
+ * 存的只是哈希，不保存用户名本身。
+ */
+class LoginThrottle : muduo::noncopyable
+{
+public:
+    struct Options
+    {
+        int    maxFailuresPerUser = 5;   // 每个用户名窗口内最多失败次数
+        int    maxFailuresPerIp = 20;    // 每个 IP 窗口内最多失败次数
+        int    windowSeconds = 300;
+        size_t capacity = 64 * 1024;     // 最多同时跟踪的 key 数
+    };
+
+    static const int kWays = 8;
+
+    explicit LoginThrottle(const Options& options);
+    ~LoginThrottle();
+
+    // 查数据库之前调用：已经超过上限返回 true，*retryAfterSeconds 为计数降到上限以下还要等的秒数
+    bool blocked(const std::string& username, const muduo::net::InetAddress& peer, int* retryAfterSeconds);
+
+    // 登录失败：用户名和 IP 各记一次
+    void recordFailure(const std::string& username, const muduo::net::InetAddress& peer);
+
+    // 登录成功：清掉这个用户名的计数 (IP 的不清，撞库时偶尔撞中一个不能给整个 IP 解封)
+    void recordSuccess(const std::string& username);
+
+    uint64_t blockedAttempts() const { return blockedAttempts_.load(std::memory_order_relaxed); }
+
+private:
+    struct Slot
+    {
+        std::atomic<uint64_t> key;   // 0 表示空槽
+        std::atomic<uint64_t> state; // 高 32 位：窗口编号；接着 16 位：上个窗口计数；低 16 位：本窗口计数
+    };
+
+    Slot* find(uint64_t key);
+    Slot* findOrInsert(uint64_t key, uint64_t nowMs);
+    double estimate(uint64_t state, uint64_t nowMs) const;
+    int retryAfterSeconds(uint64_t state, uint64_t nowMs, int limit) const;
+    bool over(uint64_t key, int limit, uint64_t nowMs, int* retryAfterSeconds);
+    void increment(uint64_t key, uint64_t nowMs);
+    uint64_t nowMs() const;
+
+private:
+    Options                 options_;
+    uint64_t                windowMs_;
+    std::unique_ptr<Slot[]> slots_;
+    size_t                  setMask_;
+
+    std::chrono::steady_clock::time_point epoch_;
+    std::atomic<uint64_t>   blockedAttempts_;
+};
+
+} // namespace auth
+} // namespace http
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <string>
+
+namespace http
+{
+namespace auth
+{
+
+/**
+ * @brief 用 scrypt (OpenSSL 的 EVP_PBE_scrypt) 做密码哈希
+ *
+ * 存储格式：$scrypt$ln=<log2 N>,r=<r>,p=<p>$<base64 盐>$<base64 派生密钥>，
+ * 参数跟着哈希一起存，调整成本参数后旧哈希照样能验证，登录成功时再按新参数重算 (needsRehash)。
+ * 不是这个格式的存储值当作旧版的明文密码处理，同样在登录成功时升级成哈希。
+ *
+ * 一次哈希要 128 * r * N 字节内存 (默认 ln=14, r=8 是 16MB) 和几十毫秒 CPU，
+ * 不要在 I/O 线程里直接调用，交给 HashExecutor。所有方法都是线程安全的。
+ */
+class PasswordHasher
+{
+public:
+    struct Params
+    {
+        int logN = 14; // N = 2^logN，内存和时间都和 N 成正比
+        int r = 8;     // 块大小
+        int p = 1;     // 并行度 (串行计算，时间和 p 成正比)
+    };
+
+    explicit PasswordHasher(const Params& params);
+
+    const Params& params() const { return params_; }
+
+    // 生成带随机盐的哈希；失败 (参数非法、内存不够) 返回空串
+    std::string hash(const std::string& password) const;
+
+    // 校验密码；stored 可以是任意参数的 scrypt 哈希，也可以是旧版明文
+    bool verify(const std::string& password, const std::string& stored) const;
+
+    // stored 是明文或者参数和当前的不同时返回 true
+    bool needsRehash(const std::string& stored) const;
+
+    static bool isLegacyPlaintext(const std::string& stored);
+
+private:
+    Params params_;
+};
+
+} // namespace auth
+} // namespace http
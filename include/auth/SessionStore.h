@@ -0,0 +1,128 @@
+#pragma once
+
+#include <muduo/base/noncopyable.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <stdint.h>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace http
+{
+namespace auth
+{
+
+// 服务端会话 (给需要能随时踢人下线、不想用无状态令牌的部署)
+struct Session
+{
+    std::string id;
+    int64_t     userId = 0;
+    std::string username;
+    int64_t     createdAt = 0;  // 秒 (Unix 时间)
+    int64_t     lastAccess = 0; // 秒 (Unix 时间)
+};
+
+/**
+ * @brief 内存里的会话表：分片加锁，空闲超时用时间轮淘汰，总数有上限
+ *
+ * 会话 id 哈希到 N 个分片，每个分片一把锁，不同会话的访问基本不互相等待。
+ * 每个分片有一个时间轮：格子按最后访问时间 (粒度 tickSeconds) 划分，格子里是会话链表。
+ * 访问会话时把它从原来的格子 splice 到当前格子的末尾，O(1)；因为所有会话的空闲超时相同，
+ * 从最老的格子开始依次往后就是按最后访问时间排好的顺序：
+ *   - 过期清理从最老的格子头部往后删，删到第一个没过期的为止；
+ *   - 会话数到上限时删掉最老格子的头部，就是 LRU 淘汰，不需要另外维护 LRU 链表。
+ *
+ * start() 后台线程每秒清理过期会话；配置了 snapshotPath 时定期把会话写到磁盘 (先写临时文件再 rename)，
+ * 启动时 loadSnapshot() 读回来，重启服务不会让所有人重新登录。
+ */
+class SessionStore : muduo::noncopyable
+{
+public:
+    struct Options
+    {
+        int         shards = 16;                  // 分片数 (向上取到 2 的幂)
+        int         idleTimeoutSeconds = 30 * 60; // 空闲多久过期
+        size_t      maxSessions = 100000;         // 会话数上限 (按分片平均分)，超过时淘汰最久没访问的
+        std::string snapshotPath;                 // 为空不做快照
+        int         snapshotIntervalSeconds = 60;
+    };
+
+    // 会话 id 放在这个名字的 Cookie 里
+    static const char kCookieName[];
+
+    explicit SessionStore(const Options& options);
+    ~SessionStore();
+
+    // 后台清理/快照线程；stop() 时如果配置了快照会再写一次
+    void start();
+    void stop();
+
+    // 新建会话，返回会话 id (随机 128 位，十六进制)
+    std::string create(int64_t userId, const std::string& username);
+
+    // 查找会话并刷新最后访问时间，不存在或已过期返回 false
+    bool touch(const std::string& id, Session* session);
+
+    // 删除会话 (登出)，不存在返回 false
+    bool remove(const std::string& id);
+
+    // 删掉所有已过期的会话，返回删掉的个数 (后台线程每秒调用一次)
+    size_t expire();
+
+    bool saveSnapshot(const std::string& path) const;
+    // 读入快照里还没过期的会话，返回读入的个数
+    size_t loadSnapshot(const std::string& path);
+
+    size_t size() const { return static_cast<size_t>(size_.load(std::memory_order_relaxed)); }
+    uint64_t evictions() const { return evictions_.load(std::memory_order_relaxed); }
+    uint64_t expiredSessions() const { return expired_.load(std::memory_order_relaxed); }
+    int idleTimeoutSeconds() const { return options_.idleTimeoutSeconds; }
+
+private:
+    struct Entry
+    {
+        Session session;
+        int64_t tick; // 所在的时间轮格子 (绝对编号，格子下标 = tick % 格子数)
+    };
+    using EntryList = std::list<Entry>;
+
+    struct Shard
+    {
+        std::mutex                                       mutex;
+        std::unordered_map<std::string, EntryList::iterator> index;
+        std::vector<EntryList>                           wheel;
+        int64_t                                          oldestTick = 0; // 最老的可能非空的格子
+    };
+
+    Shard& shardFor(const std::string& id);
+    EntryList& slot(Shard& shard, int64_t tick) { return shard.wheel[tick % shard.wheel.size()]; }
+    bool expired(const Session& session, int64_t now) const;
+    size_t expireLocked(Shard& shard, int64_t now);
+    void evictOldestLocked(Shard& shard);
+    void insertLocked(Shard& shard, const Session& session);
+    void maintenanceLoop();
+
+private:
+    Options                              options_;
+    int64_t                              tickSeconds_;
+    size_t                               maxPerShard_;
+    std::vector<std::unique_ptr<Shard>>  shards_;
+
+    std::atomic<int64_t>  size_;
+    std::atomic<uint64_t> evictions_;
+    std::atomic<uint64_t> expired_;
+
+    std::thread             thread_;
+    std::mutex              runMutex_;
+    std::condition_variable stopCond_;
+    bool                    running_;
+};
+
+} // namespace auth
+} // namespace http
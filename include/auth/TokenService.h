@@ -0,0 +1,99 @@
+#pragma once
+
+#include <muduo/base/noncopyable.h>
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <stdint.h>
+#include <string>
+#include <unordered_map>
+
+namespace http
+{
+namespace auth
+{
+
+// 令牌里携带的身份信息
+struct TokenClaims
+{
+    int64_t     userId = 0;
+    std::string username;
+    int64_t     issuedAt = 0;  // 秒 (Unix 时间)
+    int64_t     expiresAt = 0; // 秒 (Unix 时间)
+    uint64_t    tokenId = 0;   // 随机数，吊销时按它识别
+    std::string sessionId;     // 通过服务端会话 (Cookie) 认证时是会话 id，令牌认证时为空
+};
+
+/**
+ * @brief 无状态的登录令牌：HMAC-SHA256 签名，校验不查数据库
+ *
+ * 格式：base64url(载荷) "." base64url(HMAC-SHA256(密钥, base64url(载荷)))，
+ * 载荷是定长二进制 (版本、用户 id、签发/过期时间、令牌 id) 加用户名，比 JSON 解析快。
+ *
+ * HMAC 的密钥处理 (ipad/opad 两次压缩) 每个线程只做一次：线程里缓存好内外两个摘要上下文，
+ * 每次签名/校验只拷贝上下文再算消息部分。base64url 用查表实现。
+ *
+ * 吊销 (登出) 记在一个小布隆过滤器里，校验时只读几个原子字，命中才去查精确的吊销表，
+ * 所以未吊销的令牌 (绝大多数) 校验路径上没有锁。吊销记录在令牌过期后清理，过滤器随之重建。
+ */
+class TokenService : muduo::noncopyable
+{
+public:
+    struct Options
+    {
+        std::string secret;                 // 签名密钥，为空时随机生成 (重启后旧令牌全部失效)
+        int         ttlSeconds = 24 * 3600; // 令牌有效期
+        size_t      revocationBits = 1 << 16; // 吊销布隆过滤器的位数 (向上取到 2 的幂)
+    };
+
+    enum Status
+    {
+        kValid,
+        kMalformed,
+        kBadSignature,
+        kExpired,
+        kRevoked,
+    };
+
+    explicit TokenService(const Options& options);
+    ~TokenService();
+
+    // 给登录成功的用户签发令牌，claims 不为空时填入令牌里的信息
+    std::string issue(int64_t userId, const std::string& username, TokenClaims* claims = nullptr) const;
+
+    // 校验令牌：签名、有效期、是否被吊销；签名正确时填好 claims (可以为空)
+    Status verify(const std::string& token, TokenClaims* claims) const;
+
+    // 吊销令牌 (登出)，到它本来的过期时间为止都校验不过
+    void revoke(const TokenClaims& claims);
+
+    uint64_t revokedTokens() const { return revokedTokens_.load(std::memory_order_relaxed); }
+    uint64_t rejectedTokens() const { return rejectedTokens_.load(std::memory_order_relaxed); }
+    int ttlSeconds() const { return options_.ttlSeconds; }
+
+    static const char* statusString(Status status);
+
+private:
+    void sign(const char* data, size_t len, unsigned char* mac) const;
+    bool maybeRevoked(uint64_t tokenId) const;
+    void addToFilter(uint64_t tokenId);
+    void purgeRevocations(int64_t now);
+
+private:
+    Options     options_;
+    std::string key_;
+    uint64_t    instanceId_; // 区分线程里缓存的 HMAC 上下文属于哪个实例
+
+    // 吊销：布隆过滤器 (无锁读) + 精确表 (mutex 保护，只在过滤器命中时查)
+    std::unique_ptr<std::atomic<uint64_t>[]>  filter_;
+    size_t                                    filterMask_; // 位数 - 1
+    mutable std::mutex                        mutex_;
+    std::unordered_map<uint64_t, int64_t>     revoked_;    // 令牌 id -> 过期时间
+    int64_t                                   lastPurge_;
+    std::atomic<uint64_t>                     revokedTokens_;
+    mutable std::atomic<uint64_t>             rejectedTokens_; // 校验不通过的次数
+};
+
+} // namespace auth
+} // namespace http
@@ -4,11 +4,50 @@
 #include "../http/HttpResponse.h"
 #include <string>
 
+namespace http
+{
+namespace auth
+{
+class HashExecutor;
+class LoginThrottle;
+class PasswordHasher;
+class SessionStore;
+class TokenService;
+struct TokenClaims;
+}
+}
+
 // UserController 类：专门负责处理和用户相关的业务逻辑
 class UserController{
 public:
     UserController()=default;
     ~UserController()=default;
+    /**
+     * @brief 设置登录失败计数 (可选)，生命周期由调用方保证
+     * 同一用户名或同一 IP 失败太多次后，登录请求在查数据库之前就回 429
+     */
+    void setLoginThrottle(http::auth::LoginThrottle* throttle) { loginThrottle_ = throttle; }
+    /**
+     * @brief 设置密码哈希 (可选)，生命周期由调用方保证
+     * 存储的密码按 hasher 校验 (兼容旧版明文，登录成功时升级成哈希)，KDF 交给 executor 的线程算，
+     * 登录的响应推迟到算完以后在 I/O 线程里发出 (HttpResponse::defer)；executor 为空时在调用线程里算
+     */
+    void setPasswordHashing(http::auth::PasswordHasher* hasher, http::auth::HashExecutor* executor);
+    /**
+     * @brief 设置令牌签发 (可选)，生命周期由调用方保证
+     * 登录成功时签发 HMAC 签名的令牌，之后的接口凭令牌认证，不再查数据库
+     */
+    void setTokenService(http::auth::TokenService* tokens) { tokenService_ = tokens; }
+    /**
+     * @brief 设置服务端会话 (可选)，生命周期由调用方保证
+     * 登录成功时另外建一个会话，会话 id 用 HttpOnly Cookie 下发；登出时删除
+     * (令牌认证的登出请求带着会话 Cookie 时也删)。secureCookie 为 true 时 Cookie 带 Secure，只走 HTTPS
+     */
+    void setSessionStore(http::auth::SessionStore* sessions, bool secureCookie = false)
+    {
+        sessionStore_ = sessions;
+        secureCookie_ = secureCookie;
+    }
     /**
      * @brief 处理用户登录请求
      * @param req  HTTP 请求对象（包含前端发来的账号密码）
@@ -21,6 +60,39 @@ public:
      * (这个你可以先声明在这里，等登录写完了再练手实现)
      */
     void registerUser(const http::HttpRequest& req, http::HttpResponse *resp);
+    /**
+     * @brief 返回当前登录用户的信息 (需要登录，claims 由 AuthGuard 校验令牌后给出)
+     */
+    void me(const http::HttpRequest& req, const http::auth::TokenClaims& claims, http::HttpResponse *resp);
+    /**
+     * @brief 登出：吊销当前令牌，到它原本的过期时间为止都不能再用；有服务端会话的话删掉会话
+     */
+    void logout(const http::HttpRequest& req, const http::auth::TokenClaims& claims, http::HttpResponse *resp);
+
+private:
+    // 一次登录的校验结果：KDF 在哈希线程池里算完后，回到 I/O 线程据此回复
+    struct LoginAttempt
+    {
+        std::string                  username;
+        muduo::net::InetAddress      peer;
+        http::HttpRequest::Deadline  deadline;
+        int                          userId = 0;
+        bool                         found = false;
+        bool                         verified = false;
+    };
+
+    // 把旧明文或旧参数的哈希换成新哈希 (在哈希线程里调用，会借数据库连接)
+    static void saveRehash(int userId, const std::string& rehashed, http::HttpRequest::Deadline deadline);
+    void finishLogin(const LoginAttempt& attempt, http::HttpResponse* resp);
+    static void setLoginBusy(http::HttpResponse* resp);
+    std::string sessionCookieAttributes() const;
 
+    http::auth::LoginThrottle*  loginThrottle_ = nullptr;
+    http::auth::PasswordHasher* passwordHasher_ = nullptr;
+    http::auth::HashExecutor*   hashExecutor_ = nullptr;
+    http::auth::TokenService*   tokenService_ = nullptr;
+    http::auth::SessionStore*   sessionStore_ = nullptr;
+    bool                        secureCookie_ = false;
+    std::string                 dummyHash_;
 
 };
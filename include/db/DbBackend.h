@@ -0,0 +1,39 @@
+#pragma once
+#include <memory>
+#include <string>
+#include <vector>
+#include "DbResult.h"
+
+namespace http 
+{
+namespace db 
+{
+
+/**
+ * @brief 数据库后端接口
+ *
+ * DbConnection 负责参数绑定、加锁和计时，真正执行 SQL 的是后端：
+ * MySqlBackend 走 MySQL Connector/C++，MockBackend 是进程内的内存表 (压测/CI 用)。
+ * 出错时抛 DbException，超时抛 DbTimeoutException。
+ */
+class DbBackend 
+{
+public:
+    virtual ~DbBackend() = default;
+
+    // params 按 ? 占位符的顺序排列，全部以字符串形式绑定；
+    // timeoutMs 是这条语句最多能执行多久 (由请求的截止时间算出)，0 表示不限
+    virtual std::unique_ptr<DbResult> executeQuery(const std::string& sql,
+                                                   const std::vector<std::string>& params,
+                                                   int timeoutMs) = 0;
+    virtual int executeUpdate(const std::string& sql,
+                              const std::vector<std::string>& params,
+                              int timeoutMs) = 0;
+
+    virtual bool ping() = 0;
+    virtual void reconnect() = 0;
+    virtual void cleanup() = 0;
+};
+
+} // namespace db
+} // namespace http
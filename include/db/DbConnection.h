@@ -1,14 +1,14 @@
 #pragma once
+#include <chrono>
 #include <memory>
 #include <string>
 #include <mutex>
-#include <cppconn/connection.h>
-#include <cppconn/prepared_statement.h>
-#include <cppconn/resultset.h>
-#include <mysql_driver.h>
-#include <mysql/mysql.h>
-#include <muduo/base/Logging.h>
+#include <vector>
+#include "DbBackend.h"
 #include "DbException.h"
+#include "DbResult.h"
+#include "QueryCache.h"
+#include "../metrics/Metrics.h"
 
 
 // 1. 如果是 std::string，直接返回，啥也不做
@@ -35,10 +35,15 @@ namespace db
 class DbConnection 
 {
 public:
+    using Deadline = std::chrono::steady_clock::time_point;
+
+    // 连接 MySQL (MySqlBackend)
     DbConnection(const std::string& host, 
                 const std::string& user,
                 const std::string& password,
                 const std::string& database);
+    // 使用指定的后端 (比如内存后端 MockBackend)
+    explicit DbConnection(std::unique_ptr<DbBackend> backend);
     ~DbConnection();
 
     // 禁止拷贝
@@ -49,77 +54,108 @@ public:
     void reconnect();
     void cleanup();
 
+    // 当前借用者的截止时间：连接池借出时设置、归还时清除。
+    // 之后的每条语句最多执行到截止时间，已经过了就不再发出，直接抛 DbTimeoutException
+    void setDeadline(Deadline deadline) { deadline_ = deadline; }
+    Deadline deadline() const { return deadline_; }
+
+    // 查询缓存：连接池借出时设置。设置了的话写语句成功后让依赖被写的表的缓存失效
+    void setQueryCache(QueryCache* cache) { queryCache_ = cache; }
+
     template<typename... Args>
-    sql::ResultSet* executeQuery(const std::string& sql, Args&&... args)
+    std::unique_ptr<DbResult> executeQuery(const std::string& sql, Args&&... args)
     {
+        DbParams params;
+        bindParams(&params, 1, std::forward<Args>(args)...);
         std::lock_guard<std::mutex> lock(mutex_);
-        try 
-        {
-            // 直接创建新的预处理语句，不使用缓存
-            std::unique_ptr<sql::PreparedStatement> stmt(
-                conn_->prepareStatement(sql)
-            );
-            bindParams(stmt.get(), 1, std::forward<Args>(args)...);
-            return stmt->executeQuery();
-        } 
-        catch (const sql::SQLException& e) 
-        {
-            LOG_ERROR << "Query failed: " << e.what() << ", SQL: " << sql;
-            throw DbException(e.what());
-        }
+        int timeoutMs = statementTimeoutMs();
+        QueryTimer timer;
+        return backend_->executeQuery(sql, params.values, timeoutMs);
     }
     
     template<typename... Args>
     int executeUpdate(const std::string& sql, Args&&... args)
     {
+        DbParams params;
+        bindParams(&params, 1, std::forward<Args>(args)...);
         std::lock_guard<std::mutex> lock(mutex_);
-        try 
+        int timeoutMs = statementTimeoutMs();
+        QueryTimer timer;
+        int affected = backend_->executeUpdate(sql, params.values, timeoutMs);
+        if (queryCache_)
         {
-            // 直接创建新的预处理语句，不使用缓存
-            std::unique_ptr<sql::PreparedStatement> stmt(
-                conn_->prepareStatement(sql)
-            );
-            bindParams(stmt.get(), 1, std::forward<Args>(args)...);
-            return stmt->executeUpdate();
-        } 
-        catch (const sql::SQLException& e) 
-        {
-            LOG_ERROR << "Update failed: " << e.what() << ", SQL: " << sql;
-            throw DbException(e.what());
+            invalidateCache(sql);
         }
+        return affected;
     }
 
     bool ping();  // 添加检测连接是否有效的方法
-private:
-     // 辅助函数：递归终止条件
-    void bindParams(sql::PreparedStatement*, int) {}
+
+    // 参数绑定：按语句类型模板化 (只要求有 setString)，public 是为了基准测试能直接调用
+    // 辅助函数：递归终止条件
+    template<typename Stmt>
+    static void bindParams(Stmt*, int) {}
     
     // 辅助函数：绑定参数
-    template<typename T, typename... Args>
-    void bindParams(sql::PreparedStatement* stmt, int index, 
-                   T&& value, Args&&... args) 
+    template<typename Stmt, typename T, typename... Args>
+    static void bindParams(Stmt* stmt, int index, 
+                           T&& value, Args&&... args) 
     {
         stmt->setString(index, toSqlString(value));
         bindParams(stmt, index + 1, std::forward<Args>(args)...);
     }
     
     // 特化 string 类型的参数绑定
-    template<typename... Args>
-    void bindParams(sql::PreparedStatement* stmt, int index, 
-                   const std::string& value, Args&&... args) 
+    template<typename Stmt, typename... Args>
+    static void bindParams(Stmt* stmt, int index, 
+                           const std::string& value, Args&&... args) 
     {
         stmt->setString(index, value);
         bindParams(stmt, index + 1, std::forward<Args>(args)...);
     }
 
 private:
-    std::shared_ptr<sql::Connection> conn_;
-    std::string                      host_;
-    std::string                      user_;
-    std::string                      password_;
-    std::string                      database_;
-    std::mutex                       mutex_;
+    // 写语句成功后让缓存失效；事务里的写记下来，提交 / 回滚时再失效一次。调用方持有 mutex_
+    void invalidateCache(const std::string& sql);
+
+    // 距截止时间还剩多少毫秒 (至少 1)，没有截止时间返回 0；已经过了抛 DbTimeoutException
+    int statementTimeoutMs() const;
+
+    // 收集绑定好的参数，按占位符顺序交给后端
+    struct DbParams
+    {
+        std::vector<std::string> values;
+
+        void setString(int index, const std::string& value)
+        {
+            if (static_cast<int>(values.size()) < index)
+            {
+                values.resize(index);
+            }
+            values[index - 1] = value;
+        }
+    };
+
+    // 记录查询耗时：析构时上报，异常路径也能统计到
+    struct QueryTimer
+    {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        ~QueryTimer()
+        {
+            metrics::MetricsRegistry::instance().observeDbQuery(
+                std::chrono::duration_cast<std::chrono::microseconds>(
+                    std::chrono::steady_clock::now() - start).count());
+        }
+    };
+
+private:
+    std::unique_ptr<DbBackend> backend_;
+    std::mutex                 mutex_;
+    Deadline                   deadline_;
+    QueryCache*                queryCache_;
+    bool                       inTransaction_;
+    std::vector<std::string>   transactionWrites_; // 当前事务里执行过的写语句 (去重)
 };
 
 } // namespace db
-} // namespace http
\ No newline at end of file
+} // namespace http
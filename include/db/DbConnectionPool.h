@@ -1,9 +1,12 @@
 #pragma once
+#include <atomic>
 #include <queue>
 #include <mutex>
 #include <condition_variable>
+#include <functional>
 #include <memory>
 #include <thread>
+#include <vector>
 #include "DbConnection.h"
 
 namespace http 
@@ -11,6 +14,16 @@ namespace http
 namespace db 
 {
 
+/**
+ * @brief 数据库连接池：一个主库 (primary) + 若干只读副本 (replica)，每个都是一个有名字的小池子
+ *
+ * 写语句、事务、必须读到最新数据的读 (比如登录校验密码) 用 getConnection()，总是走主库；
+ * 可以容忍少量延迟的读用 getReadConnection() / executeQuery()，在副本之间挑当前未完成请求
+ * (包括正在等连接的) 最少的一个，减少慢副本上的排队。
+ *
+ * 检查线程每秒在每个副本专用的探测连接上用 lagQuery 查一次复制延迟 (副本再忙也照样能查)，超过 maxLagSeconds、复制中断或者连不上的副本
+ * 暂时不接读请求，恢复后自动重新加入；没有可用副本 (或者没配副本) 时读请求回到主库。
+ */
 class DbConnectionPool 
 {
 public:
@@ -21,15 +34,108 @@ public:
         return instance;   //确保你的整个服务器程序里，只有一个 数据库连接池
     }   
 
-    // 初始化连接池
+    // 连接工厂：决定池子里放的是哪种后端的连接
+    using ConnectionFactory = std::function<std::shared_ptr<DbConnection>()>;
+
+    // 初始化连接池 (MySQL)
     void init(const std::string& host,
              const std::string& user,
              const std::string& password,
              const std::string& database,
              size_t poolSize = 10);
 
-    // 获取连接
-    std::shared_ptr<DbConnection> getConnection();
+    // 用自定义工厂初始化连接池 (比如内存后端)
+    void init(const ConnectionFactory& factory, size_t poolSize = 10);
+
+    struct ReplicaOptions
+    {
+        int         maxLagSeconds = 5;                    // 复制延迟超过这个值不再接读请求
+        std::string lagQuery = "SHOW REPLICA STATUS";     // 查延迟的语句 (MySQL 8.0.22 之前用 SHOW SLAVE STATUS)，空串表示不查
+    };
+
+    // 添加只读副本，只能在服务启动 (开始处理请求) 之前调用。
+    // 副本连不上不会抛异常：先以不可用状态加入，检查线程补齐连接、确认可用后再接读请求
+    void addReplica(const std::string& name,
+                    const std::string& host,
+                    const std::string& user,
+                    const std::string& password,
+                    const std::string& database,
+                    size_t poolSize,
+                    const ReplicaOptions& options);
+    void addReplica(const std::string& name, const ConnectionFactory& factory,
+                    size_t poolSize, const ReplicaOptions& options);
+
+    /**
+     * @brief 借一个连接，用完 (shared_ptr 析构) 自动归还
+     * @param deadline 请求的截止时间 (HttpRequest::deadline())：池子空了最多等到这个时间，
+     *                 超时抛 DbTimeoutException(kPoolWait)；借出的连接上的语句也受它约束
+     */
+    std::shared_ptr<DbConnection> getConnection(
+        DbConnection::Deadline deadline = DbConnection::Deadline::max());
+
+    // 借一个只读连接：可用副本里未完成请求最少的一个，没有可用副本时借主库的。
+    // 副本连不上时标记为不可用并改借主库；等连接超时照样抛 DbTimeoutException
+    std::shared_ptr<DbConnection> getReadConnection(
+        DbConnection::Deadline deadline = DbConnection::Deadline::max());
+
+    // 读走副本、写走主库的便捷写法，用完连接立即归还
+    template<typename... Args>
+    std::unique_ptr<DbResult> executeQuery(DbConnection::Deadline deadline,
+                                           const std::string& sql, Args&&... args)
+    {
+        return getReadConnection(deadline)->executeQuery(sql, std::forward<Args>(args)...);
+    }
+
+    template<typename... Args>
+    int executeUpdate(DbConnection::Deadline deadline, const std::string& sql, Args&&... args)
+    {
+        return getConnection(deadline)->executeUpdate(sql, std::forward<Args>(args)...);
+    }
+
+    struct ReplicaStatus
+    {
+        std::string name;
+        bool        available;
+        int         lagSeconds;  // 最近一次查到的复制延迟，-1 表示未知
+        int         outstanding; // 借出 + 正在等连接的请求数
+        uint64_t    reads;       // 累计借出的只读连接数
+    };
+    std::vector<ReplicaStatus> replicaStatus() const;
+
+    // 配了副本但没有可用副本、读请求回到主库的次数
+    uint64_t replicaFallbacks() const { return replicaFallbacks_.load(std::memory_order_relaxed); }
+
+    // 查询缓存 (生命周期由调用方保证)：设置后借出的连接上的写语句会让相关缓存失效
+    void setQueryCache(QueryCache* cache) { queryCache_ = cache; }
+    QueryCache* queryCache() const { return queryCache_; }
+
+    /**
+     * @brief 走查询缓存的读：命中时不借连接，直接返回缓存的结果；未命中才借连接查询并写缓存
+     * @param ttlMs 结果最多缓存多久，依赖的表被写入时提前失效
+     * 没有设置查询缓存时等同于 getConnection(deadline)->executeQuery(sql, args...)
+     */
+    template<typename... Args>
+    std::unique_ptr<DbResult> executeCachedQuery(int ttlMs, DbConnection::Deadline deadline,
+                                                 const std::string& sql, const Args&... args)
+    {
+        QueryCache* cache = queryCache_;
+        // 未命中时读主库：副本落后时查到的旧数据会在失效之后重新进缓存
+        if (!cache)
+        {
+            return getConnection(deadline)->executeQuery(sql, args...);
+        }
+        QueryCache::Key key(sql);
+        DbConnection::bindParams(&key, 1, args...);
+        QueryCache::Rows rows = cache->lookup(key.text());
+        if (rows)
+        {
+            return std::unique_ptr<DbResult>(new DbResult(std::move(rows)));
+        }
+        QueryCache::Ticket ticket = cache->begin(sql);
+        std::unique_ptr<DbResult> result = getConnection(deadline)->executeQuery(sql, args...);
+        cache->store(key.text(), ticket, result->rows(), ttlMs);
+        return result;
+    }
 
 private:
     // 构造函数
@@ -41,20 +147,43 @@ private:
     DbConnectionPool(const DbConnectionPool&) = delete;
     DbConnectionPool& operator=(const DbConnectionPool&) = delete;
 
-    std::shared_ptr<DbConnection> createConnection();
+    // 一个有名字的池子 (主库或者某个副本)
+    struct Pool
+    {
+        std::string                               name;
+        ConnectionFactory                         factory;
+        ReplicaOptions                            options;      // 只对副本有意义
+        std::queue<std::shared_ptr<DbConnection>> connections;
+        std::mutex                                mutex;
+        std::condition_variable                   cv;
+        bool                                      initialized = false;
+        size_t                                    size = 0;     // 目标连接数
+        size_t                                    created = 0;  // 已经建好的连接数 (副本启动时可能不足，由检查线程补齐)
+        std::shared_ptr<DbConnection>             probe;        // 副本专用的探测连接，不进池子，只在检查线程里用
+        std::atomic<int>                          outstanding{ 0 };
+        std::atomic<bool>                         available{ true };
+        std::atomic<int>                          lagSeconds{ -1 };
+        std::atomic<uint64_t>                     reads{ 0 };
+    };
+
+    // 把副本的连接建到 pool->size 个，建连失败抛异常 (已经建好的留在池子里)
+    static void fill(Pool* pool);
+    std::shared_ptr<DbConnection> borrow(Pool* pool, DbConnection::Deadline deadline);
+    Pool* pickReplica();
+    void setAvailable(Pool* replica, bool available, const std::string& reason);
+    void probeReplica(Pool* replica);
+    std::vector<Pool*> pools();
 
     void checkConnections(); // 添加连接检查方法
 
 private:
-    std::string                               host_;
-    std::string                               user_;
-    std::string                               password_;
-    std::string                               database_;
-    std::queue<std::shared_ptr<DbConnection>> connections_;
-    std::mutex                                mutex_;
-    std::condition_variable                   cv_;
-    bool                                      initialized_ = false;
-    std::thread                               checkThread_; // 添加检查线程
+    Pool                               primary_;
+    std::vector<std::unique_ptr<Pool>> replicas_;        // 启动前添加，之后只读
+    mutable std::mutex                 replicasMutex_;   // 保护 replicas_ 和检查线程之间的并发
+    std::atomic<unsigned>              nextReplica_{ 0 }; // 未完成请求数相同时轮流选
+    std::atomic<uint64_t>              replicaFallbacks_{ 0 };
+    std::thread                        checkThread_; // 添加检查线程
+    QueryCache*                        queryCache_ = nullptr;
 };
 
 } // namespace db
@@ -15,5 +15,29 @@ public:
         : std::runtime_error(message) {}
 };
 
+/**
+ * @brief 请求的截止时间到了
+ * kPoolWait：等连接池的空闲连接时超时，还没做任何工作 (业务一般回 503)；
+ * kQuery：查询来不及发出或执行超时 (业务一般回 504)
+ */
+class DbTimeoutException : public DbException 
+{
+public:
+    enum Stage
+    {
+        kPoolWait,
+        kQuery,
+    };
+
+    DbTimeoutException(Stage stage, const std::string& message) 
+        : DbException(message)
+        , stage_(stage) {}
+
+    Stage stage() const { return stage_; }
+
+private:
+    Stage stage_;
+};
+
 } // namespace db
 } // namespace http
\ No newline at end of file
@@ -0,0 +1,82 @@
+#pragma once
+#include <memory>
+#include <string>
+#include <vector>
+#include "DbException.h"
+
+namespace http 
+{
+namespace db 
+{
+
+// 已经解码好的结果集：列名 + 按行存放的字符串值 (NULL 存为空串)
+// 数据是不可变的，多个 DbResult 可以共享同一份
+struct DbRows
+{
+    std::vector<std::string>              columns;
+    std::vector<std::vector<std::string>> rows;
+};
+
+/**
+ * @brief 查询结果，接口仿照 sql::ResultSet (next/getInt/getString)
+ *
+ * 和具体的数据库后端无关：MySQL 后端查询完就把行读出来，连接可以立刻还回池子，
+ * 内存后端直接构造。
+ */
+class DbResult 
+{
+public:
+    explicit DbResult(std::shared_ptr<const DbRows> rows)
+        : rows_(std::move(rows))
+        , cursor_(-1)
+    {}
+
+    // 游标移到下一行，没有更多行返回 false
+    bool next()
+    {
+        if (cursor_ + 1 < static_cast<long>(rows_->rows.size()))
+        {
+            ++cursor_;
+            return true;
+        }
+        return false;
+    }
+
+    int getInt(const std::string& column) const
+    {
+        return std::stoi(getString(column));
+    }
+
+    std::string getString(const std::string& column) const
+    {
+        if (cursor_ < 0 || cursor_ >= static_cast<long>(rows_->rows.size()))
+        {
+            throw DbException("Result cursor is not on a row");
+        }
+        return rows_->rows[cursor_][columnIndex(column)];
+    }
+
+    size_t rowsCount() const { return rows_->rows.size(); }
+    const std::vector<std::string>& columns() const { return rows_->columns; }
+    const std::shared_ptr<const DbRows>& rows() const { return rows_; }
+
+private:
+    size_t columnIndex(const std::string& column) const
+    {
+        for (size_t i = 0; i < rows_->columns.size(); ++i)
+        {
+            if (rows_->columns[i] == column)
+            {
+                return i;
+            }
+        }
+        throw DbException("Unknown column: " + column);
+    }
+
+private:
+    std::shared_ptr<const DbRows> rows_;
+    long                          cursor_;
+};
+
+} // namespace db
+} // namespace http
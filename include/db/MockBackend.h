@@ -0,0 +1,95 @@
+#pragma once
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "DbBackend.h"
+
+namespace http 
+{
+namespace db 
+{
+
+struct MockStatement;
+struct MockTable;
+
+/**
+ * @brief 进程内的内存数据库，给 MockBackend 用
+ *
+ * 只支持业务里用到的那一小部分 SQL：
+ *   CREATE TABLE (识别 AUTO_INCREMENT / UNIQUE / PRIMARY KEY)、INSERT ... VALUES (...), (...)、
+ *   SELECT 列|*|COUNT(*) FROM t [WHERE a = ? AND ...] [LIMIT n]、SELECT 1、
+ *   UPDATE t SET a = ? [WHERE ...]、DELETE FROM t [WHERE ...]；USE / SET / ALTER 语句直接忽略。
+ * 所有值按字符串存储和比较。解析过的语句按 SQL 文本缓存，热路径上不重复解析。
+ * 多个连接共享同一个实例，内部用一把锁保护。
+ */
+class MockDatabase 
+{
+public:
+    MockDatabase();
+    ~MockDatabase();
+
+    // 执行 init.sql 风格的种子脚本 (多条语句用 ; 分隔，-- 注释)，种子里的 SELECT 被忽略
+    void loadSeed(const std::string& script);
+    void loadSeedFile(const std::string& path);
+
+    std::unique_ptr<DbResult> executeQuery(const std::string& sql,
+                                           const std::vector<std::string>& params);
+    int executeUpdate(const std::string& sql,
+                      const std::vector<std::string>& params);
+
+    size_t tableRows(const std::string& table) const;
+
+private:
+    std::shared_ptr<const MockStatement> prepare(const std::string& sql);
+    std::unique_ptr<DbResult> runQuery(const MockStatement& stmt, const std::vector<std::string>& params);
+    int runUpdate(const MockStatement& stmt, const std::vector<std::string>& params);
+    MockTable& table(const std::string& name);
+
+private:
+    mutable std::mutex                                                  mutex_;
+    std::map<std::string, std::unique_ptr<MockTable>>                   tables_;
+    std::unordered_map<std::string, std::shared_ptr<const MockStatement>> statements_;
+};
+
+/**
+ * @brief 内存数据库后端：压测时不依赖 MySQL，只测服务端本身的开销
+ *
+ * 可以注入延迟来模拟网络往返和查询耗时：每次执行先睡 latencyUs + [0, jitterUs) 微秒。
+ * 注入的延迟超过语句的超时时间时，睡到超时为止然后抛 DbTimeoutException (和 MySQL 的
+ * MAX_EXECUTION_TIME 中断查询一样)。
+ */
+class MockBackend : public DbBackend 
+{
+public:
+    struct Options
+    {
+        int latencyUs = 0; // 每次查询固定延迟
+        int jitterUs = 0;  // 额外的随机延迟上限
+    };
+
+    MockBackend(std::shared_ptr<MockDatabase> database, const Options& options);
+
+    std::unique_ptr<DbResult> executeQuery(const std::string& sql,
+                                           const std::vector<std::string>& params,
+                                           int timeoutMs) override;
+    int executeUpdate(const std::string& sql,
+                      const std::vector<std::string>& params,
+                      int timeoutMs) override;
+
+    bool ping() override { return true; }
+    void reconnect() override {}
+    void cleanup() override {}
+
+private:
+    void injectLatency(int timeoutMs);
+
+private:
+    std::shared_ptr<MockDatabase> database_;
+    Options                       options_;
+};
+
+} // namespace db
+} // namespace http
@@ -0,0 +1,58 @@
+#pragma once
+#include <memory>
+#include <string>
+#include "DbBackend.h"
+
+namespace sql 
+{
+class Connection;
+}
+
+namespace http 
+{
+namespace db 
+{
+
+/**
+ * @brief 基于 MySQL Connector/C++ 的后端
+ *
+ * 语句超时：SELECT 加上 MAX_EXECUTION_TIME 优化器提示，由服务端中断超时的查询 (MySQL 5.7.8+)；
+ * libmysqlclient 的读写超时在建连时固定，不能按语句调整，所以只作为连接级的兜底 (kNetTimeoutSeconds)。
+ */
+class MySqlBackend : public DbBackend 
+{
+public:
+    MySqlBackend(const std::string& host, 
+                 const std::string& user,
+                 const std::string& password,
+                 const std::string& database);
+    ~MySqlBackend() override;
+
+    std::unique_ptr<DbResult> executeQuery(const std::string& sql,
+                                           const std::vector<std::string>& params,
+                                           int timeoutMs) override;
+    int executeUpdate(const std::string& sql,
+                      const std::vector<std::string>& params,
+                      int timeoutMs) override;
+
+    bool ping() override;
+    void reconnect() override;
+    void cleanup() override;
+
+    // 网络读写超时 (秒)：单条语句的超时由截止时间决定，这里只防止连接永远卡住
+    static const int kNetTimeoutSeconds = 30;
+
+private:
+    // 建立新连接 (带连接/读写超时)
+    void connect();
+
+private:
+    std::shared_ptr<sql::Connection> conn_;
+    std::string                      host_;
+    std::string                      user_;
+    std::string                      password_;
+    std::string                      database_;
+};
+
+} // namespace db
+} // namespace http
@@ -0,0 +1,155 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <stdint.h>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "DbResult.h"
+
+namespace http
+{
+namespace db
+{
+
+/**
+ * @brief 查询结果缓存：读多写少的查询在多个请求之间共享结果，不用每个 Controller 自己写缓存
+ *
+ * 键是 SQL 文本 + 绑定的参数，值是后端已经解码好的 DbRows (不可变，命中时 DbResult 直接引用，不拷贝)。
+ * 每条缓存有自己的 TTL，还有一个依赖表集合 (从 SQL 的 FROM / JOIN 里解析出来)：
+ * DbConnection::executeUpdate 成功后按语句写到的表 (INSERT INTO / UPDATE / DELETE FROM / REPLACE INTO /
+ * TRUNCATE / ALTER / DROP) 把依赖这张表的缓存全部删掉，认不出写的是哪张表时清空整个缓存。
+ *
+ * 查询执行期间表被改了的话，这次的结果不写缓存 (按表记录最近一次失效的序号，开始查询前取一个快照)，
+ * 不会出现失效之后又写进一份旧数据的情况。
+ *
+ * 显式事务 (BEGIN / START TRANSACTION ... COMMIT) 里的写在执行时失效一次，提交或回滚时再失效一次：
+ * 提交之前别的连接读到的还是旧数据，这段时间写进缓存的结果要在提交时清掉。
+ * SET autocommit = 0 开的隐式事务认不出来，这种用法不要开查询缓存。
+ *
+ * 条数满了淘汰最久没用过的一条 (LRU)，不扫描整个表。
+ *
+ * 失效只在本进程内生效，其他实例 (或者直接改库) 的写入只能靠 TTL 兜底；
+ * 事务里的读不要走缓存 (看不到本事务未提交的写)。
+ */
+class QueryCache
+{
+public:
+    using Rows = std::shared_ptr<const DbRows>;
+    using Tables = std::shared_ptr<const std::vector<std::string>>;
+
+    struct Options
+    {
+        size_t maxEntries = 10000; // 缓存条数上限
+        size_t maxRows = 1000;     // 超过这么多行的结果不缓存
+    };
+
+    // 拼缓存键：接口和 DbConnection 绑定参数用的一样 (setString)，可以直接交给 bindParams
+    class Key
+    {
+    public:
+        explicit Key(const std::string& sql) : text_(sql) {}
+
+        void setString(int index, const std::string& value);
+        const std::string& text() const { return text_; }
+
+    private:
+        std::string text_;
+    };
+
+    // 一次未命中的查询：开始前记下依赖表和失效序号，写缓存时据此判断期间有没有写入
+    struct Ticket
+    {
+        Tables   tables;
+        uint64_t epoch = 0;
+    };
+
+    explicit QueryCache(const Options& options);
+
+    QueryCache(const QueryCache&) = delete;
+    QueryCache& operator=(const QueryCache&) = delete;
+
+    // 命中且没过期返回结果，否则返回空
+    Rows lookup(const std::string& key);
+
+    // 查询开始前调用
+    Ticket begin(const std::string& sql);
+
+    // 查询完成后调用，期间依赖表被改过、结果太大时不缓存
+    void store(const std::string& key, const Ticket& ticket, const Rows& rows, int ttlMs);
+
+    // 写语句执行成功后调用
+    void invalidateWrites(const std::string& sql);
+    void invalidateTable(const std::string& table);
+    void clear();
+
+    // 事务控制语句：BEGIN / START TRANSACTION 开始，COMMIT / ROLLBACK 结束 (ROLLBACK TO SAVEPOINT 不算)
+    enum TransactionStatement
+    {
+        kNotTransaction,
+        kTransactionBegin,
+        kTransactionEnd,
+    };
+    static TransactionStatement transactionStatement(const std::string& sql);
+
+    // SQL 里读到的表 / 写到的表 (小写，去掉反引号和库名前缀)，解析不出写的表时 ok 为 false
+    static std::vector<std::string> tablesRead(const std::string& sql);
+    static std::vector<std::string> tablesWritten(const std::string& sql, bool* ok);
+
+    uint64_t hits() const { return hits_.load(std::memory_order_relaxed); }
+    uint64_t misses() const { return misses_.load(std::memory_order_relaxed); }
+    uint64_t invalidations() const { return invalidations_.load(std::memory_order_relaxed); }
+    size_t size() const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Entry
+    {
+        Rows                             rows;
+        Tables                           tables;
+        Clock::time_point                expires;
+        std::list<std::string>::iterator lruPos;
+    };
+
+    // 写语句的解析结果
+    struct Writes
+    {
+        std::vector<std::string> tables;
+        bool                     ok;
+    };
+
+    // 以下函数调用方持有 mutex_
+    Tables readTables(const std::string& sql);
+    Writes writeTables(const std::string& sql);
+    void erase(std::unordered_map<std::string, Entry>::iterator it);
+    void invalidateLocked(const std::string& table);
+    void clearLocked();
+    void makeRoom();
+
+private:
+    Options options_;
+
+    mutable std::mutex                                               mutex_;
+    std::unordered_map<std::string, Entry>                           entries_;
+    std::list<std::string>                                           lru_;         // 缓存键，最近用过的在前
+    std::unordered_map<std::string, std::unordered_set<std::string>> byTable_;     // 表 -> 依赖它的缓存键
+    std::unordered_map<std::string, uint64_t>                        invalidated_; // 表 -> 最近一次失效的序号
+    uint64_t                                                         epoch_;       // 每次失效加一
+    uint64_t                                                         clearedAt_;   // 最近一次清空的序号
+
+    // 语句 -> 解析出的表，同一条 SQL 只解析一次 (语句模板的数量有限，超过上限就不再记)
+    std::unordered_map<std::string, Tables> reads_;
+    std::unordered_map<std::string, Writes> writes_;
+
+    std::atomic<uint64_t> hits_;
+    std::atomic<uint64_t> misses_;
+    std::atomic<uint64_t> invalidations_;
+};
+
+} // namespace db
+} // namespace http
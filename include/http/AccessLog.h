@@ -0,0 +1,60 @@
+#pragma once
+
+#include <muduo/base/AsyncLogging.h>
+#include <muduo/base/noncopyable.h>
+
+#include <atomic>
+#include <string>
+
+#include "HttpRequest.h"
+
+namespace http
+{
+
+/**
+ * @brief 访问日志：每个请求一行紧凑记录，写入 muduo AsyncLogging 的双缓冲
+ *
+ * I/O 线程里只做一次 snprintf 和一次 append (内存拷贝)，落盘由后台线程完成，
+ * 文件按大小滚动。支持 1/N 采样和每秒条数上限，5xx 默认不参与采样。
+ * 路径里的控制字符、空格和非 ASCII 字节按 \xHH 转义，客户端不能借路径伪造日志行。
+ */
+class AccessLog : muduo::noncopyable
+{
+public:
+    struct Options
+    {
+        std::string basename = "access";          // 文件名前缀，AsyncLogging 会追加时间/主机名/pid
+        off_t       rollSize = 100 * 1024 * 1024; // 单个文件超过这个大小就滚动
+        int         flushInterval = 3;            // 后台线程刷盘间隔 (秒)
+        int         sampleEvery = 1;              // 每 N 条请求记一条，1 表示全记
+        int         maxPerSecond = 0;             // 每秒最多记多少条，0 表示不限
+        bool        alwaysLogErrors = true;       // 5xx 不受采样影响 (仍受每秒上限约束)
+    };
+
+    explicit AccessLog(const Options& options);
+    ~AccessLog();
+
+    void start();
+    void stop();
+
+    // 记录一条访问日志 (在 I/O 线程调用)
+    void log(const HttpRequest& req, int status, int64_t latencyUs,
+             size_t requestBytes, size_t responseBytes);
+
+    uint64_t written() const { return written_.load(std::memory_order_relaxed); }
+    uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+private:
+    bool shouldLog(int status, int64_t nowSecond);
+
+private:
+    Options               options_;
+    muduo::AsyncLogging   asyncLog_;
+    std::atomic<int64_t>  windowSecond_; // 限速窗口：当前是哪一秒
+    std::atomic<int>      windowCount_;  // 这一秒已经记了多少条
+    std::atomic<uint64_t> written_;
+    std::atomic<uint64_t> dropped_;      // 被采样或限速丢掉的条数
+    bool                  running_;
+};
+
+} // namespace http
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <muduo/base/noncopyable.h>
+
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <stdint.h>
+#include <string>
+
+namespace http
+{
+
+/**
+ * @brief 自适应并发限制：挡在业务回调前面，同时在处理的请求数超过上限就直接回 503
+ *
+ * 上限按测得的处理延迟自动调整 (gradient 算法)：
+ *   gradient = clamp(tolerance * 基线延迟 / 最近一个窗口的平均延迟, 0.5, 1)
+ *   newLimit = limit * gradient + sqrt(limit)
+ * 基线是各窗口平均延迟的最小值 (无排队时的延迟)，每个窗口上浮 baselineDrift，
+ * 业务本身变慢 (而不是排队) 时基线能慢慢跟上。
+ * 延迟没变差时 gradient 为 1，上限每个窗口多 sqrt(limit)；数据库变慢、延迟上涨时按比例收缩。
+ * 窗口里出现过载信号 (业务回了 503/504，比如等数据库连接超时) 时按 backoffRatio 乘性减小 (AIMD)。
+ * 窗口里的并发连上限的一半都没到时不再增长，避免低负载下上限虚高。
+ *
+ * 每个路由可以设置优先级：kHigh 永远放行 (指标、健康检查这类便宜的接口)，
+ * kNormal 受上限约束，kLow 只能用上限的 lowPriorityShare (贵的接口先被挡掉)。
+ *
+ * tryAcquire/release 在各个 I/O 线程里调用，快路径只有原子操作；
+ * 调整上限每个窗口做一次，由碰上窗口结束的那个线程 try_lock 后完成。
+ */
+class ConcurrencyLimiter : muduo::noncopyable
+{
+public:
+    enum Priority
+    {
+        kHigh,
+        kNormal,
+        kLow,
+    };
+
+    struct Options
+    {
+        int     initialLimit = 20;
+        int     minLimit = 2;
+        int     maxLimit = 200;
+        double  lowPriorityShare = 0.5; // kLow 请求能用到的上限比例
+        double  tolerance = 1.5;        // 最近延迟是基线的几倍以内不收缩
+        double  baselineDrift = 0.01;   // 基线每个窗口上浮的比例
+        double  smoothing = 0.2;        // 新上限的权重
+        double  backoffRatio = 0.9;     // 出现过载信号时的乘性减小系数
+        int64_t windowUs = 100 * 1000;  // 调整周期
+        int     minWindowSamples = 10;  // 一个窗口至少这么多样本才调整
+        int     retryAfterSeconds = 1;  // 被挡掉的请求建议的重试间隔
+    };
+
+    explicit ConcurrencyLimiter(const Options& options);
+
+    // 设置路由的优先级 (在 start 之前调用)，没设置的路由是 kNormal
+    void setRoutePriority(const std::string& path, Priority priority)
+    {
+        priorities_[path] = priority;
+    }
+
+    Priority priority(const std::string& path) const;
+
+    // 成功返回 true，之后必须调用 release；返回 false 表示应该回 503
+    bool tryAcquire(Priority priority);
+
+    // 请求处理完：latencyUs 为业务回调耗时，overloaded 表示业务报告了过载 (503/504)
+    void release(int64_t latencyUs, bool overloaded);
+
+    int limit() const { return limit_.load(std::memory_order_relaxed); }
+    int inFlight() const { return inFlight_.load(std::memory_order_relaxed); }
+    uint64_t rejected() const { return rejected_.load(std::memory_order_relaxed); }
+    int retryAfterSeconds() const { return options_.retryAfterSeconds; }
+
+private:
+    void update(int64_t nowUs);
+
+private:
+    Options                         options_;
+    std::map<std::string, Priority> priorities_;
+
+    std::atomic<int>      limit_;
+    std::atomic<int>      inFlight_;
+    std::atomic<uint64_t> rejected_;
+
+    // 当前窗口的样本
+    std::atomic<int64_t>  windowStartUs_;
+    std::atomic<int64_t>  windowLatencyUs_;
+    std::atomic<int>      windowSamples_;
+    std::atomic<int>      windowOverloads_;
+    std::atomic<int>      windowMaxInFlight_;
+
+    // 以下只在持有 mutex_ 时访问
+    std::mutex mutex_;
+    double     estimatedLimit_;
+    double     baselineLatencyUs_; // 基线延迟，0 表示还没有样本
+};
+
+} // namespace http
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <muduo/base/noncopyable.h>
+#include <muduo/net/Buffer.h>
+
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "HttpRequest.h"
+#include "HttpResponse.h"
+
+namespace http
+{
+
+/**
+ * @brief 服务端统一处理 CORS (跨域)，业务函数不再自己加 Access-Control-* 头
+ *
+ * 预检请求 (OPTIONS + Origin + Access-Control-Request-Method) 不进路由：
+ * 每个策略的预检响应在启动时渲染成固定的字节串 (只有回显的 Origin 是变的)，HTTP/1 直接追加到输出缓冲区，
+ * 响应带 Access-Control-Max-Age，浏览器在这段时间内不会再为同一个接口发预检。
+ * 普通的跨域请求在业务处理完之后补上 Access-Control-Allow-Origin 等头。
+ *
+ * 策略按路由配置，没配置的路由用默认策略；来源不在允许列表里的预检回 403，普通请求不加 CORS 头 (浏览器会拦下)。
+ * 允许带 Cookie (credentials) 的策略必须写明来源列表，配成 "*" 时构造/setRoutePolicy 抛 std::invalid_argument。
+ * setRoutePolicy 只能在 server.start() 之前调用。
+ */
+class CorsFilter : muduo::noncopyable
+{
+public:
+    struct Policy
+    {
+        std::vector<std::string> origins{ "*" };                   // 允许的来源，"*" 表示任意来源
+        std::string              methods = "GET, POST, OPTIONS";
+        std::string              headers = "Content-Type, Authorization";
+        std::string              exposeHeaders = "Retry-After";    // 页面脚本能读到的响应头
+        int                      maxAgeSeconds = 600;              // 浏览器缓存预检结果的时间
+        bool                     credentials = false;              // 允许带 Cookie (此时 origins 不能是 "*")
+    };
+
+    explicit CorsFilter(const Policy& defaultPolicy);
+
+    void setRoutePolicy(const std::string& path, const Policy& policy);
+
+    static bool isPreflight(const HttpRequest& req);
+
+    // 把预检响应 (完整的 HTTP/1.1 报文) 追加到 out，返回状态码 (204 或 403)
+    int appendPreflight(const HttpRequest& req, bool close, muduo::net::Buffer* out) const;
+
+    // 预检响应填到 resp 里 (HTTP/2 走这个)
+    void preflight(const HttpRequest& req, HttpResponse* resp) const;
+
+    // 普通跨域请求：来源允许时补上 CORS 响应头
+    void decorate(const HttpRequest& req, HttpResponse* resp) const;
+
+private:
+    // 启动时算好的策略
+    struct Compiled
+    {
+        Policy                          policy;
+        bool                            anyOrigin;
+        std::unordered_set<std::string> origins;
+        std::string                     allowOrigin;    // 任意来源时的固定值 "*"，为空表示按列表回显来源
+        std::string                     preflightHead;  // 状态行 + "Access-Control-Allow-Origin: "
+        std::string                     preflightTail;  // 来源之后的所有头 (不含 Connection)
+    };
+
+    static Compiled compile(const Policy& policy);
+    const Compiled& policyFor(const std::string& path) const;
+    // 来源允许时返回 Access-Control-Allow-Origin 的值，不允许返回 nullptr
+    const std::string* allowedOrigin(const Compiled& compiled, const std::string& origin) const;
+
+private:
+    Compiled                                  default_;
+    std::unordered_map<std::string, Compiled> routes_;
+};
+
+} // namespace http
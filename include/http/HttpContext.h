@@ -1,6 +1,9 @@
 #pragma once
 
+#include <deque>
 #include <iostream>
+#include <memory>
+#include <stdint.h>
 
 #include <muduo/net/TcpServer.h>
 
@@ -9,6 +12,21 @@
 namespace http
 {
 
+namespace http2
+{
+class Http2Connection;
+}
+
+namespace websocket
+{
+class WebSocketConnection;
+}
+
+namespace tls
+{
+class TlsConnection;
+}
+
 class HttpContext 
 {
 public:
@@ -22,30 +40,125 @@ public:
     
     HttpContext()
     : state_(kExpectRequestLine)
+    , request_(nullptr)
+    , readPaused_(false)
+    , responsePending_(false)
+    , accountedOutputBytes_(0)
+    , requestBytes_(0)
+    , inputReceived_(0)
+    , inputBuffered_(0)
     {}
 
-    bool parseRequest(muduo::net::Buffer* buf, muduo::Timestamp receiveTime);
+    // HttpContext 存在 boost::any 里要可拷贝：只拷贝连接状态，借来的请求对象不跟着拷贝
+    // (setContext 时拷贝的是还没开始解析的空上下文)
+    HttpContext(const HttpContext& that);
+    HttpContext& operator=(const HttpContext& that);
+    ~HttpContext();
+
+    // stopAfterHeaders 为 true 时请求头收齐就返回，请求体留在 buf 里 (先做限流这类检查再决定读不读)
+    bool parseRequest(muduo::net::Buffer* buf, muduo::Timestamp receiveTime, bool stopAfterHeaders = false);
     bool gotAll() const 
     { return state_ == kGotAll;  }
 
+    bool headersComplete() const
+    { return state_ == kExpectBody || state_ == kGotAll; }
+
     void reset()
     {
         state_ = kExpectRequestLine;
-        HttpRequest dummyData;
-        request_.swap(dummyData);
+        requestBytes_ = 0;
+        // 请求对象清空后还回本线程的池，空闲连接不占着它；
+        // 下一个请求借到的通常还是同一个对象，字段的内存照样复用
+        releaseRequest();
     }
 
-    const HttpRequest& request() const
-    { return request_;}
+    // 请求对象只在请求解析/处理期间从本线程的池里借用，空闲时为空 (const 版本返回一个空请求)
+    const HttpRequest& request() const;
+    HttpRequest& request();
+
+    // 当前请求已经从缓冲区消费的原始字节数 (请求行 + 头 + 体)
+    size_t requestBytes() const
+    { return requestBytes_; }
+
+    void addRequestBytes(size_t n)
+    { requestBytes_ += n; }
+
+    // 输出背压状态：属于连接而不是单个请求，reset() 不清空
+    bool readPaused() const
+    { return readPaused_; }
+
+    void setReadPaused(bool on)
+    { readPaused_ = on; }
+
+    // 业务推迟了响应 (HttpResponse::defer)：发出之前不处理连接上后面的请求，reset() 不清空
+    bool responsePending() const
+    { return responsePending_; }
 
-    HttpRequest& request()
-    { return request_;}
+    void setResponsePending(bool on)
+    { responsePending_ = on; }
+
+    /**
+     * @brief 输入缓冲区里还没消费的数据是什么时候收到的
+     * processInput 开始时调用 noteInput (readable 为缓冲区当前的字节数，比上次结束时多出来的就是这次读到的)，
+     * 结束时调用 noteInputLeft；inputArrival 返回第一个还没消费的字节所在的那次 onMessage 的时间，
+     * 暂停或等推迟的响应期间在缓冲区里排队的请求，截止时间从这里算，而不是从恢复处理的时刻算
+     */
+    void noteInput(size_t readable, muduo::Timestamp receiveTime);
+    void noteInputLeft(size_t readable);
+    muduo::Timestamp inputArrival(size_t readable);
+
+    // 已计入全局输出预算的字节数（即上次统计时该连接 outputBuffer 里积压的数据）
+    size_t accountedOutputBytes() const
+    { return accountedOutputBytes_; }
+
+    void setAccountedOutputBytes(size_t n)
+    { accountedOutputBytes_ = n; }
+
+    // 连接切换到 HTTP/2 之后的协议状态，为空表示还是 HTTP/1.x；reset() 不清空
+    // (HttpContext 存在 boost::any 里要可拷贝，所以用 shared_ptr)
+    const std::shared_ptr<http2::Http2Connection>& http2() const
+    { return http2_; }
+
+    void setHttp2(const std::shared_ptr<http2::Http2Connection>& connection)
+    { http2_ = connection; }
+
+    // 握手完成后的 WebSocket 连接，为空表示不是 WebSocket；reset() 不清空
+    const std::shared_ptr<websocket::WebSocketConnection>& webSocket() const
+    { return webSocket_; }
+
+    void setWebSocket(const std::shared_ptr<websocket::WebSocketConnection>& connection)
+    { webSocket_ = connection; }
+
+    // TLS 连接的加解密状态，为空表示明文连接
+    const std::shared_ptr<tls::TlsConnection>& tls() const
+    { return tls_; }
+
+    void setTls(const std::shared_ptr<tls::TlsConnection>& connection)
+    { tls_ = connection; }
 
 private:
+    // 一次读到的数据：到这次为止累计收到的字节数 + 收到的时间
+    struct Arrival
+    {
+        uint64_t         end;
+        muduo::Timestamp time;
+    };
+
     bool processRequestLine(const char* begin, const char* end);
+    void releaseRequest();
 private:
     HttpRequestParseState state_;
-    HttpRequest           request_;
+    HttpRequest*          request_; // 借自本线程的请求池，空闲时为 nullptr
+    bool                  readPaused_; // 是否因为输出积压而暂停读取/分发
+    bool                  responsePending_; // 是否在等推迟的响应
+    size_t                accountedOutputBytes_;
+    size_t                requestBytes_;
+    uint64_t              inputReceived_; // 累计收到的输入字节数
+    size_t                inputBuffered_; // 上次处理结束时缓冲区里剩下的字节数
+    std::deque<Arrival>   arrivals_;      // 还有字节没消费的那几次读取，按时间排序
+    std::shared_ptr<http2::Http2Connection> http2_;
+    std::shared_ptr<websocket::WebSocketConnection> webSocket_;
+    std::shared_ptr<tls::TlsConnection> tls_;
 };
 
 } // namespace http
\ No newline at end of file
@@ -1,14 +1,59 @@
 #pragma once
 
-#include <map>
+#include <chrono>
 #include <string>
-#include <unordered_map>
+#include <utility>
+#include <vector>
 
 #include <muduo/base/Timestamp.h>
+#include <muduo/net/InetAddress.h>
 
 namespace http
 {
 
+/**
+ * @brief 请求头、查询参数、路径参数用的扁平键值表
+ *
+ * 按插入顺序存在 vector 里，查找是线性扫描 (一个请求通常只有十几个头，比树/哈希表快)。
+ * clear() 只把长度归零，槽位里的 string 保留各自的容量，下一个请求原地覆盖写入；
+ * 连接上的请求对象复用起来之后，稳态下解析请求不再分配内存。
+ * 同名字段后写的覆盖先写的 (和原来的 map 语义一致)。
+ */
+class FieldList
+{
+public:
+    typedef std::pair<std::string, std::string> Field;
+    typedef std::vector<Field>::const_iterator const_iterator;
+
+    FieldList() : size_(0) {}
+
+    const_iterator begin() const { return fields_.begin(); }
+    const_iterator end() const { return fields_.begin() + size_; }
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+
+    void clear() { size_ = 0; }
+
+    void set(const char* name, size_t nameLen, const char* value, size_t valueLen);
+    void set(const std::string& name, const std::string& value)
+    { set(name.data(), name.size(), value.data(), value.size()); }
+
+    // 没有这个字段返回 nullptr
+    const std::string* find(const char* name, size_t nameLen) const;
+    const std::string* find(const std::string& name) const
+    { return find(name.data(), name.size()); }
+
+    void swap(FieldList& that)
+    {
+        fields_.swap(that.fields_);
+        std::swap(size_, that.size_);
+    }
+
+private:
+    std::vector<Field> fields_; // [0, size_) 是有效字段，后面是留着复用的空槽
+    size_t             size_;
+};
+
 class HttpRequest
 {
 public:
@@ -20,38 +65,54 @@ public:
     HttpRequest()
         : method_(kInvalid)
         , version_("Unknown")
+        , deadline_(Deadline::max())
     {
     }
     
+    // 清空成一个新请求，但保留各字段已分配的内存，供同一连接上的下一个请求复用
+    void clear();
+
     void setReceiveTime(muduo::Timestamp t);
     muduo::Timestamp receiveTime() const { return receiveTime_; }
+
+    // 客户端地址 (TCP 连接的对端)，由 HttpServer 在分发前设置，业务按它做限流、审计
+    void setPeerAddress(const muduo::net::InetAddress& peer) { peerAddress_ = peer; }
+    const muduo::net::InetAddress& peerAddress() const { return peerAddress_; }
     
     bool setMethod(const char* start, const char* end);
     Method method() const { return method_; }
+    const char* methodString() const;
 
     void setPath(const char* start, const char* end);
-    std::string path() const { return path_; }
+    const std::string& path() const { return path_; }
 
     void setPathParameters(const std::string &key, const std::string &value);
-    std::string getPathParameters(const std::string &key) const;
+    const std::string& getPathParameters(const std::string &key) const;
 
     void setQueryParameters(const char* start, const char* end);
-    std::string getQueryParameters(const std::string &key) const;
+    const std::string& getQueryParameters(const std::string &key) const;
+    // 原始查询串 (? 后面的部分，不含 ?)，抓包回放时按原样还原 URL
+    const std::string& query() const { return query_; }
+    const FieldList& queryParameters() const
+    { return queryParameters_; }
     
-    void setVersion(std::string v)
+    void setVersion(const char* v)
     {
         version_ = v;
     }
 
-    std::string getVersion() const
+    const std::string& getVersion() const
     {
         return version_;
     }
     
     void addHeader(const char* start, const char* colon, const char* end);
-    std::string getHeader(const std::string& field) const;
+    void addHeader(const std::string& field, const std::string& value)
+    { headers_.set(field, value); }
+    // 没有这个头返回空串
+    const std::string& getHeader(const std::string& field) const;
 
-    const std::map<std::string, std::string>& headers() const
+    const FieldList& headers() const
     { return headers_; }
 
     void setBody(const std::string& body) { content_ = body; }
@@ -63,7 +124,7 @@ public:
         }
     }
     
-    std::string getBody() const
+    const std::string& getBody() const
     { return content_; }
 
     void setContentLength(uint64_t length)
@@ -72,18 +133,40 @@ public:
     uint64_t contentLength() const
     { return contentLength_; }
 
+    /**
+     * @brief 请求的截止时间，由 HttpServer 在分发前按路由配置和 X-Request-Timeout 头设置
+     * 业务把它传给 DbConnectionPool::getConnection()，等连接和查询都不会超过它；
+     * 没有截止时间时是 time_point::max()
+     */
+    using Deadline = std::chrono::steady_clock::time_point;
+
+    void setDeadline(Deadline deadline)
+    { deadline_ = deadline; }
+
+    Deadline deadline() const
+    { return deadline_; }
+
+    bool hasDeadline() const
+    { return deadline_ != Deadline::max(); }
+
+    bool deadlineExceeded() const
+    { return hasDeadline() && std::chrono::steady_clock::now() >= deadline_; }
+
     void swap(HttpRequest& that);
 
 private:
-    Method                                       method_; // 请求方法
-    std::string                                  version_; // http版本
-    std::string                                  path_; // 请求路径
-    std::unordered_map<std::string, std::string> pathParameters_; // 路径参数
-    std::unordered_map<std::string, std::string> queryParameters_; // 查询参数
-    muduo::Timestamp                             receiveTime_; // 接收时间
-    std::map<std::string, std::string>           headers_; // 请求头
-    std::string                                  content_; // 请求体
-    uint64_t                                     contentLength_ { 0 }; // 请求体长度
+    Method           method_; // 请求方法
+    std::string      version_; // http版本
+    std::string      path_; // 请求路径
+    FieldList        pathParameters_; // 路径参数
+    std::string      query_; // 原始查询串
+    FieldList        queryParameters_; // 查询参数
+    muduo::Timestamp receiveTime_; // 接收时间
+    muduo::net::InetAddress peerAddress_; // 客户端地址
+    FieldList        headers_; // 请求头
+    std::string      content_; // 请求体
+    uint64_t         contentLength_ { 0 }; // 请求体长度
+    Deadline         deadline_; // 截止时间
 };  
 
 } // namespace http
\ No newline at end of file
@@ -2,9 +2,14 @@
 
 #include <muduo/net/TcpServer.h>
 
+#include <functional>
+#include <memory>
+
 namespace http
 {
 
+class HttpRequest;
+
 class HttpResponse 
 {
 public:
@@ -19,7 +24,11 @@ public:
         k403Forbidden = 403,
         k404NotFound = 404,
         k409Conflict = 409,
+        k413PayloadTooLarge = 413,
+        k429TooManyRequests = 429,
         k500InternalServerError = 500,
+        k503ServiceUnavailable = 503,
+        k504GatewayTimeout = 504,
     };
 
     HttpResponse(bool close = true)
@@ -38,6 +47,9 @@ public:
     void setStatusMessage(const std::string message)
     { statusMessage_ = message; }
 
+    const std::string& getStatusMessage() const
+    { return statusMessage_; }
+
     void setCloseConnection(bool on)
     { closeConnection_ = on; }
 
@@ -52,13 +64,24 @@ public:
 
     void addHeader(const std::string& key, const std::string& value)
     { headers_[key] = value; }   //设置一个键值对
+
+    const std::map<std::string, std::string>& headers() const
+    { return headers_; }
     
     void setBody(const std::string& body)
     { 
         body_ = body;
+        sharedBody_.reset();
         // body_ += "\0";
     }
 
+    // 共享的只读响应体 (缓存里的响应)：多个响应引用同一块内存，不再拷贝进 body_
+    void setSharedBody(const std::shared_ptr<const std::string>& body)
+    { sharedBody_ = body; }
+
+    const std::string& body() const
+    { return sharedBody_ ? *sharedBody_ : body_; }
+
     void setStatusLine(const std::string& version,
                          HttpStatusCode statusCode,
                          const std::string& statusMessage);
@@ -66,14 +89,41 @@ public:
     void setErrorHeader(){}
 
     void appendToBuffer(muduo::net::Buffer* outputBuf) const;
+
+    // ---------------- 异步响应 ----------------
+    // 在 I/O 线程里把结果填进还没发出的响应
+    using Fill = std::function<void (HttpResponse*)>;
+    // defer() 返回的完成函数：任何线程都可以调用 (只调用一次)，fill 会被投递回请求所在的 I/O 线程执行
+    using Completion = std::function<void (const Fill& fill)>;
+    // 服务器用：响应填好之后依次执行的收尾步骤 (中间件的 after 钩子、CORS 头、发送)
+    using Step = std::function<void (const HttpRequest&, HttpResponse*)>;
+
+    /**
+     * @brief 推迟响应：业务回调里结果还没出来 (比如要交给别的线程池算) 时调用，只能在 I/O 线程里调用
+     * 回调返回后服务器先不发这个响应，等返回的 Completion 被调用时在 I/O 线程里填好再发出；
+     * 回调返回前已经设置的头会保留。同一个 HTTP/1 连接上后面的请求等这个响应发出后再处理。
+     * 拿到的 Completion 必须调用一次，否则这个请求一直没有响应
+     */
+    Completion defer();
+    bool deferred() const { return deferred_ != nullptr; }
+
+    // 服务器用：业务推迟了响应时，每一层把自己剩下的处理登记成收尾步骤
+    void addCompletionStep(Step step);
+    // 服务器用：最外层登记完以后调用，把请求和响应交给异步状态保管 (之后这个对象不再是推迟状态)
+    void detach(const HttpRequest& req);
+
 private:
+    struct Deferred;
+
     std::string                        httpVersion_;    
     HttpStatusCode                     statusCode_;   //状态码
     std::string                        statusMessage_;
     bool                               closeConnection_;  //决定发完这一单是挂电话（Short Connection）还是保持通话（Keep-Alive）
     std::map<std::string, std::string> headers_;   //存放头信息
     std::string                        body_;     //存放具体的网页内容或 JSON 数据
+    std::shared_ptr<const std::string> sharedBody_; //设置了就代替 body_
     bool                               isFile_;
+    std::shared_ptr<Deferred>          deferred_;     //defer() 之后不为空
 };
 
 } // namespace http
\ No newline at end of file
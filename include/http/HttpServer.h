@@ -2,11 +2,16 @@
 
 #include <muduo/net/TcpServer.h>
 #include <muduo/net/EventLoop.h>
+#include <muduo/net/EventLoopThread.h>
 #include <muduo/base/Logging.h>
 #include <muduo/net/InetAddress.h>
 
+#include <atomic>
+#include <map>
+#include <memory>
 #include <string>
 #include <functional>
+#include <vector>
 
 // 只需要引用这两个，不需要 Router 那些
 #include "HttpRequest.h"
@@ -15,11 +20,48 @@
 namespace http
 {
 
+class AccessLog;
+class ConcurrencyLimiter;
+class CorsFilter;
+class HttpContext;
+class MiddlewareChain;
+class RateLimiter;
+class TrafficCapture;
+
+namespace websocket
+{
+struct WebSocketHandler;
+}
+
+namespace tls
+{
+class TlsContext;
+}
+
 class HttpServer : muduo::noncopyable
 {
 public:
     // 定义回调函数类型：当收到完整的 HTTP 请求时调用
     using HttpCallback = std::function<void (const HttpRequest&, HttpResponse*)>;
+    // 判断路径是不是注册过的路由 (对应 Router::hasRoute)
+    using RouteMatcher = std::function<bool (const std::string& path)>;
+
+    // 输出背压的运行时统计 (快照)
+    struct BackpressureStats
+    {
+        size_t   pendingOutputBytes;   // 所有连接 outputBuffer 中积压的字节数
+        int      pausedConnections;    // 当前因积压而暂停读取的连接数
+        uint64_t highWaterMarkEvents;  // 单连接超过高水位的次数
+        uint64_t budgetExceededEvents; // 因全局预算超限而暂停的次数
+    };
+
+    // HTTP/2 (h2c) 的运行时统计 (快照)
+    struct Http2Stats
+    {
+        int      activeConnections; // 当前已切换到 HTTP/2 的连接数
+        uint64_t totalConnections;  // 累计 (prior knowledge + Upgrade)
+        uint64_t totalStreams;      // 累计处理的请求 stream 数
+    };
     
     // 构造函数
     HttpServer(muduo::net::EventLoop* loop,
@@ -36,12 +78,175 @@ public:
         httpCallback_ = cb;
     }
 
+    /**
+     * @brief 设置路由匹配函数，指标的 route 标签只用注册过的路由，其余 (扫描器的随机路径、
+     *        被限流或拒绝的未知路径……) 都记成 unmatched，序列数不会随请求路径无限增长。
+     *        不设置时所有请求都记成 unmatched
+     */
+    void setRouteMatcher(const RouteMatcher& matcher)
+    {
+        routeMatcher_ = matcher;
+    }
+
     // 设置线程数
     void setThreadNum(int numThreads)
     {
         server_.setThreadNum(numThreads);
     }
 
+    /**
+     * @brief SO_REUSEPORT 多 acceptor 模式
+     * @param numListeners 监听者个数 (含 baseLoop 上的那一个)，每个都有独立的 loop，
+     *                     自己 accept 自己做 I/O，由内核在它们之间分配新连接。
+     *                     需要构造时传入 TcpServer::kReusePort，此模式下 setThreadNum 无效
+     * @param cpuSteering  给 reuseport 组挂一个 BPF 程序，按收包 CPU 选择 listener，
+     *                     并把第 i 个 listener 的线程绑到 CPU i 上；listener 个数超过 CPU 个数时按 CPU 个数开
+     */
+    void setReusePortListeners(int numListeners, bool cpuSteering = false)
+    {
+        reusePortListeners_ = numListeners;
+        cpuSteering_ = cpuSteering;
+    }
+
+    // 单个连接 outputBuffer 的高水位：超过后暂停读取和分发该连接的请求，
+    // 直到数据写完 (WriteComplete) 再恢复
+    void setHighWaterMark(size_t bytes)
+    {
+        highWaterMark_ = bytes;
+    }
+
+    // 所有连接积压输出的总预算：超过后，任何还有积压的连接都会被暂停
+    void setOutputBudget(size_t bytes)
+    {
+        outputBudget_ = bytes;
+    }
+
+    BackpressureStats backpressureStats() const;
+
+    // 设置访问日志 (可选)，生命周期由调用方保证长于 HttpServer
+    void setAccessLog(AccessLog* accessLog)
+    {
+        accessLog_ = accessLog;
+    }
+
+    // 设置流量抓取 (可选)，请求在分发给业务之前被记录，生命周期由调用方保证
+    void setTrafficCapture(TrafficCapture* capture)
+    {
+        capture_ = capture;
+    }
+
+    /**
+     * @brief 设置自适应并发限制 (可选)，生命周期由调用方保证
+     * 业务回调之前按路由优先级申请名额，申请不到直接回 503 + Retry-After，不进入业务；
+     * 业务回调的耗时和 503/504 结果反馈给限制器调整上限
+     */
+    void setConcurrencyLimiter(ConcurrencyLimiter* limiter)
+    {
+        limiter_ = limiter;
+    }
+
+    /**
+     * @brief 设置按 (客户端 IP, 路由) 的令牌桶限流 (可选)，生命周期由调用方保证
+     * HTTP/1 请求在请求头收齐、还没读请求体时检查，超限回 429 + Retry-After：
+     * 没有请求体的请求照常 keep-alive，有请求体的不再读它，回完就关闭连接。
+     * HTTP/2 的请求在分发给业务之前检查
+     */
+    void setRateLimiter(RateLimiter* rateLimiter)
+    {
+        rateLimiter_ = rateLimiter;
+    }
+
+    /**
+     * @brief 设置中间件链 (可选)，生命周期由调用方保证
+     * 业务回调 (setHttpCallback) 包在链里执行：before 钩子依次执行、可以短路，之后业务回调，再倒序执行 after；
+     * 链要在 start() 之前组装好，运行时不能再改
+     */
+    void setMiddleware(const MiddlewareChain* middleware)
+    {
+        middleware_ = middleware;
+    }
+
+    /**
+     * @brief 设置 CORS 策略 (可选)，生命周期由调用方保证
+     * 预检请求不进路由和中间件，HTTP/1 直接写出预先渲染好的响应；其他跨域请求处理完后补上 CORS 头
+     */
+    void setCors(const CorsFilter* cors)
+    {
+        cors_ = cors;
+    }
+
+    /**
+     * @brief 是否接受 h2c (明文 HTTP/2)，默认开启
+     * 客户端可以直接发 HTTP/2 连接前言 (prior knowledge)，也可以用 "Upgrade: h2c" 从 HTTP/1.1 升级。
+     * 两种方式下请求都交给同一个 HttpCallback，一个连接上的多个 stream 复用同一条 TCP 连接
+     */
+    void setHttp2Enabled(bool on)
+    {
+        http2Enabled_ = on;
+    }
+
+    Http2Stats http2Stats() const;
+
+    /**
+     * @brief 注册一个 WebSocket 路由 (在 start() 之前调用)
+     * 对这个路径的 "Upgrade: websocket" 请求回 101，之后连接上的帧交给 handler；
+     * 其他路径的升级请求按普通 HTTP 请求处理
+     */
+    void addWebSocketRoute(const std::string& path, const websocket::WebSocketHandler& handler);
+
+    // 单条 WebSocket 消息 (拼接分片后) 的上限，超过以 1009 关闭连接
+    void setWebSocketMaxMessageSize(size_t bytes)
+    {
+        webSocketMaxMessageSize_ = bytes;
+    }
+
+    int webSocketConnections() const
+    {
+        return webSocketConnections_.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief 开启 TLS (可选)，之后所有新连接都先做 TLS 握手，生命周期由调用方保证
+     * 握手在 I/O 线程里随数据到达逐步推进，不阻塞；session 缓存和 ticket 密钥在
+     * TlsContext 里，所有 loop 共享
+     */
+    void setTlsContext(tls::TlsContext* context)
+    {
+        tlsContext_ = context;
+    }
+
+    /**
+     * @brief 大量空闲长连接时的省内存模式，默认关闭
+     * 连接上没有数据在途时，把被大请求、大响应撑大的输入/输出缓冲区 (含 TLS 明文缓冲区)
+     * 缩回初始大小；代价是下一次大请求要重新分配
+     */
+    void setCompactIdleConnections(bool on)
+    {
+        compactIdle_ = on;
+    }
+
+    /**
+     * @brief 请求的超时时间 (毫秒，0 表示不限)，在 start() 之前设置
+     * 请求收齐时按 "路由的超时 (没有就用默认值)" 和客户端 X-Request-Timeout 头 (毫秒) 里较小的那个
+     * 算出截止时间，放在 HttpRequest::deadline() 里交给业务，业务再传给数据库连接池。
+     * 分发前截止时间已经过了 (在连接上排队太久) 的请求不调用业务，直接回 503
+     */
+    void setDefaultRequestTimeout(int timeoutMs)
+    {
+        defaultTimeoutMs_ = timeoutMs;
+    }
+
+    void setRequestTimeout(const std::string& path, int timeoutMs)
+    {
+        routeTimeoutsMs_[path] = timeoutMs;
+    }
+
+    // 因为截止时间已过、没有交给业务处理就回了 503 的请求数
+    uint64_t expiredRequests() const
+    {
+        return expiredRequests_.load(std::memory_order_relaxed);
+    }
+
     // 启动服务器
     void start();
 
@@ -54,12 +259,105 @@ private:
                    muduo::net::Buffer* buf,
                    muduo::Timestamp receiveTime);
                    
+    // 循环解析并分发缓冲区里的请求 (支持 pipelining)，被暂停时停止
+    void processInput(const muduo::net::TcpConnectionPtr& conn,
+                      muduo::net::Buffer* buf,
+                      muduo::Timestamp receiveTime);
+
+    // 发送/关闭：TLS 连接先加密、先发 close_notify
+    void send(const muduo::net::TcpConnectionPtr& conn, HttpContext* context, muduo::net::Buffer* buf);
+    void send(const muduo::net::TcpConnectionPtr& conn, HttpContext* context, const char* message);
+    void shutdown(const muduo::net::TcpConnectionPtr& conn, HttpContext* context);
+
     // 内部处理请求的函数
-    void onRequest(const muduo::net::TcpConnectionPtr&, const HttpRequest&);
+    void onRequest(const muduo::net::TcpConnectionPtr&, HttpRequest&, size_t requestBytes);
+
+    // 限流：超限时回 429，返回 false
+    bool checkRateLimit(const muduo::net::TcpConnectionPtr& conn, HttpContext* context);
+    void setRateLimited(HttpResponse* response, int retryAfterSeconds);
+
+    // 发送 HTTP/1 响应、记录指标，短连接发完就关
+    void sendResponse(const muduo::net::TcpConnectionPtr& conn, HttpContext* context,
+                      const HttpRequest& req, const HttpResponse& response, size_t requestBytes);
+
+    // 业务推迟了响应：填好以后再发，在那之前暂停这个连接上后面的请求
+    void deferResponse(const muduo::net::TcpConnectionPtr& conn, HttpContext* context,
+                       const HttpRequest& req, HttpResponse* response, size_t requestBytes);
+
+    // CORS 预检：预先渲染好的响应直接写到连接上
+    void sendPreflight(const muduo::net::TcpConnectionPtr& conn, HttpContext* context,
+                       const HttpRequest& req, size_t requestBytes);
+
+    // HTTP/1 和 HTTP/2 共用：抓取 + 分发 + 补 CORS 头；记录指标和访问日志
+    void serveRequest(HttpRequest& req, HttpResponse* response);
+    // 截止时间、并发限制检查后调用中间件链和业务回调
+    void dispatchRequest(HttpRequest& req, HttpResponse* response);
+    void applyDeadline(HttpRequest* req) const;
+    void recordRequest(const HttpRequest& req, const HttpResponse& response,
+                       size_t requestBytes, size_t responseBytes);
+
+    // HTTP/2：创建协议状态、处理帧
+    bool startHttp2(const muduo::net::TcpConnectionPtr& conn, HttpContext* context,
+                    HttpRequest* upgradeRequest);
+    void processHttp2(const muduo::net::TcpConnectionPtr& conn, HttpContext* context,
+                      muduo::net::Buffer* buf);
+
+    // WebSocket：握手、处理帧
+    bool startWebSocket(const muduo::net::TcpConnectionPtr& conn, HttpContext* context,
+                        const std::shared_ptr<const websocket::WebSocketHandler>& handler);
+    void processWebSocket(const muduo::net::TcpConnectionPtr& conn, HttpContext* context,
+                          muduo::net::Buffer* buf);
+
+    // 背压相关
+    void onHighWaterMark(const muduo::net::TcpConnectionPtr& conn, size_t len);
+    void onWriteComplete(const muduo::net::TcpConnectionPtr& conn);
+    void updateOutputAccounting(const muduo::net::TcpConnectionPtr& conn, HttpContext* context);
+    void pauseReading(const muduo::net::TcpConnectionPtr& conn, HttpContext* context);
+    void resumeReading(const muduo::net::TcpConnectionPtr& conn, HttpContext* context);
+
+    // 启动 reuseport 模式下额外的 listener+loop
+    void startReusePortListeners();
 
 private:
     muduo::net::TcpServer server_;
-    HttpCallback httpCallback_; // 保存 main.cpp 传进来的 dispatch 函数
+    HttpCallback    httpCallback_; // 保存 main.cpp 传进来的 dispatch 函数
+    RouteMatcher    routeMatcher_;
+    AccessLog*      accessLog_;
+    TrafficCapture* capture_;
+    ConcurrencyLimiter* limiter_;
+    RateLimiter*    rateLimiter_;
+    const MiddlewareChain* middleware_;
+    const CorsFilter* cors_;
+
+    muduo::net::InetAddress                                listenAddr_;
+    muduo::net::TcpServer::Option                          option_;
+    int                                                    reusePortListeners_;
+    bool                                                   cpuSteering_;
+    std::vector<std::unique_ptr<muduo::net::EventLoopThread>> listenerThreads_;
+    std::vector<std::unique_ptr<muduo::net::TcpServer>>       listeners_; // 除 server_ 外的 listener
+
+    size_t                highWaterMark_;
+    size_t                outputBudget_;
+    std::atomic<size_t>   pendingOutputBytes_;
+    std::atomic<int>      pausedConnections_;
+    std::atomic<uint64_t> highWaterMarkEvents_;
+    std::atomic<uint64_t> budgetExceededEvents_;
+
+    bool                  http2Enabled_;
+    std::atomic<int>      http2Connections_;
+    std::atomic<uint64_t> http2TotalConnections_;
+    std::atomic<uint64_t> http2Streams_;
+
+    std::map<std::string, std::shared_ptr<const websocket::WebSocketHandler>> webSocketRoutes_;
+    size_t                webSocketMaxMessageSize_;
+    std::atomic<int>      webSocketConnections_;
+
+    tls::TlsContext*      tlsContext_;
+    bool                  compactIdle_;
+
+    int                        defaultTimeoutMs_;
+    std::map<std::string, int> routeTimeoutsMs_;
+    std::atomic<uint64_t>      expiredRequests_;
 }; 
 
 } // namespace http
\ No newline at end of file
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <muduo/base/noncopyable.h>
+
+#include <atomic>
+#include <functional>
+#include <stdint.h>
+#include <type_traits>
+#include <vector>
+
+#include "HttpRequest.h"
+#include "HttpResponse.h"
+
+namespace http
+{
+
+/**
+ * @brief 中间件的基类：before/after 两个钩子，默认什么都不做
+ *
+ * 子类按需隐藏 (不是重写，没有虚函数) 其中一个或两个：
+ *   bool before(HttpRequest& req, HttpResponse* resp);      // 返回 false 短路：resp 已经填好，后面的中间件和业务都不执行
+ *   void after(const HttpRequest& req, HttpResponse* resp); // 业务处理完 (或被短路) 之后，按和 before 相反的顺序执行
+ * 没有隐藏的钩子在组装链时就被跳过，请求路径上不会调用空函数。
+ */
+struct Middleware
+{
+    bool before(HttpRequest&, HttpResponse*) { return true; }
+    void after(const HttpRequest&, HttpResponse*) {}
+};
+
+/**
+ * @brief 中间件链：启动时组装一次，展开成函数指针数组
+ *
+ * 每个中间件对应一个 Stage (对象指针 + 两个按具体类型实例化的函数指针)，
+ * 请求路径上只是遍历数组做直接调用，没有 std::function 的构造，也没有虚函数。
+ *
+ * 执行顺序 (洋葱模型)：before 按 use() 的顺序，业务回调，after 倒序；
+ * 某个 before 短路时，它和它之前的中间件的 after 仍然执行。
+ * 业务回调或钩子抛出的异常在这里兜住，回 500，不让异常打到 I/O 线程的事件循环上。
+ * 业务推迟了响应 (HttpResponse::defer) 时，after 钩子等响应填好以后在 I/O 线程里执行。
+ */
+class MiddlewareChain : muduo::noncopyable
+{
+public:
+    using Handler = std::function<void (const HttpRequest&, HttpResponse*)>;
+
+    MiddlewareChain() : failures_(0) {}
+
+    // 只能在 server.start() 之前调用；middleware 的生命周期由调用方保证
+    template <typename T>
+    void use(T* middleware)
+    {
+        static_assert(std::is_base_of<Middleware, T>::value, "middleware must derive from http::Middleware");
+        Stage stage;
+        stage.self = middleware;
+        stage.before = overridesBefore<T>() ? &callBefore<T> : nullptr;
+        stage.after = overridesAfter<T>() ? &callAfter<T> : nullptr;
+        stages_.push_back(stage);
+    }
+
+    // 让请求依次经过各个中间件和业务回调 handler
+    void run(HttpRequest& req, HttpResponse* resp, const Handler& handler) const;
+
+    size_t size() const { return stages_.size(); }
+    uint64_t failures() const { return failures_.load(std::memory_order_relaxed); }
+
+private:
+    struct Stage
+    {
+        void* self;
+        bool (*before)(void*, HttpRequest&, HttpResponse*);
+        void (*after)(void*, const HttpRequest&, HttpResponse*);
+    };
+
+    template <typename T>
+    static bool callBefore(void* self, HttpRequest& req, HttpResponse* resp)
+    {
+        return static_cast<T*>(self)->before(req, resp);
+    }
+
+    template <typename T>
+    static void callAfter(void* self, const HttpRequest& req, HttpResponse* resp)
+    {
+        static_cast<T*>(self)->after(req, resp);
+    }
+
+    // 子类没有自己的 before/after 时，&T::before 的类型还是基类的成员函数指针
+    template <typename T>
+    static constexpr bool overridesBefore()
+    {
+        return !std::is_same<decltype(&T::before), decltype(&Middleware::before)>::value;
+    }
+
+    template <typename T>
+    static constexpr bool overridesAfter()
+    {
+        return !std::is_same<decltype(&T::after), decltype(&Middleware::after)>::value;
+    }
+
+    // 倒序执行前 entered 个中间件的 after 钩子
+    void runAfter(const HttpRequest& req, HttpResponse* resp, size_t entered) const;
+
+    static void setInternalError(HttpResponse* resp);
+
+private:
+    std::vector<Stage>            stages_;
+    mutable std::atomic<uint64_t> failures_; // 被兜住的异常数
+};
+
+/**
+ * @brief 慢请求日志：从收到请求到业务处理完超过阈值的请求记一条 WARN
+ *
+ * 访问日志可以采样或关闭，慢请求不能漏；只在 after 里比较一次时间，正常请求几乎没有开销。
+ */
+class SlowRequestLogger : public Middleware
+{
+public:
+    explicit SlowRequestLogger(int thresholdMs)
+        : thresholdUs_(static_cast<int64_t>(thresholdMs) * 1000)
+    {
+    }
+
+    void after(const HttpRequest& req, HttpResponse* resp);
+
+private:
+    int64_t thresholdUs_;
+};
+
+} // namespace http
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <muduo/base/noncopyable.h>
+#include <muduo/net/InetAddress.h>
+
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace http
+{
+
+/**
+ * @brief 按 (客户端 IP, 路由) 的令牌桶限流，超过的请求回 429
+ *
+ * 每个 key 一个令牌桶：容量 burst，每秒补充 ratePerSecond 个令牌，每个请求取走一个。
+ * 单独设置了规则的路由各自一个桶；其余路由按 IP 共用默认规则的一个桶
+ * (不按路径区分，扫描器的随机路径不会得到新的桶)。IPv6 客户端按 /64 前缀计数，和 LoginThrottle 一样。
+ *
+ * 桶放在固定大小的组相联表里：key 的哈希选出一组 (kWays 个槽)，组内没有这个 key 时
+ * 替换组内最久没访问的槽 (组内 LRU)，冷 key 自然被挤掉，内存不随客户端数增长。
+ * 每个槽是两个 64 位原子量：key 和 (上次补充时间, 令牌数)，取令牌是一次 CAS，不加锁。
+ * 替换槽和别的线程同时在这个槽上取令牌之间有很小的竞争窗口，最坏是个别请求多放行/多挡一次，
+ * 对限流来说可以接受。
+ */
+class RateLimiter : muduo::noncopyable
+{
+public:
+    struct Rule
+    {
+        double ratePerSecond; // 每秒补充的令牌数，<= 0 表示不限流
+        int    burst;         // 桶容量，即允许的突发请求数，<= 0 表示不限流 (最大 kMaxBurst)
+    };
+
+    static const int kWays = 8;
+    static const int kMaxBurst = 4000;
+
+    // capacity 为最多同时跟踪的 key 数 (向上取到 kWays 的 2 的幂倍)
+    explicit RateLimiter(const Rule& defaultRule, size_t capacity = 64 * 1024);
+    ~RateLimiter();
+
+    // 单独给某个路由设置规则 (在 start 之前调用)
+    void setRouteRule(const std::string& path, const Rule& rule);
+
+    // 取一个令牌：成功返回 true；失败返回 false，*retryAfterSeconds 为攒够一个令牌还要等的秒数
+    bool allow(const muduo::net::InetAddress& peer, const std::string& path, int* retryAfterSeconds);
+
+    uint64_t rejected() const { return rejected_.load(std::memory_order_relaxed); }
+    uint64_t evictions() const { return evictions_.load(std::memory_order_relaxed); }
+
+    // 按客户端计数时用的地址键 (未混淆)：IPv4 是地址本身，IPv6 是 /64 前缀的哈希，
+    // 双栈监听时的 IPv4 客户端 (::ffff:a.b.c.d) 按它的 IPv4 地址算。LoginThrottle 也用它
+    static uint64_t clientKey(const muduo::net::InetAddress& peer);
+
+private:
+    // 换算成整数运算用的规则：令牌以 1/1000 为单位
+    struct CompiledRule
+    {
+        int64_t milliPerSecond; // 每秒补充多少 1/1000 令牌
+        int64_t burstMilli;
+        int64_t fillUs;         // 从空桶补满要多久
+    };
+
+    struct Slot
+    {
+        std::atomic<uint64_t> key;   // 0 表示空槽
+        std::atomic<uint64_t> state; // 高 kTimeBits 位：上次补充时间 (微秒)；低 kTokenBits 位：令牌数
+    };
+
+    static CompiledRule compile(const Rule& rule);
+
+    uint64_t nowUs() const;
+    bool take(Slot* slot, const CompiledRule& rule, uint64_t now, int* retryAfterSeconds);
+
+private:
+    std::vector<CompiledRule>  rules_;    // 下标即路由编号，0 是默认规则
+    std::map<std::string, int> routeIds_;
+
+    std::unique_ptr<Slot[]> slots_;
+    size_t                  setMask_;
+
+    std::chrono::steady_clock::time_point epoch_;
+
+    std::atomic<uint64_t> rejected_;
+    std::atomic<uint64_t> evictions_;
+};
+
+} // namespace http
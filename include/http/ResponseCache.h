@@ -0,0 +1,132 @@
+#pragma once
+
+#include <muduo/base/noncopyable.h>
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdint.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Middleware.h"
+
+namespace http
+{
+
+/**
+ * @brief 按路由开启的响应缓存 (中间件)：读多写少的接口不必每个请求都查一次数据库
+ *
+ * 只缓存 GET 的 200 响应 (带 Set-Cookie 的不缓存)，键是 方法 + 路径 + 查询串 + 路由配置的请求头
+ * (按用户返回不同内容的接口一定要把 Authorization/Cookie 配进去)。
+ *   - 新鲜期 (ttlMs) 内直接返回缓存，不进业务；
+ *   - 过了新鲜期、还在 staleMs 内：先返回旧内容，同时往当前 I/O 线程的事件循环里排一个刷新任务，
+ *     响应发出去之后再调用业务回调更新缓存 (stale-while-revalidate)，同一个键同时只刷新一次；
+ *   - 没有可用的缓存：同一个键只让第一个请求 (leader) 执行业务，同时到达的其他请求推迟响应
+ *     (HttpResponse::defer)，不占着 I/O 线程，leader 的结果出来后再投递回各自的 I/O 线程填上，
+ *     N 个并发未命中只查一次数据库 (single-flight)。leader 的结果不能缓存、或者等了 maxWaitMs
+ *     (请求自己的截止时间更早时以它为准) 还没结果时，等待者各自执行业务。
+ * 缓存的响应体是共享的只读字符串，命中时响应直接引用它，不再拷贝。条数满了淘汰最久没用过的一条 (LRU)。
+ *
+ * 开了缓存的路由，业务回调要同步填好响应 (不能 defer)：leader 和后台刷新都是按同步调用处理的。
+ * 后台刷新和等待者自己执行业务时直接调用 origin，不经过中间件链里排在缓存后面的中间件，也不经过
+ * 服务器的并发限制：缓存要挂在链的最后，开了缓存的路由不能依赖后面的中间件 (认证之类的放在缓存前面，
+ * 或者用 AuthGuard 包在 origin 里的路由处理函数上)。
+ * addRoute 只能在 server.start() 之前调用。
+ */
+class ResponseCache : public Middleware, muduo::noncopyable
+{
+public:
+    using Handler = MiddlewareChain::Handler;
+
+    struct RouteOptions
+    {
+        int                      ttlMs = 1000; // 新鲜期
+        int                      staleMs = 0;  // 过了新鲜期后还能先返回旧内容的时间
+        std::vector<std::string> varyHeaders;  // 参与缓存键的请求头
+    };
+
+    struct Options
+    {
+        size_t maxEntries = 10000;         // 缓存条数上限
+        size_t maxBodyBytes = 1 << 20;     // 超过这个大小的响应不缓存
+        int    maxWaitMs = 5000;           // 等待者等 leader 结果的最长时间 (请求自己的截止时间更早时以它为准)
+        int    refreshTimeoutMs = 5000;    // 后台刷新请求的截止时间
+    };
+
+    // origin：后台刷新时调用的业务回调 (一般就是 Router::dispatch)
+    ResponseCache(const Options& options, const Handler& origin);
+
+    void addRoute(const std::string& path, const RouteOptions& options);
+
+    bool before(HttpRequest& req, HttpResponse* resp);
+    void after(const HttpRequest& req, HttpResponse* resp);
+
+    uint64_t hits() const { return hits_.load(std::memory_order_relaxed); }
+    uint64_t staleHits() const { return staleHits_.load(std::memory_order_relaxed); }
+    uint64_t misses() const { return misses_.load(std::memory_order_relaxed); }
+    uint64_t coalesced() const { return coalesced_.load(std::memory_order_relaxed); }
+    size_t size() const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Cached
+    {
+        HttpResponse::HttpStatusCode       status;
+        std::string                        statusMessage;
+        std::map<std::string, std::string> headers;
+        std::shared_ptr<const std::string> body;
+        Clock::time_point                  freshUntil;
+        Clock::time_point                  staleUntil;
+    };
+    using CachedPtr = std::shared_ptr<const Cached>;
+
+    struct Entry
+    {
+        CachedPtr                        response;
+        bool                             refreshing = false;
+        std::list<std::string>::iterator lruPos;
+    };
+
+    // 等 leader 结果的请求：拿到结果 (不能缓存时为空) 后投递回自己的 I/O 线程填响应
+    using Waiter = std::function<void (const CachedPtr& result)>;
+
+    // 当前线程上以 leader 身份执行业务的未命中，after 里用它写缓存、通知等待者
+    struct Pending
+    {
+        const ResponseCache* owner = nullptr;
+        std::string          key;
+        const RouteOptions*  route = nullptr;
+    };
+    static Pending& pending();
+
+    static std::string makeKey(const HttpRequest& req, const RouteOptions& route);
+    static void fill(const Cached& cached, const char* cacheStatus, HttpResponse* resp);
+    CachedPtr capture(const HttpResponse& resp, const RouteOptions& route) const;
+    void store(const std::string& key, const CachedPtr& cached);
+    void answerWaiter(const HttpRequest& req, const CachedPtr& result, HttpResponse* resp);
+    void refresh(HttpRequest req, const std::string& key, const RouteOptions* route);
+
+private:
+    Options                                  options_;
+    Handler                                  origin_;
+    std::unordered_map<std::string, RouteOptions> routes_;
+
+    mutable std::mutex                                   mutex_;
+    std::unordered_map<std::string, Entry>               entries_;
+    std::list<std::string>                               lru_;     // 缓存键，最近用过的在前
+    std::unordered_map<std::string, std::vector<Waiter>> flights_; // 正在执行的未命中 -> 等它的请求
+
+    std::atomic<uint64_t> hits_;
+    std::atomic<uint64_t> staleHits_;
+    std::atomic<uint64_t> misses_;
+    std::atomic<uint64_t> coalesced_;
+};
+
+} // namespace http
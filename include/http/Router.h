@@ -0,0 +1,39 @@
+#pragma once
+
+#include <functional>
+#include <map>
+#include <string>
+
+#include "HttpRequest.h"
+#include "HttpResponse.h"
+
+namespace http
+{
+
+// 路由表：把 URL 字符串映射到具体的处理函数
+// 例如："/api/user/login" -> UserController::login
+class Router
+{
+public:
+    // 定义路由处理函数的类型
+    using HttpHandler = std::function<void(const HttpRequest&, HttpResponse*)>;
+
+    void addRoute(const std::string& path, const HttpHandler& handler)
+    {
+        routes_[path] = handler;
+    }
+
+    // 路径有没有注册过 (指标按路由打标签时用，没注册的路径统一记成 unmatched)
+    bool hasRoute(const std::string& path) const
+    {
+        return routes_.count(path) != 0;
+    }
+
+    // 核心分发器：HttpServer 收到请求后会调用这个函数，找不到路由返回 404
+    void dispatch(const HttpRequest& req, HttpResponse* resp) const;
+
+private:
+    std::map<std::string, HttpHandler> routes_;
+};
+
+} // namespace http
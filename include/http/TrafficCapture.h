@@ -0,0 +1,69 @@
+#pragma once
+
+#include <muduo/base/AsyncLogging.h>
+#include <muduo/base/noncopyable.h>
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include "HttpRequest.h"
+
+namespace http
+{
+
+/**
+ * @brief 流量抓取：把收到的请求 (时间戳、方法、路径、查询串、请求头、请求体) 写成 JSONL
+ *
+ * 一行一个 JSON 对象，和访问日志一样走 muduo AsyncLogging，I/O 线程只做序列化和一次拷贝。
+ * 请求体是可打印文本时写在 "body" 里，否则 base64 编码后写在 "body_b64" 里。
+ * 产出的文件可以直接交给 sentinel_replay 按原速或加速回放。
+ *
+ * 默认脱敏 (redact)：凭证类请求头 (Authorization、Cookie 等) 的值写成 "[REDACTED]"；
+ * 登录/注册这类路由的请求体是 JSON 时把密码等字段的值换成 "[REDACTED]"，不是 JSON 的整个请求体不写。
+ * 只有在确实需要原样回放凭证的测试环境里才关掉 redact。
+ */
+class TrafficCapture : muduo::noncopyable
+{
+public:
+    struct Options
+    {
+        std::string basename = "capture";           // 文件名前缀
+        off_t       rollSize = 256 * 1024 * 1024;   // 单个文件超过这个大小就滚动
+        int         flushInterval = 3;              // 后台线程刷盘间隔 (秒)
+        int         sampleEvery = 1;                // 每 N 个请求抓一个，1 表示全抓
+        size_t      maxBodyBytes = 64 * 1024;       // 请求体超过这个大小的请求不抓
+        bool        redact = true;                  // 脱敏，见类注释
+        std::vector<std::string> redactHeaders{ "Authorization", "Proxy-Authorization", "Cookie",
+                                                "Set-Cookie", "X-Api-Key", "X-Auth-Token" };
+        std::vector<std::string> redactBodyPaths{ "/api/user/login", "/api/user/register" };
+        std::vector<std::string> redactFields{ "password", "token", "secret" }; // 这些路由请求体里要脱敏的字段
+    };
+
+    explicit TrafficCapture(const Options& options);
+    ~TrafficCapture();
+
+    void start();
+    void stop();
+
+    // 抓取一个完整的请求 (在 I/O 线程调用)
+    void capture(const HttpRequest& req);
+
+    uint64_t captured() const { return captured_.load(std::memory_order_relaxed); }
+    uint64_t skipped() const { return skipped_.load(std::memory_order_relaxed); }
+
+private:
+    bool redactHeader(const std::string& name) const;
+    bool redactBody(const std::string& path) const;
+    // 脱敏后的请求体写进 line，返回 false 表示请求体不能写
+    bool appendRedactedBody(std::string* line, const std::string& body) const;
+
+private:
+    Options               options_;
+    muduo::AsyncLogging   asyncLog_;
+    std::atomic<uint64_t> captured_;
+    std::atomic<uint64_t> skipped_; // 被采样跳过或请求体过大的请求数
+    bool                  running_;
+};
+
+} // namespace http
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <deque>
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace http
+{
+namespace http2
+{
+
+// 头部列表：HTTP/2 的头部名都是小写，顺序有意义 (伪头部在前)
+using HeaderList = std::vector<std::pair<std::string, std::string>>;
+
+/**
+ * @brief HPACK 动态表 (RFC 7541 2.3.2)
+ *
+ * 新条目插在最前面，下标 0 对应 HPACK 索引 62；超过容量时从最老的条目开始淘汰。
+ * 条目大小按规范计为 name + value + 32 字节。
+ */
+class HpackDynamicTable
+{
+public:
+    explicit HpackDynamicTable(size_t maxSize = 4096)
+        : size_(0)
+        , maxSize_(maxSize)
+    {}
+
+    void add(const std::string& name, const std::string& value);
+    void setMaxSize(size_t maxSize);
+
+    // index 从 0 开始 (即 HPACK 索引 - 62)
+    const std::pair<std::string, std::string>* get(size_t index) const
+    { return index < entries_.size() ? &entries_[index] : nullptr; }
+
+    // 查找条目：完全匹配返回下标并置 *exact = true；只有名字匹配返回第一个名字匹配的下标；都没有返回 -1
+    int find(const std::string& name, const std::string& value, bool* exact) const;
+
+    size_t count() const { return entries_.size(); }
+    size_t size() const { return size_; }
+    size_t maxSize() const { return maxSize_; }
+
+private:
+    void evict(size_t limit);
+
+private:
+    std::deque<std::pair<std::string, std::string>> entries_;
+    size_t                                          size_;
+    size_t                                          maxSize_;
+};
+
+/**
+ * @brief HPACK 解码器：每个连接一个，解码对端发来的 header block
+ */
+class HpackDecoder
+{
+public:
+    // maxTableSize 是我方在 SETTINGS_HEADER_TABLE_SIZE 里允许的上限
+    explicit HpackDecoder(size_t maxTableSize = 4096)
+        : table_(maxTableSize)
+        , maxAllowedSize_(maxTableSize)
+    {}
+
+    // 解码一个完整的 header block，出错返回 false (对应 COMPRESSION_ERROR，连接不可再用)。
+    // 解出的头部按 RFC 7541 的算法 (name + value + 32) 累计超过 maxListSize 时也返回 false：
+    // 一个字面量进了动态表以后每个 1 字节的索引都能把它再复制一遍，只限制压缩后的大小挡不住
+    bool decode(const char* data, size_t len, size_t maxListSize, HeaderList* headers);
+
+private:
+    bool lookup(uint64_t index, std::string* name, std::string* value) const;
+
+private:
+    HpackDynamicTable table_;
+    size_t            maxAllowedSize_;
+};
+
+/**
+ * @brief HPACK 编码器：每个连接一个，编码发给对端的响应头
+ *
+ * 重复出现的头部 (content-type、CORS 头等) 进入动态表，之后每次只占一两个字节；
+ * 每次都变的头部 (content-length 等) 不进表，避免把有用的条目挤出去。
+ * 字符串在 Huffman 编码更短时使用 Huffman。
+ */
+class HpackEncoder
+{
+public:
+    HpackEncoder()
+        : table_(4096)
+        , pendingSizeUpdate_(false)
+    {}
+
+    // 对端 SETTINGS_HEADER_TABLE_SIZE 变化时调用，下一个 header block 开头会带上表大小更新
+    void setMaxTableSize(size_t maxSize);
+
+    void encode(const HeaderList& headers, std::string* out);
+
+private:
+    HpackDynamicTable table_;
+    bool              pendingSizeUpdate_;
+};
+
+// 以下是编解码的基础函数，公开出来给测试/基准使用
+namespace hpack
+{
+
+// 整数编码 (RFC 7541 5.1)，prefixBits 为前缀位数，first 为首字节里前缀以外的高位
+void encodeInteger(uint64_t value, int prefixBits, uint8_t first, std::string* out);
+// 解码成功返回消耗的字节数，失败返回 0
+size_t decodeInteger(const uint8_t* data, size_t len, int prefixBits, uint64_t* value);
+
+size_t huffmanEncodedLength(const std::string& value);
+void huffmanEncode(const std::string& value, std::string* out);
+bool huffmanDecode(const uint8_t* data, size_t len, std::string* out);
+
+} // namespace hpack
+
+} // namespace http2
+} // namespace http
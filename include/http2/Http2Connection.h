@@ -0,0 +1,153 @@
+#pragma once
+
+#include <muduo/net/Buffer.h>
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+
+#include "Hpack.h"
+#include "../http/HttpRequest.h"
+#include "../http/HttpResponse.h"
+
+namespace http
+{
+namespace http2
+{
+
+/**
+ * @brief 一个 h2c (明文 HTTP/2) 连接的协议状态
+ *
+ * 和具体的网络库无关：onData() 从输入缓冲区里解析帧，要发出去的帧写进输出缓冲区，
+ * 由 HttpServer 负责收发。支持两种进入方式：
+ *   - prior knowledge：客户端一上来就发连接前言 "PRI * HTTP/2.0..."
+ *   - Upgrade：HTTP/1.1 请求带 "Upgrade: h2c"，回 101 后原请求作为 stream 1 处理
+ *
+ * 每个 stream 收齐请求 (END_STREAM) 后同步调用 RequestHandler，接口和 HTTP/1 的 HttpCallback 一样，
+ * 现有路由不用改。业务推迟了响应 (HttpResponse::defer) 时 stream 保持打开，响应填好后再编码，交给 Writer 发出；
+ * 其他 stream 照常处理，不用等它。没收齐的请求体有上限 (单个 stream 和整个连接各一个)：流量控制窗口只对上限以内的数据补充，
+ * 单个请求体超限回 413，连接上积压的请求体总量超限时拒绝 (RST_STREAM) 新来数据的 stream。响应体按对端的流量控制窗口分帧发送，窗口不够时留在 stream 上，
+ * 收到 WINDOW_UPDATE 再继续发。
+ */
+class Http2Connection : public std::enable_shared_from_this<Http2Connection>
+{
+public:
+    // 请求不是 const 的：服务器在调用业务前要设置请求的截止时间
+    using RequestHandler = std::function<void (HttpRequest&, HttpResponse*)>;
+    // 响应编码完成后回调 (指标、访问日志)，字节数含帧头和压缩后的头部
+    using ResponseObserver = std::function<void (const HttpRequest&, const HttpResponse&,
+                                                 size_t requestBytes, size_t responseBytes)>;
+    // 发送 onData() 之外产生的帧 (推迟的响应)
+    using Writer = std::function<void (muduo::net::Buffer* out)>;
+
+    // 客户端连接前言
+    static const char   kClientPreface[];
+    static const size_t kClientPrefaceLength = 24;
+
+    Http2Connection(const RequestHandler& handler, const ResponseObserver& observer);
+
+    // 要支持推迟的响应必须设置 (对象要由 shared_ptr 管理)
+    void setWriter(const Writer& writer) { writer_ = writer; }
+
+    // prior knowledge：发送服务端的 SETTINGS，之后等客户端前言
+    void start(muduo::net::Buffer* out);
+
+    /**
+     * @brief h2c Upgrade：应用 HTTP2-Settings，发送 SETTINGS，把原请求作为 stream 1 处理
+     * 调用方需要先把 101 Switching Protocols 写进 out
+     * @return HTTP2-Settings 格式错误返回 false (此时应按 HTTP/1.1 回 400)
+     */
+    bool upgrade(HttpRequest& req, size_t requestBytes, muduo::net::Buffer* out);
+
+    // 处理收到的数据，返回 false 表示发生连接级错误 (已写入 GOAWAY)，调用方应关闭连接
+    bool onData(muduo::net::Buffer* in, muduo::net::Buffer* out);
+
+    size_t activeStreams() const { return streams_.size(); }
+    uint64_t totalStreams() const { return totalStreams_; }
+
+    // 判断一个 HTTP/1.1 请求是不是 h2c 升级请求
+    static bool isUpgradeRequest(const HttpRequest& req);
+
+private:
+    struct Stream
+    {
+        uint32_t    id = 0;
+        HeaderList  headers;
+        std::string body;
+        size_t      requestBytes = 0;   // 这个 stream 收到的帧字节数
+        bool        remoteClosed = false; // 对端已发 END_STREAM
+        bool        responding = false;   // 响应头已发出，正在发响应体
+        bool        bodyTooLarge = false; // 请求体超过上限，回 413
+        int64_t     sendWindow = 0;     // 对端给这个 stream 的发送窗口
+        int64_t     recvWindow = 0;     // 我方给这个 stream 的接收窗口
+        size_t      unackedRecv = 0;    // 已消费但还没用 WINDOW_UPDATE 还给对端的字节
+        std::string pending;            // 还没发出去的响应体
+        size_t      pendingOffset = 0;
+    };
+
+    // 帧处理：返回 false 表示已经发生连接错误
+    bool onFrame(uint8_t type, uint8_t flags, uint32_t streamId,
+                 const char* payload, size_t length, muduo::net::Buffer* out);
+    bool onDataFrame(uint8_t flags, uint32_t streamId, const char* payload, size_t length,
+                     muduo::net::Buffer* out);
+    bool onHeadersFrame(uint8_t flags, uint32_t streamId, const char* payload, size_t length,
+                        muduo::net::Buffer* out);
+    bool onContinuationFrame(uint8_t flags, uint32_t streamId, const char* payload, size_t length,
+                             muduo::net::Buffer* out);
+    bool onSettingsFrame(uint8_t flags, uint32_t streamId, const char* payload, size_t length,
+                         muduo::net::Buffer* out);
+    bool onWindowUpdateFrame(uint32_t streamId, const char* payload, size_t length,
+                             muduo::net::Buffer* out);
+    bool applySettings(const char* payload, size_t length, muduo::net::Buffer* out);
+    bool onHeaderBlockComplete(muduo::net::Buffer* out);
+
+    void dispatch(Stream* stream, muduo::net::Buffer* out);
+    void respond(Stream* stream, const HttpRequest& req, const HttpResponse& response,
+                 muduo::net::Buffer* out);
+    // 业务推迟了响应：填好以后 (在 I/O 线程里) 编码并通过 writer_ 发出
+    void deferResponse(Stream* stream, const HttpRequest& req, HttpResponse* response);
+    // 在流量控制窗口允许的范围内发送响应体，发完的 stream 关闭
+    void flushStream(Stream* stream, muduo::net::Buffer* out);
+    void flushAll(muduo::net::Buffer* out);
+    void closeStream(uint32_t streamId);
+
+    bool connectionError(uint32_t errorCode, muduo::net::Buffer* out);
+    void resetStream(uint32_t streamId, uint32_t errorCode, muduo::net::Buffer* out);
+
+    static void appendFrameHeader(muduo::net::Buffer* out, size_t length, uint8_t type,
+                                  uint8_t flags, uint32_t streamId);
+    static void appendWindowUpdate(muduo::net::Buffer* out, uint32_t streamId, uint32_t increment);
+
+private:
+    RequestHandler             handler_;
+    ResponseObserver           observer_;
+    Writer                     writer_;
+    HpackDecoder               decoder_;
+    HpackEncoder               encoder_;
+    std::map<uint32_t, Stream> streams_;       // 按 id 有序，积压的响应按先来后到发送
+
+    bool        prefaceReceived_;
+    bool        goAwaySent_;
+    uint32_t    lastStreamId_;     // 对端打开过的最大 stream id
+    uint64_t    totalStreams_;
+
+    // 正在收的 header block (HEADERS + CONTINUATION)
+    uint32_t    headerStreamId_;   // 0 表示没有
+    bool        headerEndStream_;
+    size_t      headerFrameBytes_;
+    std::string headerBlock_;
+
+    // 对端的设置
+    size_t      peerMaxFrameSize_;
+    int64_t     peerInitialWindow_;
+
+    // 连接级流量控制
+    int64_t     connSendWindow_;
+    int64_t     connRecvWindow_;
+    size_t      connUnackedRecv_;
+    size_t      bufferedBody_;     // 所有 stream 上还没交给业务的请求体字节数
+};
+
+} // namespace http2
+} // namespace http
@@ -0,0 +1,148 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace http
+{
+namespace metrics
+{
+
+/**
+ * @brief HDR 风格的延迟直方图 (单位: 微秒)
+ *
+ * 按 2 的幂分段，每段再线性切成 kSubBuckets 个桶，相对误差约 1/kSubBuckets。
+ * record() 只由所属线程调用，计数器用 relaxed 原子变量，读方 (抓取线程) 不加锁也不阻塞写方。
+ */
+class LatencyHistogram
+{
+public:
+    static const int kSubBucketBits = 4;
+    static const int kSubBuckets = 1 << kSubBucketBits;
+    static const int kMaxExponent = 40; // 2^40 us ≈ 12 天，足够了
+    static const int kBucketCount = (kMaxExponent - kSubBucketBits + 2) * kSubBuckets;
+
+    // 快照：多个线程的直方图合并后的结果，用于计算分位数
+    struct Snapshot
+    {
+        std::vector<uint64_t> counts;
+        uint64_t              count = 0;
+        uint64_t              sum = 0;
+        uint64_t              max = 0;
+
+        Snapshot() : counts(kBucketCount, 0) {}
+
+        void merge(const Snapshot& other);
+        // q 取 [0, 1]，返回对应分位数的值 (桶上界)
+        uint64_t percentile(double q) const;
+        // 小于等于 value 的样本数 (用于 Prometheus 的 le 桶)
+        uint64_t countAtOrBelow(uint64_t value) const;
+    };
+
+    LatencyHistogram();
+
+    void record(uint64_t value);
+    void snapshotInto(Snapshot* snapshot) const;
+
+    static int bucketIndex(uint64_t value);
+    static uint64_t bucketUpperBound(int index);
+
+private:
+    std::unique_ptr<std::atomic<uint64_t>[]> counts_;
+    std::atomic<uint64_t>                    count_;
+    std::atomic<uint64_t>                    sum_;
+    std::atomic<uint64_t>                    max_;
+};
+
+/**
+ * @brief 进程级指标注册表 (单例)
+ *
+ * 每个线程有自己的分片，热路径上只做无锁的 map 查找和 relaxed 原子加；
+ * /metrics 抓取时再把所有分片合并，输出 Prometheus 文本格式。
+ */
+class MetricsRegistry
+{
+public:
+    using GaugeFunc = std::function<double()>;
+
+    static MetricsRegistry& instance()
+    {
+        static MetricsRegistry registry;
+        return registry;
+    }
+
+    // HTTP 请求：按路由 + 状态码记录延迟和收发字节数
+    void observeRequest(const std::string& route, int status, int64_t latencyUs,
+                        size_t requestBytes, size_t responseBytes);
+    void incInFlight();
+    void decInFlight();
+
+    // 数据库：等待连接池的时间、执行查询的时间
+    void observeDbWait(int64_t us);
+    void observeDbQuery(int64_t us);
+
+    // TLS：完整握手或会话恢复的耗时 (从收到 ClientHello 到握手完成)
+    void observeTlsHandshake(int64_t us);
+
+    // 密码哈希：任务在哈希线程池里排队的时间、KDF 本身的耗时
+    void observePasswordHashWait(int64_t us);
+    void observePasswordHash(int64_t us);
+
+    // 注册一个抓取时才求值的 gauge (比如背压统计)，回调在抓取线程里执行
+    void registerGauge(const std::string& name, const std::string& help, const GaugeFunc& func);
+    // 同上，但回调返回的是只增不减的累计值 (xxx_total)，按 counter 类型输出
+    void registerCounter(const std::string& name, const std::string& help, const GaugeFunc& func);
+
+    std::string renderPrometheus();
+
+private:
+    struct RouteSeries
+    {
+        int                   status;
+        LatencyHistogram      latency;
+        std::atomic<uint64_t> requests { 0 };
+        std::atomic<uint64_t> requestBytes { 0 };
+        std::atomic<uint64_t> responseBytes { 0 };
+    };
+
+    // 每个线程一个分片：只有所属线程写，mutex 只在新增序列和抓取时使用
+    struct ThreadShard
+    {
+        std::mutex                                                             mutex;
+        std::unordered_map<std::string, std::vector<std::unique_ptr<RouteSeries>>> routes;
+        std::atomic<int64_t>                                                   inFlight { 0 };
+        LatencyHistogram                                                       dbWait;
+        LatencyHistogram                                                       dbQuery;
+        LatencyHistogram                                                       tlsHandshake;
+        LatencyHistogram                                                       passwordHashWait;
+        LatencyHistogram                                                       passwordHash;
+    };
+
+    struct Gauge
+    {
+        std::string name;
+        std::string help;
+        GaugeFunc   func;
+        const char* type; // "gauge" 或 "counter"
+    };
+
+    MetricsRegistry() = default;
+    MetricsRegistry(const MetricsRegistry&) = delete;
+    MetricsRegistry& operator=(const MetricsRegistry&) = delete;
+
+    ThreadShard* localShard();
+    RouteSeries* findSeries(ThreadShard* shard, const std::string& route, int status);
+
+private:
+    std::mutex                                mutex_;  // 保护 shards_ 和 gauges_
+    std::vector<std::unique_ptr<ThreadShard>> shards_; // 线程退出后分片保留，计数不丢
+    std::vector<Gauge>                        gauges_;
+};
+
+} // namespace metrics
+} // namespace http
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <muduo/base/noncopyable.h>
+#include <muduo/base/Timestamp.h>
+#include <muduo/net/Buffer.h>
+
+#include <string>
+
+struct ssl_st;
+struct bio_st;
+
+namespace http
+{
+namespace tls
+{
+
+class TlsContext;
+
+/**
+ * @brief 一个 TCP 连接上的 TLS 状态 (服务端)
+ *
+ * 用一对内存 BIO 和 muduo 的非阻塞 I/O 对接：muduo 读到的密文写进 rbio，
+ * SSL 产生的密文 (握手消息、加密后的响应、告警) 从 wbio 取出交给 TcpConnection 发送。
+ * 握手在 onData() 里逐步推进，不会阻塞 I/O 线程。
+ *
+ * SSL 对象不是线程安全的，所有方法都必须在连接所属的 I/O 线程里调用。
+ */
+class TlsConnection : muduo::noncopyable
+{
+public:
+    explicit TlsConnection(TlsContext* context);
+    ~TlsConnection();
+
+    // 构造时创建 SSL 对象失败 (内存不够) 返回 false，调用方应直接关闭连接
+    bool ok() const { return ssl_ != nullptr; }
+
+    /**
+     * @brief 处理收到的密文，解出来的明文追加到 plaintext()
+     * @param out 需要发给对端的密文 (握手阶段的回复等)
+     * @return false 表示握手失败或协议错误，调用方应发送 out 后关闭连接
+     */
+    bool onData(muduo::net::Buffer* in, muduo::net::Buffer* out);
+
+    // 加密明文，密文追加到 out
+    void encrypt(const char* data, size_t len, muduo::net::Buffer* out);
+
+    // 发送 close_notify
+    void shutdown(muduo::net::Buffer* out);
+
+    // 已解密、等待 HTTP 层解析的数据
+    muduo::net::Buffer* plaintext() { return &plaintext_; }
+
+    bool handshakeDone() const { return handshakeDone_; }
+    // 对端发了 close_notify
+    bool peerClosed() const { return peerClosed_; }
+    // ALPN 协商结果，没协商返回空串
+    std::string alpn() const;
+
+private:
+    // 把 wbio 里积攒的密文移到 out
+    void drain(muduo::net::Buffer* out);
+
+private:
+    TlsContext*         context_;
+    ssl_st*             ssl_;
+    bio_st*             rbio_;  // 网络 -> SSL
+    bio_st*             wbio_;  // SSL -> 网络
+    muduo::net::Buffer  plaintext_;
+    muduo::Timestamp    handshakeStart_;
+    bool                handshakeDone_;
+    bool                peerClosed_;
+};
+
+} // namespace tls
+} // namespace http
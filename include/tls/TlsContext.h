@@ -0,0 +1,64 @@
+#pragma once
+
+#include <muduo/base/noncopyable.h>
+
+#include <atomic>
+#include <stdint.h>
+#include <string>
+
+struct ssl_st;
+struct ssl_ctx_st;
+
+namespace http
+{
+namespace tls
+{
+
+/**
+ * @brief 服务端 TLS 配置：一个 SSL_CTX，所有 I/O 线程的连接共用
+ *
+ * 证书、私钥只加载一次；session 缓存和 session ticket 的密钥都挂在 SSL_CTX 上，
+ * 所以客户端不管被分到哪个 loop 都能恢复会话 (OpenSSL 内部对缓存加锁)。
+ * ALPN 声明 h2 和 http/1.1，协商到 h2 的客户端直接发 HTTP/2 连接前言。
+ *
+ * 配置错误 (证书/私钥读不了、不匹配) 在构造时抛 std::runtime_error。
+ */
+class TlsContext : muduo::noncopyable
+{
+public:
+    struct Options
+    {
+        std::string certFile;                 // PEM 证书链 (服务端证书在最前)
+        std::string keyFile;                  // PEM 私钥
+        long        sessionCacheSize = 20480; // 服务端 session 缓存条数 (按 session id 恢复)
+        long        sessionTimeout = 300;     // session 有效期 (秒)
+        bool        sessionTickets = true;    // 无状态 session ticket
+        bool        http2 = true;             // ALPN 里是否声明 h2
+    };
+
+    explicit TlsContext(const Options& options);
+    ~TlsContext();
+
+    // 为一个新连接创建 SSL 对象 (服务端模式)
+    ssl_st* newSsl();
+
+    // 握手结果，由 TlsConnection 调用
+    void onHandshake(bool resumed, int64_t latencyUs);
+    void onHandshakeFailure();
+
+    uint64_t handshakes() const { return handshakes_.load(std::memory_order_relaxed); }
+    uint64_t resumedHandshakes() const { return resumed_.load(std::memory_order_relaxed); }
+    uint64_t failedHandshakes() const { return failures_.load(std::memory_order_relaxed); }
+    // 服务端 session 缓存里的条目数
+    long cachedSessions() const;
+
+private:
+    ssl_ctx_st*           ctx_;
+    std::string           alpn_;      // ALPN 协议列表 (wire 格式)
+    std::atomic<uint64_t> handshakes_;
+    std::atomic<uint64_t> resumed_;
+    std::atomic<uint64_t> failures_;
+};
+
+} // namespace tls
+} // namespace http
@@ -0,0 +1,145 @@
+#pragma once
+
+#include <muduo/base/noncopyable.h>
+#include <muduo/net/Buffer.h>
+#include <muduo/net/TcpConnection.h>
+
+#include <functional>
+#include <memory>
+#include <string>
+
+#include "../http/HttpRequest.h"
+
+namespace http
+{
+namespace websocket
+{
+
+class WebSocketConnection;
+using WebSocketConnectionPtr = std::shared_ptr<WebSocketConnection>;
+
+// 一个 WebSocket 路由的回调，都在连接所属的 I/O 线程里调用
+struct WebSocketHandler
+{
+    // 握手前调用 (可选)：返回 false 时回 403 不升级，用来校验 Origin、凭证
+    std::function<bool (const HttpRequest&)>                                                accept;
+    // 握手完成，req 是升级前的 HTTP 请求
+    std::function<void (const WebSocketConnectionPtr&, const HttpRequest&)>                 onOpen;
+    // 收到一条完整的消息 (分片已经拼好)
+    std::function<void (const WebSocketConnectionPtr&, const std::string& message, bool binary)> onMessage;
+    // TCP 连接断开，每个连接只调用一次
+    std::function<void (const WebSocketConnectionPtr&)>                                     onClose;
+};
+
+/**
+ * @brief 一个已经完成握手的 WebSocket 连接 (RFC 6455，服务端)
+ *
+ * 由 HttpServer 在 101 之后创建并挂在 HttpContext 上，onData() 从输入缓冲区里解析帧：
+ * 掩码按 8 字节一组异或还原，分片消息拼好后交给 onMessage，ping 自动回 pong，
+ * 收到 close 回一个 close 后由服务端关闭 TCP 连接。
+ *
+ * 只持有 TcpConnection 的 weak_ptr，避免 TcpConnection -> HttpContext -> 这里的循环引用。
+ */
+class WebSocketConnection : public std::enable_shared_from_this<WebSocketConnection>,
+                            muduo::noncopyable
+{
+public:
+    enum Opcode
+    {
+        kContinuation = 0x0,
+        kText = 0x1,
+        kBinary = 0x2,
+        kClose = 0x8,
+        kPing = 0x9,
+        kPong = 0xa,
+    };
+
+    // close 帧的状态码 (RFC 6455 7.4.1)
+    enum CloseCode
+    {
+        kNormalClosure = 1000,
+        kGoingAway = 1001,
+        kProtocolError = 1002,
+        kUnsupportedData = 1003,
+        kInvalidPayload = 1007,
+        kMessageTooBig = 1009,
+    };
+
+    // 把编码好的帧写到连接上，在 I/O 线程里调用 (TLS 连接用它先加密)
+    using Writer = std::function<void (const muduo::net::TcpConnectionPtr&, const char* data, size_t len)>;
+
+    WebSocketConnection(const muduo::net::TcpConnectionPtr& conn,
+                        const std::shared_ptr<const WebSocketHandler>& handler,
+                        size_t maxMessageSize);
+
+    // 判断是不是 WebSocket 升级请求 (GET + Upgrade: websocket + Sec-WebSocket-Key)
+    static bool isUpgradeRequest(const HttpRequest& req);
+
+    // 校验握手请求，把 101 响应写进 out；版本不对或缺少 key 返回 false
+    static bool handshake(const HttpRequest& req, muduo::net::Buffer* out);
+
+    // Sec-WebSocket-Accept = base64(SHA1(key + GUID))
+    static std::string acceptKey(const std::string& key);
+
+    // 编码一个服务端帧 (不带掩码)，广播时编码一次、发给所有订阅者
+    static void encodeFrame(Opcode opcode, const char* data, size_t len, std::string* out);
+
+    // 原地按掩码异或，offset 是 data[0] 在整个负载里的位置
+    static void applyMask(char* data, size_t len, const char mask[4], size_t offset = 0);
+
+    // 不设置时直接 TcpConnection::send
+    void setWriter(const Writer& writer) { writer_ = writer; }
+
+    // 握手完成后由 HttpServer 调用，触发 onOpen
+    void onOpen(const HttpRequest& req);
+
+    // 处理收到的数据，返回 false 表示应该关闭连接 (close 握手完成或协议错误，close 帧已发出)
+    bool onData(muduo::net::Buffer* in);
+
+    // TCP 连接断开时由 HttpServer 调用
+    void onClosed();
+
+    // 发送：线程安全，可以在任意线程调用
+    void sendText(const std::string& message);
+    void sendBinary(const std::string& message);
+    void ping(const std::string& payload = std::string());
+    void close(CloseCode code = kNormalClosure, const std::string& reason = std::string());
+
+    /**
+     * @brief 发送一个已经编码好的帧，必须在连接的 I/O 线程里调用
+     * 输出缓冲区积压超过 maxPendingBytes 时丢弃这一帧 (慢订阅者不拖累其他人)
+     * @return 是否发送
+     */
+    bool sendEncoded(const std::string& frame, size_t maxPendingBytes);
+
+    muduo::net::EventLoop* loop() const { return loop_; }
+    const std::string& name() const { return name_; }
+    bool connected() const;
+
+private:
+    // 一个数据帧已经追加进 message_，fin 时把整条消息交给 onMessage
+    bool onDataFrame(bool fin);
+    bool onControlFrame(uint8_t opcode, const char* payload, size_t len);
+    bool failConnection(CloseCode code, const std::string& reason);
+    void sendFrame(Opcode opcode, const char* data, size_t len);
+    void write(const muduo::net::TcpConnectionPtr& conn, const std::string& frame);
+
+private:
+    std::weak_ptr<muduo::net::TcpConnection> conn_;
+    std::shared_ptr<const WebSocketHandler>  handler_;
+    Writer                                   writer_;
+    muduo::net::EventLoop*                   loop_;
+    std::string                              name_;
+    size_t                                   maxMessageSize_;
+
+    // 正在拼接的分片消息
+    bool        assembling_;
+    uint8_t     messageOpcode_;
+    std::string message_;
+
+    bool        closeSent_;
+    bool        closed_;
+};
+
+} // namespace websocket
+} // namespace http
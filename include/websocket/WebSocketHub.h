@@ -0,0 +1,71 @@
+#pragma once
+
+#include <muduo/base/noncopyable.h>
+#include <muduo/net/EventLoop.h>
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "WebSocketConnection.h"
+
+namespace http
+{
+namespace websocket
+{
+
+/**
+ * @brief 广播组：一条消息编码一次，扇出给所有订阅的 WebSocket 连接
+ *
+ * 订阅者按所属的 EventLoop 分片，每个分片只在自己的 I/O 线程里读写，不需要加锁。
+ * broadcast() 可以在任意线程调用：帧只编码一次放进 shared_ptr，每个 loop 投递一个任务，
+ * 在 loop 线程里逐个 send。在 loop 线程里 send 时 muduo 直接 write 到 socket，
+ * 只有内核缓冲区满时剩下的部分才拷进该连接的 outputBuffer。
+ *
+ * 积压超过 maxPendingBytes 的慢订阅者会跳过这条消息，计入 dropped()。
+ */
+class WebSocketHub : muduo::noncopyable
+{
+public:
+    explicit WebSocketHub(size_t maxPendingBytes = 1024 * 1024);
+
+    // 订阅/退订，在连接的 I/O 线程里调用 (一般在 onOpen/onClose 里)
+    void subscribe(const WebSocketConnectionPtr& conn);
+    void unsubscribe(const WebSocketConnectionPtr& conn);
+
+    // 广播一条消息，线程安全
+    void broadcast(const std::string& message, bool binary = false);
+
+    size_t   subscribers() const { return subscribers_.load(std::memory_order_relaxed); }
+    uint64_t broadcasts() const { return broadcasts_.load(std::memory_order_relaxed); }
+    uint64_t delivered() const { return delivered_.load(std::memory_order_relaxed); }
+    uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+private:
+    // 一个 I/O 线程上的订阅者
+    struct Shard
+    {
+        muduo::net::EventLoop*                                   loop;
+        std::map<WebSocketConnection*, std::weak_ptr<WebSocketConnection>> members;
+    };
+    using ShardPtr = std::shared_ptr<Shard>;
+
+    ShardPtr shardFor(muduo::net::EventLoop* loop);
+    void deliver(const ShardPtr& shard, const std::shared_ptr<const std::string>& frame);
+
+private:
+    size_t                                   maxPendingBytes_;
+    mutable std::mutex                       mutex_;  // 只保护 shards_ 本身 (loop 很少增加)
+    std::map<muduo::net::EventLoop*, ShardPtr> shards_;
+
+    std::atomic<size_t>   subscribers_;
+    std::atomic<uint64_t> broadcasts_;
+    std::atomic<uint64_t> delivered_;
+    std::atomic<uint64_t> dropped_;
+};
+
+} // namespace websocket
+} // namespace http
@@ -2,13 +2,17 @@
 USE smart_sentinel_db;
 
 -- 2. 创建用户表 users
+-- password 存 scrypt 哈希 ($scrypt$ln=..,r=..,p=..$盐$密钥，约 90 个字符)，留足长度方便以后换算法/调参数
 CREATE TABLE IF NOT EXISTS users (
     id INT AUTO_INCREMENT PRIMARY KEY,
     username VARCHAR(50) NOT NULL UNIQUE,
-    password VARCHAR(50) NOT NULL
+    password VARCHAR(255) NOT NULL
 );
 
--- 3. 插入一个测试用户 (账号: admin, 密码: 123)
+-- 已有的旧表 (password 是 VARCHAR(50) 的明文) 放宽列长度；明文密码在用户下次登录成功时自动换成哈希
+ALTER TABLE users MODIFY password VARCHAR(255) NOT NULL;
+
+-- 3. 插入一个测试用户 (账号: admin, 密码: 123)，明文种子，第一次登录后升级成哈希
 INSERT INTO users (username, password) VALUES ('admin', '123');
 
 -- 4. 验证一下
@@ -0,0 +1,111 @@
+#include "../../include/auth/AuthGuard.h"
+
+#include <muduo/base/Logging.h>
+
+#include <string.h>
+#include <strings.h>
+
+namespace http
+{
+namespace auth
+{
+
+namespace
+{
+
+const char   kBearer[] = "Bearer ";
+const size_t kBearerLength = sizeof(kBearer) - 1;
+
+void setUnauthorized(HttpResponse* resp, const char* error)
+{
+    resp->setStatusCode(HttpResponse::k401Unauthorized);
+    resp->setStatusMessage("Unauthorized");
+    resp->addHeader("WWW-Authenticate", std::string("Bearer error=\"") + error + "\"");
+    resp->addHeader("Content-Type", "application/json");
+    resp->setBody(R"({"code":401,"msg":"Missing or invalid token"})");
+}
+
+} // namespace
+
+bool AuthGuard::bearerToken(const HttpRequest& req, std::string* token)
+{
+    const std::string& value = req.getHeader("Authorization");
+    // 认证方案名不区分大小写 (RFC 7235)
+    if (value.size() <= kBearerLength || ::strncasecmp(value.c_str(), kBearer, kBearerLength) != 0)
+    {
+        return false;
+    }
+    size_t start = value.find_first_not_of(' ', kBearerLength);
+    size_t end = value.find_last_not_of(' ');
+    if (start == std::string::npos)
+    {
+        return false;
+    }
+    token->assign(value, start, end - start + 1);
+    return true;
+}
+
+bool AuthGuard::sessionCookie(const HttpRequest& req, std::string* sessionId)
+{
+    // Cookie: a=1; sentinel_session=<id>; b=2
+    const std::string& cookies = req.getHeader("Cookie");
+    const size_t nameLength = ::strlen(SessionStore::kCookieName);
+    size_t pos = 0;
+    while (pos < cookies.size())
+    {
+        size_t end = cookies.find(';', pos);
+        if (end == std::string::npos)
+        {
+            end = cookies.size();
+        }
+        size_t start = cookies.find_first_not_of(' ', pos);
+        if (start < end && end - start > nameLength + 1 &&
+            cookies.compare(start, nameLength, SessionStore::kCookieName) == 0 &&
+            cookies[start + nameLength] == '=')
+        {
+            sessionId->assign(cookies, start + nameLength + 1, end - start - nameLength - 1);
+            return true;
+        }
+        pos = end + 1;
+    }
+    return false;
+}
+
+Router::HttpHandler AuthGuard::protect(const AuthedHandler& handler) const
+{
+    const TokenService* tokens = tokens_;
+    SessionStore* sessions = sessions_;
+    return [tokens, sessions, handler](const HttpRequest& req, HttpResponse* resp)
+    {
+        std::string token;
+        TokenClaims claims;
+        if (!tokens || !bearerToken(req, &token))
+        {
+            // 没有令牌时看有没有服务端会话
+            Session session;
+            if (sessions && sessionCookie(req, &token) && sessions->touch(token, &session))
+            {
+                claims.userId = session.userId;
+                claims.username = session.username;
+                claims.issuedAt = session.createdAt;
+                claims.expiresAt = session.lastAccess + sessions->idleTimeoutSeconds();
+                claims.sessionId = session.id;
+                handler(req, claims, resp);
+                return;
+            }
+            setUnauthorized(resp, "invalid_request");
+            return;
+        }
+        TokenService::Status status = tokens->verify(token, &claims);
+        if (status != TokenService::kValid)
+        {
+            LOG_DEBUG << "Rejected token for " << req.path() << ": " << TokenService::statusString(status);
+            setUnauthorized(resp, "invalid_token");
+            return;
+        }
+        handler(req, claims, resp);
+    };
+}
+
+} // namespace auth
+} // namespace http
@@ -0,0 +1,152 @@
+#include "../../include/auth/HashExecutor.h"
+#include "../../include/metrics/Metrics.h"
+
+#include <muduo/base/Logging.h>
+#include <muduo/base/Timestamp.h>
+
+#include <algorithm>
+
+namespace http
+{
+namespace auth
+{
+
+HashExecutor::HashExecutor(const Options& options)
+    : options_(options)
+    , running_(false)
+    , queued_(0)
+    , completed_(0)
+    , rejected_(0)
+    , timedOut_(0)
+    , failed_(0)
+{
+    options_.threads = std::max(1, options_.threads);
+}
+
+HashExecutor::~HashExecutor()
+{
+    stop();
+}
+
+void HashExecutor::start()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (running_)
+    {
+        return;
+    }
+    running_ = true;
+    for (int i = 0; i < options_.threads; ++i)
+    {
+        threads_.emplace_back(&HashExecutor::workerLoop, this);
+    }
+    LOG_INFO << "HashExecutor started with " << options_.threads << " threads, queue limit "
+             << options_.maxQueueSize;
+}
+
+void HashExecutor::stop()
+{
+    std::deque<Job> cancelled;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!running_)
+        {
+            return;
+        }
+        running_ = false;
+        cancelled.swap(queue_);
+        queued_.store(0, std::memory_order_relaxed);
+    }
+    notEmpty_.notify_all();
+    for (std::thread& thread : threads_)
+    {
+        thread.join();
+    }
+    threads_.clear();
+    // 还在排队的任务取消掉，调用方按超时处理
+    for (Job& job : cancelled)
+    {
+        timedOut_.fetch_add(1, std::memory_order_relaxed);
+        job.done(kTimedOut);
+    }
+}
+
+void HashExecutor::submit(const Task& task, Deadline deadline, const Done& done)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (running_ && queue_.size() < options_.maxQueueSize)
+        {
+            Job job;
+            job.task = task;
+            job.done = done;
+            job.deadline = deadline;
+            job.enqueuedUs = muduo::Timestamp::now().microSecondsSinceEpoch();
+            queue_.push_back(std::move(job));
+            queued_.store(static_cast<int>(queue_.size()), std::memory_order_relaxed);
+            notEmpty_.notify_one();
+            return;
+        }
+    }
+    rejected_.fetch_add(1, std::memory_order_relaxed);
+    done(kRejected);
+}
+
+void HashExecutor::workerLoop()
+{
+    metrics::MetricsRegistry& registry = metrics::MetricsRegistry::instance();
+    for (;;)
+    {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            notEmpty_.wait(lock, [this] { return !running_ || !queue_.empty(); });
+            if (!running_)
+            {
+                return;
+            }
+            job = std::move(queue_.front());
+            queue_.pop_front();
+            queued_.store(static_cast<int>(queue_.size()), std::memory_order_relaxed);
+        }
+
+        int64_t startUs = muduo::Timestamp::now().microSecondsSinceEpoch();
+        registry.observePasswordHashWait(startUs - job.enqueuedUs);
+        // 排队的时候请求已经超时了：客户端多半已经放弃，不再白算一次 KDF
+        if (job.deadline != Deadline::max() && std::chrono::steady_clock::now() >= job.deadline)
+        {
+            timedOut_.fetch_add(1, std::memory_order_relaxed);
+            job.done(kTimedOut);
+            continue;
+        }
+        // 任务抛了异常的话结果是半成品 (比如 verified 还是初始值)，不能当成算完了
+        Result result = kDone;
+        try
+        {
+            job.task();
+        }
+        catch (const std::exception& e)
+        {
+            LOG_ERROR << "Password hashing task failed: " << e.what();
+            result = kFailed;
+        }
+        catch (...)
+        {
+            LOG_ERROR << "Password hashing task failed";
+            result = kFailed;
+        }
+        registry.observePasswordHash(muduo::Timestamp::now().microSecondsSinceEpoch() - startUs);
+        if (result == kDone)
+        {
+            completed_.fetch_add(1, std::memory_order_relaxed);
+        }
+        else
+        {
+            failed_.fetch_add(1, std::memory_order_relaxed);
+        }
+        job.done(result);
+    }
+}
+
+} // namespace auth
+} // namespace http
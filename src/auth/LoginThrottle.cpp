@@ -0,0 +1,277 @@
+#include "../../include/auth/LoginThrottle.h"
+#include "../../include/http/RateLimiter.h"
+
+#include <algorithm>
+#include <ctype.h>
+
+namespace http
+{
+namespace auth
+{
+
+const int LoginThrottle::kWays;
+
+namespace
+{
+
+const uint64_t kCountMask = 0xffff;
+const uint64_t kIndexMask = 0xffffffff;
+
+// key 的种类，同一个哈希值的用户名和 IP 不会撞在一起
+const uint64_t kUserTag = 0x75736572ULL << 32;
+const uint64_t kIpTag = 0x69706164ULL << 32;
+
+uint64_t packState(uint64_t index, uint64_t prev, uint64_t curr)
+{
+    return ((index & kIndexMask) << 32) | (prev << 16) | curr;
+}
+
+uint64_t mix64(uint64_t x)
+{
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+uint64_t nonZero(uint64_t h)
+{
+    return h != 0 ? h : 1; // 0 留给空槽
+}
+
+// 用户名不区分大小写 (MySQL 默认的排序规则下 Admin 和 admin 是同一个账号)，换大小写绕不过去
+uint64_t userKey(const std::string& username)
+{
+    uint64_t h = 0xcbf29ce484222325ULL; // FNV-1a
+    for (char c : username)
+    {
+        h ^= static_cast<unsigned char>(::tolower(static_cast<unsigned char>(c)));
+        h *= 0x100000001b3ULL;
+    }
+    return nonZero(mix64(h ^ kUserTag));
+}
+
+// 和限流用同一个地址键：IPv6 按 /64 前缀，双栈监听时的 IPv4 客户端按 IPv4 地址
+uint64_t ipKey(const muduo::net::InetAddress& peer)
+{
+    return nonZero(mix64(RateLimiter::clientKey(peer) ^ kIpTag));
+}
+
+} // namespace
+
+LoginThrottle::LoginThrottle(const Options& options)
+    : options_(options)
+    , windowMs_(static_cast<uint64_t>(std::max(1, options.windowSeconds)) * 1000)
+    , setMask_(0)
+    , epoch_(std::chrono::steady_clock::now())
+    , blockedAttempts_(0)
+{
+    size_t sets = 1;
+    while (sets * kWays < options_.capacity)
+    {
+        sets <<= 1;
+    }
+    setMask_ = sets - 1;
+    slots_.reset(new Slot[sets * kWays]);
+    for (size_t i = 0; i < sets * kWays; ++i)
+    {
+        slots_[i].key.store(0, std::memory_order_relaxed);
+        slots_[i].state.store(0, std::memory_order_relaxed);
+    }
+}
+
+LoginThrottle::~LoginThrottle() = default;
+
+uint64_t LoginThrottle::nowMs() const
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - epoch_).count();
+}
+
+bool LoginThrottle::blocked(const std::string& username, const muduo::net::InetAddress& peer,
+                            int* retryAfterSeconds)
+{
+    uint64_t now = nowMs();
+    int userWait = 0;
+    int ipWait = 0;
+    bool userOver = over(userKey(username), options_.maxFailuresPerUser, now, &userWait);
+    bool ipOver = over(ipKey(peer), options_.maxFailuresPerIp, now, &ipWait);
+    if (!userOver && !ipOver)
+    {
+        return false;
+    }
+    blockedAttempts_.fetch_add(1, std::memory_order_relaxed);
+    *retryAfterSeconds = std::max(userWait, ipWait);
+    return true;
+}
+
+void LoginThrottle::recordFailure(const std::string& username, const muduo::net::InetAddress& peer)
+{
+    uint64_t now = nowMs();
+    increment(userKey(username), now);
+    increment(ipKey(peer), now);
+}
+
+void LoginThrottle::recordSuccess(const std::string& username)
+{
+    if (Slot* slot = find(userKey(username)))
+    {
+        slot->state.store(0, std::memory_order_relaxed);
+    }
+}
+
+bool LoginThrottle::over(uint64_t key, int limit, uint64_t nowMs, int* retryAfterSeconds)
+{
+    if (limit <= 0)
+    {
+        return false; // 不限
+    }
+    Slot* slot = find(key);
+    if (!slot)
+    {
+        return false;
+    }
+    uint64_t state = slot->state.load(std::memory_order_acquire);
+    if (estimate(state, nowMs) < limit)
+    {
+        return false;
+    }
+    *retryAfterSeconds = this->retryAfterSeconds(state, nowMs, limit);
+    return true;
+}
+
+double LoginThrottle::estimate(uint64_t state, uint64_t nowMs) const
+{
+    if (state == 0)
+    {
+        return 0;
+    }
+    uint64_t index = (nowMs / windowMs_) & kIndexMask;
+    uint64_t behind = (index - (state >> 32)) & kIndexMask;
+    double prevWeight = 1 - static_cast<double>(nowMs % windowMs_) / windowMs_;
+    uint64_t prev = (state >> 16) & kCountMask;
+    uint64_t curr = state & kCountMask;
+    if (behind == 0)
+    {
+        return curr + prev * prevWeight;
+    }
+    if (behind == 1)
+    {
+        return curr * prevWeight; // 记录的本窗口已经成了上个窗口
+    }
+    return 0;
+}
+
+int LoginThrottle::retryAfterSeconds(uint64_t state, uint64_t nowMs, int limit) const
+{
+    uint64_t index = (nowMs / windowMs_) & kIndexMask;
+    uint64_t behind = (index - (state >> 32)) & kIndexMask;
+    double curr = static_cast<double>(state & kCountMask);
+    double prev = static_cast<double>((state >> 16) & kCountMask);
+    if (behind == 1)
+    {
+        prev = curr;
+        curr = 0;
+    }
+    double window = static_cast<double>(windowMs_);
+    double offset = static_cast<double>(nowMs % windowMs_);
+    double waitMs;
+    if (curr >= limit)
+    {
+        // 要等本窗口变成上个窗口，并且它的权重降到 limit / curr 以下
+        waitMs = (window - offset) + window * (1 - limit / curr);
+    }
+    else
+    {
+        // 上个窗口的权重降到 (limit - curr) / prev 以下
+        waitMs = window * (1 - (limit - curr) / prev) - offset;
+    }
+    return std::max(1, static_cast<int>((waitMs + 999) / 1000));
+}
+
+LoginThrottle::Slot* LoginThrottle::find(uint64_t key)
+{
+    Slot* set = &slots_[(key & setMask_) * kWays];
+    for (int i = 0; i < kWays; ++i)
+    {
+        if (set[i].key.load(std::memory_order_acquire) == key)
+        {
+            return &set[i];
+        }
+    }
+    return nullptr;
+}
+
+LoginThrottle::Slot* LoginThrottle::findOrInsert(uint64_t key, uint64_t nowMs)
+{
+    Slot* set = &slots_[(key & setMask_) * kWays];
+    for (int attempt = 0; attempt < 2; ++attempt)
+    {
+        // 组满时替换空槽、过期的槽，再不行替换估计值最小的槽
+        Slot* victim = nullptr;
+        double victimScore = 0;
+        for (int i = 0; i < kWays; ++i)
+        {
+            uint64_t slotKey = set[i].key.load(std::memory_order_acquire);
+            if (slotKey == key)
+            {
+                return &set[i];
+            }
+            double score = slotKey == 0 ? -1 : estimate(set[i].state.load(std::memory_order_relaxed), nowMs);
+            if (!victim || score < victimScore)
+            {
+                victim = &set[i];
+                victimScore = score;
+            }
+        }
+
+        uint64_t oldKey = victim->key.load(std::memory_order_relaxed);
+        if (oldKey != key && victim->key.compare_exchange_strong(oldKey, key, std::memory_order_acq_rel))
+        {
+            victim->state.store(0, std::memory_order_release);
+            return victim;
+        }
+        // 别的线程抢先占了这个槽 (可能就是同一个 key)，重新找一遍
+    }
+    return nullptr;
+}
+
+void LoginThrottle::increment(uint64_t key, uint64_t nowMs)
+{
+    Slot* slot = findOrInsert(key, nowMs);
+    if (!slot)
+    {
+        return;
+    }
+    uint64_t index = (nowMs / windowMs_) & kIndexMask;
+    uint64_t state = slot->state.load(std::memory_order_acquire);
+    for (;;)
+    {
+        uint64_t behind = (index - (state >> 32)) & kIndexMask;
+        uint64_t prev = (state >> 16) & kCountMask;
+        uint64_t curr = state & kCountMask;
+        if (state != 0 && behind == 0)
+        {
+            curr = std::min(curr + 1, kCountMask);
+        }
+        else if (state != 0 && behind == 1)
+        {
+            prev = curr;
+            curr = 1;
+        }
+        else
+        {
+            prev = 0;
+            curr = 1;
+        }
+        if (slot->state.compare_exchange_weak(state, packState(index, prev, curr), std::memory_order_acq_rel))
+        {
+            return;
+        }
+    }
+}
+
+} // namespace auth
+} // namespace http
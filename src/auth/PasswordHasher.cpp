@@ -0,0 +1,199 @@
+#include "../../include/auth/PasswordHasher.h"
+
+#include <muduo/base/Logging.h>
+
+#include <openssl/crypto.h>
+#include <openssl/evp.h>
+#include <openssl/rand.h>
+
+#include <stdio.h>
+#include <string.h>
+
+namespace http
+{
+namespace auth
+{
+
+namespace
+{
+
+const char   kPrefix[] = "$scrypt$";
+const size_t kPrefixLength = sizeof(kPrefix) - 1;
+const size_t kSaltLength = 16;
+const size_t kKeyLength = 32;
+
+struct Encoded
+{
+    PasswordHasher::Params params;
+    std::string            salt;
+    std::string            key;
+};
+
+std::string base64Encode(const unsigned char* data, size_t len)
+{
+    std::string out(4 * ((len + 2) / 3) + 1, '\0');
+    int n = ::EVP_EncodeBlock(reinterpret_cast<unsigned char*>(&out[0]), data, static_cast<int>(len));
+    out.resize(n);
+    return out;
+}
+
+bool base64Decode(const std::string& in, std::string* out)
+{
+    if (in.empty() || in.size() % 4 != 0)
+    {
+        return false;
+    }
+    out->assign(in.size() / 4 * 3 + 1, '\0');
+    int n = ::EVP_DecodeBlock(reinterpret_cast<unsigned char*>(&(*out)[0]),
+                              reinterpret_cast<const unsigned char*>(in.data()), static_cast<int>(in.size()));
+    if (n < 0)
+    {
+        return false;
+    }
+    // EVP_DecodeBlock 把填充的 '=' 也算成了 0 字节
+    size_t padding = 0;
+    for (size_t i = in.size(); i > 0 && in[i - 1] == '='; --i)
+    {
+        ++padding;
+    }
+    out->resize(n - padding);
+    return true;
+}
+
+bool validParams(const PasswordHasher::Params& params)
+{
+    return params.logN >= 1 && params.logN <= 24 && params.r >= 1 && params.r <= 64 &&
+           params.p >= 1 && params.p <= 16;
+}
+
+// $scrypt$ln=14,r=8,p=1$<salt>$<key>
+bool decode(const std::string& stored, Encoded* encoded)
+{
+    if (stored.compare(0, kPrefixLength, kPrefix) != 0)
+    {
+        return false;
+    }
+    size_t paramsEnd = stored.find('$', kPrefixLength);
+    if (paramsEnd == std::string::npos)
+    {
+        return false;
+    }
+    size_t saltEnd = stored.find('$', paramsEnd + 1);
+    if (saltEnd == std::string::npos)
+    {
+        return false;
+    }
+    std::string params = stored.substr(kPrefixLength, paramsEnd - kPrefixLength);
+    int consumed = 0;
+    if (::sscanf(params.c_str(), "ln=%d,r=%d,p=%d%n", &encoded->params.logN, &encoded->params.r,
+                 &encoded->params.p, &consumed) != 3 ||
+        static_cast<size_t>(consumed) != params.size() || !validParams(encoded->params))
+    {
+        return false;
+    }
+    return base64Decode(stored.substr(paramsEnd + 1, saltEnd - paramsEnd - 1), &encoded->salt) &&
+           base64Decode(stored.substr(saltEnd + 1), &encoded->key) &&
+           !encoded->key.empty();
+}
+
+bool derive(const std::string& password, const std::string& salt, const PasswordHasher::Params& params,
+            unsigned char* key, size_t keyLength)
+{
+    uint64_t n = 1ULL << params.logN;
+    uint64_t r = static_cast<uint64_t>(params.r);
+    uint64_t p = static_cast<uint64_t>(params.p);
+    // OpenSSL 默认只允许 32MB，按参数算出实际需要的内存 (V 数组 + B 数组) 再留点余量
+    uint64_t maxMem = 128 * r * (n + 2) + 128 * r * p + (1 << 20);
+    if (::EVP_PBE_scrypt(password.data(), password.size(),
+                         reinterpret_cast<const unsigned char*>(salt.data()), salt.size(),
+                         n, r, p, maxMem, key, keyLength) != 1)
+    {
+        LOG_ERROR << "EVP_PBE_scrypt failed (ln=" << params.logN << ", r=" << params.r
+                  << ", p=" << params.p << ")";
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+PasswordHasher::PasswordHasher(const Params& params)
+    : params_(params)
+{
+    if (!validParams(params_))
+    {
+        LOG_ERROR << "Invalid scrypt parameters (ln=" << params_.logN << ", r=" << params_.r
+                  << ", p=" << params_.p << "), using defaults";
+        params_ = Params();
+    }
+}
+
+bool PasswordHasher::isLegacyPlaintext(const std::string& stored)
+{
+    return stored.compare(0, kPrefixLength, kPrefix) != 0;
+}
+
+std::string PasswordHasher::hash(const std::string& password) const
+{
+    unsigned char salt[kSaltLength];
+    if (::RAND_bytes(salt, sizeof salt) != 1)
+    {
+        LOG_ERROR << "RAND_bytes failed";
+        return std::string();
+    }
+    unsigned char key[kKeyLength];
+    if (!derive(password, std::string(reinterpret_cast<const char*>(salt), sizeof salt), params_,
+                key, sizeof key))
+    {
+        return std::string();
+    }
+
+    char params[48];
+    snprintf(params, sizeof params, "ln=%d,r=%d,p=%d", params_.logN, params_.r, params_.p);
+    std::string out(kPrefix);
+    out.append(params).append("$").append(base64Encode(salt, sizeof salt))
+       .append("$").append(base64Encode(key, sizeof key));
+    return out;
+}
+
+bool PasswordHasher::verify(const std::string& password, const std::string& stored) const
+{
+    if (isLegacyPlaintext(stored))
+    {
+        // 旧数据：明文比较，也用定长时间比较，不按第一个不同的字节提前返回。
+        // 照样按当前参数算一次 KDF (结果不用)：耗时和哈希过的账号、不存在的账号 (校验 dummy 哈希) 一样，
+        // 不能凭响应时间分辨出哪些账号还存着明文
+        unsigned char scratch[kKeyLength];
+        derive(password, std::string(kSaltLength, '\0'), params_, scratch, sizeof scratch);
+        return password.size() == stored.size() &&
+               ::CRYPTO_memcmp(password.data(), stored.data(), stored.size()) == 0;
+    }
+
+    Encoded encoded;
+    if (!decode(stored, &encoded))
+    {
+        LOG_WARN << "Malformed scrypt hash in storage";
+        return false;
+    }
+    std::string key(encoded.key.size(), '\0');
+    if (!derive(password, encoded.salt, encoded.params,
+                reinterpret_cast<unsigned char*>(&key[0]), key.size()))
+    {
+        return false;
+    }
+    return ::CRYPTO_memcmp(key.data(), encoded.key.data(), key.size()) == 0;
+}
+
+bool PasswordHasher::needsRehash(const std::string& stored) const
+{
+    Encoded encoded;
+    if (!decode(stored, &encoded))
+    {
+        return true;
+    }
+    return encoded.params.logN != params_.logN || encoded.params.r != params_.r ||
+           encoded.params.p != params_.p;
+}
+
+} // namespace auth
+} // namespace http
@@ -0,0 +1,424 @@
+#include "../../include/auth/SessionStore.h"
+#include "../base/json.hpp"
+
+#include <muduo/base/Logging.h>
+
+#include <openssl/rand.h>
+
+#include <algorithm>
+#include <chrono>
+#include <fcntl.h>
+#include <fstream>
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+
+using json = nlohmann::json;
+
+namespace http
+{
+namespace auth
+{
+
+const char SessionStore::kCookieName[] = "sentinel_session";
+
+namespace
+{
+
+const int kSnapshotVersion = 1;
+// 时间轮最多这么多格，空闲超时很长时每格覆盖多秒
+const int64_t kMaxWheelSlots = 512;
+
+int64_t nowSeconds()
+{
+    return static_cast<int64_t>(::time(nullptr));
+}
+
+std::string newSessionId()
+{
+    static const char kHex[] = "0123456789abcdef";
+    unsigned char random[16];
+    if (::RAND_bytes(random, sizeof random) != 1)
+    {
+        LOG_ERROR << "RAND_bytes failed while creating a session";
+        return std::string();
+    }
+    std::string id(sizeof random * 2, '\0');
+    for (size_t i = 0; i < sizeof random; ++i)
+    {
+        id[2 * i] = kHex[random[i] >> 4];
+        id[2 * i + 1] = kHex[random[i] & 0xf];
+    }
+    return id;
+}
+
+} // namespace
+
+SessionStore::SessionStore(const Options& options)
+    : options_(options)
+    , size_(0)
+    , evictions_(0)
+    , expired_(0)
+    , running_(false)
+{
+    options_.idleTimeoutSeconds = std::max(1, options_.idleTimeoutSeconds);
+    options_.snapshotIntervalSeconds = std::max(1, options_.snapshotIntervalSeconds);
+    int shards = 1;
+    while (shards < options_.shards)
+    {
+        shards <<= 1;
+    }
+    options_.shards = shards;
+
+    tickSeconds_ = std::max<int64_t>(1, (options_.idleTimeoutSeconds + kMaxWheelSlots - 1) / kMaxWheelSlots);
+    // 比空闲超时多两格：最老的未过期会话和当前格子之间不会绕回同一个下标
+    size_t slots = static_cast<size_t>(options_.idleTimeoutSeconds / tickSeconds_ + 2);
+    maxPerShard_ = std::max<size_t>(1, options_.maxSessions / shards);
+    int64_t now = nowSeconds();
+    for (int i = 0; i < shards; ++i)
+    {
+        shards_.emplace_back(new Shard);
+        shards_.back()->wheel.resize(slots);
+        shards_.back()->oldestTick = now / tickSeconds_;
+    }
+}
+
+SessionStore::~SessionStore()
+{
+    stop();
+}
+
+void SessionStore::start()
+{
+    std::lock_guard<std::mutex> lock(runMutex_);
+    if (running_)
+    {
+        return;
+    }
+    running_ = true;
+    thread_ = std::thread(&SessionStore::maintenanceLoop, this);
+}
+
+void SessionStore::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(runMutex_);
+        if (!running_)
+        {
+            return;
+        }
+        running_ = false;
+    }
+    stopCond_.notify_all();
+    thread_.join();
+    if (!options_.snapshotPath.empty())
+    {
+        saveSnapshot(options_.snapshotPath);
+    }
+}
+
+SessionStore::Shard& SessionStore::shardFor(const std::string& id)
+{
+    return *shards_[std::hash<std::string>()(id) & (shards_.size() - 1)];
+}
+
+bool SessionStore::expired(const Session& session, int64_t now) const
+{
+    return session.lastAccess + options_.idleTimeoutSeconds <= now;
+}
+
+// 从最老的格子往后删过期会话，碰到第一个没过期的就停 (后面的都比它新)
+size_t SessionStore::expireLocked(Shard& shard, int64_t now)
+{
+    int64_t current = now / tickSeconds_;
+    size_t removed = 0;
+    while (shard.oldestTick < current)
+    {
+        if (shard.index.empty())
+        {
+            shard.oldestTick = current;
+            break;
+        }
+        EntryList& list = slot(shard, shard.oldestTick);
+        while (!list.empty() && expired(list.front().session, now))
+        {
+            shard.index.erase(list.front().session.id);
+            list.pop_front();
+            ++removed;
+        }
+        if (!list.empty())
+        {
+            break;
+        }
+        ++shard.oldestTick;
+    }
+    if (removed > 0)
+    {
+        size_.fetch_sub(static_cast<int64_t>(removed), std::memory_order_relaxed);
+        expired_.fetch_add(removed, std::memory_order_relaxed);
+    }
+    return removed;
+}
+
+// 分片满了：删掉最久没访问的会话 (最老的非空格子的头部)
+void SessionStore::evictOldestLocked(Shard& shard)
+{
+    for (;;)
+    {
+        EntryList& list = slot(shard, shard.oldestTick);
+        if (!list.empty())
+        {
+            shard.index.erase(list.front().session.id);
+            list.pop_front();
+            break;
+        }
+        ++shard.oldestTick;
+    }
+    size_.fetch_sub(1, std::memory_order_relaxed);
+    evictions_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void SessionStore::insertLocked(Shard& shard, const Session& session)
+{
+    if (shard.index.size() >= maxPerShard_)
+    {
+        evictOldestLocked(shard);
+    }
+    // 时钟回拨时也不放到比最老格子更早的位置
+    int64_t tick = std::max(session.lastAccess / tickSeconds_, shard.oldestTick);
+    EntryList& list = slot(shard, tick);
+    list.push_back(Entry{ session, tick });
+    shard.index[session.id] = std::prev(list.end());
+    size_.fetch_add(1, std::memory_order_relaxed);
+}
+
+std::string SessionStore::create(int64_t userId, const std::string& username)
+{
+    Session session;
+    session.id = newSessionId();
+    if (session.id.empty())
+    {
+        return std::string();
+    }
+    session.userId = userId;
+    session.username = username;
+    session.createdAt = nowSeconds();
+    session.lastAccess = session.createdAt;
+
+    Shard& shard = shardFor(session.id);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    expireLocked(shard, session.createdAt);
+    insertLocked(shard, session);
+    return session.id;
+}
+
+bool SessionStore::touch(const std::string& id, Session* session)
+{
+    int64_t now = nowSeconds();
+    Shard& shard = shardFor(id);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    expireLocked(shard, now);
+    auto it = shard.index.find(id);
+    if (it == shard.index.end())
+    {
+        return false;
+    }
+    EntryList::iterator entry = it->second;
+    if (expired(entry->session, now))
+    {
+        // 时钟回拨过才会走到这里：顺序被打乱的过期会话没被上面清掉
+        slot(shard, entry->tick).erase(entry);
+        shard.index.erase(it);
+        size_.fetch_sub(1, std::memory_order_relaxed);
+        expired_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    // 挪到当前格子的末尾：时间轮里的顺序始终是最后访问时间的顺序
+    int64_t tick = std::max(now / tickSeconds_, entry->tick);
+    EntryList& from = slot(shard, entry->tick);
+    EntryList& to = slot(shard, tick);
+    to.splice(to.end(), from, entry);
+    entry->tick = tick;
+    entry->session.lastAccess = std::max(now, entry->session.lastAccess);
+    if (session)
+    {
+        *session = entry->session;
+    }
+    return true;
+}
+
+bool SessionStore::remove(const std::string& id)
+{
+    Shard& shard = shardFor(id);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.index.find(id);
+    if (it == shard.index.end())
+    {
+        return false;
+    }
+    slot(shard, it->second->tick).erase(it->second);
+    shard.index.erase(it);
+    size_.fetch_sub(1, std::memory_order_relaxed);
+    return true;
+}
+
+size_t SessionStore::expire()
+{
+    int64_t now = nowSeconds();
+    size_t removed = 0;
+    for (auto& shard : shards_)
+    {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        removed += expireLocked(*shard, now);
+    }
+    return removed;
+}
+
+bool SessionStore::saveSnapshot(const std::string& path) const
+{
+    // 先在锁里拷出来，写文件时不占着分片锁
+    std::vector<Session> sessions;
+    sessions.reserve(size());
+    for (const auto& shard : shards_)
+    {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        for (const auto& item : shard->index)
+        {
+            sessions.push_back(item.second->session);
+        }
+    }
+
+    // 快照里的会话 id 等同于登录凭据，文件只给自己读写
+    std::string tmpPath = path + ".tmp";
+    int fd = ::open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    FILE* fp = fd >= 0 ? ::fdopen(fd, "w") : nullptr;
+    if (!fp)
+    {
+        if (fd >= 0)
+        {
+            ::close(fd);
+        }
+        LOG_ERROR << "Cannot write session snapshot " << tmpPath;
+        return false;
+    }
+    json header;
+    header["version"] = kSnapshotVersion;
+    header["savedAt"] = nowSeconds();
+    std::string line = header.dump() + "\n";
+    bool ok = ::fputs(line.c_str(), fp) >= 0;
+    for (const Session& session : sessions)
+    {
+        if (!ok)
+        {
+            break;
+        }
+        json item;
+        item["id"] = session.id;
+        item["userId"] = session.userId;
+        item["username"] = session.username;
+        item["createdAt"] = session.createdAt;
+        item["lastAccess"] = session.lastAccess;
+        line = item.dump() + "\n";
+        ok = ::fputs(line.c_str(), fp) >= 0;
+    }
+    ok = ok && ::fflush(fp) == 0 && ::fsync(::fileno(fp)) == 0;
+    ok = ::fclose(fp) == 0 && ok;
+    if (!ok || ::rename(tmpPath.c_str(), path.c_str()) != 0)
+    {
+        LOG_ERROR << "Failed to save session snapshot " << path;
+        ::unlink(tmpPath.c_str());
+        return false;
+    }
+    LOG_DEBUG << "Saved " << sessions.size() << " sessions to " << path;
+    return true;
+}
+
+size_t SessionStore::loadSnapshot(const std::string& path)
+{
+    std::ifstream in(path);
+    if (!in)
+    {
+        return 0;
+    }
+    int64_t now = nowSeconds();
+    std::vector<Session> sessions;
+    std::string line;
+    bool first = true;
+    while (std::getline(in, line))
+    {
+        try
+        {
+            json item = json::parse(line);
+            if (first)
+            {
+                first = false;
+                if (item.value("version", 0) != kSnapshotVersion)
+                {
+                    LOG_WARN << "Unknown session snapshot version in " << path << ", ignored";
+                    return 0;
+                }
+                continue;
+            }
+            Session session;
+            session.id = item.at("id").get<std::string>();
+            session.userId = item.at("userId").get<int64_t>();
+            session.username = item.at("username").get<std::string>();
+            session.createdAt = item.at("createdAt").get<int64_t>();
+            session.lastAccess = item.at("lastAccess").get<int64_t>();
+            if (!session.id.empty() && !expired(session, now))
+            {
+                sessions.push_back(session);
+            }
+        }
+        catch (const std::exception& e)
+        {
+            LOG_WARN << "Skipping malformed session snapshot line: " << e.what();
+        }
+    }
+
+    // 按最后访问时间从旧到新插入，时间轮里的顺序和原来一样
+    std::sort(sessions.begin(), sessions.end(), [](const Session& a, const Session& b)
+    {
+        return a.lastAccess < b.lastAccess;
+    });
+    size_t loaded = 0;
+    for (const Session& session : sessions)
+    {
+        Shard& shard = shardFor(session.id);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        if (shard.index.count(session.id) == 0)
+        {
+            expireLocked(shard, now);
+            insertLocked(shard, session);
+            ++loaded;
+        }
+    }
+    LOG_INFO << "Loaded " << loaded << " sessions from " << path;
+    return loaded;
+}
+
+void SessionStore::maintenanceLoop()
+{
+    int64_t lastSnapshot = nowSeconds();
+    std::unique_lock<std::mutex> lock(runMutex_);
+    while (running_)
+    {
+        stopCond_.wait_for(lock, std::chrono::seconds(1));
+        if (!running_)
+        {
+            break;
+        }
+        lock.unlock();
+        expire();
+        int64_t now = nowSeconds();
+        if (!options_.snapshotPath.empty() && now - lastSnapshot >= options_.snapshotIntervalSeconds)
+        {
+            saveSnapshot(options_.snapshotPath);
+            lastSnapshot = now;
+        }
+        lock.lock();
+    }
+}
+
+} // namespace auth
+} // namespace http
@@ -0,0 +1,488 @@
+#include "../../include/auth/TokenService.h"
+
+#include <muduo/base/Logging.h>
+
+#include <openssl/crypto.h>
+#include <openssl/evp.h>
+#include <openssl/rand.h>
+
+#include <algorithm>
+#include <string.h>
+#include <time.h>
+#include <vector>
+
+namespace http
+{
+namespace auth
+{
+
+namespace
+{
+
+const unsigned char kVersion = 1;
+// 版本(1) + 用户 id(8) + 签发时间(8) + 过期时间(8) + 令牌 id(8)，后面跟用户名
+const size_t kFixedPayload = 1 + 8 + 8 + 8 + 8;
+const size_t kMaxUsername = 255;
+const size_t kMacLength = 32;            // SHA-256
+const size_t kMacEncodedLength = 43;     // base64url(32 字节)，不带填充
+const size_t kBlockSize = 64;            // SHA-256 的分组长度
+const size_t kMaxTokenLength = 1024;
+const int    kBloomHashes = 4;
+const int64_t kPurgeIntervalSeconds = 60;
+
+std::atomic<uint64_t> g_nextInstanceId(1);
+
+const char kEncodeTable[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+
+// 解码表：非法字符为 0xff
+struct DecodeTable
+{
+    unsigned char values[256];
+
+    DecodeTable()
+    {
+        memset(values, 0xff, sizeof values);
+        for (int i = 0; i < 64; ++i)
+        {
+            values[static_cast<unsigned char>(kEncodeTable[i])] = static_cast<unsigned char>(i);
+        }
+    }
+};
+
+const DecodeTable kDecodeTable;
+
+size_t encodedLength(size_t len)
+{
+    return len / 3 * 4 + (len % 3 == 0 ? 0 : len % 3 + 1);
+}
+
+// base64url 编码 (不带 '=' 填充)，out 至少 encodedLength(len) 字节
+void base64UrlEncode(const unsigned char* in, size_t len, char* out)
+{
+    size_t i = 0;
+    for (; i + 3 <= len; i += 3)
+    {
+        uint32_t v = (static_cast<uint32_t>(in[i]) << 16) | (static_cast<uint32_t>(in[i + 1]) << 8) | in[i + 2];
+        *out++ = kEncodeTable[v >> 18];
+        *out++ = kEncodeTable[(v >> 12) & 0x3f];
+        *out++ = kEncodeTable[(v >> 6) & 0x3f];
+        *out++ = kEncodeTable[v & 0x3f];
+    }
+    if (len - i == 1)
+    {
+        uint32_t v = static_cast<uint32_t>(in[i]) << 16;
+        *out++ = kEncodeTable[v >> 18];
+        *out++ = kEncodeTable[(v >> 12) & 0x3f];
+    }
+    else if (len - i == 2)
+    {
+        uint32_t v = (static_cast<uint32_t>(in[i]) << 16) | (static_cast<uint32_t>(in[i + 1]) << 8);
+        *out++ = kEncodeTable[v >> 18];
+        *out++ = kEncodeTable[(v >> 12) & 0x3f];
+        *out++ = kEncodeTable[(v >> 6) & 0x3f];
+    }
+}
+
+// base64url 解码，遇到非法字符或长度不对返回 false
+bool base64UrlDecode(const char* in, size_t len, std::string* out)
+{
+    if (len % 4 == 1)
+    {
+        return false;
+    }
+    out->resize(len / 4 * 3 + (len % 4 == 0 ? 0 : len % 4 - 1));
+    unsigned char* dst = reinterpret_cast<unsigned char*>(&(*out)[0]);
+    const unsigned char* src = reinterpret_cast<const unsigned char*>(in);
+    // 四个字符的 6 位值或在一起，任何一个非法 (0xff) 都会让结果的高位置位
+    size_t i = 0;
+    for (; i + 4 <= len; i += 4)
+    {
+        uint32_t a = kDecodeTable.values[src[i]];
+        uint32_t b = kDecodeTable.values[src[i + 1]];
+        uint32_t c = kDecodeTable.values[src[i + 2]];
+        uint32_t d = kDecodeTable.values[src[i + 3]];
+        if ((a | b | c | d) & 0x80)
+        {
+            return false;
+        }
+        uint32_t v = (a << 18) | (b << 12) | (c << 6) | d;
+        *dst++ = static_cast<unsigned char>(v >> 16);
+        *dst++ = static_cast<unsigned char>(v >> 8);
+        *dst++ = static_cast<unsigned char>(v);
+    }
+    size_t rest = len - i;
+    if (rest > 0)
+    {
+        uint32_t v = 0;
+        for (size_t j = 0; j < rest; ++j)
+        {
+            uint32_t x = kDecodeTable.values[src[i + j]];
+            if (x & 0x80)
+            {
+                return false;
+            }
+            v |= x << (18 - 6 * j);
+        }
+        *dst++ = static_cast<unsigned char>(v >> 16);
+        if (rest == 3)
+        {
+            *dst++ = static_cast<unsigned char>(v >> 8);
+        }
+    }
+    return true;
+}
+
+void putUint64(unsigned char* p, uint64_t v)
+{
+    for (int i = 0; i < 8; ++i)
+    {
+        p[i] = static_cast<unsigned char>(v >> (8 * i));
+    }
+}
+
+uint64_t getUint64(const unsigned char* p)
+{
+    uint64_t v = 0;
+    for (int i = 7; i >= 0; --i)
+    {
+        v = (v << 8) | p[i];
+    }
+    return v;
+}
+
+uint64_t mix64(uint64_t x)
+{
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+// 每个线程缓存一份 HMAC 的中间状态：密钥异或 ipad/opad 后的分组已经压缩进了 inner/outer，
+// 之后每条消息只需要拷贝上下文再算消息本身，省掉两次分组压缩和上下文的创建
+struct HmacContext
+{
+    uint64_t    owner = 0; // 所属 TokenService 的实例 id
+    EVP_MD_CTX* inner = nullptr;
+    EVP_MD_CTX* outer = nullptr;
+    EVP_MD_CTX* work = nullptr;
+
+    ~HmacContext()
+    {
+        ::EVP_MD_CTX_free(inner);
+        ::EVP_MD_CTX_free(outer);
+        ::EVP_MD_CTX_free(work);
+    }
+
+    void init(uint64_t id, const std::string& key)
+    {
+        if (!inner)
+        {
+            inner = ::EVP_MD_CTX_new();
+            outer = ::EVP_MD_CTX_new();
+            work = ::EVP_MD_CTX_new();
+        }
+        // 密钥比分组长先哈希一次 (RFC 2104)
+        unsigned char block[kBlockSize] = { 0 };
+        if (key.size() > kBlockSize)
+        {
+            unsigned int n = 0;
+            ::EVP_Digest(key.data(), key.size(), block, &n, ::EVP_sha256(), nullptr);
+        }
+        else
+        {
+            memcpy(block, key.data(), key.size());
+        }
+        unsigned char ipad[kBlockSize];
+        unsigned char opad[kBlockSize];
+        for (size_t i = 0; i < kBlockSize; ++i)
+        {
+            ipad[i] = block[i] ^ 0x36;
+            opad[i] = block[i] ^ 0x5c;
+        }
+        ::EVP_DigestInit_ex(inner, ::EVP_sha256(), nullptr);
+        ::EVP_DigestUpdate(inner, ipad, sizeof ipad);
+        ::EVP_DigestInit_ex(outer, ::EVP_sha256(), nullptr);
+        ::EVP_DigestUpdate(outer, opad, sizeof opad);
+        ::OPENSSL_cleanse(block, sizeof block);
+        ::OPENSSL_cleanse(ipad, sizeof ipad);
+        ::OPENSSL_cleanse(opad, sizeof opad);
+        owner = id;
+    }
+};
+
+thread_local HmacContext t_hmac;
+
+int64_t nowSeconds()
+{
+    return static_cast<int64_t>(::time(nullptr));
+}
+
+} // namespace
+
+TokenService::TokenService(const Options& options)
+    : options_(options)
+    , key_(options.secret)
+    , instanceId_(g_nextInstanceId.fetch_add(1))
+    , filterMask_(0)
+    , lastPurge_(nowSeconds())
+    , revokedTokens_(0)
+    , rejectedTokens_(0)
+{
+    if (key_.empty())
+    {
+        unsigned char random[32];
+        if (::RAND_bytes(random, sizeof random) != 1)
+        {
+            LOG_FATAL << "RAND_bytes failed while generating the token key";
+        }
+        key_.assign(reinterpret_cast<const char*>(random), sizeof random);
+        ::OPENSSL_cleanse(random, sizeof random);
+    }
+    if (options_.ttlSeconds <= 0)
+    {
+        options_.ttlSeconds = Options().ttlSeconds;
+    }
+
+    size_t bits = 64;
+    while (bits < options_.revocationBits)
+    {
+        bits <<= 1;
+    }
+    filterMask_ = bits - 1;
+    filter_.reset(new std::atomic<uint64_t>[bits / 64]);
+    for (size_t i = 0; i < bits / 64; ++i)
+    {
+        filter_[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+TokenService::~TokenService()
+{
+    ::OPENSSL_cleanse(&key_[0], key_.size());
+}
+
+const char* TokenService::statusString(Status status)
+{
+    switch (status)
+    {
+    case kValid: return "valid";
+    case kMalformed: return "malformed";
+    case kBadSignature: return "bad signature";
+    case kExpired: return "expired";
+    case kRevoked: return "revoked";
+    }
+    return "unknown";
+}
+
+void TokenService::sign(const char* data, size_t len, unsigned char* mac) const
+{
+    HmacContext& ctx = t_hmac;
+    if (ctx.owner != instanceId_)
+    {
+        ctx.init(instanceId_, key_);
+    }
+    unsigned char innerHash[kMacLength];
+    ::EVP_MD_CTX_copy_ex(ctx.work, ctx.inner);
+    ::EVP_DigestUpdate(ctx.work, data, len);
+    ::EVP_DigestFinal_ex(ctx.work, innerHash, nullptr);
+    ::EVP_MD_CTX_copy_ex(ctx.work, ctx.outer);
+    ::EVP_DigestUpdate(ctx.work, innerHash, sizeof innerHash);
+    ::EVP_DigestFinal_ex(ctx.work, mac, nullptr);
+}
+
+std::string TokenService::issue(int64_t userId, const std::string& username, TokenClaims* claims) const
+{
+    size_t nameLength = std::min(username.size(), kMaxUsername);
+    unsigned char payload[kFixedPayload + kMaxUsername];
+    uint64_t tokenId = 0;
+    if (::RAND_bytes(reinterpret_cast<unsigned char*>(&tokenId), sizeof tokenId) != 1)
+    {
+        LOG_ERROR << "RAND_bytes failed while issuing a token";
+        return std::string();
+    }
+    int64_t now = nowSeconds();
+    int64_t expiresAt = now + options_.ttlSeconds;
+    payload[0] = kVersion;
+    putUint64(payload + 1, static_cast<uint64_t>(userId));
+    putUint64(payload + 9, static_cast<uint64_t>(now));
+    putUint64(payload + 17, static_cast<uint64_t>(expiresAt));
+    putUint64(payload + 25, tokenId);
+    memcpy(payload + kFixedPayload, username.data(), nameLength);
+
+    size_t payloadLength = kFixedPayload + nameLength;
+    size_t bodyLength = encodedLength(payloadLength);
+    std::string token(bodyLength + 1 + kMacEncodedLength, '\0');
+    base64UrlEncode(payload, payloadLength, &token[0]);
+    token[bodyLength] = '.';
+
+    unsigned char mac[kMacLength];
+    sign(token.data(), bodyLength, mac);
+    base64UrlEncode(mac, sizeof mac, &token[bodyLength + 1]);
+
+    if (claims)
+    {
+        claims->userId = userId;
+        claims->username.assign(username, 0, nameLength);
+        claims->issuedAt = now;
+        claims->expiresAt = expiresAt;
+        claims->tokenId = tokenId;
+    }
+    return token;
+}
+
+TokenService::Status TokenService::verify(const std::string& token, TokenClaims* claims) const
+{
+    TokenClaims unused;
+    if (!claims)
+    {
+        claims = &unused;
+    }
+    Status status = kValid;
+    size_t dot = token.find('.');
+    if (token.size() > kMaxTokenLength || dot == std::string::npos ||
+        token.size() - dot - 1 != kMacEncodedLength)
+    {
+        status = kMalformed;
+    }
+    else
+    {
+        // 先验签名再解析载荷，没有密钥的人构造不出能走到后面的输入
+        unsigned char mac[kMacLength];
+        char expected[kMacEncodedLength];
+        sign(token.data(), dot, mac);
+        base64UrlEncode(mac, sizeof mac, expected);
+        std::string payload;
+        if (::CRYPTO_memcmp(expected, token.data() + dot + 1, kMacEncodedLength) != 0)
+        {
+            status = kBadSignature;
+        }
+        else if (!base64UrlDecode(token.data(), dot, &payload) || payload.size() < kFixedPayload ||
+                 static_cast<unsigned char>(payload[0]) != kVersion)
+        {
+            status = kMalformed;
+        }
+        else
+        {
+            const unsigned char* p = reinterpret_cast<const unsigned char*>(payload.data());
+            claims->userId = static_cast<int64_t>(getUint64(p + 1));
+            claims->issuedAt = static_cast<int64_t>(getUint64(p + 9));
+            claims->expiresAt = static_cast<int64_t>(getUint64(p + 17));
+            claims->tokenId = getUint64(p + 25);
+            claims->username.assign(payload, kFixedPayload, std::string::npos);
+            if (claims->expiresAt <= nowSeconds())
+            {
+                status = kExpired;
+            }
+            else if (maybeRevoked(claims->tokenId))
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (revoked_.count(claims->tokenId) > 0)
+                {
+                    status = kRevoked;
+                }
+            }
+        }
+    }
+    if (status != kValid)
+    {
+        rejectedTokens_.fetch_add(1, std::memory_order_relaxed);
+    }
+    return status;
+}
+
+bool TokenService::maybeRevoked(uint64_t tokenId) const
+{
+    // 双重哈希取 k 个位置：h1 + i * h2
+    uint64_t h = mix64(tokenId);
+    uint64_t h1 = h & 0xffffffffULL;
+    uint64_t h2 = (h >> 32) | 1;
+    for (int i = 0; i < kBloomHashes; ++i)
+    {
+        size_t bit = static_cast<size_t>(h1 + i * h2) & filterMask_;
+        if ((filter_[bit / 64].load(std::memory_order_acquire) & (1ULL << (bit % 64))) == 0)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// 调用方持有 mutex_
+void TokenService::addToFilter(uint64_t tokenId)
+{
+    uint64_t h = mix64(tokenId);
+    uint64_t h1 = h & 0xffffffffULL;
+    uint64_t h2 = (h >> 32) | 1;
+    for (int i = 0; i < kBloomHashes; ++i)
+    {
+        size_t bit = static_cast<size_t>(h1 + i * h2) & filterMask_;
+        filter_[bit / 64].fetch_or(1ULL << (bit % 64), std::memory_order_release);
+    }
+}
+
+void TokenService::revoke(const TokenClaims& claims)
+{
+    int64_t now = nowSeconds();
+    if (claims.expiresAt <= now)
+    {
+        return; // 已经过期的令牌本来就校验不过
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (revoked_.emplace(claims.tokenId, claims.expiresAt).second)
+    {
+        addToFilter(claims.tokenId);
+        revokedTokens_.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (now - lastPurge_ >= kPurgeIntervalSeconds)
+    {
+        purgeRevocations(now);
+    }
+}
+
+// 调用方持有 mutex_。清掉已经过期的吊销记录并重建过滤器：
+// 新的位集合是旧集合的子集，逐个字覆盖的过程中读者看到的总是旧集合的超集，不会漏掉仍然有效的吊销
+void TokenService::purgeRevocations(int64_t now)
+{
+    lastPurge_ = now;
+    size_t before = revoked_.size();
+    for (auto it = revoked_.begin(); it != revoked_.end();)
+    {
+        if (it->second <= now)
+        {
+            it = revoked_.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+    if (revoked_.size() == before)
+    {
+        return;
+    }
+
+    size_t words = (filterMask_ + 1) / 64;
+    std::vector<uint64_t> rebuilt(words, 0);
+    for (const auto& entry : revoked_)
+    {
+        uint64_t h = mix64(entry.first);
+        uint64_t h1 = h & 0xffffffffULL;
+        uint64_t h2 = (h >> 32) | 1;
+        for (int i = 0; i < kBloomHashes; ++i)
+        {
+            size_t bit = static_cast<size_t>(h1 + i * h2) & filterMask_;
+            rebuilt[bit / 64] |= 1ULL << (bit % 64);
+        }
+    }
+    for (size_t i = 0; i < words; ++i)
+    {
+        filter_[i].store(rebuilt[i], std::memory_order_release);
+    }
+    LOG_DEBUG << "Purged " << before - revoked_.size() << " expired token revocations";
+}
+
+} // namespace auth
+} // namespace http
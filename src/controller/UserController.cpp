@@ -1,34 +1,43 @@
 #include "../../include/controller/UserController.h" //接口
+#include "../../include/auth/AuthGuard.h"  //取会话 Cookie
+#include "../../include/auth/HashExecutor.h"  //密码哈希线程池
+#include "../../include/auth/LoginThrottle.h"  //登录失败计数
+#include "../../include/auth/PasswordHasher.h"  //密码哈希 (scrypt)
+#include "../../include/auth/SessionStore.h"  //服务端会话
+#include "../../include/auth/TokenService.h"  //登录令牌
 #include "../../include/db/DbConnectionPool.h"  //引入数据库连接池
 #include "../../src/base/json.hpp"  //引入json格式
-#include <iostream>
+#include <muduo/base/Logging.h>
 #include <string>
 using json=nlohmann::json;
 using namespace http;
 using namespace http::db;
+using namespace http::auth;
+
+// 登录时按用户名查出的密码哈希最多缓存多久 (毫秒)；本进程内改密码会立即失效，其他实例改的靠它兜底
+static const int kUserLookupCacheMs = 2000;
+
+void UserController::setPasswordHashing(PasswordHasher* hasher, HashExecutor* executor) {
+    passwordHasher_=hasher;
+    hashExecutor_=executor;
+    // 用户名不存在时拿它来算一次 KDF，响应时间和用户名存在时一样，不能据此探测哪些账号存在
+    dummyHash_=hasher ? hasher->hash("sentinel-dummy-password") : std::string();
+}
+
+// 哈希线程都忙、排队也满了 (或者排队时已经过了截止时间)：和等不到数据库连接一样回 503
+void UserController::setLoginBusy(HttpResponse* resp) {
+    resp->setStatusCode(HttpResponse::k503ServiceUnavailable);
+    resp->setStatusMessage("Service Unavailable");
+    resp->addHeader("Retry-After","1");
+    resp->setBody(R"({"code":503,"msg":"Login busy, try again later"})");
+}
 
 // ==========================================================
 // 核心功能：登录接口实现
 // ==========================================================
 void UserController::login(const HttpRequest& req, HttpResponse* resp) {
 
-    // ==========================================================
-    // NEW: 添加 CORS 跨域头 (给浏览器的通行证)
-    // ==========================================================
-    resp->addHeader("Access-Control-Allow-Origin", "*");
-    resp->addHeader("Access-Control-Allow-Methods", "POST, GET, OPTIONS");
-    resp->addHeader("Access-Control-Allow-Headers", "Content-Type, Authorization");
-
-    // ==========================================================
-    // NEW: 处理浏览器的“试探”请求 (OPTIONS)
-    // ==========================================================
-    // 注意：这里假设 HttpRequest::kOptions 是你的枚举值。
-    // 如果你的 method() 返回的是 string，请改成 if (req.methodString() == "OPTIONS")
-    if (req.method() == HttpRequest::kOptions) {
-        resp->setStatusCode(HttpResponse::k200Ok);
-        resp->setStatusMessage("OK"); // <--- 【一定要加上这一句】
-        return; 
-    }
+    // CORS (包括 OPTIONS 预检) 由 HttpServer 统一处理，这里只管业务
 
     // ------------------------------------------------------
     // STEP 1: 协议设置
@@ -58,38 +67,124 @@ void UserController::login(const HttpRequest& req, HttpResponse* resp) {
         resp->setBody(R"({"code":400,"msg":"Username or password cannot be empty"})");
         return;
     }
+    // 失败太多次的用户名/IP 直接挡掉，暴力破解和撞库的流量不再打到数据库上
+    int retryAfter=0;
+    if(loginThrottle_ && loginThrottle_->blocked(username, req.peerAddress(), &retryAfter)){
+        resp->setStatusCode(HttpResponse::k429TooManyRequests);
+        resp->setStatusMessage("Too Many Requests");
+        resp->addHeader("Retry-After",std::to_string(retryAfter));
+        resp->setBody(R"({"code":429,"msg":"Too many failed login attempts, try again later"})");
+        return;
+    }
     // ------------------------------------------------------
     // STEP 3: 获取数据库资源 (Resource)
     // ------------------------------------------------------
-    // 从单例连接池中“借”一个连接
-    // getConnection() 返回的是 shared_ptr，用完出作用域会自动归还，不用担心内存泄漏
-    auto conn=DbConnectionPool::getInstance().getConnection();
-    /*  等价于 第一步先拿到连接池的大管家（对象引用）
-        DbConnectionPool& pool = DbConnectionPool::getInstance();
-        //    第二步：再问大管家要一个连接
-        auto conn = pool.getConnection(); */
-    if(!conn){
+    // 用户名 -> 密码哈希的查询走连接池的查询缓存 (SENTINEL_QUERY_CACHE=1 时)：
+    // 同一个用户名短时间内反复登录不用每次都借连接查库，改密码 (UPDATE users) 时缓存立即失效。
+    // 没开缓存时等同于借一个连接查询，查完马上归还 (KDF 要算几十毫秒，不能占着数据库连接)。
+    // 传入请求的截止时间：池子空了最多等到截止时间，之后的查询也不会超过它
+    std::unique_ptr<DbResult> result;
+    try {
+        // ------------------------------------------------------
+        // STEP 4: 数据库查询 (Business Logic)
+        // ------------------------------------------------------
+        // 准备 SQL 语句。
+        // 注意：我们使用 ? 作为占位符，而不是拼接字符串。
+        // 这样如果用户输入 "admin' OR '1'='1"，会被当成纯文本处理，防止 SQL 注入攻击。
+        // 密码存的是哈希，不能在 SQL 里比较，取出来交给 PasswordHasher 校验
+        std::string sql = "SELECT id, password FROM users WHERE username = ?";
+        // 执行查询，传入参数，username 会被填到 ? 的位置
+        // 返回的 DbResult 已经把行读出来了，unique_ptr 负责释放
+        result = DbConnectionPool::getInstance().executeCachedQuery(kUserLookupCacheMs, req.deadline(), sql, username);
+    }catch(const DbTimeoutException& e){
+        // 等连接超时：没做任何工作，告诉客户端稍后重试 (503)；查询超时：504
+        if(e.stage()==DbTimeoutException::kPoolWait){
+            resp->setStatusCode(HttpResponse::k503ServiceUnavailable);
+            resp->setStatusMessage("Service Unavailable");
+            resp->addHeader("Retry-After","1");
+            resp->setBody(R"({"code":503,"msg":"Database busy, try again later"})");
+        }else{
+            resp->setStatusCode(HttpResponse::k504GatewayTimeout);
+            resp->setStatusMessage("Gateway Timeout");
+            resp->setBody(R"({"code":504,"msg":"Database query timed out"})");
+        }
+        LOG_WARN << "Login timed out: " << e.what();
+        return;
+    }catch(const DbException& e){
         resp->setStatusCode(HttpResponse::k500InternalServerError);
-        resp->setBody(R"({"code":500,"msg":"Database connection unavailable"})");
+        resp->setBody(R"({"code":500,"msg":"Database error"})");
+        LOG_ERROR << "Login query failed: " << e.what();
         return;
     }
+    auto attempt = std::make_shared<LoginAttempt>();
+    attempt->username = username;
+    attempt->peer = req.peerAddress();
+    attempt->deadline = req.deadline();
+    std::string stored;
+    attempt->found = result && result->next();
+    if (attempt->found) {
+        attempt->userId = result->getInt("id");
+        stored = result->getString("password");
+    }
+
     // ------------------------------------------------------
-    // STEP 4: 数据库查询 (Business Logic)
+    // STEP 4.5: 校验密码 (KDF 在哈希线程池里算，不占 I/O 线程)
     // ------------------------------------------------------
-    // 准备 SQL 语句。
-    // 注意：我们使用 ? 作为占位符，而不是拼接字符串。
-    // 这样如果用户输入 "admin' OR '1'='1"，会被当成纯文本处理，防止 SQL 注入攻击。
-    std::string sql = "SELECT id, username FROM users WHERE username = ? AND password = ?";
-    // 执行查询，传入参数。conn 会自动帮我们把 username 和 password 填到 ? 的位置
-    auto result = conn->executeQuery(sql, username, password);
+    if (!passwordHasher_) {
+        // 没有配置哈希：只认旧版明文
+        attempt->verified = attempt->found && PasswordHasher::isLegacyPlaintext(stored) && stored == password;
+        finishLogin(*attempt, resp);
+        return;
+    }
+    // 用户名不存在时校验 dummy 哈希，耗时和存在时一样；旧明文或旧参数的哈希校验通过后顺便换成新哈希
+    // (写库也在哈希线程里做，I/O 线程只负责回复)
+    const PasswordHasher* hasher = passwordHasher_;
+    HashExecutor::Task task = [hasher, password, stored, attempt, this] {
+        attempt->verified = hasher->verify(password, attempt->found ? stored : dummyHash_) && attempt->found;
+        if (attempt->verified && hasher->needsRehash(stored)) {
+            saveRehash(attempt->userId, hasher->hash(password), attempt->deadline);
+        }
+    };
+    if (!hashExecutor_) {
+        task();
+        finishLogin(*attempt, resp);
+        return;
+    }
+    // 推迟响应：I/O 线程不等 KDF，算完后把结果投递回 I/O 线程再回复
+    HttpResponse::Completion complete = resp->defer();
+    hashExecutor_->submit(task, req.deadline(), [this, attempt, complete](HashExecutor::Result result) {
+        complete([this, attempt, result](HttpResponse* r) {
+            // 没算 (队列满、超时) 或者算的时候出错：verified 不可信，回 503，不能当成密码错误记失败次数
+            if (result != HashExecutor::kDone) {
+                setLoginBusy(r);
+                return;
+            }
+            finishLogin(*attempt, r);
+        });
+    });
+}
+
+// 顺手升级存储的密码；失败不影响这次登录，下次登录再试
+void UserController::saveRehash(int userId, const std::string& rehashed, HttpRequest::Deadline deadline) {
+    try {
+        auto updateConn = DbConnectionPool::getInstance().getConnection(deadline);
+        if (updateConn) {
+            updateConn->executeUpdate("UPDATE users SET password = ? WHERE id = ?", rehashed, userId);
+        }
+    } catch (const DbException& e) {
+        LOG_WARN << "Password rehash for user " << userId << " failed: " << e.what();
+    }
+}
+
+// 在 I/O 线程里根据校验结果回复
+void UserController::finishLogin(const LoginAttempt& attempt, HttpResponse* resp) {
     // ------------------------------------------------------
     // STEP 5: 构造响应 (Response)
     // ------------------------------------------------------
     json respJson; // 准备返回给前端的 JSON
-    // result->next() 返回 true 说明查到了数据（也就是账号密码匹配）
-    if (result && result->next()) {
+    // verified 为 true 说明查到了用户并且密码校验通过
+    if (attempt.verified) {
         // --- 登录成功 ---
-        int userId = result->getInt("id");
         
         resp->setStatusCode(HttpResponse::k200Ok);
         resp->setStatusMessage("OK");
@@ -99,15 +194,29 @@ void UserController::login(const HttpRequest& req, HttpResponse* resp) {
         
         // 返回一些业务数据
         respJson["data"] = {
-            {"userId", userId},
-            {"username", username},
-            // 在这里，通常我们会生成一个 JWT Token 返回给前端
-            // 前端下次请求带着这个 Token，我们就知道他是谁了
-            // 目前先返回一个假的 Token 占位
-            {"token", "mock_token_xyz_123"} 
+            {"userId", attempt.userId},
+            {"username", attempt.username}
         };
+        // 签发 HMAC 签名的令牌：前端之后带着 "Authorization: Bearer <token>" 请求，
+        // 服务端只验签名就知道是谁，不用再查数据库
+        if(tokenService_){
+            respJson["data"]["token"] = tokenService_->issue(attempt.userId, attempt.username);
+            respJson["data"]["expiresIn"] = tokenService_->ttlSeconds();
+        }
+        // 服务端会话：会话 id 只放在 HttpOnly Cookie 里，页面脚本拿不到
+        if(sessionStore_){
+            std::string sessionId = sessionStore_->create(attempt.userId, attempt.username);
+            if(!sessionId.empty()){
+                resp->addHeader("Set-Cookie", std::string(SessionStore::kCookieName) + "=" + sessionId +
+                                sessionCookieAttributes());
+            }
+        }
         
-        std::cout << "[INFO] User login success: " << username << std::endl;
+        if(loginThrottle_){
+            loginThrottle_->recordSuccess(attempt.username);
+        }
+        // 每次登录都同步写 stdout 会在 I/O 线程里抢锁，这里降到 DEBUG，请求记录交给访问日志
+        LOG_DEBUG << "User login success: " << attempt.username;
     } else {
         // --- 登录失败 ---
         // 虽然业务失败了，但 HTTP 状态码可以用 200 (表示服务器处理完了请求)
@@ -116,8 +225,11 @@ void UserController::login(const HttpRequest& req, HttpResponse* resp) {
         
         respJson["code"] = 1001; // 自定义错误码：1001 代表账号密码错误
         respJson["msg"] = "Username or password incorrect";
+        if(loginThrottle_){
+            loginThrottle_->recordFailure(attempt.username, attempt.peer);
+        }
         
-        std::cout << "[WARN] User login failed: " << username << std::endl;
+        LOG_DEBUG << "User login failed: " << attempt.username;
     }
 
     // 最后，把 JSON 对象转成字符串 (.dump())，放入响应体
@@ -125,6 +237,55 @@ void UserController::login(const HttpRequest& req, HttpResponse* resp) {
     
 }
 
+// 会话 Cookie 的属性：开了 TLS 时加 Secure，浏览器不会在明文连接上带出会话 id
+std::string UserController::sessionCookieAttributes() const {
+    std::string attributes = "; Path=/; HttpOnly; SameSite=Strict";
+    if(secureCookie_){
+        attributes += "; Secure";
+    }
+    return attributes;
+}
+
+void UserController::me(const HttpRequest& req, const TokenClaims& claims, HttpResponse* resp) {
+    // 身份信息全部来自令牌，不查数据库
+    json respJson;
+    respJson["code"] = 0;
+    respJson["msg"] = "OK";
+    respJson["data"] = {
+        {"userId", claims.userId},
+        {"username", claims.username},
+        {"issuedAt", claims.issuedAt},
+        {"expiresAt", claims.expiresAt}
+    };
+    resp->setStatusCode(HttpResponse::k200Ok);
+    resp->setStatusMessage("OK");
+    resp->addHeader("Content-Type","application/json");
+    resp->setBody(respJson.dump());
+}
+
+void UserController::logout(const HttpRequest& req, const TokenClaims& claims, HttpResponse* resp) {
+    std::string sessionId = claims.sessionId;
+    if(sessionId.empty()){
+        // 令牌认证的请求：吊销令牌；同一次登录下发的会话 Cookie 也带上来了的话一起删掉，不然会话还能接着用
+        if(tokenService_){
+            tokenService_->revoke(claims);
+        }
+        AuthGuard::sessionCookie(req, &sessionId);
+    }
+    if(!sessionId.empty()){
+        // 删掉会话并让浏览器清掉 Cookie
+        if(sessionStore_){
+            sessionStore_->remove(sessionId);
+        }
+        resp->addHeader("Set-Cookie", std::string(SessionStore::kCookieName) + "=" + sessionCookieAttributes() + "; Max-Age=0");
+    }
+    resp->setStatusCode(HttpResponse::k200Ok);
+    resp->setStatusMessage("OK");
+    resp->addHeader("Content-Type","application/json");
+    resp->setBody(R"({"code":0,"msg":"Logout Success"})");
+    LOG_DEBUG << "User logout: " << claims.username;
+}
+
 void UserController::registerUser(const HttpRequest& req, HttpResponse* resp) {
     // 提示：
     // 1. 解析 JSON
@@ -1,6 +1,9 @@
 #include "../../include/db/DbConnection.h"
 #include "../../include/db/DbException.h"
+#include "../../include/db/MySqlBackend.h"
 #include <muduo/base/Logging.h>
+#include <algorithm>
+#include <stdint.h>
 
 namespace http 
 {
@@ -11,142 +14,93 @@ DbConnection::DbConnection(const std::string& host,
                          const std::string& user,
                          const std::string& password,
                          const std::string& database)
-    : host_(host)
-    , user_(user)
-    , password_(password)
-    , database_(database)
+    : backend_(new MySqlBackend(host, user, password, database))
+    , deadline_(Deadline::max())
+    , queryCache_(nullptr)
+    , inTransaction_(false)
 {
-    try 
-    {
-        sql::mysql::MySQL_Driver* driver = sql::mysql::get_mysql_driver_instance();
-        conn_.reset(driver->connect(host_, user_, password_));
-        if (conn_) 
-        {
-            conn_->setSchema(database_);
-            
-            // 设置连接属性
-            conn_->setClientOption("OPT_RECONNECT", "true");
-            conn_->setClientOption("OPT_CONNECT_TIMEOUT", "10");
-            conn_->setClientOption("multi_statements", "false");
-            
-            // 设置字符集
-            std::unique_ptr<sql::Statement> stmt(conn_->createStatement());
-            stmt->execute("SET NAMES utf8mb4");
-            
-            LOG_INFO << "Database connection established";
-        }
-    } 
-    catch (const sql::SQLException& e) 
+}
+
+DbConnection::DbConnection(std::unique_ptr<DbBackend> backend)
+    : backend_(std::move(backend))
+    , deadline_(Deadline::max())
+    , queryCache_(nullptr)
+    , inTransaction_(false)
+{
+    if (!backend_)
     {
-        LOG_ERROR << "Failed to create database connection: " << e.what();
-        throw DbException(e.what());
+        throw DbException("DbConnection requires a backend");
     }
 }
 
 DbConnection::~DbConnection() 
 {
-    try 
-    {
-        cleanup();
-    } 
-    catch (...) 
-    {
-        // 析构函数中不抛出异常
-    }
-    LOG_INFO << "Database connection closed";
+    // 后端析构时自己清理连接
 }
 
 bool DbConnection::ping() 
 {
-    try 
-    {
-        // 不使用 getStmt，直接创建新的语句
-        std::unique_ptr<sql::Statement> stmt(conn_->createStatement());
-        std::unique_ptr<sql::ResultSet> rs(stmt->executeQuery("SELECT 1"));
-        return true;
-    } 
-    catch (const sql::SQLException& e) 
-    {
-        LOG_ERROR << "Ping failed: " << e.what();
-        return false;
-    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    return backend_->ping();
 }
 
 bool DbConnection::isValid() 
 {
-    try 
-    {
-        if (!conn_) return false;
-        std::unique_ptr<sql::Statement> stmt(conn_->createStatement());
-        stmt->execute("SELECT 1");
-        return true;
-    } 
-    catch (const sql::SQLException&) 
-    {
-        return false;
-    }
+    return ping();
 }
 
 void DbConnection::reconnect() 
 {
-    try 
+    std::lock_guard<std::mutex> lock(mutex_);
+    backend_->reconnect();
+}
+
+void DbConnection::cleanup() 
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    backend_->cleanup();
+}
+
+void DbConnection::invalidateCache(const std::string& sql)
+{
+    QueryCache::TransactionStatement statement = QueryCache::transactionStatement(sql);
+    if (statement == QueryCache::kTransactionBegin)
     {
-        if (conn_) 
-        {
-            conn_->reconnect();
-        } 
-        else 
+        inTransaction_ = true;
+        transactionWrites_.clear();
+        return;
+    }
+    if (statement == QueryCache::kTransactionEnd)
+    {
+        // 提交之前其他连接读到的旧数据可能已经进了缓存，这里再清一次
+        for (const std::string& write : transactionWrites_)
         {
-            sql::mysql::MySQL_Driver* driver = sql::mysql::get_mysql_driver_instance();
-            conn_.reset(driver->connect(host_, user_, password_));
-            conn_->setSchema(database_);
+            queryCache_->invalidateWrites(write);
         }
-    } 
-    catch (const sql::SQLException& e) 
+        inTransaction_ = false;
+        transactionWrites_.clear();
+        return;
+    }
+    queryCache_->invalidateWrites(sql);
+    if (inTransaction_ && std::find(transactionWrites_.begin(), transactionWrites_.end(), sql) == transactionWrites_.end())
     {
-        LOG_ERROR << "Reconnect failed: " << e.what();
-        throw DbException(e.what());
+        transactionWrites_.push_back(sql);
     }
 }
 
-void DbConnection::cleanup() 
+int DbConnection::statementTimeoutMs() const
 {
-    std::lock_guard<std::mutex> lock(mutex_);
-    try 
+    if (deadline_ == Deadline::max())
     {
-        if (conn_) 
-        {
-            // 确保所有事务都已完成
-            if (!conn_->getAutoCommit()) 
-            {
-                conn_->rollback();
-                conn_->setAutoCommit(true);
-            }
-            
-            // 清理所有未处理的结果集
-            std::unique_ptr<sql::Statement> stmt(conn_->createStatement());
-            while (stmt->getMoreResults()) 
-            {
-                auto result = stmt->getResultSet();
-                while (result && result->next()) 
-                {
-                    // 消费所有结果
-                }
-            }
-        }
-    } 
-    catch (const std::exception& e) 
+        return 0;
+    }
+    auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+        deadline_ - std::chrono::steady_clock::now()).count();
+    if (remaining <= 0)
     {
-        LOG_WARN << "Error cleaning up connection: " << e.what();
-        try 
-        {
-            reconnect();
-        } 
-        catch (...) 
-        {
-            // 忽略重连错误
-        }
+        throw DbTimeoutException(DbTimeoutException::kQuery, "Request deadline exceeded before query");
     }
+    return static_cast<int>(std::min<int64_t>(remaining, INT32_MAX));
 }
 
 } // namespace db
@@ -1,6 +1,9 @@
 #include "../../include/db/DbConnectionPool.h"
 #include "../../include/db/DbException.h"
+#include "../../include/metrics/Metrics.h"
 #include <muduo/base/Logging.h>
+#include <algorithm>
+#include <chrono>
 
 namespace http 
 {
@@ -12,30 +15,99 @@ void DbConnectionPool::init(const std::string& host,
                           const std::string& password,
                           const std::string& database,
                           size_t poolSize) 
+{
+    init([host, user, password, database]
+         {
+             return std::make_shared<DbConnection>(host, user, password, database);
+         },
+         poolSize);
+}
+
+void DbConnectionPool::init(const ConnectionFactory& factory, size_t poolSize) 
 {
     // 连接池会被多个线程访问，所以操作其成员变量时需要加锁
-    std::lock_guard<std::mutex> lock(mutex_);
+    std::lock_guard<std::mutex> lock(primary_.mutex);
     // 确保只初始化一次
-    if (initialized_) 
+    if (primary_.initialized) 
     {
         return;
     }
 
-    host_ = host;
-    user_ = user;
-    password_ = password;
-    database_ = database;
+    primary_.name = "primary";
+    primary_.factory = factory;
+    primary_.size = poolSize;
 
-    // 创建连接
+    // 创建连接 (主库连不上直接抛异常，服务起不来)
     for (size_t i = 0; i < poolSize; ++i) 
     {
-        connections_.push(createConnection());
+        primary_.connections.push(primary_.factory());
     }
+    primary_.created = poolSize;
 
-    initialized_ = true;
+    primary_.initialized = true;
     LOG_INFO << "Database connection pool initialized with " << poolSize << " connections";
 }
 
+void DbConnectionPool::addReplica(const std::string& name,
+                                  const std::string& host,
+                                  const std::string& user,
+                                  const std::string& password,
+                                  const std::string& database,
+                                  size_t poolSize,
+                                  const ReplicaOptions& options)
+{
+    addReplica(name,
+               [host, user, password, database]
+               {
+                   return std::make_shared<DbConnection>(host, user, password, database);
+               },
+               poolSize, options);
+}
+
+void DbConnectionPool::addReplica(const std::string& name, const ConnectionFactory& factory,
+                                  size_t poolSize, const ReplicaOptions& options)
+{
+    std::unique_ptr<Pool> replica(new Pool);
+    replica->name = name;
+    replica->factory = factory;
+    replica->options = options;
+    replica->size = poolSize;
+    replica->initialized = true;
+    // 第一次查到延迟之前先不接读请求 (不查延迟、连接也都建好了的副本直接可用)
+    replica->available = false;
+    try
+    {
+        fill(replica.get());
+        if (options.lagQuery.empty())
+        {
+            replica->available = true;
+            replica->lagSeconds = 0;
+        }
+    }
+    catch (const std::exception& e)
+    {
+        // 副本挂了不影响启动：读请求先走主库，检查线程连上之后再加入
+        LOG_WARN << "Database replica " << name << " is unreachable, added as unavailable: " << e.what();
+    }
+
+    std::lock_guard<std::mutex> lock(replicasMutex_);
+    replicas_.push_back(std::move(replica));
+    LOG_INFO << "Database replica " << name << " added with " << poolSize << " connections";
+}
+
+void DbConnectionPool::fill(Pool* pool)
+{
+    while (pool->created < pool->size)
+    {
+        // 建连可能很慢，不拿着锁；created 只在启动时和检查线程里修改
+        std::shared_ptr<DbConnection> conn = pool->factory();
+        std::lock_guard<std::mutex> lock(pool->mutex);
+        pool->connections.push(conn);
+        ++pool->created;
+        pool->cv.notify_one();
+    }
+}
+
 DbConnectionPool::DbConnectionPool() 
 {
     checkThread_ = std::thread(&DbConnectionPool::checkConnections, this);
@@ -44,33 +116,161 @@ DbConnectionPool::DbConnectionPool()
 
 DbConnectionPool::~DbConnectionPool() 
 {
-    std::lock_guard<std::mutex> lock(mutex_);
-    while (!connections_.empty()) 
+    for (Pool* pool : pools())
     {
-        connections_.pop();
+        std::lock_guard<std::mutex> lock(pool->mutex);
+        while (!pool->connections.empty()) 
+        {
+            pool->connections.pop();
+        }
     }
     LOG_INFO << "Database connection pool destroyed";
 }
 
+std::vector<DbConnectionPool::Pool*> DbConnectionPool::pools()
+{
+    std::vector<Pool*> result{ &primary_ };
+    std::lock_guard<std::mutex> lock(replicasMutex_);
+    for (auto& replica : replicas_)
+    {
+        result.push_back(replica.get());
+    }
+    return result;
+}
+
+std::shared_ptr<DbConnection> DbConnectionPool::getConnection(DbConnection::Deadline deadline) 
+{
+    return borrow(&primary_, deadline);
+}
+
+std::shared_ptr<DbConnection> DbConnectionPool::getReadConnection(DbConnection::Deadline deadline)
+{
+    Pool* replica = pickReplica();
+    if (!replica)
+    {
+        if (!replicas_.empty())
+        {
+            replicaFallbacks_.fetch_add(1, std::memory_order_relaxed);
+        }
+        return borrow(&primary_, deadline);
+    }
+    try
+    {
+        std::shared_ptr<DbConnection> conn = borrow(replica, deadline);
+        replica->reads.fetch_add(1, std::memory_order_relaxed);
+        return conn;
+    }
+    catch (const DbTimeoutException&)
+    {
+        throw; // 等连接超时：请求的时间已经用完，换主库也来不及
+    }
+    catch (const std::exception& e)
+    {
+        // 副本连不上：先摘掉，检查线程确认恢复后再加回来
+        setAvailable(replica, false, e.what());
+        replicaFallbacks_.fetch_add(1, std::memory_order_relaxed);
+        return borrow(&primary_, deadline);
+    }
+}
+
+// replicas_ 启动后不再变化，热路径上不加锁
+DbConnectionPool::Pool* DbConnectionPool::pickReplica()
+{
+    size_t count = replicas_.size();
+    if (count == 0)
+    {
+        return nullptr;
+    }
+    // 从轮转的位置开始找未完成请求最少的可用副本，相同的时候请求就会轮流分到各个副本
+    size_t start = nextReplica_.fetch_add(1, std::memory_order_relaxed) % count;
+    Pool* best = nullptr;
+    int bestOutstanding = 0;
+    for (size_t i = 0; i < count; ++i)
+    {
+        Pool* replica = replicas_[(start + i) % count].get();
+        if (!replica->available.load(std::memory_order_relaxed))
+        {
+            continue;
+        }
+        int outstanding = replica->outstanding.load(std::memory_order_relaxed);
+        if (!best || outstanding < bestOutstanding)
+        {
+            best = replica;
+            bestOutstanding = outstanding;
+        }
+    }
+    return best;
+}
+
+void DbConnectionPool::setAvailable(Pool* replica, bool available, const std::string& reason)
+{
+    if (replica->available.exchange(available) == available)
+    {
+        return; // 状态没变，不重复打日志
+    }
+    if (available)
+    {
+        LOG_INFO << "Database replica " << replica->name << " is serving reads again";
+    }
+    else
+    {
+        LOG_WARN << "Database replica " << replica->name << " removed from reads: " << reason;
+    }
+}
+
+std::vector<DbConnectionPool::ReplicaStatus> DbConnectionPool::replicaStatus() const
+{
+    std::vector<ReplicaStatus> result;
+    std::lock_guard<std::mutex> lock(replicasMutex_);
+    for (const auto& replica : replicas_)
+    {
+        ReplicaStatus status;
+        status.name = replica->name;
+        status.available = replica->available.load(std::memory_order_relaxed);
+        status.lagSeconds = replica->lagSeconds.load(std::memory_order_relaxed);
+        status.outstanding = replica->outstanding.load(std::memory_order_relaxed);
+        status.reads = replica->reads.load(std::memory_order_relaxed);
+        result.push_back(status);
+    }
+    return result;
+}
+
 // 修改获取连接的函数
-std::shared_ptr<DbConnection> DbConnectionPool::getConnection() 
+std::shared_ptr<DbConnection> DbConnectionPool::borrow(Pool* pool, DbConnection::Deadline deadline) 
 {
+    auto waitStart = std::chrono::steady_clock::now(); // 统计等待连接的耗时
+    // 从开始等连接算起就计入未完成请求，选副本时排队的请求也算上
+    pool->outstanding.fetch_add(1, std::memory_order_relaxed);
     std::shared_ptr<DbConnection> conn;
     {
-        std::unique_lock<std::mutex> lock(mutex_); //加锁
+        std::unique_lock<std::mutex> lock(pool->mutex); //加锁
         
-        while (connections_.empty())  //连接池空了就等待
+        while (pool->connections.empty())  //连接池空了就等待
         {
-            if (!initialized_) 
+            if (!pool->initialized) 
             {
+                pool->outstanding.fetch_sub(1, std::memory_order_relaxed);
                 throw DbException("Connection pool not initialized");
             }
             LOG_INFO << "Waiting for available connection...";
-            cv_.wait(lock);  //等待条件变量通知,（释放锁+挂起线程）
+            //等待条件变量通知,（释放锁+挂起线程），有截止时间的请求最多等到截止时间
+            if (deadline == DbConnection::Deadline::max())
+            {
+                pool->cv.wait(lock);
+            }
+            else if (pool->cv.wait_until(lock, deadline) == std::cv_status::timeout && pool->connections.empty())
+            {
+                pool->outstanding.fetch_sub(1, std::memory_order_relaxed);
+                metrics::MetricsRegistry::instance().observeDbWait(
+                    std::chrono::duration_cast<std::chrono::microseconds>(
+                        std::chrono::steady_clock::now() - waitStart).count());
+                throw DbTimeoutException(DbTimeoutException::kPoolWait,
+                                         "Timed out waiting for a database connection");
+            }
         }
         
-        conn = connections_.front(); //取出队首连接
-        connections_.pop();    //弹出队首连接
+        conn = pool->connections.front(); //取出队首连接
+        pool->connections.pop();    //弹出队首连接
     } // 释放锁
     
     try 
@@ -81,72 +281,154 @@ std::shared_ptr<DbConnection> DbConnectionPool::getConnection()
             LOG_WARN << "Connection lost, attempting to reconnect...";
             conn->reconnect(); //重新连接数据库
         }
+        metrics::MetricsRegistry::instance().observeDbWait(
+            std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - waitStart).count());
+        conn->setDeadline(deadline);
+        conn->setQueryCache(queryCache_);
         // 8. 重新包装一个 shared_ptr 返回给用户, 并自定义删除器，归还连接到连接池
         return std::shared_ptr<DbConnection>(conn.get(), 
-            [this, conn](DbConnection*) {
-                std::lock_guard<std::mutex> lock(mutex_);  // 上锁
-                connections_.push(conn);  // 把连接放回队列
-                cv_.notify_one();  // 通知等待的线程有连接可用
+            [pool, conn](DbConnection*) {
+                conn->setDeadline(DbConnection::Deadline::max());
+                std::lock_guard<std::mutex> lock(pool->mutex);  // 上锁
+                pool->connections.push(conn);  // 把连接放回队列
+                pool->outstanding.fetch_sub(1, std::memory_order_relaxed);
+                pool->cv.notify_one();  // 通知等待的线程有连接可用
             });
     } 
     catch (const std::exception& e) //捕获所有异常
     {
-        LOG_ERROR << "Failed to get connection: " << e.what(); //记录错误日志
+        LOG_ERROR << "Failed to get connection from " << pool->name << ": " << e.what(); //记录错误日志
         {
-            std::lock_guard<std::mutex> lock(mutex_);
-            connections_.push(conn);
-            cv_.notify_one();
+            std::lock_guard<std::mutex> lock(pool->mutex);
+            pool->connections.push(conn);
+            pool->outstanding.fetch_sub(1, std::memory_order_relaxed);
+            pool->cv.notify_one();
         }
         throw;
     }
 }
 
-std::shared_ptr<DbConnection> DbConnectionPool::createConnection() 
+// 查一次副本的复制延迟，查不到 (连不上、复制中断) 就标记为不可用
+void DbConnectionPool::probeReplica(Pool* replica)
 {
-    return std::make_shared<DbConnection>(host_, user_, password_, database_);
+    if (replica->created < replica->size)
+    {
+        // 启动时没连上的副本：先把连接补齐，补不齐就继续不可用
+        try
+        {
+            fill(replica);
+        }
+        catch (const std::exception& e)
+        {
+            replica->lagSeconds = -1;
+            setAvailable(replica, false, e.what());
+            return;
+        }
+    }
+
+    try
+    {
+        // 用专用连接探测：池子里的连接全借出去的时候 (延迟往往正在变大) 也能查
+        if (!replica->probe)
+        {
+            replica->probe = replica->factory();
+        }
+        else if (!replica->probe->ping())
+        {
+            replica->probe->reconnect();
+        }
+        int lag = 0;
+        if (!replica->options.lagQuery.empty())
+        {
+            std::unique_ptr<DbResult> result = replica->probe->executeQuery(replica->options.lagQuery);
+            const std::vector<std::string>& columns = result->columns();
+            std::string column;
+            for (const char* name : { "Seconds_Behind_Source", "Seconds_Behind_Master" })
+            {
+                if (std::find(columns.begin(), columns.end(), name) != columns.end())
+                {
+                    column = name;
+                    break;
+                }
+            }
+            if (column.empty() || !result->next())
+            {
+                throw DbException("no replication status (is this server a replica?)");
+            }
+            std::string value = result->getString(column);
+            if (value.empty())
+            {
+                throw DbException("replication is not running"); // Seconds_Behind_Source 为 NULL
+            }
+            lag = std::stoi(value);
+        }
+        replica->lagSeconds = lag;
+        if (lag > replica->options.maxLagSeconds)
+        {
+            setAvailable(replica, false, "replication lag " + std::to_string(lag) + "s");
+        }
+        else
+        {
+            setAvailable(replica, true, "");
+        }
+    }
+    catch (const std::exception& e)
+    {
+        replica->lagSeconds = -1;
+        setAvailable(replica, false, e.what());
+    }
 }
 
 // 修改检查连接的函数
 void DbConnectionPool::checkConnections() 
 {
+    // 每秒查一次副本的延迟，每 60 秒检查一遍所有空闲连接
+    const int kPingEverySeconds = 60;
+    int tick = 0;
     while (true) 
     {
         try 
         {
-            std::vector<std::shared_ptr<DbConnection>> connsToCheck;
+            std::vector<Pool*> all = pools();
+            for (size_t i = 1; i < all.size(); ++i)
             {
-                std::unique_lock<std::mutex> lock(mutex_);
-                if (connections_.empty()) 
-                {
-                    std::this_thread::sleep_for(std::chrono::seconds(1));
-                    continue;
-                }
-                
-                auto temp = connections_;
-                while (!temp.empty()) 
-                {
-                    connsToCheck.push_back(temp.front());
-                    temp.pop();
-                }
+                probeReplica(all[i]);
             }
-            
-            // 在锁外检查连接
-            for (auto& conn : connsToCheck) 
+
+            if (tick++ % kPingEverySeconds == 0)
             {
-                if (!conn->ping()) 
+                std::vector<std::shared_ptr<DbConnection>> connsToCheck;
+                for (Pool* pool : all)
                 {
-                    try 
+                    // 只在锁里拷一份，ping 在锁外做：拿着锁检查会让等连接的请求错过截止时间
+                    std::unique_lock<std::mutex> lock(pool->mutex);
+                    auto temp = pool->connections;
+                    while (!temp.empty()) 
                     {
-                        conn->reconnect();
-                    } 
-                    catch (const std::exception& e) 
+                        connsToCheck.push_back(temp.front());
+                        temp.pop();
+                    }
+                }
+
+                // 在锁外检查连接
+                for (auto& conn : connsToCheck) 
+                {
+                    if (!conn->ping()) 
                     {
-                        LOG_ERROR << "Failed to reconnect: " << e.what();
+                        try 
+                        {
+                            conn->reconnect();
+                        } 
+                        catch (const std::exception& e) 
+                        {
+                            LOG_ERROR << "Failed to reconnect: " << e.what();
+                        }
                     }
                 }
             }
             
-            std::this_thread::sleep_for(std::chrono::seconds(60));
+            std::this_thread::sleep_for(std::chrono::seconds(1));
         } 
         catch (const std::exception& e) 
         {
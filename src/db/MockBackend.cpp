@@ -0,0 +1,1017 @@
+#include "../../include/db/MockBackend.h"
+#include "../../include/db/DbException.h"
+#include <muduo/base/Logging.h>
+#include <algorithm>
+#include <chrono>
+#include <ctype.h>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <stdlib.h>
+#include <strings.h>
+#include <thread>
+
+namespace http
+{
+namespace db
+{
+
+namespace
+{
+
+// ==========================================================
+// 词法分析：把 SQL 切成 token
+// ==========================================================
+struct Token
+{
+    enum Type { kIdent, kString, kNumber, kSymbol, kParam, kEnd };
+
+    Type        type;
+    std::string text;
+};
+
+std::vector<Token> tokenize(const std::string& sql)
+{
+    std::vector<Token> tokens;
+    size_t i = 0;
+    const size_t n = sql.size();
+    while (i < n)
+    {
+        char c = sql[i];
+        if (isspace(static_cast<unsigned char>(c)))
+        {
+            ++i;
+        }
+        else if (c == '-' && i + 1 < n && sql[i + 1] == '-')
+        {
+            // -- 注释一直到行尾
+            while (i < n && sql[i] != '\n')
+            {
+                ++i;
+            }
+        }
+        else if (isalpha(static_cast<unsigned char>(c)) || c == '_')
+        {
+            size_t start = i;
+            while (i < n && (isalnum(static_cast<unsigned char>(sql[i])) || sql[i] == '_' || sql[i] == '.'))
+            {
+                ++i;
+            }
+            tokens.push_back({ Token::kIdent, sql.substr(start, i - start) });
+        }
+        else if (c == '`')
+        {
+            size_t end = sql.find('`', i + 1);
+            if (end == std::string::npos)
+            {
+                throw DbException("Unterminated identifier in SQL: " + sql);
+            }
+            tokens.push_back({ Token::kIdent, sql.substr(i + 1, end - i - 1) });
+            i = end + 1;
+        }
+        else if (c == '\'' || c == '"')
+        {
+            // 字符串字面量：支持 '' 和反斜杠转义
+            std::string value;
+            ++i;
+            bool closed = false;
+            while (i < n)
+            {
+                if (sql[i] == '\\' && i + 1 < n)
+                {
+                    value += sql[i + 1];
+                    i += 2;
+                }
+                else if (sql[i] == c)
+                {
+                    if (i + 1 < n && sql[i + 1] == c)
+                    {
+                        value += c;
+                        i += 2;
+                    }
+                    else
+                    {
+                        ++i;
+                        closed = true;
+                        break;
+                    }
+                }
+                else
+                {
+                    value += sql[i++];
+                }
+            }
+            if (!closed)
+            {
+                throw DbException("Unterminated string in SQL: " + sql);
+            }
+            tokens.push_back({ Token::kString, value });
+        }
+        else if (isdigit(static_cast<unsigned char>(c)) ||
+                 (c == '-' && i + 1 < n && isdigit(static_cast<unsigned char>(sql[i + 1]))))
+        {
+            size_t start = i++;
+            while (i < n && (isdigit(static_cast<unsigned char>(sql[i])) || sql[i] == '.'))
+            {
+                ++i;
+            }
+            tokens.push_back({ Token::kNumber, sql.substr(start, i - start) });
+        }
+        else if (c == '?')
+        {
+            tokens.push_back({ Token::kParam, "?" });
+            ++i;
+        }
+        else
+        {
+            tokens.push_back({ Token::kSymbol, std::string(1, c) });
+            ++i;
+        }
+    }
+    tokens.push_back({ Token::kEnd, "" });
+    return tokens;
+}
+
+// 列名统一按小写、去掉表名前缀比较 (MySQL 的列名不区分大小写)
+std::string normalizeColumn(const std::string& name)
+{
+    size_t dot = name.rfind('.');
+    std::string column = dot == std::string::npos ? name : name.substr(dot + 1);
+    std::transform(column.begin(), column.end(), column.begin(), ::tolower);
+    return column;
+}
+
+// 把脚本按 ; 切成多条语句 (忽略引号和注释里的 ;)
+std::vector<std::string> splitStatements(const std::string& script)
+{
+    std::vector<std::string> statements;
+    std::string current;
+    char quote = 0;
+    for (size_t i = 0; i < script.size(); ++i)
+    {
+        char c = script[i];
+        if (quote)
+        {
+            current += c;
+            if (c == '\\' && i + 1 < script.size())
+            {
+                current += script[++i];
+            }
+            else if (c == quote)
+            {
+                quote = 0;
+            }
+        }
+        else if (c == '-' && i + 1 < script.size() && script[i + 1] == '-')
+        {
+            while (i < script.size() && script[i] != '\n')
+            {
+                ++i;
+            }
+            current += '\n';
+        }
+        else if (c == ';')
+        {
+            statements.push_back(current);
+            current.clear();
+        }
+        else
+        {
+            if (c == '\'' || c == '"' || c == '`')
+            {
+                quote = c;
+            }
+            current += c;
+        }
+    }
+    statements.push_back(current);
+    return statements;
+}
+
+} // namespace
+
+// ==========================================================
+// 语句和表的内部表示
+// ==========================================================
+
+// 值：? 占位符 (按出现顺序编号)、NULL 或字面量
+struct MockValue
+{
+    int         paramIndex = -1;
+    bool        null = false;
+    std::string literal;
+
+    const std::string& evaluate(const std::vector<std::string>& params, const std::string& empty) const
+    {
+        if (paramIndex >= 0)
+        {
+            if (paramIndex >= static_cast<int>(params.size()))
+            {
+                throw DbException("Missing value for parameter " + std::to_string(paramIndex + 1));
+            }
+            return params[paramIndex];
+        }
+        return null ? empty : literal;
+    }
+};
+
+struct MockCondition
+{
+    std::string column; // 已规范化
+    MockValue   value;
+};
+
+struct MockStatement
+{
+    enum Kind { kIgnore, kCreate, kDrop, kInsert, kSelect, kSelectConst, kUpdate, kDelete };
+
+    Kind                                 kind = kIgnore;
+    std::string                          table;
+    bool                                 ifExists = false;  // CREATE ... IF NOT EXISTS / DROP ... IF EXISTS
+    std::vector<std::string>             columns;           // CREATE/INSERT/UPDATE/SELECT 的列 (已规范化)
+    std::vector<std::string>             labels;            // SELECT 结果的列名
+    bool                                 selectAll = false;
+    bool                                 countStar = false;
+    std::vector<std::vector<MockValue>>  values;            // INSERT 的多行 / SELECT 常量 / UPDATE SET 的值 (values[0])
+    std::vector<MockCondition>           where;             // 只支持 a = v AND b = v
+    long                                 limit = -1;
+    std::string                          autoIncrement;     // CREATE：自增列
+    std::vector<std::string>             unique;            // CREATE：唯一列 (含主键)
+};
+
+struct MockTable
+{
+    std::vector<std::string>              columns;
+    std::string                           autoIncrement;
+    std::vector<size_t>                   unique;
+    std::vector<std::vector<std::string>> rows;
+    long                                  nextId = 1;
+
+    size_t columnIndex(const std::string& column) const
+    {
+        for (size_t i = 0; i < columns.size(); ++i)
+        {
+            if (columns[i] == column)
+            {
+                return i;
+            }
+        }
+        throw DbException("Unknown column '" + column + "'");
+    }
+};
+
+namespace
+{
+
+// ==========================================================
+// 语法分析：递归下降，只认上面列出的那几种语句
+// ==========================================================
+class MockParser
+{
+public:
+    explicit MockParser(const std::string& sql)
+        : sql_(sql)
+        , tokens_(tokenize(sql))
+        , pos_(0)
+        , params_(0)
+    {}
+
+    bool empty() const { return tokens_.size() == 1; }
+
+    void parse(MockStatement* stmt)
+    {
+        if (acceptKeyword("SELECT"))
+        {
+            parseSelect(stmt);
+        }
+        else if (acceptKeyword("INSERT"))
+        {
+            parseInsert(stmt);
+        }
+        else if (acceptKeyword("UPDATE"))
+        {
+            parseUpdate(stmt);
+        }
+        else if (acceptKeyword("DELETE"))
+        {
+            expectKeyword("FROM");
+            stmt->kind = MockStatement::kDelete;
+            stmt->table = expectIdent();
+            parseWhere(stmt);
+        }
+        else if (acceptKeyword("CREATE"))
+        {
+            parseCreate(stmt);
+            return; // 表选项 (ENGINE=... 等) 忽略
+        }
+        else if (acceptKeyword("DROP"))
+        {
+            expectKeyword("TABLE");
+            stmt->kind = MockStatement::kDrop;
+            if (acceptKeyword("IF"))
+            {
+                expectKeyword("EXISTS");
+                stmt->ifExists = true;
+            }
+            stmt->table = expectIdent();
+        }
+        else if (acceptKeyword("USE") || acceptKeyword("SET") || acceptKeyword("ALTER"))
+        {
+            // 值都按字符串存，ALTER TABLE 改列类型对内存库没有意义
+            stmt->kind = MockStatement::kIgnore;
+            return;
+        }
+        else
+        {
+            fail("unsupported statement");
+        }
+
+        if (peek().type != Token::kEnd)
+        {
+            fail("unexpected '" + peek().text + "'");
+        }
+    }
+
+private:
+    void parseSelect(MockStatement* stmt)
+    {
+        // 选择列表
+        std::vector<MockValue> constants;
+        do
+        {
+            if (acceptSymbol("*"))
+            {
+                stmt->selectAll = true;
+                continue;
+            }
+            std::string label;
+            if (peekKeyword("COUNT"))
+            {
+                next();
+                expectSymbol("(");
+                expectSymbol("*");
+                expectSymbol(")");
+                stmt->countStar = true;
+                label = "COUNT(*)";
+            }
+            else if (peek().type == Token::kIdent)
+            {
+                label = next().text;
+                stmt->columns.push_back(normalizeColumn(label));
+                size_t dot = label.rfind('.');
+                if (dot != std::string::npos)
+                {
+                    label = label.substr(dot + 1);
+                }
+            }
+            else
+            {
+                label = peek().text;
+                constants.push_back(parseValue());
+            }
+            if (acceptKeyword("AS"))
+            {
+                label = expectIdent();
+            }
+            stmt->labels.push_back(label);
+        } while (acceptSymbol(","));
+
+        if (!acceptKeyword("FROM"))
+        {
+            // SELECT 1 这类不带表的查询
+            if (constants.size() != stmt->labels.size())
+            {
+                fail("SELECT without FROM only supports constants");
+            }
+            stmt->kind = MockStatement::kSelectConst;
+            stmt->values.push_back(constants);
+            return;
+        }
+        if (!constants.empty() || (stmt->countStar && stmt->labels.size() != 1))
+        {
+            fail("unsupported select list");
+        }
+        stmt->kind = MockStatement::kSelect;
+        stmt->table = expectIdent();
+        parseWhere(stmt);
+        if (acceptKeyword("LIMIT"))
+        {
+            if (peek().type != Token::kNumber)
+            {
+                fail("LIMIT expects a number");
+            }
+            stmt->limit = ::atol(next().text.c_str());
+        }
+    }
+
+    void parseInsert(MockStatement* stmt)
+    {
+        expectKeyword("INTO");
+        stmt->kind = MockStatement::kInsert;
+        stmt->table = expectIdent();
+        expectSymbol("(");
+        do
+        {
+            stmt->columns.push_back(normalizeColumn(expectIdent()));
+        } while (acceptSymbol(","));
+        expectSymbol(")");
+        expectKeyword("VALUES");
+        do
+        {
+            expectSymbol("(");
+            std::vector<MockValue> row;
+            do
+            {
+                row.push_back(parseValue());
+            } while (acceptSymbol(","));
+            expectSymbol(")");
+            if (row.size() != stmt->columns.size())
+            {
+                fail("column count doesn't match value count");
+            }
+            stmt->values.push_back(std::move(row));
+        } while (acceptSymbol(","));
+    }
+
+    void parseUpdate(MockStatement* stmt)
+    {
+        stmt->kind = MockStatement::kUpdate;
+        stmt->table = expectIdent();
+        expectKeyword("SET");
+        stmt->values.emplace_back();
+        do
+        {
+            stmt->columns.push_back(normalizeColumn(expectIdent()));
+            expectSymbol("=");
+            stmt->values[0].push_back(parseValue());
+        } while (acceptSymbol(","));
+        parseWhere(stmt);
+    }
+
+    void parseCreate(MockStatement* stmt)
+    {
+        expectKeyword("TABLE");
+        stmt->kind = MockStatement::kCreate;
+        if (acceptKeyword("IF"))
+        {
+            expectKeyword("NOT");
+            expectKeyword("EXISTS");
+            stmt->ifExists = true;
+        }
+        stmt->table = expectIdent();
+        expectSymbol("(");
+        do
+        {
+            if (acceptKeyword("PRIMARY") || acceptKeyword("UNIQUE"))
+            {
+                // 表级约束：PRIMARY KEY (col) / UNIQUE [KEY name] (col)
+                while (!peekSymbol("(") && peek().type != Token::kEnd)
+                {
+                    next();
+                }
+                expectSymbol("(");
+                stmt->unique.push_back(normalizeColumn(expectIdent()));
+                skipDefinition();
+            }
+            else if (peekKeyword("KEY") || peekKeyword("INDEX") ||
+                     peekKeyword("CONSTRAINT") || peekKeyword("FOREIGN"))
+            {
+                skipDefinition();
+            }
+            else
+            {
+                // 列定义：名字 类型 [属性...]
+                std::string column = normalizeColumn(expectIdent());
+                stmt->columns.push_back(column);
+                int depth = 0;
+                while (peek().type != Token::kEnd)
+                {
+                    if (depth == 0 && (peekSymbol(",") || peekSymbol(")")))
+                    {
+                        break;
+                    }
+                    const Token& token = next();
+                    if (token.type == Token::kSymbol)
+                    {
+                        depth += token.text == "(" ? 1 : token.text == ")" ? -1 : 0;
+                    }
+                    else if (token.type == Token::kIdent)
+                    {
+                        if (equalsKeyword(token, "AUTO_INCREMENT"))
+                        {
+                            stmt->autoIncrement = column;
+                        }
+                        else if (equalsKeyword(token, "UNIQUE") || equalsKeyword(token, "PRIMARY"))
+                        {
+                            stmt->unique.push_back(column);
+                        }
+                    }
+                }
+            }
+        } while (acceptSymbol(","));
+        expectSymbol(")");
+    }
+
+    void parseWhere(MockStatement* stmt)
+    {
+        if (!acceptKeyword("WHERE"))
+        {
+            return;
+        }
+        do
+        {
+            MockCondition cond;
+            cond.column = normalizeColumn(expectIdent());
+            expectSymbol("=");
+            cond.value = parseValue();
+            stmt->where.push_back(std::move(cond));
+        } while (acceptKeyword("AND"));
+    }
+
+    MockValue parseValue()
+    {
+        MockValue value;
+        const Token& token = next();
+        if (token.type == Token::kParam)
+        {
+            value.paramIndex = params_++;
+        }
+        else if (token.type == Token::kString || token.type == Token::kNumber)
+        {
+            value.literal = token.text;
+        }
+        else if (equalsKeyword(token, "NULL"))
+        {
+            value.null = true;
+        }
+        else
+        {
+            fail("expected a value near '" + token.text + "'");
+        }
+        return value;
+    }
+
+    // 跳过一个表级定义，停在同层的 , 或 ) 前
+    void skipDefinition()
+    {
+        int depth = 0;
+        while (peek().type != Token::kEnd)
+        {
+            if (depth == 0 && (peekSymbol(",") || peekSymbol(")")))
+            {
+                return;
+            }
+            const Token& token = next();
+            if (token.type == Token::kSymbol)
+            {
+                depth += token.text == "(" ? 1 : token.text == ")" ? -1 : 0;
+            }
+        }
+    }
+
+    static bool equalsKeyword(const Token& token, const char* keyword)
+    {
+        return token.type == Token::kIdent && ::strcasecmp(token.text.c_str(), keyword) == 0;
+    }
+
+    const Token& peek() const { return tokens_[pos_]; }
+    const Token& next()
+    {
+        const Token& token = tokens_[pos_];
+        if (token.type != Token::kEnd)
+        {
+            ++pos_;
+        }
+        return token;
+    }
+    bool peekKeyword(const char* keyword) const { return equalsKeyword(peek(), keyword); }
+    bool peekSymbol(const char* symbol) const { return peek().type == Token::kSymbol && peek().text == symbol; }
+
+    bool acceptKeyword(const char* keyword)
+    {
+        if (peekKeyword(keyword))
+        {
+            ++pos_;
+            return true;
+        }
+        return false;
+    }
+
+    bool acceptSymbol(const char* symbol)
+    {
+        if (peekSymbol(symbol))
+        {
+            ++pos_;
+            return true;
+        }
+        return false;
+    }
+
+    void expectKeyword(const char* keyword)
+    {
+        if (!acceptKeyword(keyword))
+        {
+            fail(std::string("expected ") + keyword);
+        }
+    }
+
+    void expectSymbol(const char* symbol)
+    {
+        if (!acceptSymbol(symbol))
+        {
+            fail(std::string("expected '") + symbol + "'");
+        }
+    }
+
+    std::string expectIdent()
+    {
+        if (peek().type != Token::kIdent)
+        {
+            fail("expected an identifier");
+        }
+        return next().text;
+    }
+
+    void fail(const std::string& what) const
+    {
+        throw DbException("Mock backend cannot parse SQL (" + what + "): " + sql_);
+    }
+
+private:
+    const std::string& sql_;
+    std::vector<Token> tokens_;
+    size_t             pos_;
+    int                params_;
+};
+
+const size_t kMaxCachedStatements = 1024;
+
+} // namespace
+
+// ==========================================================
+// MockDatabase
+// ==========================================================
+MockDatabase::MockDatabase() = default;
+MockDatabase::~MockDatabase() = default;
+
+void MockDatabase::loadSeed(const std::string& script)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t executed = 0;
+    for (const std::string& sql : splitStatements(script))
+    {
+        MockParser parser(sql);
+        if (parser.empty())
+        {
+            continue;
+        }
+        MockStatement stmt;
+        parser.parse(&stmt);
+        // 种子脚本里的 SELECT 只是给人看的验证语句
+        if (stmt.kind == MockStatement::kSelect || stmt.kind == MockStatement::kSelectConst)
+        {
+            continue;
+        }
+        runUpdate(stmt, std::vector<std::string>());
+        ++executed;
+    }
+    LOG_INFO << "Mock database seeded with " << executed << " statements";
+}
+
+void MockDatabase::loadSeedFile(const std::string& path)
+{
+    std::ifstream in(path);
+    if (!in)
+    {
+        throw DbException("Cannot open seed file: " + path);
+    }
+    std::ostringstream script;
+    script << in.rdbuf();
+    loadSeed(script.str());
+}
+
+std::unique_ptr<DbResult> MockDatabase::executeQuery(const std::string& sql,
+                                                     const std::vector<std::string>& params)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::shared_ptr<const MockStatement> stmt = prepare(sql);
+    return runQuery(*stmt, params);
+}
+
+int MockDatabase::executeUpdate(const std::string& sql,
+                                const std::vector<std::string>& params)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::shared_ptr<const MockStatement> stmt = prepare(sql);
+    return runUpdate(*stmt, params);
+}
+
+size_t MockDatabase::tableRows(const std::string& name) const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = tables_.find(name);
+    return it == tables_.end() ? 0 : it->second->rows.size();
+}
+
+std::shared_ptr<const MockStatement> MockDatabase::prepare(const std::string& sql)
+{
+    auto it = statements_.find(sql);
+    if (it != statements_.end())
+    {
+        return it->second;
+    }
+    std::shared_ptr<MockStatement> stmt = std::make_shared<MockStatement>();
+    MockParser(sql).parse(stmt.get());
+    // 正常业务都用占位符，SQL 文本是有限的；防止拼接 SQL 把缓存撑大
+    if (statements_.size() >= kMaxCachedStatements)
+    {
+        statements_.clear();
+    }
+    statements_[sql] = stmt;
+    return stmt;
+}
+
+MockTable& MockDatabase::table(const std::string& name)
+{
+    auto it = tables_.find(name);
+    if (it == tables_.end())
+    {
+        throw DbException("Table '" + name + "' doesn't exist");
+    }
+    return *it->second;
+}
+
+namespace
+{
+
+bool matches(const std::vector<std::string>& row,
+             const std::vector<std::pair<size_t, const std::string*>>& where)
+{
+    for (const auto& cond : where)
+    {
+        if (row[cond.first] != *cond.second)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+std::unique_ptr<DbResult> MockDatabase::runQuery(const MockStatement& stmt,
+                                                 const std::vector<std::string>& params)
+{
+    static const std::string kEmpty;
+    std::shared_ptr<DbRows> result = std::make_shared<DbRows>();
+
+    if (stmt.kind == MockStatement::kSelectConst)
+    {
+        result->columns = stmt.labels;
+        std::vector<std::string> row;
+        for (const MockValue& value : stmt.values[0])
+        {
+            row.push_back(value.evaluate(params, kEmpty));
+        }
+        result->rows.push_back(std::move(row));
+        return std::unique_ptr<DbResult>(new DbResult(std::move(result)));
+    }
+    if (stmt.kind != MockStatement::kSelect)
+    {
+        throw DbException("executeQuery expects a SELECT statement");
+    }
+
+    MockTable& t = table(stmt.table);
+    std::vector<std::pair<size_t, const std::string*>> where;
+    for (const MockCondition& cond : stmt.where)
+    {
+        where.emplace_back(t.columnIndex(cond.column), &cond.value.evaluate(params, kEmpty));
+    }
+
+    std::vector<size_t> projection;
+    if (stmt.selectAll)
+    {
+        for (size_t i = 0; i < t.columns.size(); ++i)
+        {
+            projection.push_back(i);
+            result->columns.push_back(t.columns[i]);
+        }
+    }
+    for (size_t i = 0; i < stmt.columns.size(); ++i)
+    {
+        projection.push_back(t.columnIndex(stmt.columns[i]));
+    }
+    if (!stmt.countStar)
+    {
+        result->columns.insert(result->columns.end(), stmt.labels.begin(), stmt.labels.end());
+    }
+
+    size_t count = 0;
+    for (const std::vector<std::string>& row : t.rows)
+    {
+        if (stmt.limit >= 0 && count >= static_cast<size_t>(stmt.limit) && !stmt.countStar)
+        {
+            break;
+        }
+        if (!matches(row, where))
+        {
+            continue;
+        }
+        ++count;
+        if (!stmt.countStar)
+        {
+            std::vector<std::string> out;
+            out.reserve(projection.size());
+            for (size_t index : projection)
+            {
+                out.push_back(row[index]);
+            }
+            result->rows.push_back(std::move(out));
+        }
+    }
+
+    if (stmt.countStar)
+    {
+        result->columns = stmt.labels;
+        result->rows.push_back({ std::to_string(count) });
+    }
+    return std::unique_ptr<DbResult>(new DbResult(std::move(result)));
+}
+
+int MockDatabase::runUpdate(const MockStatement& stmt, const std::vector<std::string>& params)
+{
+    static const std::string kEmpty;
+    switch (stmt.kind)
+    {
+    case MockStatement::kIgnore:
+        return 0;
+
+    case MockStatement::kCreate:
+    {
+        if (tables_.count(stmt.table))
+        {
+            if (stmt.ifExists)
+            {
+                return 0;
+            }
+            throw DbException("Table '" + stmt.table + "' already exists");
+        }
+        std::unique_ptr<MockTable> t(new MockTable);
+        t->columns = stmt.columns;
+        t->autoIncrement = stmt.autoIncrement;
+        for (const std::string& column : stmt.unique)
+        {
+            t->unique.push_back(t->columnIndex(column));
+        }
+        tables_[stmt.table] = std::move(t);
+        return 0;
+    }
+
+    case MockStatement::kDrop:
+        if (!tables_.erase(stmt.table) && !stmt.ifExists)
+        {
+            throw DbException("Table '" + stmt.table + "' doesn't exist");
+        }
+        return 0;
+
+    case MockStatement::kInsert:
+    {
+        MockTable& t = table(stmt.table);
+        std::vector<size_t> targets;
+        for (const std::string& column : stmt.columns)
+        {
+            targets.push_back(t.columnIndex(column));
+        }
+        for (const std::vector<MockValue>& values : stmt.values)
+        {
+            std::vector<std::string> row(t.columns.size());
+            for (size_t i = 0; i < targets.size(); ++i)
+            {
+                row[targets[i]] = values[i].evaluate(params, kEmpty);
+            }
+            if (!t.autoIncrement.empty())
+            {
+                std::string& id = row[t.columnIndex(t.autoIncrement)];
+                if (id.empty())
+                {
+                    id = std::to_string(t.nextId++);
+                }
+                else
+                {
+                    t.nextId = std::max(t.nextId, ::atol(id.c_str()) + 1);
+                }
+            }
+            for (size_t index : t.unique)
+            {
+                for (const std::vector<std::string>& existing : t.rows)
+                {
+                    if (existing[index] == row[index])
+                    {
+                        throw DbException("Duplicate entry '" + row[index] +
+                                          "' for key '" + t.columns[index] + "'");
+                    }
+                }
+            }
+            t.rows.push_back(std::move(row));
+        }
+        return static_cast<int>(stmt.values.size());
+    }
+
+    case MockStatement::kUpdate:
+    {
+        MockTable& t = table(stmt.table);
+        std::vector<std::pair<size_t, const std::string*>> where;
+        for (const MockCondition& cond : stmt.where)
+        {
+            where.emplace_back(t.columnIndex(cond.column), &cond.value.evaluate(params, kEmpty));
+        }
+        std::vector<std::pair<size_t, std::string>> assignments;
+        for (size_t i = 0; i < stmt.columns.size(); ++i)
+        {
+            assignments.emplace_back(t.columnIndex(stmt.columns[i]),
+                                     stmt.values[0][i].evaluate(params, kEmpty));
+        }
+        int affected = 0;
+        for (std::vector<std::string>& row : t.rows)
+        {
+            if (matches(row, where))
+            {
+                for (const auto& assignment : assignments)
+                {
+                    row[assignment.first] = assignment.second;
+                }
+                ++affected;
+            }
+        }
+        return affected;
+    }
+
+    case MockStatement::kDelete:
+    {
+        MockTable& t = table(stmt.table);
+        std::vector<std::pair<size_t, const std::string*>> where;
+        for (const MockCondition& cond : stmt.where)
+        {
+            where.emplace_back(t.columnIndex(cond.column), &cond.value.evaluate(params, kEmpty));
+        }
+        size_t before = t.rows.size();
+        t.rows.erase(std::remove_if(t.rows.begin(), t.rows.end(),
+                                    [&where](const std::vector<std::string>& row)
+                                    { return matches(row, where); }),
+                     t.rows.end());
+        return static_cast<int>(before - t.rows.size());
+    }
+
+    default:
+        throw DbException("executeUpdate cannot run a SELECT statement");
+    }
+}
+
+// ==========================================================
+// MockBackend
+// ==========================================================
+MockBackend::MockBackend(std::shared_ptr<MockDatabase> database, const Options& options)
+    : database_(std::move(database))
+    , options_(options)
+{
+}
+
+std::unique_ptr<DbResult> MockBackend::executeQuery(const std::string& sql,
+                                                    const std::vector<std::string>& params,
+                                                    int timeoutMs)
+{
+    injectLatency(timeoutMs);
+    return database_->executeQuery(sql, params);
+}
+
+int MockBackend::executeUpdate(const std::string& sql,
+                               const std::vector<std::string>& params,
+                               int timeoutMs)
+{
+    injectLatency(timeoutMs);
+    return database_->executeUpdate(sql, params);
+}
+
+void MockBackend::injectLatency(int timeoutMs)
+{
+    int delayUs = options_.latencyUs;
+    if (options_.jitterUs > 0)
+    {
+        thread_local std::mt19937 rng(std::random_device{}());
+        delayUs += static_cast<int>(rng() % static_cast<unsigned>(options_.jitterUs));
+    }
+    if (timeoutMs > 0 && delayUs > timeoutMs * 1000)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(timeoutMs));
+        throw DbTimeoutException(DbTimeoutException::kQuery,
+                                 "Query execution was interrupted, maximum statement execution time exceeded");
+    }
+    if (delayUs > 0)
+    {
+        // 在数据库锁外面睡，模拟的是各连接各自的往返时间
+        std::this_thread::sleep_for(std::chrono::microseconds(delayUs));
+    }
+}
+
+} // namespace db
+} // namespace http
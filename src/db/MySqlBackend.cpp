@@ -0,0 +1,255 @@
+#include "../../include/db/MySqlBackend.h"
+#include "../../include/db/DbException.h"
+#include <cppconn/connection.h>
+#include <cppconn/prepared_statement.h>
+#include <cppconn/resultset.h>
+#include <mysql_driver.h>
+#include <mysql/mysql.h>
+#include <muduo/base/Logging.h>
+#include <ctype.h>
+#include <strings.h>
+
+namespace http 
+{
+namespace db 
+{
+
+namespace
+{
+
+// 服务端因 MAX_EXECUTION_TIME 中断查询时的错误码 (ER_QUERY_TIMEOUT)
+const int kQueryTimeoutError = 3024;
+
+// 给 SELECT 加上执行时间上限的优化器提示，其他语句原样返回
+std::string withExecutionTimeLimit(const std::string& sql, int timeoutMs)
+{
+    size_t start = sql.find_first_not_of(" \t\r\n");
+    if (timeoutMs <= 0 || start == std::string::npos ||
+        sql.size() < start + 7 || ::strncasecmp(sql.c_str() + start, "SELECT", 6) != 0 ||
+        !::isspace(static_cast<unsigned char>(sql[start + 6])))
+    {
+        return sql;
+    }
+    std::string limited(sql, 0, start + 6);
+    limited += " /*+ MAX_EXECUTION_TIME(" + std::to_string(timeoutMs) + ") */";
+    limited.append(sql, start + 6, std::string::npos);
+    return limited;
+}
+
+} // namespace
+
+const int MySqlBackend::kNetTimeoutSeconds;
+
+MySqlBackend::MySqlBackend(const std::string& host,
+                           const std::string& user,
+                           const std::string& password,
+                           const std::string& database)
+    : host_(host)
+    , user_(user)
+    , password_(password)
+    , database_(database)
+{
+    try 
+    {
+        connect();
+        if (conn_) 
+        {
+            // 设置连接属性
+            conn_->setClientOption("OPT_RECONNECT", "true");
+            conn_->setClientOption("multi_statements", "false");
+            
+            // 设置字符集
+            std::unique_ptr<sql::Statement> stmt(conn_->createStatement());
+            stmt->execute("SET NAMES utf8mb4");
+            
+            LOG_INFO << "Database connection established";
+        }
+    } 
+    catch (const sql::SQLException& e) 
+    {
+        LOG_ERROR << "Failed to create database connection: " << e.what();
+        throw DbException(e.what());
+    }
+}
+
+void MySqlBackend::connect()
+{
+    // 读写超时只能在建连时设置
+    sql::ConnectOptionsMap options;
+    options["hostName"] = host_;
+    options["userName"] = user_;
+    options["password"] = password_;
+    options["OPT_CONNECT_TIMEOUT"] = 10;
+    options["OPT_READ_TIMEOUT"] = kNetTimeoutSeconds;
+    options["OPT_WRITE_TIMEOUT"] = kNetTimeoutSeconds;
+    sql::mysql::MySQL_Driver* driver = sql::mysql::get_mysql_driver_instance();
+    conn_.reset(driver->connect(options));
+    if (conn_)
+    {
+        conn_->setSchema(database_);
+    }
+}
+
+MySqlBackend::~MySqlBackend() 
+{
+    try 
+    {
+        cleanup();
+    } 
+    catch (...) 
+    {
+        // 析构函数中不抛出异常
+    }
+    LOG_INFO << "Database connection closed";
+}
+
+std::unique_ptr<DbResult> MySqlBackend::executeQuery(const std::string& sql,
+                                                     const std::vector<std::string>& params,
+                                                     int timeoutMs)
+{
+    try 
+    {
+        // 直接创建新的预处理语句，不使用缓存
+        std::unique_ptr<sql::PreparedStatement> stmt(
+            conn_->prepareStatement(withExecutionTimeLimit(sql, timeoutMs))
+        );
+        for (size_t i = 0; i < params.size(); ++i)
+        {
+            stmt->setString(static_cast<unsigned int>(i + 1), params[i]);
+        }
+        std::unique_ptr<sql::ResultSet> rs(stmt->executeQuery());
+
+        // 把结果一次性读出来，这样连接可以马上还回连接池
+        std::shared_ptr<DbRows> rows = std::make_shared<DbRows>();
+        sql::ResultSetMetaData* meta = rs->getMetaData();
+        unsigned int columnCount = meta->getColumnCount();
+        for (unsigned int i = 1; i <= columnCount; ++i)
+        {
+            rows->columns.push_back(meta->getColumnLabel(i));
+        }
+        rows->rows.reserve(rs->rowsCount());
+        while (rs->next())
+        {
+            std::vector<std::string> row;
+            row.reserve(columnCount);
+            for (unsigned int i = 1; i <= columnCount; ++i)
+            {
+                row.push_back(rs->isNull(i) ? std::string() : std::string(rs->getString(i)));
+            }
+            rows->rows.push_back(std::move(row));
+        }
+        return std::unique_ptr<DbResult>(new DbResult(std::move(rows)));
+    } 
+    catch (const sql::SQLException& e) 
+    {
+        if (e.getErrorCode() == kQueryTimeoutError)
+        {
+            LOG_WARN << "Query timed out after " << timeoutMs << " ms, SQL: " << sql;
+            throw DbTimeoutException(DbTimeoutException::kQuery, e.what());
+        }
+        LOG_ERROR << "Query failed: " << e.what() << ", SQL: " << sql;
+        throw DbException(e.what());
+    }
+}
+
+int MySqlBackend::executeUpdate(const std::string& sql,
+                                const std::vector<std::string>& params,
+                                int)
+{
+    // MAX_EXECUTION_TIME 只对 SELECT 生效，写语句的超时靠连接级的读写超时兜底
+    try 
+    {
+        // 直接创建新的预处理语句，不使用缓存
+        std::unique_ptr<sql::PreparedStatement> stmt(
+            conn_->prepareStatement(sql)
+        );
+        for (size_t i = 0; i < params.size(); ++i)
+        {
+            stmt->setString(static_cast<unsigned int>(i + 1), params[i]);
+        }
+        return stmt->executeUpdate();
+    } 
+    catch (const sql::SQLException& e) 
+    {
+        LOG_ERROR << "Update failed: " << e.what() << ", SQL: " << sql;
+        throw DbException(e.what());
+    }
+}
+
+bool MySqlBackend::ping() 
+{
+    try 
+    {
+        // 不使用 getStmt，直接创建新的语句
+        std::unique_ptr<sql::Statement> stmt(conn_->createStatement());
+        std::unique_ptr<sql::ResultSet> rs(stmt->executeQuery("SELECT 1"));
+        return true;
+    } 
+    catch (const sql::SQLException& e) 
+    {
+        LOG_ERROR << "Ping failed: " << e.what();
+        return false;
+    }
+}
+
+void MySqlBackend::reconnect() 
+{
+    try 
+    {
+        if (conn_) 
+        {
+            conn_->reconnect();
+        } 
+        else 
+        {
+            connect();
+        }
+    } 
+    catch (const sql::SQLException& e) 
+    {
+        LOG_ERROR << "Reconnect failed: " << e.what();
+        throw DbException(e.what());
+    }
+}
+
+void MySqlBackend::cleanup() 
+{
+    try 
+    {
+        if (conn_) 
+        {
+            // 确保所有事务都已完成
+            if (!conn_->getAutoCommit()) 
+            {
+                conn_->rollback();
+                conn_->setAutoCommit(true);
+            }
+            
+            // 清理所有未处理的结果集
+            std::unique_ptr<sql::Statement> stmt(conn_->createStatement());
+            while (stmt->getMoreResults()) 
+            {
+                auto result = stmt->getResultSet();
+                while (result && result->next()) 
+                {
+                    // 消费所有结果
+                }
+            }
+        }
+    } 
+    catch (const std::exception& e) 
+    {
+        LOG_WARN << "Error cleaning up connection: " << e.what();
+        try 
+        {
+            reconnect();
+        } 
+        catch (...) 
+        {
+            // 忽略重连错误
+        }
+    }
+}
+
+} // namespace db
+} // namespace http
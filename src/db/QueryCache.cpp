@@ -0,0 +1,487 @@
+#include "../../include/db/QueryCache.h"
+#include <ctype.h>
+#include <algorithm>
+#include <iterator>
+
+namespace http
+{
+namespace db
+{
+
+namespace
+{
+
+const size_t kMaxParsedStatements = 4096;
+
+// 把 SQL 切成小写的词：标识符 (可以带反引号和库名前缀)、逗号、括号；字符串常量和注释跳过
+std::vector<std::string> tokenize(const std::string& sql)
+{
+    std::vector<std::string> tokens;
+    size_t i = 0;
+    size_t n = sql.size();
+    while (i < n)
+    {
+        char c = sql[i];
+        if (c == '\'' || c == '"')
+        {
+            // 字符串常量：跳到配对的引号 (反斜杠转义)
+            for (++i; i < n && sql[i] != c; ++i)
+            {
+                if (sql[i] == '\\')
+                {
+                    ++i;
+                }
+            }
+            ++i;
+        }
+        else if (c == '-' && i + 1 < n && sql[i + 1] == '-')
+        {
+            i = sql.find('\n', i);
+            i = i == std::string::npos ? n : i + 1;
+        }
+        else if (c == '/' && i + 1 < n && sql[i + 1] == '*')
+        {
+            i = sql.find("*/", i + 2);
+            i = i == std::string::npos ? n : i + 2;
+        }
+        else if (c == ',' || c == '(' || c == ')' || c == ';')
+        {
+            tokens.push_back(std::string(1, c));
+            ++i;
+        }
+        else if (isalnum(static_cast<unsigned char>(c)) || c == '_' || c == '`' || c == '$')
+        {
+            std::string token;
+            for (; i < n; ++i)
+            {
+                char d = sql[i];
+                if (d == '`')
+                {
+                    continue; // 反引号去掉
+                }
+                if (!isalnum(static_cast<unsigned char>(d)) && d != '_' && d != '$' && d != '.')
+                {
+                    break;
+                }
+                token += static_cast<char>(tolower(static_cast<unsigned char>(d)));
+            }
+            tokens.push_back(token);
+        }
+        else
+        {
+            ++i; // 运算符、占位符 ?、空白
+        }
+    }
+    return tokens;
+}
+
+// 出现在表名位置但不是表名的关键字
+bool isKeyword(const std::string& token)
+{
+    static const char* const kKeywords[] = {
+        "select", "where", "join", "left", "right", "inner", "outer", "cross", "natural", "straight_join",
+        "on", "using", "group", "order", "limit", "having", "as", "union", "for", "lock", "set", "values",
+        "value", "into", "from", "ignore", "low_priority", "delayed", "high_priority", "quick", "table",
+        "if", "exists", "partition", "force", "use", "index", "key", "window", "to",
+    };
+    for (const char* keyword : kKeywords)
+    {
+        if (token == keyword)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool isName(const std::string& token)
+{
+    if (token.empty() || token == "," || token == "(" || token == ")" || token == ";")
+    {
+        return false;
+    }
+    return !isKeyword(token);
+}
+
+// 去掉库名前缀 (db.users -> users)
+std::string tableName(const std::string& token)
+{
+    size_t dot = token.rfind('.');
+    return dot == std::string::npos ? token : token.substr(dot + 1);
+}
+
+void addTable(std::vector<std::string>* tables, const std::string& token)
+{
+    std::string name = tableName(token);
+    if (!name.empty() && std::find(tables->begin(), tables->end(), name) == tables->end())
+    {
+        tables->push_back(name);
+    }
+}
+
+// 从 tokens[begin] 开始到 stop 里任何一个关键字之前，所有像名字的词都当成表 (别名也会被算进去，多失效一点没关系)
+void addNamesUntil(const std::vector<std::string>& tokens, size_t begin,
+                   std::initializer_list<const char*> stop, std::vector<std::string>* tables)
+{
+    for (size_t i = begin; i < tokens.size(); ++i)
+    {
+        for (const char* word : stop)
+        {
+            if (tokens[i] == word)
+            {
+                return;
+            }
+        }
+        if (tokens[i] == "(")
+        {
+            return; // 子查询或列定义
+        }
+        if (isName(tokens[i]))
+        {
+            addTable(tables, tokens[i]);
+        }
+    }
+}
+
+} // namespace
+
+void QueryCache::Key::setString(int, const std::string& value)
+{
+    // 参数前面带上长度，"a" + "bc" 和 "ab" + "c" 不会拼成同一个键
+    text_ += '\0';
+    text_ += std::to_string(value.size());
+    text_ += ':';
+    text_ += value;
+}
+
+QueryCache::QueryCache(const Options& options)
+    : options_(options)
+    , epoch_(0)
+    , clearedAt_(0)
+    , hits_(0)
+    , misses_(0)
+    , invalidations_(0)
+{
+}
+
+std::vector<std::string> QueryCache::tablesRead(const std::string& sql)
+{
+    std::vector<std::string> tables;
+    std::vector<std::string> tokens = tokenize(sql);
+    for (size_t i = 0; i < tokens.size(); ++i)
+    {
+        if (tokens[i] != "from" && tokens[i] != "join")
+        {
+            continue;
+        }
+        // FROM a [AS] x, b y JOIN c ...
+        size_t j = i + 1;
+        while (j < tokens.size() && isName(tokens[j]))
+        {
+            addTable(&tables, tokens[j++]);
+            if (j < tokens.size() && tokens[j] == "as")
+            {
+                ++j;
+            }
+            if (j < tokens.size() && isName(tokens[j]))
+            {
+                ++j; // 别名
+            }
+            if (j < tokens.size() && tokens[j] == "," && tokens[i] == "from")
+            {
+                ++j;
+                continue;
+            }
+            break;
+        }
+    }
+    return tables;
+}
+
+std::vector<std::string> QueryCache::tablesWritten(const std::string& sql, bool* ok)
+{
+    std::vector<std::string> tables;
+    std::vector<std::string> tokens = tokenize(sql);
+    *ok = true;
+    size_t first = 0;
+    while (first < tokens.size() && tokens[first] == "(")
+    {
+        ++first;
+    }
+    if (first >= tokens.size())
+    {
+        return tables;
+    }
+
+    const std::string& verb = tokens[first];
+    if (verb == "insert" || verb == "replace")
+    {
+        // INSERT [IGNORE] [INTO] t ...：第一个名字就是目标表
+        for (size_t i = first + 1; i < tokens.size(); ++i)
+        {
+            if (isName(tokens[i]))
+            {
+                addTable(&tables, tokens[i]);
+                break;
+            }
+        }
+    }
+    else if (verb == "update")
+    {
+        addNamesUntil(tokens, first + 1, { "set" }, &tables);
+    }
+    else if (verb == "delete")
+    {
+        addNamesUntil(tokens, first + 1, { "where", "order", "limit" }, &tables);
+    }
+    else if (verb == "truncate" || verb == "alter" || verb == "drop" || verb == "create" || verb == "rename")
+    {
+        addNamesUntil(tokens, first + 1, {}, &tables);
+    }
+    else if (verb == "set" || verb == "use" || verb == "begin" || verb == "start" || verb == "commit" ||
+             verb == "rollback" || verb == "savepoint" || verb == "release" || verb == "lock" || verb == "unlock")
+    {
+        // 不改表数据
+    }
+    else
+    {
+        *ok = false; // CALL 等：不知道改了什么
+    }
+    if (tables.empty() && (verb == "insert" || verb == "replace" || verb == "update" || verb == "delete"))
+    {
+        *ok = false;
+    }
+    return tables;
+}
+
+QueryCache::TransactionStatement QueryCache::transactionStatement(const std::string& sql)
+{
+    std::vector<std::string> tokens = tokenize(sql);
+    if (tokens.empty())
+    {
+        return kNotTransaction;
+    }
+    const std::string& verb = tokens[0];
+    if (verb == "begin" || (verb == "start" && tokens.size() > 1 && tokens[1] == "transaction"))
+    {
+        return kTransactionBegin;
+    }
+    if (verb == "commit")
+    {
+        return kTransactionEnd;
+    }
+    if (verb == "rollback")
+    {
+        // ROLLBACK [WORK] TO [SAVEPOINT] x 只回滚到保存点，事务还在
+        for (size_t i = 1; i < tokens.size(); ++i)
+        {
+            if (tokens[i] == "to")
+            {
+                return kNotTransaction;
+            }
+        }
+        return kTransactionEnd;
+    }
+    return kNotTransaction;
+}
+
+QueryCache::Tables QueryCache::readTables(const std::string& sql)
+{
+    auto it = reads_.find(sql);
+    if (it != reads_.end())
+    {
+        return it->second;
+    }
+    Tables tables = std::make_shared<const std::vector<std::string>>(tablesRead(sql));
+    if (reads_.size() < kMaxParsedStatements)
+    {
+        reads_[sql] = tables;
+    }
+    return tables;
+}
+
+QueryCache::Writes QueryCache::writeTables(const std::string& sql)
+{
+    auto it = writes_.find(sql);
+    if (it != writes_.end())
+    {
+        return it->second;
+    }
+    Writes writes;
+    writes.tables = tablesWritten(sql, &writes.ok);
+    if (writes_.size() < kMaxParsedStatements)
+    {
+        writes_[sql] = writes;
+    }
+    return writes;
+}
+
+size_t QueryCache::size() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return entries_.size();
+}
+
+QueryCache::Rows QueryCache::lookup(const std::string& key)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = entries_.find(key);
+        if (it != entries_.end())
+        {
+            if (Clock::now() < it->second.expires)
+            {
+                lru_.splice(lru_.begin(), lru_, it->second.lruPos);
+                Rows rows = it->second.rows;
+                hits_.fetch_add(1, std::memory_order_relaxed);
+                return rows;
+            }
+            erase(it);
+        }
+    }
+    misses_.fetch_add(1, std::memory_order_relaxed);
+    return Rows();
+}
+
+QueryCache::Ticket QueryCache::begin(const std::string& sql)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    Ticket ticket;
+    ticket.tables = readTables(sql);
+    ticket.epoch = epoch_;
+    return ticket;
+}
+
+void QueryCache::store(const std::string& key, const Ticket& ticket, const Rows& rows, int ttlMs)
+{
+    if (!rows || !ticket.tables || ttlMs <= 0 || rows->rows.size() > options_.maxRows)
+    {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    // 查询期间依赖的表被写过：结果可能是旧的，不缓存
+    if (clearedAt_ > ticket.epoch)
+    {
+        return;
+    }
+    for (const std::string& table : *ticket.tables)
+    {
+        auto it = invalidated_.find(table);
+        if (it != invalidated_.end() && it->second > ticket.epoch)
+        {
+            return;
+        }
+    }
+
+    auto existing = entries_.find(key);
+    if (existing != entries_.end())
+    {
+        erase(existing);
+    }
+    else if (entries_.size() >= options_.maxEntries)
+    {
+        makeRoom();
+    }
+    lru_.push_front(key);
+    Entry& entry = entries_[key];
+    entry.rows = rows;
+    entry.tables = ticket.tables;
+    entry.expires = Clock::now() + std::chrono::milliseconds(ttlMs);
+    entry.lruPos = lru_.begin();
+    for (const std::string& table : *ticket.tables)
+    {
+        byTable_[table].insert(key);
+    }
+}
+
+void QueryCache::invalidateWrites(const std::string& sql)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    Writes writes = writeTables(sql);
+    if (!writes.ok)
+    {
+        clearLocked();
+        return;
+    }
+    for (const std::string& table : writes.tables)
+    {
+        invalidateLocked(table);
+    }
+}
+
+void QueryCache::invalidateTable(const std::string& table)
+{
+    std::string name = table;
+    std::transform(name.begin(), name.end(), name.begin(),
+                   [](char c) { return static_cast<char>(tolower(static_cast<unsigned char>(c))); });
+    std::lock_guard<std::mutex> lock(mutex_);
+    invalidateLocked(name);
+}
+
+void QueryCache::clear()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    clearLocked();
+}
+
+void QueryCache::invalidateLocked(const std::string& table)
+{
+    invalidated_[table] = ++epoch_;
+    auto keys = byTable_.find(table);
+    if (keys == byTable_.end())
+    {
+        return;
+    }
+    // 先把键集合拿出来，erase 会改 byTable_
+    std::unordered_set<std::string> victims;
+    victims.swap(keys->second);
+    byTable_.erase(keys);
+    for (const std::string& key : victims)
+    {
+        auto it = entries_.find(key);
+        if (it != entries_.end())
+        {
+            erase(it);
+            invalidations_.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+}
+
+void QueryCache::clearLocked()
+{
+    clearedAt_ = ++epoch_;
+    invalidations_.fetch_add(entries_.size(), std::memory_order_relaxed);
+    entries_.clear();
+    lru_.clear();
+    byTable_.clear();
+}
+
+void QueryCache::erase(std::unordered_map<std::string, Entry>::iterator it)
+{
+    for (const std::string& table : *it->second.tables)
+    {
+        auto keys = byTable_.find(table);
+        if (keys != byTable_.end())
+        {
+            keys->second.erase(it->first);
+            if (keys->second.empty())
+            {
+                byTable_.erase(keys);
+            }
+        }
+    }
+    lru_.erase(it->second.lruPos);
+    entries_.erase(it);
+}
+
+void QueryCache::makeRoom()
+{
+    // 满了：淘汰最久没用过的 (过期的条目没人命中，自然排到后面)
+    while (!lru_.empty() && entries_.size() >= options_.maxEntries)
+    {
+        erase(entries_.find(lru_.back()));
+    }
+}
+
+} // namespace db
+} // namespace http
@@ -0,0 +1,156 @@
+#include "../../include/http/AccessLog.h"
+
+#include <muduo/base/Timestamp.h>
+
+#include <algorithm>
+#include <stdio.h>
+#include <time.h>
+
+namespace http
+{
+
+namespace
+{
+
+const size_t kMaxLoggedPath = 256; // 路径最多记这么多字节
+
+// 控制字符 (CR/LF 能在日志里伪造出一整行)、空格 (字段分隔符)、反斜杠和非 ASCII 字节写成 \xHH，
+// 一行日志总是一条记录，按空格切分也不会错位。out 至少要 4 * kMaxLoggedPath 字节
+size_t escapePath(const std::string& path, char* out)
+{
+    static const char kHex[] = "0123456789abcdef";
+    size_t n = 0;
+    size_t end = std::min(path.size(), kMaxLoggedPath);
+    for (size_t i = 0; i < end; ++i)
+    {
+        unsigned char c = static_cast<unsigned char>(path[i]);
+        if (c <= 0x20 || c >= 0x7f || c == '\\')
+        {
+            out[n++] = '\\';
+            out[n++] = 'x';
+            out[n++] = kHex[c >> 4];
+            out[n++] = kHex[c & 0xf];
+        }
+        else
+        {
+            out[n++] = static_cast<char>(c);
+        }
+    }
+    return n;
+}
+
+} // namespace
+
+AccessLog::AccessLog(const Options& options)
+    : options_(options)
+    , asyncLog_(options.basename, options.rollSize, options.flushInterval)
+    , windowSecond_(0)
+    , windowCount_(0)
+    , written_(0)
+    , dropped_(0)
+    , running_(false)
+{
+    if (options_.sampleEvery < 1)
+    {
+        options_.sampleEvery = 1;
+    }
+}
+
+AccessLog::~AccessLog()
+{
+    stop();
+}
+
+void AccessLog::start()
+{
+    if (!running_)
+    {
+        asyncLog_.start();
+        running_ = true;
+    }
+}
+
+void AccessLog::stop()
+{
+    if (running_)
+    {
+        asyncLog_.stop();
+        running_ = false;
+    }
+}
+
+bool AccessLog::shouldLog(int status, int64_t nowSecond)
+{
+    // 1. 采样：每个线程自己计数，不需要同步
+    if (options_.sampleEvery > 1 && !(options_.alwaysLogErrors && status >= 500))
+    {
+        thread_local uint64_t counter = 0;
+        if (++counter % options_.sampleEvery != 0)
+        {
+            return false;
+        }
+    }
+
+    // 2. 限速：按秒划窗口，进入新的一秒时重置计数 (偶尔多记几条无所谓)
+    if (options_.maxPerSecond > 0)
+    {
+        int64_t window = windowSecond_.load(std::memory_order_relaxed);
+        if (window != nowSecond &&
+            windowSecond_.compare_exchange_strong(window, nowSecond, std::memory_order_relaxed))
+        {
+            windowCount_.store(0, std::memory_order_relaxed);
+        }
+        if (windowCount_.fetch_add(1, std::memory_order_relaxed) >= options_.maxPerSecond)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+void AccessLog::log(const HttpRequest& req, int status, int64_t latencyUs,
+                    size_t requestBytes, size_t responseBytes)
+{
+    int64_t receiveUs = req.receiveTime().microSecondsSinceEpoch();
+    int64_t nowSecond = receiveUs / muduo::Timestamp::kMicroSecondsPerSecond;
+    if (!shouldLog(status, nowSecond))
+    {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    // 时间戳格式化：同一秒内复用上次的结果，省掉 gmtime_r
+    thread_local int64_t lastSecond = -1;
+    thread_local char timeBuf[32];
+    if (nowSecond != lastSecond)
+    {
+        time_t seconds = static_cast<time_t>(nowSecond);
+        struct tm tm;
+        gmtime_r(&seconds, &tm);
+        strftime(timeBuf, sizeof timeBuf, "%Y%m%d %H:%M:%S", &tm);
+        lastSecond = nowSecond;
+    }
+
+    // 一行一条：时间 方法 路径 状态码 延迟(us) 请求字节 响应字节
+    char path[4 * kMaxLoggedPath];
+    size_t pathLen = escapePath(req.path(), path);
+    char line[sizeof path + 256];
+    int len = snprintf(line, sizeof line, "%s.%06d %s %.*s %d %lld %zu %zu\n",
+                       timeBuf,
+                       static_cast<int>(receiveUs % muduo::Timestamp::kMicroSecondsPerSecond),
+                       req.methodString(),
+                       static_cast<int>(pathLen), path,
+                       status,
+                       static_cast<long long>(latencyUs),
+                       requestBytes,
+                       responseBytes);
+    if (len > static_cast<int>(sizeof line) - 1)
+    {
+        len = static_cast<int>(sizeof line) - 1;
+        line[len - 1] = '\n';
+    }
+    asyncLog_.append(line, len);
+    written_.fetch_add(1, std::memory_order_relaxed);
+}
+
+} // namespace http
@@ -0,0 +1,142 @@
+#include "../../include/http/ConcurrencyLimiter.h"
+
+#include <muduo/base/Logging.h>
+#include <muduo/base/Timestamp.h>
+
+#include <algorithm>
+#include <math.h>
+
+namespace http
+{
+
+namespace
+{
+
+int64_t nowUs()
+{
+    return muduo::Timestamp::now().microSecondsSinceEpoch();
+}
+
+} // namespace
+
+ConcurrencyLimiter::ConcurrencyLimiter(const Options& options)
+    : options_(options)
+    , limit_(options.initialLimit)
+    , inFlight_(0)
+    , rejected_(0)
+    , windowStartUs_(nowUs())
+    , windowLatencyUs_(0)
+    , windowSamples_(0)
+    , windowOverloads_(0)
+    , windowMaxInFlight_(0)
+    , estimatedLimit_(options.initialLimit)
+    , baselineLatencyUs_(0)
+{
+}
+
+ConcurrencyLimiter::Priority ConcurrencyLimiter::priority(const std::string& path) const
+{
+    auto it = priorities_.find(path);
+    return it != priorities_.end() ? it->second : kNormal;
+}
+
+bool ConcurrencyLimiter::tryAcquire(Priority priority)
+{
+    int current = inFlight_.fetch_add(1, std::memory_order_relaxed);
+    if (priority != kHigh)
+    {
+        int limit = limit_.load(std::memory_order_relaxed);
+        if (priority == kLow)
+        {
+            limit = std::max(1, static_cast<int>(limit * options_.lowPriorityShare));
+        }
+        if (current >= limit)
+        {
+            inFlight_.fetch_sub(1, std::memory_order_relaxed);
+            rejected_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+    }
+
+    int seen = windowMaxInFlight_.load(std::memory_order_relaxed);
+    while (current + 1 > seen &&
+           !windowMaxInFlight_.compare_exchange_weak(seen, current + 1, std::memory_order_relaxed))
+    {
+    }
+    return true;
+}
+
+void ConcurrencyLimiter::release(int64_t latencyUs, bool overloaded)
+{
+    inFlight_.fetch_sub(1, std::memory_order_relaxed);
+    windowLatencyUs_.fetch_add(latencyUs, std::memory_order_relaxed);
+    windowSamples_.fetch_add(1, std::memory_order_relaxed);
+    if (overloaded)
+    {
+        windowOverloads_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    int64_t now = nowUs();
+    if (now - windowStartUs_.load(std::memory_order_relaxed) >= options_.windowUs &&
+        windowSamples_.load(std::memory_order_relaxed) >= options_.minWindowSamples)
+    {
+        // 别的线程正在调整就不等了，样本留给下一个窗口
+        std::unique_lock<std::mutex> lock(mutex_, std::try_to_lock);
+        if (lock.owns_lock())
+        {
+            update(now);
+        }
+    }
+}
+
+void ConcurrencyLimiter::update(int64_t now)
+{
+    int samples = windowSamples_.exchange(0, std::memory_order_relaxed);
+    int64_t totalUs = windowLatencyUs_.exchange(0, std::memory_order_relaxed);
+    int overloads = windowOverloads_.exchange(0, std::memory_order_relaxed);
+    int maxInFlight = windowMaxInFlight_.exchange(inFlight_.load(std::memory_order_relaxed),
+                                                  std::memory_order_relaxed);
+    windowStartUs_.store(now, std::memory_order_relaxed);
+    if (samples <= 0)
+    {
+        return;
+    }
+
+    double shortLatencyUs = std::max(1.0, static_cast<double>(totalUs) / samples);
+    if (baselineLatencyUs_ <= 0 || shortLatencyUs < baselineLatencyUs_)
+    {
+        baselineLatencyUs_ = shortLatencyUs;
+    }
+    else
+    {
+        baselineLatencyUs_ *= 1 + options_.baselineDrift;
+    }
+
+    double newLimit;
+    if (overloads > 0)
+    {
+        newLimit = estimatedLimit_ * options_.backoffRatio;
+    }
+    else
+    {
+        double gradient = std::max(0.5, std::min(1.0, options_.tolerance * baselineLatencyUs_ / shortLatencyUs));
+        newLimit = estimatedLimit_ * gradient + ::sqrt(estimatedLimit_);
+        if (maxInFlight < estimatedLimit_ / 2)
+        {
+            newLimit = std::min(newLimit, estimatedLimit_); // 负载没到上限，不知道能不能更高
+        }
+        newLimit = estimatedLimit_ * (1 - options_.smoothing) + newLimit * options_.smoothing;
+    }
+
+    estimatedLimit_ = std::max<double>(options_.minLimit, std::min<double>(options_.maxLimit, newLimit));
+    int limit = static_cast<int>(estimatedLimit_);
+    if (limit != limit_.load(std::memory_order_relaxed))
+    {
+        LOG_DEBUG << "Concurrency limit " << limit_.load(std::memory_order_relaxed) << " -> " << limit
+                  << " (latency " << static_cast<int64_t>(shortLatencyUs) << "us, baseline "
+                  << static_cast<int64_t>(baselineLatencyUs_) << "us, overloads " << overloads << ")";
+        limit_.store(limit, std::memory_order_relaxed);
+    }
+}
+
+} // namespace http
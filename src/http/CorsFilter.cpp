@@ -0,0 +1,206 @@
+#include "../../include/http/CorsFilter.h"
+
+#include <stdexcept>
+
+namespace http
+{
+
+namespace
+{
+
+const char kForbiddenPreflight[] = "HTTP/1.1 403 Forbidden\r\nContent-Length: 0\r\n";
+const char kVaryOrigin[] = "Vary: Origin\r\n";
+const char kKeepAlive[] = "Connection: Keep-Alive\r\n\r\n";
+const char kClose[] = "Connection: close\r\n\r\n";
+
+// 回显的来源会原样写进响应头，带控制字符的一律不认
+bool safeHeaderValue(const std::string& value)
+{
+    for (char c : value)
+    {
+        if (static_cast<unsigned char>(c) < 0x20 || c == 0x7f)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+CorsFilter::CorsFilter(const Policy& defaultPolicy)
+    : default_(compile(defaultPolicy))
+{
+}
+
+void CorsFilter::setRoutePolicy(const std::string& path, const Policy& policy)
+{
+    routes_[path] = compile(policy);
+}
+
+CorsFilter::Compiled CorsFilter::compile(const Policy& policy)
+{
+    Compiled compiled;
+    compiled.policy = policy;
+    compiled.anyOrigin = false;
+    for (const std::string& origin : policy.origins)
+    {
+        if (origin == "*")
+        {
+            // 带 Cookie 的跨域请求不能对任意来源开放，否则任何网站都能以用户身份读接口
+            if (policy.credentials)
+            {
+                throw std::invalid_argument("CORS credentials require an explicit origin list, not \"*\"");
+            }
+            compiled.anyOrigin = true;
+        }
+        else
+        {
+            compiled.origins.insert(origin);
+        }
+    }
+    // 任意来源时固定回 "*"；否则回显来源，响应随 Origin 变化
+    if (compiled.anyOrigin)
+    {
+        compiled.allowOrigin = "*";
+    }
+
+    compiled.preflightHead = "HTTP/1.1 204 No Content\r\nAccess-Control-Allow-Origin: ";
+    std::string& tail = compiled.preflightTail;
+    tail = "\r\n";
+    if (compiled.allowOrigin.empty())
+    {
+        tail += "Vary: Origin\r\n";
+    }
+    tail += "Access-Control-Allow-Methods: " + policy.methods + "\r\n";
+    tail += "Access-Control-Allow-Headers: " + policy.headers + "\r\n";
+    if (policy.maxAgeSeconds > 0)
+    {
+        tail += "Access-Control-Max-Age: " + std::to_string(policy.maxAgeSeconds) + "\r\n";
+    }
+    if (policy.credentials)
+    {
+        tail += "Access-Control-Allow-Credentials: true\r\n";
+    }
+    tail += "Content-Length: 0\r\n";
+    return compiled;
+}
+
+const CorsFilter::Compiled& CorsFilter::policyFor(const std::string& path) const
+{
+    if (!routes_.empty())
+    {
+        auto it = routes_.find(path);
+        if (it != routes_.end())
+        {
+            return it->second;
+        }
+    }
+    return default_;
+}
+
+const std::string* CorsFilter::allowedOrigin(const Compiled& compiled, const std::string& origin) const
+{
+    if (!compiled.allowOrigin.empty())
+    {
+        return &compiled.allowOrigin;
+    }
+    if ((compiled.anyOrigin || compiled.origins.count(origin) > 0) && safeHeaderValue(origin))
+    {
+        return &origin;
+    }
+    return nullptr;
+}
+
+bool CorsFilter::isPreflight(const HttpRequest& req)
+{
+    return req.method() == HttpRequest::kOptions && !req.getHeader("Origin").empty() &&
+           !req.getHeader("Access-Control-Request-Method").empty();
+}
+
+int CorsFilter::appendPreflight(const HttpRequest& req, bool close, muduo::net::Buffer* out) const
+{
+    const Compiled& compiled = policyFor(req.path());
+    const std::string* origin = allowedOrigin(compiled, req.getHeader("Origin"));
+    if (!origin)
+    {
+        out->append(kForbiddenPreflight, sizeof(kForbiddenPreflight) - 1);
+        if (compiled.allowOrigin.empty())
+        {
+            out->append(kVaryOrigin, sizeof(kVaryOrigin) - 1);
+        }
+        out->append(close ? kClose : kKeepAlive);
+        return HttpResponse::k403Forbidden;
+    }
+    out->append(compiled.preflightHead);
+    out->append(*origin);
+    out->append(compiled.preflightTail);
+    out->append(close ? kClose : kKeepAlive);
+    return HttpResponse::k204NoContent;
+}
+
+void CorsFilter::preflight(const HttpRequest& req, HttpResponse* resp) const
+{
+    const Compiled& compiled = policyFor(req.path());
+    const std::string* origin = allowedOrigin(compiled, req.getHeader("Origin"));
+    if (!origin)
+    {
+        resp->setStatusCode(HttpResponse::k403Forbidden);
+        resp->setStatusMessage("Forbidden");
+        if (compiled.allowOrigin.empty())
+        {
+            resp->addHeader("Vary", "Origin");
+        }
+        return;
+    }
+    const Policy& policy = compiled.policy;
+    resp->setStatusCode(HttpResponse::k204NoContent);
+    resp->setStatusMessage("No Content");
+    resp->addHeader("Access-Control-Allow-Origin", *origin);
+    if (compiled.allowOrigin.empty())
+    {
+        resp->addHeader("Vary", "Origin");
+    }
+    resp->addHeader("Access-Control-Allow-Methods", policy.methods);
+    resp->addHeader("Access-Control-Allow-Headers", policy.headers);
+    if (policy.maxAgeSeconds > 0)
+    {
+        resp->addHeader("Access-Control-Max-Age", std::to_string(policy.maxAgeSeconds));
+    }
+    if (policy.credentials)
+    {
+        resp->addHeader("Access-Control-Allow-Credentials", "true");
+    }
+}
+
+void CorsFilter::decorate(const HttpRequest& req, HttpResponse* resp) const
+{
+    const Compiled& compiled = policyFor(req.path());
+    if (compiled.allowOrigin.empty())
+    {
+        // 按来源列表回显的策略：不管这次是允许、拒绝还是同源请求，响应都随 Origin 变化，
+        // 不加 Vary 的话共享缓存可能把一个来源的响应给另一个来源
+        resp->addHeader("Vary", "Origin");
+    }
+    const std::string& requestOrigin = req.getHeader("Origin");
+    if (requestOrigin.empty())
+    {
+        return; // 不是跨域请求
+    }
+    const std::string* origin = allowedOrigin(compiled, requestOrigin);
+    if (!origin)
+    {
+        return;
+    }
+    resp->addHeader("Access-Control-Allow-Origin", *origin);
+    if (compiled.policy.credentials)
+    {
+        resp->addHeader("Access-Control-Allow-Credentials", "true");
+    }
+    if (!compiled.policy.exposeHeaders.empty())
+    {
+        resp->addHeader("Access-Control-Expose-Headers", compiled.policy.exposeHeaders);
+    }
+}
+
+} // namespace http
@@ -1,16 +1,170 @@
 #include "../../include/http/HttpContext.h"
 
+#include <assert.h>
+#include <vector>
+
 using namespace muduo;
 using namespace muduo::net;
 
 namespace http
 {
 
+namespace
+{
+
+// 每个线程 (即每个 EventLoop) 池里最多留多少个空闲请求对象，超出的直接释放
+const size_t kMaxPooledRequests = 256;
+
+// 请求对象池：只有本线程访问，不加锁。连接的上下文在哪个线程析构就还到哪个线程的池
+struct RequestPool
+{
+    std::vector<HttpRequest*> free;
+
+    ~RequestPool()
+    {
+        for (HttpRequest* request : free)
+        {
+            delete request;
+        }
+    }
+};
+
+RequestPool& requestPool()
+{
+    thread_local RequestPool pool;
+    return pool;
+}
+
+HttpRequest* acquireRequest()
+{
+    RequestPool& pool = requestPool();
+    if (pool.free.empty())
+    {
+        return new HttpRequest;
+    }
+    HttpRequest* request = pool.free.back();
+    pool.free.pop_back();
+    return request;
+}
+
+} // namespace
+
+HttpContext::HttpContext(const HttpContext& that)
+    : state_(that.state_)
+    , request_(nullptr)
+    , readPaused_(that.readPaused_)
+    , responsePending_(that.responsePending_)
+    , accountedOutputBytes_(that.accountedOutputBytes_)
+    , requestBytes_(that.requestBytes_)
+    , inputReceived_(that.inputReceived_)
+    , inputBuffered_(that.inputBuffered_)
+    , arrivals_(that.arrivals_)
+    , http2_(that.http2_)
+    , webSocket_(that.webSocket_)
+    , tls_(that.tls_)
+{
+    assert(that.request_ == nullptr);
+}
+
+HttpContext& HttpContext::operator=(const HttpContext& that)
+{
+    assert(that.request_ == nullptr);
+    if (this != &that)
+    {
+        releaseRequest();
+        state_ = that.state_;
+        readPaused_ = that.readPaused_;
+        responsePending_ = that.responsePending_;
+        accountedOutputBytes_ = that.accountedOutputBytes_;
+        requestBytes_ = that.requestBytes_;
+        inputReceived_ = that.inputReceived_;
+        inputBuffered_ = that.inputBuffered_;
+        arrivals_ = that.arrivals_;
+        http2_ = that.http2_;
+        webSocket_ = that.webSocket_;
+        tls_ = that.tls_;
+    }
+    return *this;
+}
+
+HttpContext::~HttpContext()
+{
+    releaseRequest();
+}
+
+void HttpContext::noteInput(size_t readable, Timestamp receiveTime)
+{
+    if (readable > inputBuffered_)
+    {
+        inputReceived_ += readable - inputBuffered_;
+        arrivals_.push_back(Arrival { inputReceived_, receiveTime });
+    }
+    inputBuffered_ = readable;
+}
+
+void HttpContext::noteInputLeft(size_t readable)
+{
+    inputBuffered_ = readable;
+    if (readable == 0)
+    {
+        arrivals_.clear();
+    }
+}
+
+Timestamp HttpContext::inputArrival(size_t readable)
+{
+    // 第一个还没消费的字节是累计的第 inputReceived_ - readable 个，前面整次都消费完的读取丢掉
+    uint64_t first = inputReceived_ - readable;
+    while (arrivals_.size() > 1 && arrivals_.front().end <= first)
+    {
+        arrivals_.pop_front();
+    }
+    return arrivals_.empty() ? Timestamp::now() : arrivals_.front().time;
+}
+
+const HttpRequest& HttpContext::request() const
+{
+    static const HttpRequest kIdleRequest;
+    return request_ ? *request_ : kIdleRequest;
+}
+
+HttpRequest& HttpContext::request()
+{
+    if (!request_)
+    {
+        request_ = acquireRequest();
+    }
+    return *request_;
+}
+
+void HttpContext::releaseRequest()
+{
+    if (!request_)
+    {
+        return;
+    }
+    request_->clear();
+    RequestPool& pool = requestPool();
+    if (pool.free.size() < kMaxPooledRequests)
+    {
+        pool.free.push_back(request_);
+    }
+    else
+    {
+        delete request_;
+    }
+    request_ = nullptr;
+}
+
 // 将报文解析出来将关键信息封装到HttpRequest对象里面去
-bool HttpContext::parseRequest(Buffer *buf, Timestamp receiveTime)
+bool HttpContext::parseRequest(Buffer *buf, Timestamp receiveTime, bool stopAfterHeaders)
 {
     bool ok = true; // 解析每行请求格式是否正确
     bool hasMore = true;
+    if (!request_)
+    {
+        request_ = acquireRequest(); // 有数据到了才借请求对象
+    }
     while (hasMore)
     {
         if (state_ == kExpectRequestLine)
@@ -21,7 +175,7 @@ bool HttpContext::parseRequest(Buffer *buf, Timestamp receiveTime)
                 ok = processRequestLine(buf->peek(), crlf);
                 if (ok)
                 {
-                    request_.setReceiveTime(receiveTime);
+                    request_->setReceiveTime(receiveTime);
                     buf->retrieveUntil(crlf + 2);   // 下一行（Host）的开头,移动指针
                     state_ = kExpectHeaders;    // 2.【变身】状态切换：下一步准备读 Header
                 }
@@ -43,7 +197,7 @@ bool HttpContext::parseRequest(Buffer *buf, Timestamp receiveTime)
                 const char *colon = std::find(buf->peek(), crlf, ':');
                 if (colon < crlf)
                 {   // 既然有冒号，就把 Key 和 Value 抠出来，存进 request_ 对象里
-                    request_.addHeader(buf->peek(), colon, crlf);
+                    request_->addHeader(buf->peek(), colon, crlf);
                 }
                 else if (buf->peek() == crlf)
                 { 
@@ -51,18 +205,19 @@ bool HttpContext::parseRequest(Buffer *buf, Timestamp receiveTime)
                     // 根据请求方法和Content-Length判断是否需要继续读取body
                     //// HTTP 协议规定：Header 和 Body 之间必须有一个空行。//状态切换
                     // 只有 POST 或 PUT 请求才会有 Body，GET 请求通常没有
-                    if (request_.method() == HttpRequest::kPost || 
-                        request_.method() == HttpRequest::kPut)
+                    if (request_->method() == HttpRequest::kPost || 
+                        request_->method() == HttpRequest::kPut)
                     {
-                        std::string contentLength = request_.getHeader("Content-Length");
+                        const std::string& contentLength = request_->getHeader("Content-Length");
                         // 看看 Header 里有没有 Content-Length
                         if (!contentLength.empty())
                         {   
                             // 把长度转成数字存起来 (比如 "100" -> 100)
-                            request_.setContentLength(std::stoi(contentLength));
-                            if (request_.contentLength() > 0)
+                            request_->setContentLength(std::stoi(contentLength));
+                            if (request_->contentLength() > 0)
                             {
                                 state_ = kExpectBody;
+                                hasMore = !stopAfterHeaders;
                             }
                             else
                             {   // 长度是0，说明没数据，直接收工
@@ -100,18 +255,17 @@ bool HttpContext::parseRequest(Buffer *buf, Timestamp receiveTime)
         else if (state_ == kExpectBody)
         {
             // 检查缓冲区中是否有足够的数据
-            if (buf->readableBytes() < request_.contentLength())
+            if (buf->readableBytes() < request_->contentLength())
             {
                 hasMore = false; // 数据不完整，等待更多数据
                 return true;
             }
 
             // 只读取 Content-Length 指定的长度
-            std::string body(buf->peek(), buf->peek() + request_.contentLength());
-            request_.setBody(body);
+            request_->setBody(buf->peek(), buf->peek() + request_->contentLength());
 
             // 准确移动读指针
-            buf->retrieve(request_.contentLength());
+            buf->retrieve(request_->contentLength());
 
             state_ = kGotAll;
             hasMore = false;
@@ -127,7 +281,7 @@ bool HttpContext::processRequestLine(const char *begin, const char *end)
     const char *start = begin; //开始指针进入的是数据包的包头
     const char *space = std::find(start, end, ' '); //找到第一个空格
     // 3. 如果找到了空格，就把 start 到 space 之间的东西 ("GET") 拿去解析
-    if (space != end && request_.setMethod(start, space))
+    if (space != end && request_->setMethod(start, space))
     {
         start = space + 1;  //start 跳过空格，指向 '/'
         space = std::find(start, end, ' ');  //找到下一个空格
@@ -137,12 +291,12 @@ bool HttpContext::processRequestLine(const char *begin, const char *end)
             if (argumentStart != space) // 请求带参数
             {   
                 //这里的 start 是 '/'，argumentStart 是 '?'，space是空格
-                request_.setPath(start, argumentStart); // 注意这些返回值边界,// 切出 "/home"
-                request_.setQueryParameters(argumentStart + 1, space); // 切出 "id=1"
+                request_->setPath(start, argumentStart); // 注意这些返回值边界,// 切出 "/home"
+                request_->setQueryParameters(argumentStart + 1, space); // 切出 "id=1"
             }
             else // 请求不带参数 ， // 情况 B：没找到 '?' (比如只是 /home)，
             {
-                request_.setPath(start, space); // 整个都是路径 
+                request_->setPath(start, space); // 整个都是路径 
             }
 
             start = space + 1;  // 指针移到 'H' (HTTP的开头)
@@ -151,11 +305,11 @@ bool HttpContext::processRequestLine(const char *begin, const char *end)
             {
                 if (*(end - 1) == '1')
                 {
-                    request_.setVersion("HTTP/1.1");
+                    request_->setVersion("HTTP/1.1");
                 }
                 else if (*(end - 1) == '0')
                 {
-                    request_.setVersion("HTTP/1.0");
+                    request_->setVersion("HTTP/1.0");
                 }
                 else
                 {
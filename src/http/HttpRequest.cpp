@@ -1,8 +1,79 @@
 #include "../../include/http/HttpRequest.h"
 
+#include <algorithm>
+#include <assert.h>
+#include <string.h>
+
 namespace http
 {
 
+namespace
+{
+
+// 请求体超过这个大小时 clear() 释放它，不让一次大上传一直占着连接的内存
+const size_t kMaxRetainedBody = 64 * 1024;
+
+const std::string kEmpty;
+
+} // namespace
+
+void FieldList::set(const char* name, size_t nameLen, const char* value, size_t valueLen)
+{
+    for (size_t i = 0; i < size_; ++i)
+    {
+        Field& field = fields_[i];
+        if (field.first.size() == nameLen && ::memcmp(field.first.data(), name, nameLen) == 0)
+        {
+            field.second.assign(value, valueLen);
+            return;
+        }
+    }
+    if (size_ == fields_.size())
+    {
+        fields_.emplace_back();
+    }
+    // assign 复用槽位里 string 已有的容量
+    Field& field = fields_[size_++];
+    field.first.assign(name, nameLen);
+    field.second.assign(value, valueLen);
+}
+
+const std::string* FieldList::find(const char* name, size_t nameLen) const
+{
+    for (size_t i = 0; i < size_; ++i)
+    {
+        const Field& field = fields_[i];
+        if (field.first.size() == nameLen && ::memcmp(field.first.data(), name, nameLen) == 0)
+        {
+            return &field.second;
+        }
+    }
+    return nullptr;
+}
+
+void HttpRequest::clear()
+{
+    method_ = kInvalid;
+    version_ = "Unknown";
+    path_.clear();
+    pathParameters_.clear();
+    query_.clear();
+    queryParameters_.clear();
+    receiveTime_ = muduo::Timestamp();
+    peerAddress_ = muduo::net::InetAddress();
+    headers_.clear();
+    if (content_.capacity() > kMaxRetainedBody)
+    {
+        std::string().swap(content_);
+    }
+    else
+    {
+        content_.clear();
+    }
+    contentLength_ = 0;
+    deadline_ = Deadline::max();
+}
+
 void HttpRequest::setReceiveTime(muduo::Timestamp t)
 {
     receiveTime_ = t;
@@ -11,24 +82,26 @@ void HttpRequest::setReceiveTime(muduo::Timestamp t)
 bool HttpRequest::setMethod(const char *start, const char *end)
 {
     assert(method_ == kInvalid);
-    std::string m(start, end); // [start, end)
-    if (m == "GET")
+    // 直接比较 [start, end)，不构造临时 string
+    size_t len = end - start;
+    auto is = [start, len](const char* m) { return len == ::strlen(m) && ::memcmp(start, m, len) == 0; };
+    if (is("GET"))
     {
         method_ = kGet;
     }
-    else if (m == "POST")
+    else if (is("POST"))
     {
         method_ = kPost;
     }
-    else if (m == "PUT")
+    else if (is("PUT"))
     {
         method_ = kPut;
     }
-    else if (m == "DELETE")
+    else if (is("DELETE"))
     {
         method_ = kDelete;
     }
-    else if (m == "OPTIONS")
+    else if (is("OPTIONS"))
     {
         method_ = kOptions;
     }
@@ -40,6 +113,20 @@ bool HttpRequest::setMethod(const char *start, const char *end)
     return method_ != kInvalid;
 }
 
+const char* HttpRequest::methodString() const
+{
+    switch (method_)
+    {
+    case kGet:     return "GET";
+    case kPost:    return "POST";
+    case kHead:    return "HEAD";
+    case kPut:     return "PUT";
+    case kDelete:  return "DELETE";
+    case kOptions: return "OPTIONS";
+    default:       return "UNKNOWN";
+    }
+}
+
 void HttpRequest::setPath(const char *start, const char *end)
 {
     path_.assign(start, end);
@@ -47,99 +134,79 @@ void HttpRequest::setPath(const char *start, const char *end)
 
 void HttpRequest::setPathParameters(const std::string &key, const std::string &value)
 {
-    pathParameters_[key] = value;
+    pathParameters_.set(key, value);
 }
 
-std::string HttpRequest::getPathParameters(const std::string &key) const
+const std::string& HttpRequest::getPathParameters(const std::string &key) const
 {
-    auto it = pathParameters_.find(key);
-    if (it != pathParameters_.end())
-    {
-        return it->second;
-    }
-    return "";
+    const std::string* value = pathParameters_.find(key);
+    return value ? *value : kEmpty;
 }
 
-std::string HttpRequest::getQueryParameters(const std::string &key) const
+const std::string& HttpRequest::getQueryParameters(const std::string &key) const
 {
-    auto it = queryParameters_.find(key);
-    if (it != queryParameters_.end())
-    {
-        return it->second;
-    }
-    return "";
+    const std::string* value = queryParameters_.find(key);
+    return value ? *value : kEmpty;
 }
 
 // 这是从问号后面分割参数
 void HttpRequest::setQueryParameters(const char *start, const char *end)
 {
-    std::string argumentStr(start, end);
-    std::string::size_type pos = 0;
-    std::string::size_type prev = 0;
+    query_.assign(start, end);
+    const char* p = query_.data();
+    const char* last = p + query_.size();
 
-    // 按 & 分割多个参数
-    while ((pos = argumentStr.find('&', prev)) != std::string::npos)
+    // 按 & 分割多个参数，没有 = 的片段忽略
+    for (;;)
     {
-        std::string pair = argumentStr.substr(prev, pos - prev);
-        std::string::size_type equalPos = pair.find('=');
-
-        if (equalPos != std::string::npos)
+        const char* amp = std::find(p, last, '&');
+        const char* equal = std::find(p, amp, '=');
+        if (equal != amp)
         {
-            std::string key = pair.substr(0, equalPos);
-            std::string value = pair.substr(equalPos + 1);
-            queryParameters_[key] = value;
+            queryParameters_.set(p, equal - p, equal + 1, amp - equal - 1);
         }
-
-        prev = pos + 1;
-    }
-
-    // 处理最后一个参数
-    std::string lastPair = argumentStr.substr(prev);
-    std::string::size_type equalPos = lastPair.find('=');
-    if (equalPos != std::string::npos)
-    {
-        std::string key = lastPair.substr(0, equalPos);
-        std::string value = lastPair.substr(equalPos + 1);
-        queryParameters_[key] = value;
+        if (amp == last)
+        {
+            break;
+        }
+        p = amp + 1;
     }
 }
 
 void HttpRequest::addHeader(const char *start, const char *colon, const char *end)
 {
-    std::string key(start, colon);
-    ++colon;
-    while (colon < end && isspace(*colon))
+    const char* value = colon + 1;
+    while (value < end && isspace(*value))
     {
-        ++colon;
+        ++value;
     }
-    std::string value(colon, end);
-    while (!value.empty() && isspace(value[value.size() - 1])) // 消除尾部空格
+    while (end > value && isspace(end[-1])) // 消除尾部空格
     {
-        value.resize(value.size() - 1);
+        --end;
     }
-    headers_[key] = value;
+    headers_.set(start, colon - start, value, end - value);
 }
 
-std::string HttpRequest::getHeader(const std::string &field) const
+const std::string& HttpRequest::getHeader(const std::string &field) const
 {
-    std::string result;
-    auto it = headers_.find(field);
-    if (it != headers_.end())
-    {
-        result = it->second;
-    }
-    return result;
+    const std::string* value = headers_.find(field);
+    return value ? *value : kEmpty;
 }
 
 void HttpRequest::swap(HttpRequest &that)
 {
     std::swap(method_, that.method_);
     std::swap(path_, that.path_);
-    std::swap(pathParameters_, that.pathParameters_);
-    std::swap(queryParameters_, that.queryParameters_);
+    pathParameters_.swap(that.pathParameters_);
+    std::swap(query_, that.query_);
+    queryParameters_.swap(that.queryParameters_);
     std::swap(version_, that.version_);
-    std::swap(headers_, that.headers_);
+    headers_.swap(that.headers_);
     std::swap(receiveTime_, that.receiveTime_);
+    std::swap(peerAddress_, that.peerAddress_);
+    std::swap(content_, that.content_);
+    std::swap(contentLength_, that.contentLength_);
+    std::swap(deadline_, that.deadline_);
 }
 
 } // namespace http
\ No newline at end of file
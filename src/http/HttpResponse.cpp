@@ -1,6 +1,11 @@
 #include "../../include/http/HttpResponse.h"
+#include "../../include/http/HttpRequest.h"
+#include <muduo/base/Logging.h>
 #include <muduo/net/Buffer.h>
+#include <muduo/net/EventLoop.h>
+#include <assert.h>
 #include <stdio.h>
+#include <vector>
 
 using namespace muduo;
 using namespace muduo::net;
@@ -24,7 +29,7 @@ void HttpResponse::appendToBuffer(muduo::net::Buffer* output) const
     }
     else
     {
-        snprintf(buf, sizeof buf, "Content-Length: %zd\r\n", body_.size());
+        snprintf(buf, sizeof buf, "Content-Length: %zd\r\n", body().size());
         output->append(buf);
         output->append("Connection: Keep-Alive\r\n");
     }
@@ -42,7 +47,7 @@ void HttpResponse::appendToBuffer(muduo::net::Buffer* output) const
     output->append("\r\n");
 
     // 5. 响应体
-    output->append(body_);
+    output->append(body());
 }
 
 void HttpResponse::setStatusLine(const std::string& version,
@@ -54,4 +59,79 @@ void HttpResponse::setStatusLine(const std::string& version,
     statusMessage_ = statusMessage;
 }
 
+// 推迟的响应：completion 和服务器共享，fill 在 loop 里执行
+struct HttpResponse::Deferred
+{
+    // fill 抛了异常：整个换成 500，之前加上的头不跟着发出去
+    static void setInternalError(HttpResponse* resp)
+    {
+        *resp = HttpResponse(resp->closeConnection());
+        resp->setStatusCode(k500InternalServerError);
+        resp->setStatusMessage("Internal Server Error");
+        resp->setContentType("application/json");
+        resp->setBody("{\"code\":500,\"msg\":\"Internal server error\"}");
+    }
+
+    EventLoop*                    loop = nullptr;
+    std::vector<Step>             steps;
+    std::unique_ptr<HttpRequest>  request;  // detach() 之后才有
+    std::unique_ptr<HttpResponse> response;
+
+    void complete(const Fill& fill)
+    {
+        // 没有 detach (业务抛了异常，服务器已经按 500 回了) 或者重复调用：结果没人要了
+        if (!response)
+        {
+            return;
+        }
+        std::unique_ptr<HttpRequest> req = std::move(request);
+        std::unique_ptr<HttpResponse> resp = std::move(response);
+        try
+        {
+            fill(resp.get());
+        }
+        catch (const std::exception& e)
+        {
+            LOG_ERROR << "Deferred response for " << req->path() << " failed: " << e.what();
+            setInternalError(resp.get());
+        }
+        catch (...)
+        {
+            // 不能让异常打到事件循环上：后面的步骤不执行的话连接一直等这个响应
+            LOG_ERROR << "Deferred response for " << req->path() << " failed";
+            setInternalError(resp.get());
+        }
+        for (const Step& step : steps)
+        {
+            step(*req, resp.get());
+        }
+    }
+};
+
+HttpResponse::Completion HttpResponse::defer()
+{
+    assert(!deferred_);
+    deferred_ = std::make_shared<Deferred>();
+    deferred_->loop = EventLoop::getEventLoopOfCurrentThread();
+    assert(deferred_->loop);
+    std::shared_ptr<Deferred> state = deferred_;
+    return [state](const Fill& fill)
+    {
+        state->loop->queueInLoop([state, fill] { state->complete(fill); });
+    };
+}
+
+void HttpResponse::addCompletionStep(Step step)
+{
+    deferred_->steps.push_back(std::move(step));
+}
+
+void HttpResponse::detach(const HttpRequest& req)
+{
+    // 先把状态拿出来，挪进去的响应就不再引用它 (不然状态和响应互相持有)
+    std::shared_ptr<Deferred> state = std::move(deferred_);
+    state->request.reset(new HttpRequest(req));
+    state->response.reset(new HttpResponse(std::move(*this)));
+}
+
 } // namespace http
\ No newline at end of file
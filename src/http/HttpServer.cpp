@@ -1,7 +1,29 @@
 #include "http/HttpServer.h"
+#include "http/AccessLog.h"
+#include "http/ConcurrencyLimiter.h"
+#include "http/CorsFilter.h"
 #include "http/HttpContext.h"
 #include "http/HttpRequest.h"
 #include "http/HttpResponse.h"
+#include "http/Middleware.h"
+#include "http/RateLimiter.h"
+#include "http/TrafficCapture.h"
+#include "http2/Http2Connection.h"
+#include "tls/TlsConnection.h"
+#include "websocket/WebSocketConnection.h"
+#include "metrics/Metrics.h"
+
+#include <muduo/base/CountDownLatch.h>
+
+#include <algorithm>
+#include <dirent.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <linux/filter.h>
 
 using namespace muduo;
 using namespace muduo::net;
@@ -17,12 +39,165 @@ void defaultHttpCallback(const HttpRequest&, HttpResponse* resp)
     resp->setCloseConnection(true);
 }
 
+namespace
+{
+
+// 把当前线程绑到指定 CPU 上
+void pinCurrentThreadToCpu(int cpu)
+{
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    int ret = pthread_setaffinity_np(pthread_self(), sizeof set, &set);
+    if (ret != 0)
+    {
+        LOG_WARN << "pthread_setaffinity_np(cpu " << cpu << ") failed: " << strerror_tl(ret);
+    }
+}
+
+// 给端口为 port 的 reuseport 组挂 CPU 分流程序：返回 (当前 CPU % groupSize) 作为 socket 下标。
+// muduo 没有暴露 Acceptor 的 fd，这里扫描本进程的 fd 找到正在监听该端口的 socket，
+// 挂在组内任意一个 socket 上即对整个组生效
+bool attachCpuSteeringProgram(const InetAddress& listenAddr, int groupSize)
+{
+#ifdef SO_ATTACH_REUSEPORT_CBPF
+    DIR* dir = ::opendir("/proc/self/fd");
+    if (!dir)
+    {
+        LOG_SYSERR << "opendir /proc/self/fd";
+        return false;
+    }
+
+    int listenFd = -1;
+    while (struct dirent* entry = ::readdir(dir))
+    {
+        int fd = ::atoi(entry->d_name);
+        if (fd <= 2)
+        {
+            continue;
+        }
+        int accepting = 0;
+        socklen_t len = sizeof accepting;
+        if (::getsockopt(fd, SOL_SOCKET, SO_ACCEPTCONN, &accepting, &len) < 0 || !accepting)
+        {
+            continue;
+        }
+        struct sockaddr_storage addr;
+        socklen_t addrLen = sizeof addr;
+        if (::getsockname(fd, reinterpret_cast<struct sockaddr*>(&addr), &addrLen) == 0 &&
+            addr.ss_family == listenAddr.family() &&
+            reinterpret_cast<struct sockaddr_in*>(&addr)->sin_port == listenAddr.portNetEndian())
+        {
+            listenFd = fd;
+            break;
+        }
+    }
+    ::closedir(dir);
+
+    if (listenFd < 0)
+    {
+        LOG_ERROR << "No listening socket found on " << listenAddr.toIpPort();
+        return false;
+    }
+
+    struct sock_filter code[] = {
+        { BPF_LD  | BPF_W | BPF_ABS, 0, 0, static_cast<uint32_t>(SKF_AD_OFF + SKF_AD_CPU) }, // A = 当前 CPU
+        { BPF_ALU | BPF_MOD | BPF_K, 0, 0, static_cast<uint32_t>(groupSize) },               // A = A % groupSize
+        { BPF_RET | BPF_A, 0, 0, 0 },                                                        // 返回 A
+    };
+    struct sock_fprog prog;
+    prog.len = sizeof(code) / sizeof(code[0]);
+    prog.filter = code;
+    if (::setsockopt(listenFd, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, &prog, sizeof prog) < 0)
+    {
+        LOG_SYSERR << "setsockopt SO_ATTACH_REUSEPORT_CBPF";
+        return false;
+    }
+    return true;
+#else
+    LOG_WARN << "SO_ATTACH_REUSEPORT_CBPF is not supported on this platform";
+    return false;
+#endif
+}
+
+// 每个 I/O 线程一份的临时缓冲区：组装响应、TLS 加密都借用它们，用完即空，
+// 不用每个请求都分配一次；偶尔被大响应撑大的，用完后缩回去
+struct ScratchBuffers
+{
+    Buffer response;
+    Buffer cipher;
+};
+
+const size_t kScratchKeepCapacity = 256 * 1024;
+
+ScratchBuffers& scratchBuffers()
+{
+    thread_local ScratchBuffers buffers;
+    return buffers;
+}
+
+// 客户端要求 (或 HTTP/1.0 默认) 响应后关闭连接
+bool wantsClose(const HttpRequest& req)
+{
+    const std::string& connection = req.getHeader("Connection");
+    return (connection == "close") ||
+           (req.getVersion() == "HTTP/1.0" && connection != "Keep-Alive");
+}
+
+void releaseScratch(Buffer* buf)
+{
+    // conn->send() 在连接已断开时不会取走数据，这里清掉，不能留给下一个连接
+    buf->retrieveAll();
+    if (buf->internalCapacity() > kScratchKeepCapacity)
+    {
+        buf->shrink(0);
+    }
+}
+
+// 连接空闲时把撑大的缓冲区缩回 muduo 的初始大小
+void trimIdleBuffer(Buffer* buf)
+{
+    if (buf->readableBytes() == 0 &&
+        buf->internalCapacity() > Buffer::kCheapPrepend + Buffer::kInitialSize)
+    {
+        buf->shrink(0);
+    }
+}
+
+} // namespace
+
 HttpServer::HttpServer(EventLoop* loop,
                        const InetAddress& listenAddr,
                        const std::string& name,
                        TcpServer::Option option)
   : server_(loop, listenAddr, name, option),
-    httpCallback_(defaultHttpCallback)
+    httpCallback_(defaultHttpCallback),
+    accessLog_(nullptr),
+    capture_(nullptr),
+    limiter_(nullptr),
+    rateLimiter_(nullptr),
+    middleware_(nullptr),
+    cors_(nullptr),
+    listenAddr_(listenAddr),
+    option_(option),
+    reusePortListeners_(1),
+    cpuSteering_(false),
+    highWaterMark_(64 * 1024),
+    outputBudget_(64 * 1024 * 1024),
+    pendingOutputBytes_(0),
+    pausedConnections_(0),
+    highWaterMarkEvents_(0),
+    budgetExceededEvents_(0),
+    http2Enabled_(true),
+    http2Connections_(0),
+    http2TotalConnections_(0),
+    http2Streams_(0),
+    webSocketMaxMessageSize_(1024 * 1024),
+    webSocketConnections_(0),
+    tlsContext_(nullptr),
+    compactIdle_(false),
+    defaultTimeoutMs_(0),
+    expiredRequests_(0)
 {
     server_.setConnectionCallback(
         std::bind(&HttpServer::onConnection, this, _1));
@@ -32,12 +207,129 @@ HttpServer::HttpServer(EventLoop* loop,
 
 HttpServer::~HttpServer()
 {
+    // TcpServer 只能在自己的 loop 线程里析构，逐个投递过去销毁
+    for (auto& listener : listeners_)
+    {
+        EventLoop* ioLoop = listener->getLoop();
+        CountDownLatch latch(1);
+        ioLoop->runInLoop([&listener, &latch]
+        {
+            listener.reset();
+            latch.countDown();
+        });
+        latch.wait();
+    }
+}
+
+HttpServer::BackpressureStats HttpServer::backpressureStats() const
+{
+    BackpressureStats stats;
+    stats.pendingOutputBytes = pendingOutputBytes_.load(std::memory_order_relaxed);
+    stats.pausedConnections = pausedConnections_.load(std::memory_order_relaxed);
+    stats.highWaterMarkEvents = highWaterMarkEvents_.load(std::memory_order_relaxed);
+    stats.budgetExceededEvents = budgetExceededEvents_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+HttpServer::Http2Stats HttpServer::http2Stats() const
+{
+    Http2Stats stats;
+    stats.activeConnections = http2Connections_.load(std::memory_order_relaxed);
+    stats.totalConnections = http2TotalConnections_.load(std::memory_order_relaxed);
+    stats.totalStreams = http2Streams_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+void HttpServer::addWebSocketRoute(const std::string& path, const websocket::WebSocketHandler& handler)
+{
+    webSocketRoutes_[path] = std::make_shared<const websocket::WebSocketHandler>(handler);
 }
 
 void HttpServer::start()
 {
     LOG_INFO << "HttpServer[" << server_.name() << "] starts listening on " << server_.ipPort();
+    if (reusePortListeners_ > 1)
+    {
+        startReusePortListeners();
+    }
+    else
+    {
+        server_.start();
+    }
+}
+
+void HttpServer::startReusePortListeners()
+{
+    if (option_ != TcpServer::kReusePort)
+    {
+        LOG_FATAL << "HttpServer[" << server_.name()
+                  << "] multi-listener mode requires TcpServer::kReusePort";
+    }
+
+    // BPF 程序按 "收包 CPU % listener 个数" 选 socket：listener 比 CPU 多的话多出来的永远分不到连接，
+    // 第 i 个 listener 也没法绑到 CPU i 上，这时只开 CPU 个数那么多
+    int cpus = static_cast<int>(::sysconf(_SC_NPROCESSORS_ONLN));
+    if (cpuSteering_ && cpus > 0 && reusePortListeners_ > cpus)
+    {
+        LOG_WARN << "HttpServer[" << server_.name() << "] CPU steering with " << reusePortListeners_
+                 << " listeners on " << cpus << " CPUs, using " << cpus << " listeners";
+        reusePortListeners_ = cpus;
+    }
+
+    // listener 0 就是 baseLoop 上的 server_，它自己做 I/O
+    server_.setThreadNum(0);
     server_.start();
+
+    // 按顺序逐个 listen：reuseport 组内 socket 的下标就是 listen 的先后顺序，
+    // BPF 程序返回的下标才能和绑核的 CPU 对上
+    for (int i = 1; i < reusePortListeners_; ++i)
+    {
+        int cpu = i;
+        bool steering = cpuSteering_;
+        std::string name = server_.name() + "-listener" + std::to_string(i);
+
+        listenerThreads_.emplace_back(new EventLoopThread(
+            [steering, cpu](EventLoop*)
+            {
+                if (steering)
+                {
+                    pinCurrentThreadToCpu(cpu);
+                }
+            }, name));
+        EventLoop* ioLoop = listenerThreads_.back()->startLoop();
+
+        listeners_.emplace_back(new TcpServer(ioLoop, listenAddr_, name, TcpServer::kReusePort));
+        TcpServer* listener = listeners_.back().get();
+        listener->setConnectionCallback(
+            std::bind(&HttpServer::onConnection, this, _1));
+        listener->setMessageCallback(
+            std::bind(&HttpServer::onMessage, this, _1, _2, _3));
+
+        // TcpServer::start 要求在自己的 loop 线程里调用
+        CountDownLatch latch(1);
+        ioLoop->runInLoop([listener, &latch]
+        {
+            listener->start();
+            latch.countDown();
+        });
+        latch.wait();
+    }
+
+    if (cpuSteering_)
+    {
+        if (attachCpuSteeringProgram(listenAddr_, reusePortListeners_))
+        {
+            // 最后才绑 baseLoop 所在的线程 (通常是主线程)：之前绑的话，之后创建的线程都会继承 CPU 0
+            pinCurrentThreadToCpu(0);
+        }
+        else
+        {
+            LOG_WARN << "HttpServer[" << server_.name()
+                     << "] CPU steering disabled, falling back to kernel hashing";
+        }
+    }
+    LOG_INFO << "HttpServer[" << server_.name() << "] running " << reusePortListeners_
+             << " SO_REUSEPORT listeners" << (cpuSteering_ ? " with CPU steering" : "");
 }
 
 void HttpServer::onConnection(const TcpConnectionPtr& conn)
@@ -46,7 +338,49 @@ void HttpServer::onConnection(const TcpConnectionPtr& conn)
     {
         // 连接建立时，绑定一个 HttpContext 到这个连接上
         // 这样每个连接都有自己独立的解析上下文
-        conn->setContext(HttpContext());
+        HttpContext context;
+        if (tlsContext_)
+        {
+            std::shared_ptr<tls::TlsConnection> tls = std::make_shared<tls::TlsConnection>(tlsContext_);
+            if (!tls->ok())
+            {
+                // 断开时的回调还要用 context，先挂上再关
+                conn->setContext(context);
+                conn->forceClose();
+                return;
+            }
+            context.setTls(tls);
+        }
+        conn->setContext(context);
+        // outputBuffer 越过高水位时 muduo 会回调，用来暂停这个连接
+        conn->setHighWaterMarkCallback(
+            std::bind(&HttpServer::onHighWaterMark, this, _1, _2), highWaterMark_);
+    }
+    else
+    {
+        // 连接断开：把它占用的输出预算和暂停计数还回去
+        HttpContext* context = boost::any_cast<HttpContext>(conn->getMutableContext());
+        if (context)
+        {
+            pendingOutputBytes_.fetch_sub(context->accountedOutputBytes());
+            context->setAccountedOutputBytes(0);
+            if (context->readPaused())
+            {
+                context->setReadPaused(false);
+                --pausedConnections_;
+            }
+            if (context->http2())
+            {
+                context->setHttp2(nullptr);
+                --http2Connections_;
+            }
+            if (context->webSocket())
+            {
+                context->webSocket()->onClosed();
+                context->setWebSocket(nullptr);
+                --webSocketConnections_;
+            }
+        }
     }
 }
 
@@ -54,52 +388,692 @@ void HttpServer::onMessage(const TcpConnectionPtr& conn,
                            Buffer* buf,
                            Timestamp receiveTime)
 {
-    // 取出当前连接的上下文
     HttpContext* context = boost::any_cast<HttpContext>(conn->getMutableContext());
+    if (std::shared_ptr<tls::TlsConnection> tls = context->tls())
+    {
+        // 先解密，HTTP 层只看到明文；握手阶段的回复直接发出去
+        Buffer* out = &scratchBuffers().cipher;
+        bool ok = tls->onData(buf, out);
+        if (out->readableBytes() > 0)
+        {
+            conn->send(out);
+        }
+        releaseScratch(out);
+        if (!ok)
+        {
+            conn->shutdown();
+            return;
+        }
+        processInput(conn, tls->plaintext(), receiveTime);
+        if (tls->peerClosed() && conn->connected())
+        {
+            shutdown(conn, context);
+        }
+        if (compactIdle_)
+        {
+            trimIdleBuffer(tls->plaintext());
+            trimIdleBuffer(buf);
+        }
+        return;
+    }
+    processInput(conn, buf, receiveTime);
+    if (compactIdle_)
+    {
+        trimIdleBuffer(buf);
+    }
+}
 
-    // 解析请求
-    if (!context->parseRequest(buf, receiveTime))
+void HttpServer::send(const TcpConnectionPtr& conn, HttpContext* context, Buffer* buf)
+{
+    if (context->tls())
+    {
+        Buffer* cipher = &scratchBuffers().cipher;
+        context->tls()->encrypt(buf->peek(), buf->readableBytes(), cipher);
+        buf->retrieveAll();
+        conn->send(cipher);
+        releaseScratch(cipher);
+    }
+    else
     {
-        // 解析出错，直接发 400 错误并关闭连接
-        conn->send("HTTP/1.1 400 Bad Request\r\n\r\n");
-        conn->shutdown();
+        conn->send(buf);
     }
+}
+
+void HttpServer::send(const TcpConnectionPtr& conn, HttpContext* context, const char* message)
+{
+    Buffer buf;
+    buf.append(message, ::strlen(message));
+    send(conn, context, &buf);
+}
 
-    // 如果解析完成了一个完整的请求
-    if (context->gotAll())
+void HttpServer::shutdown(const TcpConnectionPtr& conn, HttpContext* context)
+{
+    // TLS 连接先发 close_notify，对端才能区分正常关闭和截断
+    if (context->tls())
     {
+        Buffer out;
+        context->tls()->shutdown(&out);
+        if (out.readableBytes() > 0)
+        {
+            conn->send(&out);
+        }
+    }
+    conn->shutdown();
+}
+
+void HttpServer::processInput(const TcpConnectionPtr& conn,
+                              Buffer* buf,
+                              Timestamp receiveTime)
+{
+    // 取出当前连接的上下文
+    HttpContext* context = boost::any_cast<HttpContext>(conn->getMutableContext());
+    // 记下这次新读到的数据是什么时候到的 (恢复处理时没有新数据，receiveTime 不会被用到)
+    context->noteInput(buf->readableBytes(), receiveTime);
+
+    // 一次读到的数据里可能有多个 pipelining 的请求，逐个处理；
+    // 如果连接因为输出积压被暂停、或者在等推迟的响应，剩下的数据留在 buf 里，等恢复后再处理
+    while (!context->readPaused() && !context->responsePending() && buf->readableBytes() > 0)
+    {
+        // 已经切换到 HTTP/2 或 WebSocket，剩下的数据都是帧
+        if (context->http2())
+        {
+            processHttp2(conn, context, buf);
+            break;
+        }
+        if (context->webSocket())
+        {
+            processWebSocket(conn, context, buf);
+            break;
+        }
+
+        // 在请求边界上看到 HTTP/2 连接前言 (prior knowledge)
+        if (http2Enabled_ && context->requestBytes() == 0)
+        {
+            size_t n = std::min(buf->readableBytes(), http2::Http2Connection::kClientPrefaceLength);
+            if (::memcmp(buf->peek(), http2::Http2Connection::kClientPreface, n) == 0)
+            {
+                if (n < http2::Http2Connection::kClientPrefaceLength)
+                {
+                    break; // 前言还没收全
+                }
+                startHttp2(conn, context, nullptr);
+                continue;
+            }
+        }
+
+        // 解析请求；要限流时请求头收齐就先停下，请求体留到通过检查以后再读。
+        // 请求的接收时间用它的第一个字节读到的时间，在缓冲区里排队的时间也算进去
+        bool checkRate = rateLimiter_ && !context->headersComplete();
+        size_t readable = buf->readableBytes();
+        bool ok = context->parseRequest(buf, context->inputArrival(readable), checkRate);
+        context->addRequestBytes(readable - buf->readableBytes());
+        if (!ok)
+        {
+            // 解析出错，直接发 400 错误并关闭连接
+            send(conn, context, "HTTP/1.1 400 Bad Request\r\n\r\n");
+            shutdown(conn, context);
+            break;
+        }
+
+        if (checkRate && context->headersComplete())
+        {
+            if (!checkRateLimit(conn, context))
+            {
+                if (!conn->connected() || !context->gotAll())
+                {
+                    // 请求体没读，连接上剩下的数据没法再按请求边界解析，丢掉
+                    buf->retrieveAll();
+                    break;
+                }
+                context->reset();
+                continue;
+            }
+            if (!context->gotAll())
+            {
+                continue; // 接着读请求体
+            }
+        }
+
+        // 数据还不够一个完整请求，等下一次 onMessage
+        if (!context->gotAll())
+        {
+            break;
+        }
+
+        // h2c 升级：回 101，原请求在 HTTP/2 的 stream 1 上处理
+        if (http2Enabled_ && http2::Http2Connection::isUpgradeRequest(context->request()))
+        {
+            bool upgraded = startHttp2(conn, context, &context->request());
+            context->reset();
+            if (!upgraded)
+            {
+                send(conn, context, "HTTP/1.1 400 Bad Request\r\n\r\n");
+                shutdown(conn, context);
+                break;
+            }
+            continue;
+        }
+
+        // WebSocket 升级：只接受注册过的路径
+        if (!webSocketRoutes_.empty() &&
+            websocket::WebSocketConnection::isUpgradeRequest(context->request()))
+        {
+            auto route = webSocketRoutes_.find(context->request().path());
+            if (route != webSocketRoutes_.end())
+            {
+                if (route->second->accept && !route->second->accept(context->request()))
+                {
+                    context->reset();
+                    send(conn, context, "HTTP/1.1 403 Forbidden\r\nContent-Length: 0\r\nConnection: close\r\n\r\n");
+                    shutdown(conn, context);
+                    break;
+                }
+                bool upgraded = startWebSocket(conn, context, route->second);
+                context->reset();
+                if (!upgraded)
+                {
+                    send(conn, context, "HTTP/1.1 400 Bad Request\r\nSec-WebSocket-Version: 13\r\n\r\n");
+                    shutdown(conn, context);
+                    break;
+                }
+                continue;
+            }
+        }
+
         // 处理请求
-        onRequest(conn, context->request());
+        context->request().setPeerAddress(conn->peerAddress());
+        onRequest(conn, context->request(), context->requestBytes());
         // 重置上下文，准备接收下一个请求 (Keep-Alive)
         context->reset();
+
+        // 短连接已经 shutdown，后面的请求不用再处理了
+        if (!conn->connected())
+        {
+            break;
+        }
     }
+    context->noteInputLeft(buf->readableBytes());
 }
 
-void HttpServer::onRequest(const TcpConnectionPtr& conn, const HttpRequest& req)
+void HttpServer::onRequest(const TcpConnectionPtr& conn, HttpRequest& req, size_t requestBytes)
 {
-    const string& connection = req.getHeader("Connection");
-    bool close = (connection == "close") ||
-                 (req.getVersion() == "HTTP/1.0" && connection != "Keep-Alive");
+    HttpContext* context = boost::any_cast<HttpContext>(conn->getMutableContext());
+
+    if (cors_ && CorsFilter::isPreflight(req))
+    {
+        sendPreflight(conn, context, req, requestBytes);
+        return;
+    }
 
     // 构造响应对象
+    HttpResponse response(wantsClose(req));
+    serveRequest(req, &response);
+    if (response.deferred())
+    {
+        deferResponse(conn, context, req, &response, requestBytes);
+        return;
+    }
+    sendResponse(conn, context, req, response, requestBytes);
+}
+
+void HttpServer::deferResponse(const TcpConnectionPtr& conn, HttpContext* context,
+                               const HttpRequest& req, HttpResponse* response, size_t requestBytes)
+{
+    // HTTP/1 的响应要按请求的顺序发：发出之前不处理后面的请求，也先不读
+    context->setResponsePending(true);
+    if (!context->readPaused())
+    {
+        conn->stopRead();
+    }
+    std::weak_ptr<TcpConnection> weakConn(conn);
+    response->addCompletionStep([this, weakConn, requestBytes](const HttpRequest& request, HttpResponse* resp)
+    {
+        TcpConnectionPtr c = weakConn.lock();
+        if (!c || !c->connected())
+        {
+            recordRequest(request, *resp, requestBytes, 0); // 连接已经断开，只记指标
+            return;
+        }
+        HttpContext* ctx = boost::any_cast<HttpContext>(c->getMutableContext());
+        ctx->setResponsePending(false);
+        sendResponse(c, ctx, request, *resp, requestBytes);
+        if (c->connected() && !resp->closeConnection() && !ctx->readPaused())
+        {
+            // 等待期间已经读进来的请求接着处理 (输出积压暂停的话由 resumeReading 处理)
+            c->startRead();
+            processInput(c, ctx->tls() ? ctx->tls()->plaintext() : c->inputBuffer(), Timestamp::now());
+        }
+    });
+    response->detach(req);
+}
+
+void HttpServer::sendPreflight(const TcpConnectionPtr& conn, HttpContext* context,
+                               const HttpRequest& req, size_t requestBytes)
+{
+    metrics::MetricsRegistry::instance().incInFlight(); // recordRequest 里减回去
+    bool close = wantsClose(req);
+    Buffer* buf = &scratchBuffers().response;
+    int status = cors_->appendPreflight(req, close, buf);
+    size_t responseBytes = buf->readableBytes();
+    send(conn, context, buf);
+    releaseScratch(buf);
+    updateOutputAccounting(conn, context);
+
+    // 只为指标和访问日志记一下状态码
     HttpResponse response(close);
+    response.setStatusCode(static_cast<HttpResponse::HttpStatusCode>(status));
+    recordRequest(req, response, requestBytes, responseBytes);
+    if (close)
+    {
+        shutdown(conn, context);
+    }
+}
 
-    // 【关键】调用你在 main.cpp 里设置的 dispatch 函数
-    if (httpCallback_)
+bool HttpServer::checkRateLimit(const TcpConnectionPtr& conn, HttpContext* context)
+{
+    HttpRequest& req = context->request();
+    int retryAfterSeconds = 0;
+    if (rateLimiter_->allow(conn->peerAddress(), req.path(), &retryAfterSeconds))
     {
-        httpCallback_(req, &response);
+        return true;
     }
 
+    // 还有请求体没读的话连接没法继续用，回完 429 就关闭
+    HttpResponse response(!context->gotAll() || wantsClose(req));
+    metrics::MetricsRegistry::instance().incInFlight(); // recordRequest 里减回去
+    setRateLimited(&response, retryAfterSeconds);
+    if (cors_)
+    {
+        cors_->decorate(req, &response); // 让页面脚本能读到 429 和 Retry-After
+    }
+    sendResponse(conn, context, req, response, context->requestBytes());
+    return false;
+}
+
+void HttpServer::setRateLimited(HttpResponse* response, int retryAfterSeconds)
+{
+    response->setStatusCode(HttpResponse::k429TooManyRequests);
+    response->setStatusMessage("Too Many Requests");
+    response->addHeader("Retry-After", std::to_string(retryAfterSeconds));
+    response->setContentType("application/json");
+    response->setBody("{\"code\":429,\"msg\":\"Too many requests, slow down\"}");
+}
+
+void HttpServer::sendResponse(const TcpConnectionPtr& conn, HttpContext* context,
+                              const HttpRequest& req, const HttpResponse& response, size_t requestBytes)
+{
     // 发送响应数据
-    Buffer buf;
-    response.appendToBuffer(&buf);
-    conn->send(&buf);
+    Buffer* buf = &scratchBuffers().response;
+    response.appendToBuffer(buf);
+    size_t responseBytes = buf->readableBytes();
+    send(conn, context, buf);
+    releaseScratch(buf);
+
+    // 统计这个连接还没写出去的数据，必要时暂停读取
+    updateOutputAccounting(conn, context);
+
+    recordRequest(req, response, requestBytes, responseBytes);
 
     // 如果是短连接，发完就关
     if (response.closeConnection())
     {
-        conn->shutdown();
+        shutdown(conn, context);
+    }
+}
+
+void HttpServer::serveRequest(HttpRequest& req, HttpResponse* response)
+{
+    metrics::MetricsRegistry::instance().incInFlight();
+
+    // 抓取原始请求，供离线回放
+    if (capture_)
+    {
+        capture_->capture(req);
+    }
+
+    // HTTP/2 的预检走到这里 (HTTP/1 的在 onRequest 里已经直接回了)
+    if (cors_ && CorsFilter::isPreflight(req))
+    {
+        cors_->preflight(req, response);
+        return;
+    }
+    dispatchRequest(req, response);
+    if (cors_)
+    {
+        if (response->deferred())
+        {
+            response->addCompletionStep([this](const HttpRequest& request, HttpResponse* resp)
+            {
+                cors_->decorate(request, resp);
+            });
+        }
+        else
+        {
+            cors_->decorate(req, response);
+        }
+    }
+}
+
+void HttpServer::dispatchRequest(HttpRequest& req, HttpResponse* response)
+{
+    // 在连接上排队 (pipelining、输出背压暂停) 的时间已经用完了截止时间，客户端多半已经放弃，
+    // 不再交给业务，把 I/O 线程留给还来得及的请求
+    applyDeadline(&req);
+    if (req.deadlineExceeded())
+    {
+        ++expiredRequests_;
+        response->setStatusCode(HttpResponse::k503ServiceUnavailable);
+        response->setStatusMessage("Service Unavailable");
+        response->setContentType("application/json");
+        response->setBody("{\"code\":503,\"msg\":\"Request deadline exceeded before processing\"}");
+        return;
+    }
+
+    // 并发超过上限：先挡掉低优先级的贵接口，业务线程 (I/O 线程) 不再堆在数据库连接池上
+    if (limiter_ && !limiter_->tryAcquire(limiter_->priority(req.path())))
+    {
+        response->setStatusCode(HttpResponse::k503ServiceUnavailable);
+        response->setStatusMessage("Service Unavailable");
+        response->addHeader("Retry-After", std::to_string(limiter_->retryAfterSeconds()));
+        response->setContentType("application/json");
+        response->setBody("{\"code\":503,\"msg\":\"Server overloaded, try again later\"}");
+        return;
+    }
+
+    // 【关键】调用你在 main.cpp 里设置的 dispatch 函数
+    int64_t startUs = Timestamp::now().microSecondsSinceEpoch();
+    if (middleware_)
+    {
+        middleware_->run(req, response, httpCallback_);
+    }
+    else if (httpCallback_)
+    {
+        httpCallback_(req, response);
+    }
+    if (limiter_)
+    {
+        // 推迟的响应按分发到填好的耗时反馈给限制器，名额也占到那时候
+        auto release = [this, startUs](const HttpRequest&, HttpResponse* resp)
+        {
+            int status = resp->getStatusCode();
+            limiter_->release(Timestamp::now().microSecondsSinceEpoch() - startUs,
+                              status == HttpResponse::k503ServiceUnavailable ||
+                              status == HttpResponse::k504GatewayTimeout);
+        };
+        if (response->deferred())
+        {
+            response->addCompletionStep(release);
+        }
+        else
+        {
+            release(req, response);
+        }
+    }
+}
+
+void HttpServer::recordRequest(const HttpRequest& req, const HttpResponse& response,
+                               size_t requestBytes, size_t responseBytes)
+{
+    // 记录指标：只有注册过的路由用自己的路径做标签，其余统一归到 unmatched，避免随机路径撑爆序列数
+    metrics::MetricsRegistry& registry = metrics::MetricsRegistry::instance();
+    registry.decInFlight();
+    int status = response.getStatusCode();
+    int64_t latencyUs = Timestamp::now().microSecondsSinceEpoch() -
+                        req.receiveTime().microSecondsSinceEpoch();
+    static const std::string kUnmatchedRoute = "unmatched";
+    bool matched = routeMatcher_ && routeMatcher_(req.path());
+    registry.observeRequest(matched ? req.path() : kUnmatchedRoute,
+                            status, latencyUs, requestBytes, responseBytes);
+    if (accessLog_)
+    {
+        accessLog_->log(req, status, latencyUs, requestBytes, responseBytes);
+    }
+}
+
+void HttpServer::applyDeadline(HttpRequest* req) const
+{
+    int timeoutMs = defaultTimeoutMs_;
+    if (!routeTimeoutsMs_.empty())
+    {
+        auto route = routeTimeoutsMs_.find(req->path());
+        if (route != routeTimeoutsMs_.end())
+        {
+            timeoutMs = route->second;
+        }
+    }
+    // 客户端只能把超时改短：它自己等不了那么久，服务端也就没必要做完
+    const std::string& header = req->getHeader("X-Request-Timeout");
+    if (!header.empty())
+    {
+        int clientMs = ::atoi(header.c_str());
+        if (clientMs > 0 && (timeoutMs <= 0 || clientMs < timeoutMs))
+        {
+            timeoutMs = clientMs;
+        }
+    }
+    if (timeoutMs <= 0)
+    {
+        return;
+    }
+    // 从读到请求的第一个字节开始算，包括在连接上排队的时间 (暂停读取、等前面推迟的响应)
+    int64_t queuedUs = Timestamp::now().microSecondsSinceEpoch() -
+                       req->receiveTime().microSecondsSinceEpoch();
+    req->setDeadline(std::chrono::steady_clock::now() +
+                     std::chrono::milliseconds(timeoutMs) -
+                     std::chrono::microseconds(std::max<int64_t>(queuedUs, 0)));
+}
+
+bool HttpServer::startHttp2(const TcpConnectionPtr& conn, HttpContext* context,
+                            HttpRequest* upgradeRequest)
+{
+    muduo::net::InetAddress peer = conn->peerAddress();
+    auto http2 = std::make_shared<http2::Http2Connection>(
+        [this, peer](HttpRequest& req, HttpResponse* response)
+        {
+            req.setPeerAddress(peer);
+            int retryAfterSeconds = 0;
+            if (rateLimiter_ && !rateLimiter_->allow(peer, req.path(), &retryAfterSeconds))
+            {
+                metrics::MetricsRegistry::instance().incInFlight(); // recordRequest 里减回去
+                setRateLimited(response, retryAfterSeconds);
+                return;
+            }
+            serveRequest(req, response);
+        },
+        [this](const HttpRequest& req, const HttpResponse& response,
+               size_t requestBytes, size_t responseBytes)
+        {
+            ++http2Streams_;
+            recordRequest(req, response, requestBytes, responseBytes);
+        });
+    // 推迟的响应填好以后编码出来的帧，由这里发出
+    std::weak_ptr<TcpConnection> weakConn(conn);
+    http2->setWriter([this, weakConn](Buffer* out)
+    {
+        TcpConnectionPtr c = weakConn.lock();
+        if (c && c->connected())
+        {
+            HttpContext* ctx = boost::any_cast<HttpContext>(c->getMutableContext());
+            send(c, ctx, out);
+            updateOutputAccounting(c, ctx);
+        }
+    });
+
+    Buffer out;
+    if (upgradeRequest)
+    {
+        out.append("HTTP/1.1 101 Switching Protocols\r\n"
+                   "Connection: Upgrade\r\n"
+                   "Upgrade: h2c\r\n\r\n");
+        if (!http2->upgrade(*upgradeRequest, context->requestBytes(), &out))
+        {
+            return false;
+        }
+    }
+    else
+    {
+        http2->start(&out);
+    }
+
+    context->setHttp2(http2);
+    ++http2Connections_;
+    ++http2TotalConnections_;
+    send(conn, context, &out);
+    updateOutputAccounting(conn, context);
+    return true;
+}
+
+void HttpServer::processHttp2(const TcpConnectionPtr& conn, HttpContext* context, Buffer* buf)
+{
+    // 一个连接上的所有 stream 都在这个 IO 线程里处理，响应帧攒在一起一次发出
+    Buffer out;
+    bool ok = context->http2()->onData(buf, &out);
+    if (out.readableBytes() > 0)
+    {
+        send(conn, context, &out);
+        updateOutputAccounting(conn, context);
+    }
+    if (!ok)
+    {
+        // 连接级错误：GOAWAY 已经发出，丢掉剩下的数据并关闭
+        buf->retrieveAll();
+        shutdown(conn, context);
+    }
+}
+
+bool HttpServer::startWebSocket(const TcpConnectionPtr& conn, HttpContext* context,
+                                const std::shared_ptr<const websocket::WebSocketHandler>& handler)
+{
+    Buffer out;
+    if (!websocket::WebSocketConnection::handshake(context->request(), &out))
+    {
+        return false;
+    }
+    send(conn, context, &out);
+
+    auto webSocket = std::make_shared<websocket::WebSocketConnection>(
+        conn, handler, webSocketMaxMessageSize_);
+    if (std::shared_ptr<tls::TlsConnection> tls = context->tls())
+    {
+        // wss：帧在 I/O 线程里加密后再发
+        webSocket->setWriter([tls](const TcpConnectionPtr& c, const char* data, size_t len)
+        {
+            Buffer cipher;
+            tls->encrypt(data, len, &cipher);
+            c->send(&cipher);
+        });
+    }
+    context->setWebSocket(webSocket);
+    ++webSocketConnections_;
+    // 长连接不适用 Nagle，推送的小消息要马上发出去
+    conn->setTcpNoDelay(true);
+    webSocket->onOpen(context->request());
+    updateOutputAccounting(conn, context);
+    return true;
+}
+
+void HttpServer::processWebSocket(const TcpConnectionPtr& conn, HttpContext* context, Buffer* buf)
+{
+    // 先拿一份引用：回调里可能关闭连接
+    std::shared_ptr<websocket::WebSocketConnection> webSocket = context->webSocket();
+    bool ok = webSocket->onData(buf);
+    updateOutputAccounting(conn, context);
+    if (!ok)
+    {
+        // close 帧已经发出：丢掉剩下的数据，由服务端先关闭 TCP (RFC 6455 7.1.1)
+        buf->retrieveAll();
+        shutdown(conn, context);
+    }
+}
+
+void HttpServer::onHighWaterMark(const TcpConnectionPtr& conn, size_t len)
+{
+    ++highWaterMarkEvents_;
+    LOG_DEBUG << "HttpServer[" << server_.name() << "] connection " << conn->name()
+              << " output buffer reached high water mark: " << len << " bytes";
+    if (conn->connected())
+    {
+        HttpContext* context = boost::any_cast<HttpContext>(conn->getMutableContext());
+        updateOutputAccounting(conn, context);
+        pauseReading(conn, context);
+    }
+}
+
+void HttpServer::onWriteComplete(const TcpConnectionPtr& conn)
+{
+    HttpContext* context = boost::any_cast<HttpContext>(conn->getMutableContext());
+    // 积压已经全部写完，不再需要这个回调 (平时不挂，避免每个响应都多一次回调)
+    conn->setWriteCompleteCallback(WriteCompleteCallback());
+    updateOutputAccounting(conn, context);
+    if (compactIdle_)
+    {
+        trimIdleBuffer(conn->outputBuffer());
+    }
+    if (context->readPaused())
+    {
+        resumeReading(conn, context);
+    }
+}
+
+void HttpServer::updateOutputAccounting(const TcpConnectionPtr& conn, HttpContext* context)
+{
+    size_t pending = conn->outputBuffer()->readableBytes();
+    size_t accounted = context->accountedOutputBytes();
+    if (pending > accounted)
+    {
+        pendingOutputBytes_.fetch_add(pending - accounted);
+    }
+    else if (pending < accounted)
+    {
+        pendingOutputBytes_.fetch_sub(accounted - pending);
+    }
+    context->setAccountedOutputBytes(pending);
+
+    if (pending == 0)
+    {
+        return;
+    }
+
+    // 内核发送缓冲区满了，数据留在了 outputBuffer 里：等它写完时再结算
+    conn->setWriteCompleteCallback(std::bind(&HttpServer::onWriteComplete, this, _1));
+
+    // muduo 的高水位回调是异步投递的，这里同步检查一次，
+    // 保证不会在积压的情况下继续分发同一批 pipelining 请求
+    if (pending >= highWaterMark_)
+    {
+        pauseReading(conn, context);
+    }
+    else if (pendingOutputBytes_.load(std::memory_order_relaxed) > outputBudget_)
+    {
+        ++budgetExceededEvents_;
+        pauseReading(conn, context);
+    }
+}
+
+void HttpServer::pauseReading(const TcpConnectionPtr& conn, HttpContext* context)
+{
+    if (context->readPaused())
+    {
+        return;
+    }
+    context->setReadPaused(true);
+    ++pausedConnections_;
+    conn->stopRead();
+}
+
+void HttpServer::resumeReading(const TcpConnectionPtr& conn, HttpContext* context)
+{
+    context->setReadPaused(false);
+    --pausedConnections_;
+    if (context->responsePending())
+    {
+        // 还在等推迟的响应：读取由它发出之后恢复，不然客户端可以一直往没人消费的输入缓冲区里塞数据
+        return;
     }
+    conn->startRead();
+    // 暂停期间已经读进来的请求，现在接着处理
+    processInput(conn, context->tls() ? context->tls()->plaintext() : conn->inputBuffer(),
+                 Timestamp::now());
 }
 
 } // namespace http
\ No newline at end of file
@@ -0,0 +1,102 @@
+#include "../../include/http/Middleware.h"
+
+#include <muduo/base/Logging.h>
+#include <muduo/base/Timestamp.h>
+
+namespace http
+{
+
+void MiddlewareChain::setInternalError(HttpResponse* resp)
+{
+    // 整个换掉：出错之前加上的头 (比如登录成功时的 Set-Cookie) 不能跟着 500 一起发出去
+    *resp = HttpResponse(resp->closeConnection());
+    resp->setStatusCode(HttpResponse::k500InternalServerError);
+    resp->setStatusMessage("Internal Server Error");
+    resp->setContentType("application/json");
+    resp->setBody("{\"code\":500,\"msg\":\"Internal server error\"}");
+}
+
+void MiddlewareChain::run(HttpRequest& req, HttpResponse* resp, const Handler& handler) const
+{
+    // entered：before 已经执行过的中间件个数，只有它们的 after 会执行
+    size_t entered = 0;
+    try
+    {
+        bool proceed = true;
+        while (entered < stages_.size())
+        {
+            const Stage& stage = stages_[entered++];
+            if (stage.before && !stage.before(stage.self, req, resp))
+            {
+                proceed = false;
+                break;
+            }
+        }
+        if (proceed && handler)
+        {
+            handler(req, resp);
+        }
+    }
+    catch (const std::exception& e)
+    {
+        failures_.fetch_add(1, std::memory_order_relaxed);
+        LOG_ERROR << "Unhandled exception while serving " << req.path() << ": " << e.what();
+        setInternalError(resp);
+    }
+    catch (...)
+    {
+        failures_.fetch_add(1, std::memory_order_relaxed);
+        LOG_ERROR << "Unhandled exception while serving " << req.path();
+        setInternalError(resp);
+    }
+
+    if (resp->deferred())
+    {
+        // 业务推迟了响应：after 钩子等响应填好以后再执行
+        resp->addCompletionStep([this, entered](const HttpRequest& request, HttpResponse* response)
+        {
+            runAfter(request, response, entered);
+        });
+        return;
+    }
+    runAfter(req, resp, entered);
+}
+
+void MiddlewareChain::runAfter(const HttpRequest& req, HttpResponse* resp, size_t entered) const
+{
+    while (entered > 0)
+    {
+        const Stage& stage = stages_[--entered];
+        if (!stage.after)
+        {
+            continue;
+        }
+        try
+        {
+            stage.after(stage.self, req, resp);
+        }
+        catch (const std::exception& e)
+        {
+            failures_.fetch_add(1, std::memory_order_relaxed);
+            LOG_ERROR << "Middleware after-hook failed for " << req.path() << ": " << e.what();
+        }
+        catch (...)
+        {
+            failures_.fetch_add(1, std::memory_order_relaxed);
+            LOG_ERROR << "Middleware after-hook failed for " << req.path();
+        }
+    }
+}
+
+void SlowRequestLogger::after(const HttpRequest& req, HttpResponse* resp)
+{
+    int64_t elapsedUs = muduo::Timestamp::now().microSecondsSinceEpoch() -
+                        req.receiveTime().microSecondsSinceEpoch();
+    if (elapsedUs >= thresholdUs_)
+    {
+        LOG_WARN << "Slow request: " << req.methodString() << " " << req.path() << " -> "
+                 << resp->getStatusCode() << " in " << elapsedUs / 1000 << " ms";
+    }
+}
+
+} // namespace http
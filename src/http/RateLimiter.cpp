@@ -0,0 +1,254 @@
+#include "../../include/http/RateLimiter.h"
+
+#include <muduo/base/Logging.h>
+
+#include <algorithm>
+#include <netinet/in.h>
+#include <string.h>
+
+namespace http
+{
+
+const int RateLimiter::kWays;
+const int RateLimiter::kMaxBurst;
+
+namespace
+{
+
+// state 的布局：时间 42 位 (微秒，约 50 天回绕一次，按模运算处理)，令牌 22 位 (1/1000 令牌，最多 4194 个)
+const int      kTokenBits = 22;
+const uint64_t kTokenMask = (1ULL << kTokenBits) - 1;
+const uint64_t kTimeMask = (1ULL << (64 - kTokenBits)) - 1;
+const int64_t  kMilli = 1000; // 一个令牌
+
+uint64_t packState(uint64_t timeUs, int64_t tokens)
+{
+    return ((timeUs & kTimeMask) << kTokenBits) | static_cast<uint64_t>(tokens);
+}
+
+// 64 位整数哈希 (splitmix64 的收尾部分)
+uint64_t mix64(uint64_t x)
+{
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+uint64_t hashKey(const muduo::net::InetAddress& peer, int routeId)
+{
+    uint64_t h = mix64(RateLimiter::clientKey(peer) ^ (static_cast<uint64_t>(routeId) << 48));
+    return h != 0 ? h : 1; // 0 留给空槽
+}
+
+} // namespace
+
+// IPv6 按 /64 前缀计数：一个客户端通常能拿到整个 /64，按完整地址计数的话换个地址就是一个新桶
+uint64_t RateLimiter::clientKey(const muduo::net::InetAddress& peer)
+{
+    uint64_t h;
+    const struct sockaddr* addr = peer.getSockAddr();
+    if (addr->sa_family == AF_INET6)
+    {
+        const struct in6_addr* addr6 = &reinterpret_cast<const struct sockaddr_in6*>(addr)->sin6_addr;
+        if (IN6_IS_ADDR_V4MAPPED(addr6))
+        {
+            // 前 64 位对所有 IPv4 客户端都一样，只能按后面的 IPv4 地址计数
+            uint32_t v4;
+            ::memcpy(&v4, &addr6->s6_addr[12], sizeof v4);
+            h = v4;
+        }
+        else
+        {
+            ::memcpy(&h, addr6, sizeof h);
+            h = mix64(h);
+        }
+    }
+    else
+    {
+        h = reinterpret_cast<const struct sockaddr_in*>(addr)->sin_addr.s_addr;
+    }
+    return h;
+}
+
+RateLimiter::RateLimiter(const Rule& defaultRule, size_t capacity)
+    : setMask_(0)
+    , epoch_(std::chrono::steady_clock::now())
+    , rejected_(0)
+    , evictions_(0)
+{
+    rules_.push_back(compile(defaultRule));
+
+    size_t sets = 1;
+    while (sets * kWays < capacity)
+    {
+        sets <<= 1;
+    }
+    setMask_ = sets - 1;
+    slots_.reset(new Slot[sets * kWays]);
+    for (size_t i = 0; i < sets * kWays; ++i)
+    {
+        slots_[i].key.store(0, std::memory_order_relaxed);
+        slots_[i].state.store(0, std::memory_order_relaxed);
+    }
+}
+
+RateLimiter::~RateLimiter() = default;
+
+RateLimiter::CompiledRule RateLimiter::compile(const Rule& rule)
+{
+    CompiledRule compiled;
+    compiled.milliPerSecond = 0;
+    compiled.burstMilli = 0;
+    compiled.fillUs = 0;
+    if (rule.ratePerSecond <= 0 || rule.burst <= 0)
+    {
+        return compiled; // 不限流
+    }
+    int burst = rule.burst;
+    if (burst > kMaxBurst)
+    {
+        LOG_WARN << "Rate limit burst " << burst << " clamped to " << kMaxBurst;
+        burst = kMaxBurst;
+    }
+    compiled.milliPerSecond = std::max<int64_t>(1, static_cast<int64_t>(rule.ratePerSecond * kMilli));
+    compiled.burstMilli = burst * kMilli;
+    compiled.fillUs = compiled.burstMilli * 1000000 / compiled.milliPerSecond;
+    return compiled;
+}
+
+void RateLimiter::setRouteRule(const std::string& path, const Rule& rule)
+{
+    auto it = routeIds_.find(path);
+    if (it != routeIds_.end())
+    {
+        rules_[it->second] = compile(rule);
+        return;
+    }
+    routeIds_[path] = static_cast<int>(rules_.size());
+    rules_.push_back(compile(rule));
+}
+
+uint64_t RateLimiter::nowUs() const
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - epoch_).count();
+}
+
+bool RateLimiter::allow(const muduo::net::InetAddress& peer, const std::string& path, int* retryAfterSeconds)
+{
+    int routeId = 0;
+    if (!routeIds_.empty())
+    {
+        auto it = routeIds_.find(path);
+        if (it != routeIds_.end())
+        {
+            routeId = it->second;
+        }
+    }
+    const CompiledRule& rule = rules_[routeId];
+    if (rule.burstMilli == 0)
+    {
+        return true;
+    }
+
+    uint64_t key = hashKey(peer, routeId);
+    Slot* set = &slots_[(key & setMask_) * kWays];
+    uint64_t now = nowUs() & kTimeMask;
+
+    for (int attempt = 0; attempt < 2; ++attempt)
+    {
+        // 组内 LRU：找 key，顺便记下空槽和最久没访问的槽
+        Slot* victim = nullptr;
+        uint64_t victimAge = 0;
+        for (int i = 0; i < kWays; ++i)
+        {
+            uint64_t slotKey = set[i].key.load(std::memory_order_acquire);
+            if (slotKey == key)
+            {
+                return take(&set[i], rule, now, retryAfterSeconds);
+            }
+            uint64_t age = kTimeMask; // 空槽优先
+            if (slotKey != 0)
+            {
+                uint64_t last = set[i].state.load(std::memory_order_relaxed) >> kTokenBits;
+                age = (now - last) & kTimeMask;
+            }
+            if (!victim || age > victimAge)
+            {
+                victim = &set[i];
+                victimAge = age;
+            }
+        }
+
+        // 新 key：占掉选中的槽，新桶是满的，直接取走一个令牌
+        uint64_t oldKey = victim->key.load(std::memory_order_relaxed);
+        if (oldKey != key && victim->key.compare_exchange_strong(oldKey, key, std::memory_order_acq_rel))
+        {
+            if (oldKey != 0)
+            {
+                evictions_.fetch_add(1, std::memory_order_relaxed);
+            }
+            victim->state.store(packState(now, rule.burstMilli - kMilli), std::memory_order_release);
+            return true;
+        }
+        // 别的线程抢先占了这个槽 (可能就是同一个 key)，重新找一遍
+    }
+    return true; // 同一组竞争太激烈时放行，不为限流阻塞请求
+}
+
+bool RateLimiter::take(Slot* slot, const CompiledRule& rule, uint64_t now, int* retryAfterSeconds)
+{
+    uint64_t state = slot->state.load(std::memory_order_acquire);
+    for (;;)
+    {
+        uint64_t last = state >> kTokenBits;
+        int64_t tokens = static_cast<int64_t>(state & kTokenMask);
+        uint64_t elapsed = (now - last) & kTimeMask;
+        if (elapsed > kTimeMask / 2)
+        {
+            elapsed = 0; // 别的线程刚写入了稍晚一点的时间
+        }
+
+        // 补充令牌：时间只推进到补出整数个 1/1000 令牌为止，零头留到下次，低速率也不会丢令牌
+        uint64_t newLast = last;
+        if (static_cast<int64_t>(elapsed) >= rule.fillUs)
+        {
+            tokens = rule.burstMilli;
+            newLast = now;
+        }
+        else
+        {
+            int64_t gained = static_cast<int64_t>(elapsed) * rule.milliPerSecond / 1000000;
+            tokens += gained;
+            newLast = last + static_cast<uint64_t>(gained * 1000000 / rule.milliPerSecond);
+            if (tokens >= rule.burstMilli)
+            {
+                tokens = rule.burstMilli;
+                newLast = now;
+            }
+        }
+
+        bool allowed = tokens >= kMilli;
+        if (allowed)
+        {
+            tokens -= kMilli;
+        }
+        uint64_t newState = packState(newLast, tokens);
+        if (newState == state ||
+            slot->state.compare_exchange_weak(state, newState, std::memory_order_acq_rel))
+        {
+            if (!allowed)
+            {
+                rejected_.fetch_add(1, std::memory_order_relaxed);
+                int64_t waitUs = (kMilli - tokens) * 1000000 / rule.milliPerSecond;
+                *retryAfterSeconds = static_cast<int>(std::max<int64_t>(1, (waitUs + 999999) / 1000000));
+            }
+            return allowed;
+        }
+    }
+}
+
+} // namespace http
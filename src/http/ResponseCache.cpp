@@ -0,0 +1,279 @@
+#include "../../include/http/ResponseCache.h"
+
+#include <muduo/base/Logging.h>
+#include <muduo/net/EventLoop.h>
+
+#include <algorithm>
+
+namespace http
+{
+
+ResponseCache::ResponseCache(const Options& options, const Handler& origin)
+    : options_(options)
+    , origin_(origin)
+    , hits_(0)
+    , staleHits_(0)
+    , misses_(0)
+    , coalesced_(0)
+{
+}
+
+void ResponseCache::addRoute(const std::string& path, const RouteOptions& options)
+{
+    routes_[path] = options;
+}
+
+// before/after 在同一个线程里成对调用，后台刷新不经过中间件链，所以一个线程同时只有一个 leader
+ResponseCache::Pending& ResponseCache::pending()
+{
+    thread_local Pending t_pending;
+    return t_pending;
+}
+
+size_t ResponseCache::size() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return entries_.size();
+}
+
+std::string ResponseCache::makeKey(const HttpRequest& req, const RouteOptions& route)
+{
+    std::string key(req.methodString());
+    key += ' ';
+    key += req.path();
+    key += '?';
+    key += req.query();
+    for (const std::string& header : route.varyHeaders)
+    {
+        key += '\n';
+        key += req.getHeader(header);
+    }
+    return key;
+}
+
+void ResponseCache::fill(const Cached& cached, const char* cacheStatus, HttpResponse* resp)
+{
+    resp->setStatusCode(cached.status);
+    resp->setStatusMessage(cached.statusMessage);
+    for (const auto& header : cached.headers)
+    {
+        resp->addHeader(header.first, header.second);
+    }
+    resp->addHeader("X-Cache", cacheStatus);
+    resp->setSharedBody(cached.body);
+}
+
+ResponseCache::CachedPtr ResponseCache::capture(const HttpResponse& resp, const RouteOptions& route) const
+{
+    if (resp.getStatusCode() != HttpResponse::k200Ok || resp.body().size() > options_.maxBodyBytes ||
+        resp.headers().count("Set-Cookie") > 0)
+    {
+        return CachedPtr();
+    }
+    auto cached = std::make_shared<Cached>();
+    cached->status = resp.getStatusCode();
+    cached->statusMessage = resp.getStatusMessage();
+    cached->headers = resp.headers();
+    cached->body = std::make_shared<const std::string>(resp.body());
+    Clock::time_point now = Clock::now();
+    cached->freshUntil = now + std::chrono::milliseconds(route.ttlMs);
+    cached->staleUntil = cached->freshUntil + std::chrono::milliseconds(route.staleMs);
+    return cached;
+}
+
+// 调用方持有 mutex_
+void ResponseCache::store(const std::string& key, const CachedPtr& cached)
+{
+    auto it = entries_.find(key);
+    if (it == entries_.end())
+    {
+        // 满了：淘汰最久没用过的
+        while (!lru_.empty() && entries_.size() >= options_.maxEntries)
+        {
+            entries_.erase(lru_.back());
+            lru_.pop_back();
+        }
+        lru_.push_front(key);
+        it = entries_.emplace(key, Entry()).first;
+        it->second.lruPos = lru_.begin();
+    }
+    else
+    {
+        lru_.splice(lru_.begin(), lru_, it->second.lruPos);
+    }
+    it->second.response = cached;
+    it->second.refreshing = false;
+}
+
+void ResponseCache::answerWaiter(const HttpRequest& req, const CachedPtr& result, HttpResponse* resp)
+{
+    if (result)
+    {
+        hits_.fetch_add(1, std::memory_order_relaxed);
+        fill(*result, "HIT", resp);
+        return;
+    }
+    // leader 的结果不能缓存 (出错、超时) 或者等太久了：自己执行业务，不再写缓存
+    misses_.fetch_add(1, std::memory_order_relaxed);
+    origin_(req, resp);
+}
+
+bool ResponseCache::before(HttpRequest& req, HttpResponse* resp)
+{
+    if (req.method() != HttpRequest::kGet || routes_.empty())
+    {
+        return true;
+    }
+    auto route = routes_.find(req.path());
+    if (route == routes_.end())
+    {
+        return true;
+    }
+
+    std::string key = makeKey(req, route->second);
+    Clock::time_point now = Clock::now();
+    muduo::net::EventLoop* loop = muduo::net::EventLoop::getEventLoopOfCurrentThread();
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        auto it = entries_.find(key);
+        if (it != entries_.end())
+        {
+            CachedPtr cached = it->second.response;
+            if (now < cached->freshUntil)
+            {
+                lru_.splice(lru_.begin(), lru_, it->second.lruPos);
+                lock.unlock();
+                hits_.fetch_add(1, std::memory_order_relaxed);
+                fill(*cached, "HIT", resp);
+                return false;
+            }
+            if (now < cached->staleUntil && loop)
+            {
+                bool startRefresh = !it->second.refreshing;
+                it->second.refreshing = true;
+                lru_.splice(lru_.begin(), lru_, it->second.lruPos);
+                lock.unlock();
+                staleHits_.fetch_add(1, std::memory_order_relaxed);
+                fill(*cached, "STALE", resp);
+                if (startRefresh)
+                {
+                    // 排在当前事件循环里：这个响应先发出去，再刷新缓存
+                    const RouteOptions* options = &route->second;
+                    loop->queueInLoop([this, req, key, options] { refresh(req, key, options); });
+                }
+                return false;
+            }
+        }
+
+        auto inFlight = flights_.find(key);
+        if (inFlight != flights_.end())
+        {
+            if (!loop)
+            {
+                // 不在 I/O 线程里没法推迟响应：自己执行业务，不写缓存
+                lock.unlock();
+                misses_.fetch_add(1, std::memory_order_relaxed);
+                return true;
+            }
+
+            // 推迟响应，等 leader 的结果，最多等到自己的截止时间；
+            // 超时和 leader 完成两边都会调 completion，先到的生效，后到的被忽略
+            coalesced_.fetch_add(1, std::memory_order_relaxed);
+            HttpResponse::Completion completion = resp->defer();
+            Waiter waiter = [this, completion, req](const CachedPtr& result)
+            {
+                completion([this, req, result](HttpResponse* response) { answerWaiter(req, result, response); });
+            };
+            inFlight->second.push_back(waiter);
+            lock.unlock();
+
+            Clock::time_point waitUntil = now + std::chrono::milliseconds(options_.maxWaitMs);
+            if (req.hasDeadline() && req.deadline() < waitUntil)
+            {
+                waitUntil = req.deadline();
+            }
+            double waitSeconds = std::chrono::duration<double>(waitUntil - now).count();
+            loop->runAfter(std::max(waitSeconds, 0.0), [waiter] { waiter(CachedPtr()); });
+            return false;
+        }
+        flights_[key]; // 没有人在执行：自己当 leader
+    }
+
+    misses_.fetch_add(1, std::memory_order_relaxed);
+    Pending& current = pending();
+    current.owner = this;
+    current.key.swap(key);
+    current.route = &route->second;
+    return true;
+}
+
+void ResponseCache::after(const HttpRequest& req, HttpResponse* resp)
+{
+    Pending& current = pending();
+    if (current.owner != this)
+    {
+        return;
+    }
+    const RouteOptions* route = current.route;
+    std::string key;
+    key.swap(current.key);
+    current.owner = nullptr;
+
+    CachedPtr cached = capture(*resp, *route);
+    std::vector<Waiter> waiters;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (cached)
+        {
+            store(key, cached);
+        }
+        auto flight = flights_.find(key);
+        if (flight != flights_.end())
+        {
+            waiters.swap(flight->second);
+            flights_.erase(flight);
+        }
+    }
+    for (const Waiter& waiter : waiters)
+    {
+        waiter(cached);
+    }
+}
+
+void ResponseCache::refresh(HttpRequest req, const std::string& key, const RouteOptions* route)
+{
+    req.setDeadline(Clock::now() + std::chrono::milliseconds(options_.refreshTimeoutMs));
+    HttpResponse resp(false);
+    CachedPtr cached;
+    try
+    {
+        origin_(req, &resp);
+        cached = capture(resp, *route);
+    }
+    catch (const std::exception& e)
+    {
+        LOG_ERROR << "Refreshing cached " << req.path() << " failed: " << e.what();
+    }
+    catch (...)
+    {
+        // 不兜住的话 refreshing 一直是 true，这个键以后再也不刷新
+        LOG_ERROR << "Refreshing cached " << req.path() << " failed";
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (cached)
+    {
+        store(key, cached);
+    }
+    else
+    {
+        // 刷新失败：旧内容留到 staleUntil，下一个请求再试
+        auto it = entries_.find(key);
+        if (it != entries_.end())
+        {
+            it->second.refreshing = false;
+        }
+    }
+}
+
+} // namespace http
@@ -0,0 +1,32 @@
+#include "../../include/http/Router.h"
+
+#include <muduo/base/Logging.h>
+
+namespace http
+{
+
+void Router::dispatch(const HttpRequest& req, HttpResponse* resp) const
+{
+    const std::string& path = req.path();
+    
+    // 打印日志，方便调试 (每个请求的记录见访问日志，这里只在 DEBUG 级别输出)
+    LOG_DEBUG << "Received Request: " << req.method() << " " << path;
+
+    // 在路由表里查找有没有对应的处理器
+    auto it = routes_.find(path);
+    if (it != routes_.end())
+    {
+        // 找到了！调用对应的函数（比如 UserController::login）
+        it->second(req, resp);
+    }
+    else
+    {
+        // 没找到，返回 404
+        resp->setStatusCode(HttpResponse::k404NotFound);
+        resp->setStatusMessage("Not Found");
+        resp->setBody("404 Not Found: " + path);
+        resp->setCloseConnection(true);
+    }
+}
+
+} // namespace http
@@ -0,0 +1,255 @@
+#include "../../include/http/TrafficCapture.h"
+#include "../base/json.hpp"
+
+#include <stdio.h>
+#include <strings.h>
+
+namespace http
+{
+
+namespace
+{
+
+// JSON 字符串转义 (输入按字节处理，只在 isPrintable 为真时使用)
+void appendJsonString(std::string* out, const std::string& value)
+{
+    static const char kHex[] = "0123456789abcdef";
+    out->push_back('"');
+    for (char ch : value)
+    {
+        unsigned char c = static_cast<unsigned char>(ch);
+        switch (c)
+        {
+        case '"':  out->append("\\\""); break;
+        case '\\': out->append("\\\\"); break;
+        case '\n': out->append("\\n"); break;
+        case '\r': out->append("\\r"); break;
+        case '\t': out->append("\\t"); break;
+        default:
+            if (c < 0x20)
+            {
+                out->append("\\u00");
+                out->push_back(kHex[c >> 4]);
+                out->push_back(kHex[c & 0xf]);
+            }
+            else
+            {
+                out->push_back(ch);
+            }
+        }
+    }
+    out->push_back('"');
+}
+
+// 纯 ASCII 文本才能原样写进 JSON 字符串，其余 (二进制、非 ASCII) 走 base64
+bool isPrintable(const std::string& value)
+{
+    for (char ch : value)
+    {
+        unsigned char c = static_cast<unsigned char>(ch);
+        if (c >= 0x80 || (c < 0x20 && c != '\n' && c != '\r' && c != '\t'))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+void appendBase64(std::string* out, const std::string& value)
+{
+    static const char kAlphabet[] =
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    out->push_back('"');
+    size_t i = 0;
+    for (; i + 2 < value.size(); i += 3)
+    {
+        uint32_t n = (static_cast<unsigned char>(value[i]) << 16) |
+                     (static_cast<unsigned char>(value[i + 1]) << 8) |
+                     static_cast<unsigned char>(value[i + 2]);
+        out->push_back(kAlphabet[(n >> 18) & 63]);
+        out->push_back(kAlphabet[(n >> 12) & 63]);
+        out->push_back(kAlphabet[(n >> 6) & 63]);
+        out->push_back(kAlphabet[n & 63]);
+    }
+    if (i < value.size())
+    {
+        uint32_t n = static_cast<unsigned char>(value[i]) << 16;
+        if (i + 1 < value.size())
+        {
+            n |= static_cast<unsigned char>(value[i + 1]) << 8;
+        }
+        out->push_back(kAlphabet[(n >> 18) & 63]);
+        out->push_back(kAlphabet[(n >> 12) & 63]);
+        out->push_back(i + 1 < value.size() ? kAlphabet[(n >> 6) & 63] : '=');
+        out->push_back('=');
+    }
+    out->push_back('"');
+}
+
+} // namespace
+
+TrafficCapture::TrafficCapture(const Options& options)
+    : options_(options)
+    , asyncLog_(options.basename, options.rollSize, options.flushInterval)
+    , captured_(0)
+    , skipped_(0)
+    , running_(false)
+{
+    if (options_.sampleEvery < 1)
+    {
+        options_.sampleEvery = 1;
+    }
+}
+
+TrafficCapture::~TrafficCapture()
+{
+    stop();
+}
+
+void TrafficCapture::start()
+{
+    if (!running_)
+    {
+        asyncLog_.start();
+        running_ = true;
+    }
+}
+
+void TrafficCapture::stop()
+{
+    if (running_)
+    {
+        asyncLog_.stop();
+        running_ = false;
+    }
+}
+
+bool TrafficCapture::redactHeader(const std::string& name) const
+{
+    for (const std::string& header : options_.redactHeaders)
+    {
+        if (::strcasecmp(header.c_str(), name.c_str()) == 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool TrafficCapture::redactBody(const std::string& path) const
+{
+    for (const std::string& route : options_.redactBodyPaths)
+    {
+        if (route == path)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool TrafficCapture::appendRedactedBody(std::string* line, const std::string& body) const
+{
+    nlohmann::json json = nlohmann::json::parse(body, nullptr, false);
+    if (json.is_discarded() || !json.is_object())
+    {
+        return false;
+    }
+    for (const std::string& field : options_.redactFields)
+    {
+        auto it = json.find(field);
+        if (it != json.end())
+        {
+            *it = "[REDACTED]";
+        }
+    }
+    line->append(",\"body\":");
+    appendJsonString(line, json.dump(-1, ' ', true));
+    return true;
+}
+
+void TrafficCapture::capture(const HttpRequest& req)
+{
+    // 采样：每个线程自己计数，不需要同步
+    if (options_.sampleEvery > 1)
+    {
+        thread_local uint64_t counter = 0;
+        if (++counter % options_.sampleEvery != 0)
+        {
+            skipped_.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+    }
+    const std::string& body = req.getBody();
+    if (body.size() > options_.maxBodyBytes)
+    {
+        skipped_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    // 复用线程本地的缓冲区，稳态下不再分配内存
+    thread_local std::string line;
+    line.clear();
+
+    char prefix[64];
+    snprintf(prefix, sizeof prefix, "{\"ts\":%lld,\"method\":",
+             static_cast<long long>(req.receiveTime().microSecondsSinceEpoch()));
+    line.append(prefix);
+    appendJsonString(&line, req.methodString());
+    line.append(",\"path\":");
+    appendJsonString(&line, req.path());
+    if (!req.query().empty())
+    {
+        line.append(",\"query\":");
+        appendJsonString(&line, req.query());
+    }
+    line.append(",\"version\":");
+    appendJsonString(&line, req.getVersion());
+
+    line.append(",\"headers\":{");
+    bool first = true;
+    for (const auto& header : req.headers())
+    {
+        if (!first)
+        {
+            line.push_back(',');
+        }
+        first = false;
+        appendJsonString(&line, header.first);
+        line.push_back(':');
+        if (options_.redact && redactHeader(header.first))
+        {
+            appendJsonString(&line, "[REDACTED]");
+        }
+        else
+        {
+            appendJsonString(&line, header.second);
+        }
+    }
+    line.push_back('}');
+
+    if (!body.empty() && options_.redact && redactBody(req.path()))
+    {
+        // 认证路由：只写脱敏后的 JSON，解析不了就不写请求体
+        appendRedactedBody(&line, body);
+    }
+    else if (!body.empty())
+    {
+        if (isPrintable(body))
+        {
+            line.append(",\"body\":");
+            appendJsonString(&line, body);
+        }
+        else
+        {
+            line.append(",\"body_b64\":");
+            appendBase64(&line, body);
+        }
+    }
+    line.append("}\n");
+
+    asyncLog_.append(line.data(), static_cast<int>(line.size()));
+    captured_.fetch_add(1, std::memory_order_relaxed);
+}
+
+} // namespace http
@@ -0,0 +1,674 @@
+#include "../../include/http2/Hpack.h"
+
+#include <string.h>
+#include <unordered_map>
+
+namespace http
+{
+namespace http2
+{
+
+namespace
+{
+
+// 静态表 (RFC 7541 附录 A)，下标 0 对应 HPACK 索引 1
+const std::pair<const char*, const char*> kStaticTable[] = {
+    { ":authority", "" },
+    { ":method", "GET" },
+    { ":method", "POST" },
+    { ":path", "/" },
+    { ":path", "/index.html" },
+    { ":scheme", "http" },
+    { ":scheme", "https" },
+    { ":status", "200" },
+    { ":status", "204" },
+    { ":status", "206" },
+    { ":status", "304" },
+    { ":status", "400" },
+    { ":status", "404" },
+    { ":status", "500" },
+    { "accept-charset", "" },
+    { "accept-encoding", "gzip, deflate" },
+    { "accept-language", "" },
+    { "accept-ranges", "" },
+    { "accept", "" },
+    { "access-control-allow-origin", "" },
+    { "age", "" },
+    { "allow", "" },
+    { "authorization", "" },
+    { "cache-control", "" },
+    { "content-disposition", "" },
+    { "content-encoding", "" },
+    { "content-language", "" },
+    { "content-length", "" },
+    { "content-location", "" },
+    { "content-range", "" },
+    { "content-type", "" },
+    { "cookie", "" },
+    { "date", "" },
+    { "etag", "" },
+    { "expect", "" },
+    { "expires", "" },
+    { "from", "" },
+    { "host", "" },
+    { "if-match", "" },
+    { "if-modified-since", "" },
+    { "if-none-match", "" },
+    { "if-range", "" },
+    { "if-unmodified-since", "" },
+    { "last-modified", "" },
+    { "link", "" },
+    { "location", "" },
+    { "max-forwards", "" },
+    { "proxy-authenticate", "" },
+    { "proxy-authorization", "" },
+    { "range", "" },
+    { "referer", "" },
+    { "refresh", "" },
+    { "retry-after", "" },
+    { "server", "" },
+    { "set-cookie", "" },
+    { "strict-transport-security", "" },
+    { "transfer-encoding", "" },
+    { "user-agent", "" },
+    { "vary", "" },
+    { "via", "" },
+    { "www-authenticate", "" },
+};
+const size_t kStaticTableSize = sizeof(kStaticTable) / sizeof(kStaticTable[0]);
+
+// Huffman 编码表 (RFC 7541 附录 B)：{ 码字 (右对齐), 位数 }，下标为符号，256 是 EOS
+struct HuffmanCode
+{
+    uint32_t code;
+    uint8_t  bits;
+};
+
+const HuffmanCode kHuffmanTable[257] = {
+    { 0x1ff8, 13 }, { 0x7fffd8, 23 }, { 0xfffffe2, 28 }, { 0xfffffe3, 28 },
+    { 0xfffffe4, 28 }, { 0xfffffe5, 28 }, { 0xfffffe6, 28 }, { 0xfffffe7, 28 },
+    { 0xfffffe8, 28 }, { 0xffffea, 24 }, { 0x3ffffffc, 30 }, { 0xfffffe9, 28 },
+    { 0xfffffea, 28 }, { 0x3ffffffd, 30 }, { 0xfffffeb, 28 }, { 0xfffffec, 28 },
+    { 0xfffffed, 28 }, { 0xfffffee, 28 }, { 0xfffffef, 28 }, { 0xffffff0, 28 },
+    { 0xffffff1, 28 }, { 0xffffff2, 28 }, { 0x3ffffffe, 30 }, { 0xffffff3, 28 },
+    { 0xffffff4, 28 }, { 0xffffff5, 28 }, { 0xffffff6, 28 }, { 0xffffff7, 28 },
+    { 0xffffff8, 28 }, { 0xffffff9, 28 }, { 0xffffffa, 28 }, { 0xffffffb, 28 },
+    { 0x14, 6 }, { 0x3f8, 10 }, { 0x3f9, 10 }, { 0xffa, 12 },
+    { 0x1ff9, 13 }, { 0x15, 6 }, { 0xf8, 8 }, { 0x7fa, 11 },
+    { 0x3fa, 10 }, { 0x3fb, 10 }, { 0xf9, 8 }, { 0x7fb, 11 },
+    { 0xfa, 8 }, { 0x16, 6 }, { 0x17, 6 }, { 0x18, 6 },
+    { 0x0, 5 }, { 0x1, 5 }, { 0x2, 5 }, { 0x19, 6 },
+    { 0x1a, 6 }, { 0x1b, 6 }, { 0x1c, 6 }, { 0x1d, 6 },
+    { 0x1e, 6 }, { 0x1f, 6 }, { 0x5c, 7 }, { 0xfb, 8 },
+    { 0x7ffc, 15 }, { 0x20, 6 }, { 0xffb, 12 }, { 0x3fc, 10 },
+    { 0x1ffa, 13 }, { 0x21, 6 }, { 0x5d, 7 }, { 0x5e, 7 },
+    { 0x5f, 7 }, { 0x60, 7 }, { 0x61, 7 }, { 0x62, 7 },
+    { 0x63, 7 }, { 0x64, 7 }, { 0x65, 7 }, { 0x66, 7 },
+    { 0x67, 7 }, { 0x68, 7 }, { 0x69, 7 }, { 0x6a, 7 },
+    { 0x6b, 7 }, { 0x6c, 7 }, { 0x6d, 7 }, { 0x6e, 7 },
+    { 0x6f, 7 }, { 0x70, 7 }, { 0x71, 7 }, { 0x72, 7 },
+    { 0xfc, 8 }, { 0x73, 7 }, { 0xfd, 8 }, { 0x1ffb, 13 },
+    { 0x7fff0, 19 }, { 0x1ffc, 13 }, { 0x3ffc, 14 }, { 0x22, 6 },
+    { 0x7ffd, 15 }, { 0x3, 5 }, { 0x23, 6 }, { 0x4, 5 },
+    { 0x24, 6 }, { 0x5, 5 }, { 0x25, 6 }, { 0x26, 6 },
+    { 0x27, 6 }, { 0x6, 5 }, { 0x74, 7 }, { 0x75, 7 },
+    { 0x28, 6 }, { 0x29, 6 }, { 0x2a, 6 }, { 0x7, 5 },
+    { 0x2b, 6 }, { 0x76, 7 }, { 0x2c, 6 }, { 0x8, 5 },
+    { 0x9, 5 }, { 0x2d, 6 }, { 0x77, 7 }, { 0x78, 7 },
+    { 0x79, 7 }, { 0x7a, 7 }, { 0x7b, 7 }, { 0x7ffe, 15 },
+    { 0x7fc, 11 }, { 0x3ffd, 14 }, { 0x1ffd, 13 }, { 0xffffffc, 28 },
+    { 0xfffe6, 20 }, { 0x3fffd2, 22 }, { 0xfffe7, 20 }, { 0xfffe8, 20 },
+    { 0x3fffd3, 22 }, { 0x3fffd4, 22 }, { 0x3fffd5, 22 }, { 0x7fffd9, 23 },
+    { 0x3fffd6, 22 }, { 0x7fffda, 23 }, { 0x7fffdb, 23 }, { 0x7fffdc, 23 },
+    { 0x7fffdd, 23 }, { 0x7fffde, 23 }, { 0xffffeb, 24 }, { 0x7fffdf, 23 },
+    { 0xffffec, 24 }, { 0xffffed, 24 }, { 0x3fffd7, 22 }, { 0x7fffe0, 23 },
+    { 0xffffee, 24 }, { 0x7fffe1, 23 }, { 0x7fffe2, 23 }, { 0x7fffe3, 23 },
+    { 0x7fffe4, 23 }, { 0x1fffdc, 21 }, { 0x3fffd8, 22 }, { 0x7fffe5, 23 },
+    { 0x3fffd9, 22 }, { 0x7fffe6, 23 }, { 0x7fffe7, 23 }, { 0xffffef, 24 },
+    { 0x3fffda, 22 }, { 0x1fffdd, 21 }, { 0xfffe9, 20 }, { 0x3fffdb, 22 },
+    { 0x3fffdc, 22 }, { 0x7fffe8, 23 }, { 0x7fffe9, 23 }, { 0x1fffde, 21 },
+    { 0x7fffea, 23 }, { 0x3fffdd, 22 }, { 0x3fffde, 22 }, { 0xfffff0, 24 },
+    { 0x1fffdf, 21 }, { 0x3fffdf, 22 }, { 0x7fffeb, 23 }, { 0x7fffec, 23 },
+    { 0x1fffe0, 21 }, { 0x1fffe1, 21 }, { 0x3fffe0, 22 }, { 0x1fffe2, 21 },
+    { 0x7fffed, 23 }, { 0x3fffe1, 22 }, { 0x7fffee, 23 }, { 0x7fffef, 23 },
+    { 0xfffea, 20 }, { 0x3fffe2, 22 }, { 0x3fffe3, 22 }, { 0x3fffe4, 22 },
+    { 0x7ffff0, 23 }, { 0x3fffe5, 22 }, { 0x3fffe6, 22 }, { 0x7ffff1, 23 },
+    { 0x3ffffe0, 26 }, { 0x3ffffe1, 26 }, { 0xfffeb, 20 }, { 0x7fff1, 19 },
+    { 0x3fffe7, 22 }, { 0x7ffff2, 23 }, { 0x3fffe8, 22 }, { 0x1ffffec, 25 },
+    { 0x3ffffe2, 26 }, { 0x3ffffe3, 26 }, { 0x3ffffe4, 26 }, { 0x7ffffde, 27 },
+    { 0x7ffffdf, 27 }, { 0x3ffffe5, 26 }, { 0xfffff1, 24 }, { 0x1ffffed, 25 },
+    { 0x7fff2, 19 }, { 0x1fffe3, 21 }, { 0x3ffffe6, 26 }, { 0x7ffffe0, 27 },
+    { 0x7ffffe1, 27 }, { 0x3ffffe7, 26 }, { 0x7ffffe2, 27 }, { 0xfffff2, 24 },
+    { 0x1fffe4, 21 }, { 0x1fffe5, 21 }, { 0x3ffffe8, 26 }, { 0x3ffffe9, 26 },
+    { 0xffffffd, 28 }, { 0x7ffffe3, 27 }, { 0x7ffffe4, 27 }, { 0x7ffffe5, 27 },
+    { 0xfffec, 20 }, { 0xfffff3, 24 }, { 0xfffed, 20 }, { 0x1fffe6, 21 },
+    { 0x3fffe9, 22 }, { 0x1fffe7, 21 }, { 0x1fffe8, 21 }, { 0x7ffff3, 23 },
+    { 0x3fffea, 22 }, { 0x3fffeb, 22 }, { 0x1ffffee, 25 }, { 0x1ffffef, 25 },
+    { 0xfffff4, 24 }, { 0xfffff5, 24 }, { 0x3ffffea, 26 }, { 0x7ffff4, 23 },
+    { 0x3ffffeb, 26 }, { 0x7ffffe6, 27 }, { 0x3ffffec, 26 }, { 0x3ffffed, 26 },
+    { 0x7ffffe7, 27 }, { 0x7ffffe8, 27 }, { 0x7ffffe9, 27 }, { 0x7ffffea, 27 },
+    { 0x7ffffeb, 27 }, { 0xffffffe, 28 }, { 0x7ffffec, 27 }, { 0x7ffffed, 27 },
+    { 0x7ffffee, 27 }, { 0x7ffffef, 27 }, { 0x7fffff0, 27 }, { 0x3ffffee, 26 },
+    { 0x3fffffff, 30 },
+};
+
+// Huffman 解码树：启动时由编码表建一次，解码时逐位走树
+class HuffmanTree
+{
+public:
+    struct Node
+    {
+        int16_t child[2];
+        int16_t symbol; // 叶子节点的符号，内部节点为 -1
+    };
+
+    static const HuffmanTree& instance()
+    {
+        static HuffmanTree tree;
+        return tree;
+    }
+
+    const Node& node(int index) const { return nodes_[index]; }
+
+private:
+    HuffmanTree()
+    {
+        nodes_.push_back({ { -1, -1 }, -1 });
+        for (int symbol = 0; symbol < 257; ++symbol)
+        {
+            const HuffmanCode& code = kHuffmanTable[symbol];
+            int current = 0;
+            for (int bit = code.bits - 1; bit >= 0; --bit)
+            {
+                int b = (code.code >> bit) & 1;
+                if (nodes_[current].child[b] < 0)
+                {
+                    nodes_[current].child[b] = static_cast<int16_t>(nodes_.size());
+                    nodes_.push_back({ { -1, -1 }, -1 });
+                }
+                current = nodes_[current].child[b];
+            }
+            nodes_[current].symbol = static_cast<int16_t>(symbol);
+        }
+    }
+
+    std::vector<Node> nodes_;
+};
+
+// 静态表的查找索引：完全匹配 "name\0value" -> 索引，名字 -> 第一个索引
+struct StaticIndex
+{
+    std::unordered_map<std::string, int> exact;
+    std::unordered_map<std::string, int> byName;
+
+    static const StaticIndex& instance()
+    {
+        static StaticIndex index;
+        return index;
+    }
+
+private:
+    StaticIndex()
+    {
+        for (size_t i = 0; i < kStaticTableSize; ++i)
+        {
+            int hpackIndex = static_cast<int>(i + 1);
+            std::string key = std::string(kStaticTable[i].first) + '\0' + kStaticTable[i].second;
+            exact.emplace(key, hpackIndex);
+            byName.emplace(kStaticTable[i].first, hpackIndex);
+        }
+    }
+};
+
+// 每次响应都在变的头部，进动态表只会把有用的条目挤出去
+bool shouldIndex(const std::string& name)
+{
+    static const char* const kNoIndex[] = {
+        "content-length", "date", "etag", "last-modified", "age", "expires",
+        "set-cookie", "location", "retry-after",
+    };
+    for (const char* noIndex : kNoIndex)
+    {
+        if (name == noIndex)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+void encodeString(const std::string& value, std::string* out)
+{
+    size_t huffmanLength = hpack::huffmanEncodedLength(value);
+    if (huffmanLength < value.size())
+    {
+        hpack::encodeInteger(huffmanLength, 7, 0x80, out);
+        hpack::huffmanEncode(value, out);
+    }
+    else
+    {
+        hpack::encodeInteger(value.size(), 7, 0x00, out);
+        out->append(value);
+    }
+}
+
+// 解码一个字符串字面量，成功返回消耗的字节数，失败返回 0
+size_t decodeString(const uint8_t* data, size_t len, std::string* out)
+{
+    if (len == 0)
+    {
+        return 0;
+    }
+    bool huffman = (data[0] & 0x80) != 0;
+    uint64_t length = 0;
+    size_t consumed = hpack::decodeInteger(data, len, 7, &length);
+    if (consumed == 0 || length > len - consumed)
+    {
+        return 0;
+    }
+    out->clear();
+    if (huffman)
+    {
+        if (!hpack::huffmanDecode(data + consumed, length, out))
+        {
+            return 0;
+        }
+    }
+    else
+    {
+        out->assign(reinterpret_cast<const char*>(data + consumed), length);
+    }
+    return consumed + length;
+}
+
+} // namespace
+
+// ==========================================================
+// 基础编解码
+// ==========================================================
+namespace hpack
+{
+
+void encodeInteger(uint64_t value, int prefixBits, uint8_t first, std::string* out)
+{
+    uint64_t maxPrefix = (1u << prefixBits) - 1;
+    if (value < maxPrefix)
+    {
+        out->push_back(static_cast<char>(first | value));
+        return;
+    }
+    out->push_back(static_cast<char>(first | maxPrefix));
+    value -= maxPrefix;
+    while (value >= 128)
+    {
+        out->push_back(static_cast<char>((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    out->push_back(static_cast<char>(value));
+}
+
+size_t decodeInteger(const uint8_t* data, size_t len, int prefixBits, uint64_t* value)
+{
+    if (len == 0)
+    {
+        return 0;
+    }
+    uint64_t maxPrefix = (1u << prefixBits) - 1;
+    *value = data[0] & maxPrefix;
+    if (*value < maxPrefix)
+    {
+        return 1;
+    }
+    int shift = 0;
+    for (size_t i = 1; i < len; ++i)
+    {
+        // 超过 2^56 的值在这里没有意义，防止溢出
+        if (shift > 49)
+        {
+            return 0;
+        }
+        *value += static_cast<uint64_t>(data[i] & 0x7f) << shift;
+        shift += 7;
+        if ((data[i] & 0x80) == 0)
+        {
+            return i + 1;
+        }
+    }
+    return 0;
+}
+
+size_t huffmanEncodedLength(const std::string& value)
+{
+    size_t bits = 0;
+    for (char ch : value)
+    {
+        bits += kHuffmanTable[static_cast<unsigned char>(ch)].bits;
+    }
+    return (bits + 7) / 8;
+}
+
+void huffmanEncode(const std::string& value, std::string* out)
+{
+    uint64_t acc = 0;
+    int pending = 0; // acc 里还没输出的位数 (始终 < 8)
+    for (char ch : value)
+    {
+        const HuffmanCode& code = kHuffmanTable[static_cast<unsigned char>(ch)];
+        acc = (acc << code.bits) | code.code;
+        pending += code.bits;
+        while (pending >= 8)
+        {
+            pending -= 8;
+            out->push_back(static_cast<char>(acc >> pending));
+        }
+    }
+    if (pending > 0)
+    {
+        // 用 EOS 的前缀 (全 1) 补齐最后一个字节
+        out->push_back(static_cast<char>((acc << (8 - pending)) | (0xff >> pending)));
+    }
+}
+
+bool huffmanDecode(const uint8_t* data, size_t len, std::string* out)
+{
+    const HuffmanTree& tree = HuffmanTree::instance();
+    int current = 0;
+    int bitsSinceSymbol = 0;
+    bool allOnes = true;
+    for (size_t i = 0; i < len; ++i)
+    {
+        for (int bit = 7; bit >= 0; --bit)
+        {
+            int b = (data[i] >> bit) & 1;
+            current = tree.node(current).child[b];
+            if (current < 0)
+            {
+                return false;
+            }
+            ++bitsSinceSymbol;
+            allOnes = allOnes && b == 1;
+            int symbol = tree.node(current).symbol;
+            if (symbol >= 0)
+            {
+                if (symbol == 256)
+                {
+                    return false; // 串里不允许出现 EOS
+                }
+                out->push_back(static_cast<char>(symbol));
+                current = 0;
+                bitsSinceSymbol = 0;
+                allOnes = true;
+            }
+        }
+    }
+    // 结尾的填充必须是不超过 7 位的全 1
+    return bitsSinceSymbol <= 7 && allOnes;
+}
+
+} // namespace hpack
+
+// ==========================================================
+// HpackDynamicTable
+// ==========================================================
+void HpackDynamicTable::add(const std::string& name, const std::string& value)
+{
+    size_t entrySize = name.size() + value.size() + 32;
+    if (entrySize > maxSize_)
+    {
+        // 比整张表还大的条目：清空表，条目本身不进表
+        entries_.clear();
+        size_ = 0;
+        return;
+    }
+    evict(maxSize_ - entrySize);
+    entries_.emplace_front(name, value);
+    size_ += entrySize;
+}
+
+void HpackDynamicTable::setMaxSize(size_t maxSize)
+{
+    maxSize_ = maxSize;
+    evict(maxSize_);
+}
+
+int HpackDynamicTable::find(const std::string& name, const std::string& value, bool* exact) const
+{
+    int nameMatch = -1;
+    for (size_t i = 0; i < entries_.size(); ++i)
+    {
+        if (entries_[i].first == name)
+        {
+            if (entries_[i].second == value)
+            {
+                *exact = true;
+                return static_cast<int>(i);
+            }
+            if (nameMatch < 0)
+            {
+                nameMatch = static_cast<int>(i);
+            }
+        }
+    }
+    *exact = false;
+    return nameMatch;
+}
+
+void HpackDynamicTable::evict(size_t limit)
+{
+    while (size_ > limit && !entries_.empty())
+    {
+        const auto& oldest = entries_.back();
+        size_ -= oldest.first.size() + oldest.second.size() + 32;
+        entries_.pop_back();
+    }
+}
+
+// ==========================================================
+// HpackDecoder
+// ==========================================================
+bool HpackDecoder::lookup(uint64_t index, std::string* name, std::string* value) const
+{
+    if (index == 0)
+    {
+        return false;
+    }
+    if (index <= kStaticTableSize)
+    {
+        *name = kStaticTable[index - 1].first;
+        if (value)
+        {
+            *value = kStaticTable[index - 1].second;
+        }
+        return true;
+    }
+    const auto* entry = table_.get(index - kStaticTableSize - 1);
+    if (!entry)
+    {
+        return false;
+    }
+    *name = entry->first;
+    if (value)
+    {
+        *value = entry->second;
+    }
+    return true;
+}
+
+bool HpackDecoder::decode(const char* block, size_t len, size_t maxListSize, HeaderList* headers)
+{
+    const uint8_t* data = reinterpret_cast<const uint8_t*>(block);
+    size_t pos = 0;
+    size_t listSize = 0;
+    bool headerSeen = false;
+    while (pos < len)
+    {
+        uint8_t first = data[pos];
+        uint64_t index = 0;
+        size_t consumed = 0;
+        std::string name;
+        std::string value;
+
+        if (first & 0x80)
+        {
+            // 1xxxxxxx：索引字段
+            consumed = hpack::decodeInteger(data + pos, len - pos, 7, &index);
+            if (consumed == 0 || !lookup(index, &name, &value))
+            {
+                return false;
+            }
+            pos += consumed;
+            listSize += name.size() + value.size() + 32;
+            if (listSize > maxListSize)
+            {
+                return false;
+            }
+            headers->emplace_back(std::move(name), std::move(value));
+            headerSeen = true;
+            continue;
+        }
+
+        if ((first & 0xe0) == 0x20)
+        {
+            // 001xxxxx：动态表大小更新，只能出现在 block 开头，且不能超过我方允许的上限
+            consumed = hpack::decodeInteger(data + pos, len - pos, 5, &index);
+            if (consumed == 0 || headerSeen || index > maxAllowedSize_)
+            {
+                return false;
+            }
+            table_.setMaxSize(index);
+            pos += consumed;
+            continue;
+        }
+
+        // 01xxxxxx：带索引的字面量；0000xxxx / 0001xxxx：不索引 / 永不索引的字面量
+        bool indexing = (first & 0xc0) == 0x40;
+        int prefixBits = indexing ? 6 : 4;
+        consumed = hpack::decodeInteger(data + pos, len - pos, prefixBits, &index);
+        if (consumed == 0)
+        {
+            return false;
+        }
+        pos += consumed;
+        if (index == 0)
+        {
+            consumed = decodeString(data + pos, len - pos, &name);
+            if (consumed == 0)
+            {
+                return false;
+            }
+            pos += consumed;
+        }
+        else if (!lookup(index, &name, nullptr))
+        {
+            return false;
+        }
+        consumed = decodeString(data + pos, len - pos, &value);
+        if (consumed == 0)
+        {
+            return false;
+        }
+        pos += consumed;
+
+        if (indexing)
+        {
+            table_.add(name, value);
+        }
+        listSize += name.size() + value.size() + 32;
+        if (listSize > maxListSize)
+        {
+            return false;
+        }
+        headers->emplace_back(std::move(name), std::move(value));
+        headerSeen = true;
+    }
+    return true;
+}
+
+// ==========================================================
+// HpackEncoder
+// ==========================================================
+void HpackEncoder::setMaxTableSize(size_t maxSize)
+{
+    // 我方最多用 4096 字节，对端给得再大也不用
+    if (maxSize > 4096)
+    {
+        maxSize = 4096;
+    }
+    if (maxSize != table_.maxSize())
+    {
+        table_.setMaxSize(maxSize);
+        pendingSizeUpdate_ = true;
+    }
+}
+
+void HpackEncoder::encode(const HeaderList& headers, std::string* out)
+{
+    if (pendingSizeUpdate_)
+    {
+        hpack::encodeInteger(table_.maxSize(), 5, 0x20, out);
+        pendingSizeUpdate_ = false;
+    }
+
+    const StaticIndex& staticIndex = StaticIndex::instance();
+    std::string key;
+    for (const auto& header : headers)
+    {
+        const std::string& name = header.first;
+        const std::string& value = header.second;
+
+        // 1. 静态表完全匹配 (比如 :status 200)
+        key.assign(name);
+        key.push_back('\0');
+        key.append(value);
+        auto exact = staticIndex.exact.find(key);
+        if (exact != staticIndex.exact.end())
+        {
+            hpack::encodeInteger(exact->second, 7, 0x80, out);
+            continue;
+        }
+
+        // 2. 动态表完全匹配
+        bool dynamicExact = false;
+        int dynamicIndex = table_.find(name, value, &dynamicExact);
+        if (dynamicExact)
+        {
+            hpack::encodeInteger(kStaticTableSize + 1 + dynamicIndex, 7, 0x80, out);
+            continue;
+        }
+
+        // 3. 字面量：名字尽量用索引
+        uint64_t nameIndex = 0;
+        auto byName = staticIndex.byName.find(name);
+        if (byName != staticIndex.byName.end())
+        {
+            nameIndex = byName->second;
+        }
+        else if (dynamicIndex >= 0)
+        {
+            nameIndex = kStaticTableSize + 1 + dynamicIndex;
+        }
+
+        size_t entrySize = name.size() + value.size() + 32;
+        bool indexing = shouldIndex(name) && entrySize <= table_.maxSize() * 3 / 4;
+        if (indexing)
+        {
+            hpack::encodeInteger(nameIndex, 6, 0x40, out);
+        }
+        else
+        {
+            hpack::encodeInteger(nameIndex, 4, 0x00, out);
+        }
+        if (nameIndex == 0)
+        {
+            encodeString(name, out);
+        }
+        encodeString(value, out);
+        if (indexing)
+        {
+            table_.add(name, value);
+        }
+    }
+}
+
+} // namespace http2
+} // namespace http
@@ -0,0 +1,1006 @@
+#include "../../include/http2/Http2Connection.h"
+
+#include <muduo/base/Logging.h>
+#include <muduo/base/Timestamp.h>
+
+#include <algorithm>
+#include <ctype.h>
+#include <string.h>
+#include <strings.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+namespace http
+{
+namespace http2
+{
+
+namespace
+{
+
+// 帧类型 (RFC 7540 6)
+const uint8_t kFrameData = 0x0;
+const uint8_t kFrameHeaders = 0x1;
+const uint8_t kFramePriority = 0x2;
+const uint8_t kFrameRstStream = 0x3;
+const uint8_t kFrameSettings = 0x4;
+const uint8_t kFramePushPromise = 0x5;
+const uint8_t kFramePing = 0x6;
+const uint8_t kFrameGoAway = 0x7;
+const uint8_t kFrameWindowUpdate = 0x8;
+const uint8_t kFrameContinuation = 0x9;
+
+// 帧标志
+const uint8_t kFlagEndStream = 0x1;
+const uint8_t kFlagAck = 0x1;
+const uint8_t kFlagEndHeaders = 0x4;
+const uint8_t kFlagPadded = 0x8;
+const uint8_t kFlagPriority = 0x20;
+
+// 错误码 (RFC 7540 7)
+const uint32_t kProtocolError = 0x1;
+const uint32_t kFlowControlError = 0x3;
+const uint32_t kStreamClosed = 0x5;
+const uint32_t kFrameSizeError = 0x6;
+const uint32_t kNoError = 0x0;
+const uint32_t kRefusedStream = 0x7;
+const uint32_t kCompressionError = 0x9;
+const uint32_t kEnhanceYourCalm = 0xb;
+
+// 设置项
+const uint16_t kSettingsHeaderTableSize = 0x1;
+const uint16_t kSettingsEnablePush = 0x2;
+const uint16_t kSettingsMaxConcurrentStreams = 0x3;
+const uint16_t kSettingsInitialWindowSize = 0x4;
+const uint16_t kSettingsMaxFrameSize = 0x5;
+const uint16_t kSettingsMaxHeaderListSize = 0x6;
+
+const size_t   kFrameHeaderLength = 9;
+const size_t   kDefaultMaxFrameSize = 16384;
+const int64_t  kDefaultWindow = 65535;
+const int64_t  kMaxWindow = 0x7fffffff;
+
+// 我方的参数：单个 stream 1MB 接收窗口，整个连接 16MB
+const uint32_t kLocalMaxConcurrentStreams = 128;
+const int64_t  kLocalStreamWindow = 1 << 20;
+const int64_t  kLocalConnWindow = 1 << 24;
+const size_t   kLocalMaxHeaderBlock = 64 * 1024;
+// 请求体上限：单个请求 1MB，整个连接上没收齐的请求体加起来 4MB
+const size_t   kLocalMaxRequestBody = 1 << 20;
+const size_t   kLocalMaxBufferedBody = 1 << 22;
+
+uint32_t readUint32(const char* p)
+{
+    const uint8_t* u = reinterpret_cast<const uint8_t*>(p);
+    return (static_cast<uint32_t>(u[0]) << 24) | (static_cast<uint32_t>(u[1]) << 16) |
+           (static_cast<uint32_t>(u[2]) << 8) | u[3];
+}
+
+void appendUint32(Buffer* out, uint32_t value)
+{
+    char bytes[4] = {
+        static_cast<char>(value >> 24), static_cast<char>(value >> 16),
+        static_cast<char>(value >> 8), static_cast<char>(value),
+    };
+    out->append(bytes, 4);
+}
+
+void appendSetting(std::string* payload, uint16_t id, uint32_t value)
+{
+    payload->push_back(static_cast<char>(id >> 8));
+    payload->push_back(static_cast<char>(id));
+    payload->push_back(static_cast<char>(value >> 24));
+    payload->push_back(static_cast<char>(value >> 16));
+    payload->push_back(static_cast<char>(value >> 8));
+    payload->push_back(static_cast<char>(value));
+}
+
+// HTTP2-Settings 头是 base64url (不带填充) 编码的 SETTINGS 负载
+bool decodeBase64Url(const std::string& in, std::string* out)
+{
+    uint32_t bits = 0;
+    int count = 0;
+    for (char ch : in)
+    {
+        int v;
+        if (ch >= 'A' && ch <= 'Z') v = ch - 'A';
+        else if (ch >= 'a' && ch <= 'z') v = ch - 'a' + 26;
+        else if (ch >= '0' && ch <= '9') v = ch - '0' + 52;
+        else if (ch == '-' || ch == '+') v = 62;
+        else if (ch == '_' || ch == '/') v = 63;
+        else if (ch == '=') break;
+        else return false;
+        bits = (bits << 6) | static_cast<uint32_t>(v);
+        count += 6;
+        if (count >= 8)
+        {
+            count -= 8;
+            out->push_back(static_cast<char>((bits >> count) & 0xff));
+        }
+    }
+    return true;
+}
+
+const std::string* findHeaderIgnoreCase(const HttpRequest& req, const char* field)
+{
+    for (const auto& header : req.headers())
+    {
+        if (::strcasecmp(header.first.c_str(), field) == 0)
+        {
+            return &header.second;
+        }
+    }
+    return nullptr;
+}
+
+// h2 的头部名是小写的，转成 HTTP/1 的写法 (content-type -> Content-Type)，现有代码按这个名字取头
+std::string canonicalHeaderName(const std::string& name)
+{
+    std::string canonical = name;
+    bool upper = true;
+    for (char& ch : canonical)
+    {
+        if (upper)
+        {
+            ch = static_cast<char>(::toupper(static_cast<unsigned char>(ch)));
+        }
+        upper = (ch == '-');
+    }
+    return canonical;
+}
+
+// 连接级的头部在 HTTP/2 里是禁止的 (RFC 7540 8.1.2.2)
+bool isConnectionSpecific(const std::string& name)
+{
+    return name == "connection" || name == "keep-alive" || name == "proxy-connection" ||
+           name == "transfer-encoding" || name == "upgrade";
+}
+
+} // namespace
+
+const char Http2Connection::kClientPreface[] = "PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n";
+const size_t Http2Connection::kClientPrefaceLength;
+
+Http2Connection::Http2Connection(const RequestHandler& handler, const ResponseObserver& observer)
+    : handler_(handler)
+    , observer_(observer)
+    , prefaceReceived_(false)
+    , goAwaySent_(false)
+    , lastStreamId_(0)
+    , totalStreams_(0)
+    , headerStreamId_(0)
+    , headerEndStream_(false)
+    , headerFrameBytes_(0)
+    , peerMaxFrameSize_(kDefaultMaxFrameSize)
+    , peerInitialWindow_(kDefaultWindow)
+    , connSendWindow_(kDefaultWindow)
+    , connRecvWindow_(kDefaultWindow)
+    , connUnackedRecv_(0)
+    , bufferedBody_(0)
+{
+}
+
+bool Http2Connection::isUpgradeRequest(const HttpRequest& req)
+{
+    const std::string* upgrade = findHeaderIgnoreCase(req, "Upgrade");
+    return upgrade && ::strcasecmp(upgrade->c_str(), "h2c") == 0 &&
+           findHeaderIgnoreCase(req, "HTTP2-Settings") != nullptr;
+}
+
+void Http2Connection::start(Buffer* out)
+{
+    std::string settings;
+    appendSetting(&settings, kSettingsMaxConcurrentStreams, kLocalMaxConcurrentStreams);
+    appendSetting(&settings, kSettingsInitialWindowSize, static_cast<uint32_t>(kLocalStreamWindow));
+    appendSetting(&settings, kSettingsMaxHeaderListSize, static_cast<uint32_t>(kLocalMaxHeaderBlock));
+    appendFrameHeader(out, settings.size(), kFrameSettings, 0, 0);
+    out->append(settings);
+
+    // 连接级窗口只能通过 WINDOW_UPDATE 调大
+    appendWindowUpdate(out, 0, static_cast<uint32_t>(kLocalConnWindow - kDefaultWindow));
+    connRecvWindow_ = kLocalConnWindow;
+}
+
+bool Http2Connection::upgrade(HttpRequest& req, size_t requestBytes, Buffer* out)
+{
+    const std::string* encoded = findHeaderIgnoreCase(req, "HTTP2-Settings");
+    std::string settings;
+    if (!encoded || !decodeBase64Url(*encoded, &settings) || settings.size() % 6 != 0)
+    {
+        return false;
+    }
+
+    start(out);
+    // HTTP2-Settings 相当于客户端的第一个 SETTINGS，由 101 隐式确认，不回 ACK
+    if (!applySettings(settings.data(), settings.size(), out))
+    {
+        return true; // 已经写了 GOAWAY
+    }
+
+    // 升级前的那个请求就是 stream 1，请求已经收完 (half-closed remote)
+    lastStreamId_ = 1;
+    Stream& stream = streams_[1];
+    stream.id = 1;
+    stream.remoteClosed = true;
+    stream.requestBytes = requestBytes;
+    stream.sendWindow = peerInitialWindow_;
+    stream.recvWindow = kLocalStreamWindow;
+    ++totalStreams_;
+
+    HttpResponse response(false);
+    if (handler_)
+    {
+        handler_(req, &response);
+    }
+    respond(&stream, req, response, out);
+    return true;
+}
+
+bool Http2Connection::onData(Buffer* in, Buffer* out)
+{
+    if (goAwaySent_)
+    {
+        in->retrieveAll();
+        return false;
+    }
+
+    if (!prefaceReceived_)
+    {
+        size_t n = std::min(in->readableBytes(), kClientPrefaceLength);
+        if (::memcmp(in->peek(), kClientPreface, n) != 0)
+        {
+            return connectionError(kProtocolError, out);
+        }
+        if (n < kClientPrefaceLength)
+        {
+            return true;
+        }
+        in->retrieve(kClientPrefaceLength);
+        prefaceReceived_ = true;
+        flushAll(out);
+    }
+
+    while (in->readableBytes() >= kFrameHeaderLength)
+    {
+        const uint8_t* header = reinterpret_cast<const uint8_t*>(in->peek());
+        size_t length = (static_cast<size_t>(header[0]) << 16) | (header[1] << 8) | header[2];
+        uint8_t type = header[3];
+        uint8_t flags = header[4];
+        uint32_t streamId = readUint32(in->peek() + 5) & 0x7fffffff;
+
+        if (length > kDefaultMaxFrameSize)
+        {
+            return connectionError(kFrameSizeError, out);
+        }
+        if (in->readableBytes() < kFrameHeaderLength + length)
+        {
+            break;
+        }
+        bool ok = onFrame(type, flags, streamId, in->peek() + kFrameHeaderLength, length, out);
+        in->retrieve(kFrameHeaderLength + length);
+        if (!ok)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool Http2Connection::onFrame(uint8_t type, uint8_t flags, uint32_t streamId,
+                              const char* payload, size_t length, Buffer* out)
+{
+    // header block 必须连续：HEADERS 之后只能跟同一个 stream 的 CONTINUATION
+    if (headerStreamId_ != 0 && type != kFrameContinuation)
+    {
+        return connectionError(kProtocolError, out);
+    }
+
+    switch (type)
+    {
+    case kFrameData:
+        return onDataFrame(flags, streamId, payload, length, out);
+
+    case kFrameHeaders:
+        return onHeadersFrame(flags, streamId, payload, length, out);
+
+    case kFrameContinuation:
+        return onContinuationFrame(flags, streamId, payload, length, out);
+
+    case kFramePriority:
+        // 不做优先级调度，只校验格式
+        if (streamId == 0)
+        {
+            return connectionError(kProtocolError, out);
+        }
+        if (length != 5)
+        {
+            resetStream(streamId, kFrameSizeError, out);
+        }
+        return true;
+
+    case kFrameRstStream:
+        if (streamId == 0 || streamId > lastStreamId_)
+        {
+            return connectionError(kProtocolError, out);
+        }
+        if (length != 4)
+        {
+            return connectionError(kFrameSizeError, out);
+        }
+        closeStream(streamId);
+        return true;
+
+    case kFrameSettings:
+        return onSettingsFrame(flags, streamId, payload, length, out);
+
+    case kFramePing:
+        if (streamId != 0)
+        {
+            return connectionError(kProtocolError, out);
+        }
+        if (length != 8)
+        {
+            return connectionError(kFrameSizeError, out);
+        }
+        if (!(flags & kFlagAck))
+        {
+            appendFrameHeader(out, 8, kFramePing, kFlagAck, 0);
+            out->append(payload, 8);
+        }
+        return true;
+
+    case kFrameGoAway:
+        // 对端不再开新 stream，已有的照常处理完，由对端关闭连接
+        if (streamId != 0)
+        {
+            return connectionError(kProtocolError, out);
+        }
+        return true;
+
+    case kFrameWindowUpdate:
+        return onWindowUpdateFrame(streamId, payload, length, out);
+
+    case kFramePushPromise:
+        // 客户端不能推送
+        return connectionError(kProtocolError, out);
+
+    default:
+        // 未知类型的帧必须忽略
+        return true;
+    }
+}
+
+bool Http2Connection::onDataFrame(uint8_t flags, uint32_t streamId,
+                                  const char* payload, size_t length, Buffer* out)
+{
+    if (streamId == 0)
+    {
+        return connectionError(kProtocolError, out);
+    }
+    size_t padLength = 0;
+    size_t offset = 0;
+    if (flags & kFlagPadded)
+    {
+        if (length < 1 || static_cast<uint8_t>(payload[0]) >= length)
+        {
+            return connectionError(kProtocolError, out);
+        }
+        padLength = static_cast<uint8_t>(payload[0]);
+        offset = 1;
+    }
+
+    // 连接级窗口：整个帧 (含填充) 都算
+    connRecvWindow_ -= static_cast<int64_t>(length);
+    if (connRecvWindow_ < 0)
+    {
+        return connectionError(kFlowControlError, out);
+    }
+    connUnackedRecv_ += length;
+    if (connUnackedRecv_ >= static_cast<size_t>(kLocalConnWindow / 2))
+    {
+        appendWindowUpdate(out, 0, static_cast<uint32_t>(connUnackedRecv_));
+        connRecvWindow_ += static_cast<int64_t>(connUnackedRecv_);
+        connUnackedRecv_ = 0;
+    }
+
+    auto it = streams_.find(streamId);
+    if (it == streams_.end() || it->second.remoteClosed)
+    {
+        if (streamId > lastStreamId_)
+        {
+            return connectionError(kProtocolError, out); // idle stream
+        }
+        resetStream(streamId, kStreamClosed, out);
+        return true;
+    }
+
+    Stream& stream = it->second;
+    stream.recvWindow -= static_cast<int64_t>(length);
+    if (stream.recvWindow < 0)
+    {
+        resetStream(streamId, kFlowControlError, out);
+        return true;
+    }
+
+    // 连接窗口已经还回去的数据只有两种：在上限以内缓存起来的，和下面被丢掉的，内存不会超过上限
+    size_t dataLength = length - offset - padLength;
+    if (stream.body.size() + dataLength > kLocalMaxRequestBody)
+    {
+        // 单个请求体太大：剩下的数据不再收，直接回 413
+        stream.remoteClosed = true;
+        stream.bodyTooLarge = true;
+        dispatch(&stream, out);
+        if (streams_.count(streamId) == 0)
+        {
+            // 413 已经发完，告诉对端不用再发请求体了 (RFC 7540 8.1)
+            appendFrameHeader(out, 4, kFrameRstStream, 0, streamId);
+            appendUint32(out, kNoError);
+        }
+        return true;
+    }
+    if (bufferedBody_ + dataLength > kLocalMaxBufferedBody)
+    {
+        resetStream(streamId, kRefusedStream, out);
+        return true;
+    }
+    stream.body.append(payload + offset, dataLength);
+    bufferedBody_ += dataLength;
+    stream.requestBytes += kFrameHeaderLength + length;
+
+    if (flags & kFlagEndStream)
+    {
+        stream.remoteClosed = true;
+        dispatch(&stream, out);
+    }
+    else
+    {
+        stream.unackedRecv += length;
+        if (stream.unackedRecv >= static_cast<size_t>(kLocalStreamWindow / 2))
+        {
+            appendWindowUpdate(out, streamId, static_cast<uint32_t>(stream.unackedRecv));
+            stream.recvWindow += static_cast<int64_t>(stream.unackedRecv);
+            stream.unackedRecv = 0;
+        }
+    }
+    return true;
+}
+
+bool Http2Connection::onHeadersFrame(uint8_t flags, uint32_t streamId,
+                                     const char* payload, size_t length, Buffer* out)
+{
+    if (streamId == 0)
+    {
+        return connectionError(kProtocolError, out);
+    }
+    size_t offset = 0;
+    size_t padLength = 0;
+    if (flags & kFlagPadded)
+    {
+        if (length < 1)
+        {
+            return connectionError(kProtocolError, out);
+        }
+        padLength = static_cast<uint8_t>(payload[0]);
+        offset = 1;
+    }
+    if (flags & kFlagPriority)
+    {
+        offset += 5; // 依赖关系和权重，忽略
+    }
+    if (offset + padLength > length)
+    {
+        return connectionError(kProtocolError, out);
+    }
+
+    // 新 stream 的 id 必须是奇数且递增；小于等于 lastStreamId_ 又不在表里的是已关闭的 stream
+    if (streams_.find(streamId) == streams_.end())
+    {
+        if (streamId % 2 == 0)
+        {
+            return connectionError(kProtocolError, out);
+        }
+        if (streamId <= lastStreamId_)
+        {
+            return connectionError(kStreamClosed, out);
+        }
+        lastStreamId_ = streamId;
+    }
+
+    headerStreamId_ = streamId;
+    headerEndStream_ = (flags & kFlagEndStream) != 0;
+    headerFrameBytes_ = kFrameHeaderLength + length;
+    headerBlock_.assign(payload + offset, length - offset - padLength);
+    if (flags & kFlagEndHeaders)
+    {
+        return onHeaderBlockComplete(out);
+    }
+    return true;
+}
+
+bool Http2Connection::onContinuationFrame(uint8_t flags, uint32_t streamId,
+                                          const char* payload, size_t length, Buffer* out)
+{
+    if (headerStreamId_ == 0 || streamId != headerStreamId_)
+    {
+        return connectionError(kProtocolError, out);
+    }
+    headerBlock_.append(payload, length);
+    headerFrameBytes_ += kFrameHeaderLength + length;
+    if (headerBlock_.size() > kLocalMaxHeaderBlock)
+    {
+        return connectionError(kEnhanceYourCalm, out);
+    }
+    if (flags & kFlagEndHeaders)
+    {
+        return onHeaderBlockComplete(out);
+    }
+    return true;
+}
+
+bool Http2Connection::onHeaderBlockComplete(Buffer* out)
+{
+    uint32_t streamId = headerStreamId_;
+    headerStreamId_ = 0;
+
+    // 不管这个 stream 最后要不要，header block 都必须解码，否则 HPACK 状态就和对端对不上了；
+    // 解出的头部超过通告的 SETTINGS_MAX_HEADER_LIST_SIZE 时停止解码，HPACK 状态已经对不上，只能关连接
+    HeaderList headers;
+    if (!decoder_.decode(headerBlock_.data(), headerBlock_.size(), kLocalMaxHeaderBlock, &headers))
+    {
+        return connectionError(kCompressionError, out);
+    }
+
+    auto it = streams_.find(streamId);
+    if (it != streams_.end())
+    {
+        // 请求体之后的 trailers：必须带 END_STREAM，内容忽略
+        Stream& stream = it->second;
+        if (stream.remoteClosed || !headerEndStream_)
+        {
+            resetStream(streamId, stream.remoteClosed ? kStreamClosed : kProtocolError, out);
+            return true;
+        }
+        stream.requestBytes += headerFrameBytes_;
+        stream.remoteClosed = true;
+        dispatch(&stream, out);
+        return true;
+    }
+
+    if (streams_.size() >= kLocalMaxConcurrentStreams)
+    {
+        resetStream(streamId, kRefusedStream, out);
+        return true;
+    }
+
+    // 校验：伪头部必须在普通头部前面，头部名必须小写，不能有连接级头部，:method 和 :path 必须有
+    bool regularSeen = false;
+    bool hasMethod = false;
+    bool hasPath = false;
+    for (const auto& header : headers)
+    {
+        const std::string& name = header.first;
+        bool pseudo = !name.empty() && name[0] == ':';
+        bool invalid = (pseudo && regularSeen) || isConnectionSpecific(name) ||
+                       std::any_of(name.begin(), name.end(), [](char c) { return c >= 'A' && c <= 'Z'; });
+        if (invalid)
+        {
+            resetStream(streamId, kProtocolError, out);
+            return true;
+        }
+        regularSeen = regularSeen || !pseudo;
+        hasMethod = hasMethod || name == ":method";
+        hasPath = hasPath || (name == ":path" && !header.second.empty());
+    }
+    if (!hasMethod || !hasPath)
+    {
+        resetStream(streamId, kProtocolError, out);
+        return true;
+    }
+
+    Stream& stream = streams_[streamId];
+    stream.id = streamId;
+    stream.headers.swap(headers);
+    stream.requestBytes = headerFrameBytes_;
+    stream.sendWindow = peerInitialWindow_;
+    stream.recvWindow = kLocalStreamWindow;
+    ++totalStreams_;
+    if (headerEndStream_)
+    {
+        stream.remoteClosed = true;
+        dispatch(&stream, out);
+    }
+    return true;
+}
+
+bool Http2Connection::onSettingsFrame(uint8_t flags, uint32_t streamId,
+                                      const char* payload, size_t length, Buffer* out)
+{
+    if (streamId != 0)
+    {
+        return connectionError(kProtocolError, out);
+    }
+    if (flags & kFlagAck)
+    {
+        return length == 0 ? true : connectionError(kFrameSizeError, out);
+    }
+    if (length % 6 != 0)
+    {
+        return connectionError(kFrameSizeError, out);
+    }
+    if (!applySettings(payload, length, out))
+    {
+        return false;
+    }
+    appendFrameHeader(out, 0, kFrameSettings, kFlagAck, 0);
+    // 初始窗口可能变大了，积压的响应体接着发
+    flushAll(out);
+    return true;
+}
+
+bool Http2Connection::applySettings(const char* payload, size_t length, Buffer* out)
+{
+    for (size_t i = 0; i + 6 <= length; i += 6)
+    {
+        uint16_t id = static_cast<uint16_t>((static_cast<uint8_t>(payload[i]) << 8) |
+                                            static_cast<uint8_t>(payload[i + 1]));
+        uint32_t value = readUint32(payload + i + 2);
+        switch (id)
+        {
+        case kSettingsHeaderTableSize:
+            encoder_.setMaxTableSize(value);
+            break;
+        case kSettingsEnablePush:
+            if (value > 1)
+            {
+                return connectionError(kProtocolError, out);
+            }
+            break;
+        case kSettingsInitialWindowSize:
+        {
+            if (value > kMaxWindow)
+            {
+                return connectionError(kFlowControlError, out);
+            }
+            // 初始窗口变化要同步调整所有已打开 stream 的发送窗口
+            int64_t delta = static_cast<int64_t>(value) - peerInitialWindow_;
+            for (auto& entry : streams_)
+            {
+                entry.second.sendWindow += delta;
+            }
+            peerInitialWindow_ = value;
+            break;
+        }
+        case kSettingsMaxFrameSize:
+            if (value < kDefaultMaxFrameSize || value > 0xffffff)
+            {
+                return connectionError(kProtocolError, out);
+            }
+            peerMaxFrameSize_ = value;
+            break;
+        case kSettingsMaxConcurrentStreams:
+        case kSettingsMaxHeaderListSize:
+        default:
+            // 服务端不推送，也不限制响应头大小；未知设置项忽略
+            break;
+        }
+    }
+    return true;
+}
+
+bool Http2Connection::onWindowUpdateFrame(uint32_t streamId, const char* payload,
+                                          size_t length, Buffer* out)
+{
+    if (length != 4)
+    {
+        return connectionError(kFrameSizeError, out);
+    }
+    uint32_t increment = readUint32(payload) & 0x7fffffff;
+    if (streamId == 0)
+    {
+        if (increment == 0)
+        {
+            return connectionError(kProtocolError, out);
+        }
+        connSendWindow_ += increment;
+        if (connSendWindow_ > kMaxWindow)
+        {
+            return connectionError(kFlowControlError, out);
+        }
+        flushAll(out);
+        return true;
+    }
+
+    auto it = streams_.find(streamId);
+    if (it == streams_.end())
+    {
+        // 已关闭的 stream 上迟到的 WINDOW_UPDATE 是正常的
+        return streamId > lastStreamId_ ? connectionError(kProtocolError, out) : true;
+    }
+    if (increment == 0)
+    {
+        resetStream(streamId, kProtocolError, out);
+        return true;
+    }
+    Stream& stream = it->second;
+    stream.sendWindow += increment;
+    if (stream.sendWindow > kMaxWindow)
+    {
+        resetStream(streamId, kFlowControlError, out);
+        return true;
+    }
+    flushStream(&stream, out);
+    return true;
+}
+
+void Http2Connection::dispatch(Stream* stream, Buffer* out)
+{
+    HttpRequest req;
+    req.setReceiveTime(Timestamp::now());
+    req.setVersion("HTTP/2.0");
+
+    bool methodOk = false;
+    std::string authority;
+    for (const auto& header : stream->headers)
+    {
+        const std::string& name = header.first;
+        const std::string& value = header.second;
+        if (name == ":method")
+        {
+            methodOk = req.setMethod(value.data(), value.data() + value.size());
+        }
+        else if (name == ":path")
+        {
+            size_t question = value.find('?');
+            if (question != std::string::npos)
+            {
+                req.setPath(value.data(), value.data() + question);
+                req.setQueryParameters(value.data() + question + 1, value.data() + value.size());
+            }
+            else
+            {
+                req.setPath(value.data(), value.data() + value.size());
+            }
+        }
+        else if (name == ":authority")
+        {
+            authority = value;
+        }
+        else if (name[0] != ':')
+        {
+            // 同名头部合并 (cookie 按 RFC 7540 8.1.2.5 用 "; " 连接)
+            std::string field = canonicalHeaderName(name);
+            std::string existing = req.getHeader(field);
+            if (existing.empty())
+            {
+                req.addHeader(field, value);
+            }
+            else
+            {
+                req.addHeader(field, existing + (name == "cookie" ? "; " : ", ") + value);
+            }
+        }
+    }
+    if (!authority.empty() && req.getHeader("Host").empty())
+    {
+        req.addHeader("Host", authority);
+    }
+    if (!stream->bodyTooLarge)
+    {
+        req.setContentLength(stream->body.size());
+        req.setBody(stream->body);
+    }
+    stream->headers.clear();
+    bufferedBody_ -= stream->body.size();
+    std::string().swap(stream->body);
+
+    HttpResponse response(false);
+    if (!methodOk)
+    {
+        response.setStatusCode(HttpResponse::k400BadRequest);
+        response.setStatusMessage("Bad Request");
+    }
+    else if (stream->bodyTooLarge)
+    {
+        response.setStatusCode(HttpResponse::k413PayloadTooLarge);
+        response.setStatusMessage("Payload Too Large");
+    }
+    else if (handler_)
+    {
+        handler_(req, &response);
+        if (response.deferred())
+        {
+            deferResponse(stream, req, &response);
+            return;
+        }
+    }
+    respond(stream, req, response, out);
+}
+
+void Http2Connection::deferResponse(Stream* stream, const HttpRequest& req, HttpResponse* response)
+{
+    // 连接先关了也要回调 observer_ (服务器靠它记指标)，所以单独拷一份
+    std::weak_ptr<Http2Connection> weakSelf(shared_from_this());
+    ResponseObserver observer = observer_;
+    uint32_t streamId = stream->id;
+    size_t requestBytes = stream->requestBytes;
+    response->addCompletionStep(
+        [weakSelf, observer, streamId, requestBytes](const HttpRequest& request, HttpResponse* resp)
+        {
+            std::shared_ptr<Http2Connection> self = weakSelf.lock();
+            Stream* target = nullptr;
+            if (self && !self->goAwaySent_)
+            {
+                auto it = self->streams_.find(streamId);
+                if (it != self->streams_.end())
+                {
+                    target = &it->second;
+                }
+            }
+            if (!target)
+            {
+                // 连接关了或者 stream 已经被对端重置：响应没地方发了
+                if (observer)
+                {
+                    observer(request, *resp, requestBytes, 0);
+                }
+                return;
+            }
+            Buffer out;
+            self->respond(target, request, *resp, &out);
+            if (self->writer_ && out.readableBytes() > 0)
+            {
+                self->writer_(&out);
+            }
+        });
+    response->detach(req);
+}
+
+void Http2Connection::respond(Stream* stream, const HttpRequest& req,
+                              const HttpResponse& response, Buffer* out)
+{
+    int status = response.getStatusCode();
+    const std::string& body = response.body();
+
+    HeaderList headers;
+    headers.reserve(response.headers().size() + 2);
+    headers.emplace_back(":status", std::to_string(status >= 100 ? status : 500));
+    for (const auto& header : response.headers())
+    {
+        std::string name = header.first;
+        std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+        if (isConnectionSpecific(name) || name == "content-length")
+        {
+            continue;
+        }
+        headers.emplace_back(std::move(name), header.second);
+    }
+    headers.emplace_back("content-length", std::to_string(body.size()));
+
+    std::string block;
+    encoder_.encode(headers, &block);
+
+    // 头部太大时拆成 HEADERS + CONTINUATION
+    bool headOnly = req.method() == HttpRequest::kHead || body.empty();
+    size_t responseBytes = 0;
+    size_t offset = 0;
+    bool first = true;
+    do
+    {
+        size_t chunk = std::min(block.size() - offset, peerMaxFrameSize_);
+        bool last = offset + chunk == block.size();
+        uint8_t flags = last ? kFlagEndHeaders : 0;
+        if (first && headOnly)
+        {
+            flags |= kFlagEndStream;
+        }
+        appendFrameHeader(out, chunk, first ? kFrameHeaders : kFrameContinuation, flags, stream->id);
+        out->append(block.data() + offset, chunk);
+        responseBytes += kFrameHeaderLength + chunk;
+        offset += chunk;
+        first = false;
+    } while (offset < block.size());
+
+    stream->responding = true;
+    if (!headOnly)
+    {
+        stream->pending = body;
+        stream->pendingOffset = 0;
+        size_t frames = (body.size() + peerMaxFrameSize_ - 1) / peerMaxFrameSize_;
+        responseBytes += body.size() + frames * kFrameHeaderLength;
+    }
+    if (observer_)
+    {
+        observer_(req, response, stream->requestBytes, responseBytes);
+    }
+    flushStream(stream, out);
+}
+
+void Http2Connection::flushStream(Stream* stream, Buffer* out)
+{
+    // Upgrade 时 stream 1 的响应体等收到客户端前言再发：有的客户端在切换协议时
+    // 只能缓存有限的数据 (比如 curl 只留 32KB)，101 后面紧跟大块 DATA 会被丢掉
+    if (!stream->responding || !prefaceReceived_)
+    {
+        return;
+    }
+    while (stream->pendingOffset < stream->pending.size())
+    {
+        int64_t window = std::min(connSendWindow_, stream->sendWindow);
+        if (window <= 0)
+        {
+            return; // 等 WINDOW_UPDATE
+        }
+        size_t remaining = stream->pending.size() - stream->pendingOffset;
+        size_t chunk = std::min(std::min(remaining, peerMaxFrameSize_), static_cast<size_t>(window));
+        bool last = chunk == remaining;
+        appendFrameHeader(out, chunk, kFrameData, last ? kFlagEndStream : 0, stream->id);
+        out->append(stream->pending.data() + stream->pendingOffset, chunk);
+        stream->pendingOffset += chunk;
+        connSendWindow_ -= static_cast<int64_t>(chunk);
+        stream->sendWindow -= static_cast<int64_t>(chunk);
+    }
+    // 响应发完 (END_STREAM 已发出)，stream 关闭
+    closeStream(stream->id);
+}
+
+void Http2Connection::flushAll(Buffer* out)
+{
+    for (auto it = streams_.begin(); it != streams_.end() && connSendWindow_ > 0; )
+    {
+        auto next = std::next(it);
+        flushStream(&it->second, out);
+        it = next;
+    }
+}
+
+void Http2Connection::closeStream(uint32_t streamId)
+{
+    auto it = streams_.find(streamId);
+    if (it != streams_.end())
+    {
+        bufferedBody_ -= it->second.body.size();
+        streams_.erase(it);
+    }
+}
+
+bool Http2Connection::connectionError(uint32_t errorCode, Buffer* out)
+{
+    if (!goAwaySent_)
+    {
+        LOG_DEBUG << "HTTP/2 connection error " << errorCode << ", last stream " << lastStreamId_;
+        appendFrameHeader(out, 8, kFrameGoAway, 0, 0);
+        appendUint32(out, lastStreamId_);
+        appendUint32(out, errorCode);
+        goAwaySent_ = true;
+    }
+    return false;
+}
+
+void Http2Connection::resetStream(uint32_t streamId, uint32_t errorCode, Buffer* out)
+{
+    appendFrameHeader(out, 4, kFrameRstStream, 0, streamId);
+    appendUint32(out, errorCode);
+    closeStream(streamId);
+}
+
+void Http2Connection::appendFrameHeader(Buffer* out, size_t length, uint8_t type,
+                                        uint8_t flags, uint32_t streamId)
+{
+    char header[kFrameHeaderLength] = {
+        static_cast<char>(length >> 16), static_cast<char>(length >> 8), static_cast<char>(length),
+        static_cast<char>(type), static_cast<char>(flags),
+        static_cast<char>((streamId >> 24) & 0x7f), static_cast<char>(streamId >> 16),
+        static_cast<char>(streamId >> 8), static_cast<char>(streamId),
+    };
+    out->append(header, kFrameHeaderLength);
+}
+
+void Http2Connection::appendWindowUpdate(Buffer* out, uint32_t streamId, uint32_t increment)
+{
+    appendFrameHeader(out, 4, kFrameWindowUpdate, 0, streamId);
+    appendUint32(out, increment);
+}
+
+} // namespace http2
+} // namespace http
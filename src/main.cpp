@@ -2,52 +2,75 @@
 #include <muduo/net/InetAddress.h>
 #include <muduo/base/Logging.h>
 
+#include "http/AccessLog.h"
+#include "http/ConcurrencyLimiter.h"
+#include "http/CorsFilter.h"
 #include "http/HttpServer.h"
 #include "http/HttpRequest.h"
 #include "http/HttpResponse.h"
+#include "http/Middleware.h"
+#include "http/RateLimiter.h"
+#include "http/ResponseCache.h"
+#include "http/Router.h"
+#include "http/TrafficCapture.h"
+#include "auth/AuthGuard.h"
+#include "auth/HashExecutor.h"
+#include "auth/LoginThrottle.h"
+#include "auth/PasswordHasher.h"
+#include "auth/SessionStore.h"
+#include "auth/TokenService.h"
 #include "controller/UserController.h"
 #include "db/DbConnectionPool.h"
+#include "db/MockBackend.h"
+#include "metrics/Metrics.h"
+#include "tls/TlsContext.h"
+#include "websocket/WebSocketHub.h"
 
+#include <algorithm>
 #include <functional>
-#include <map>
+#include <memory>
+#include <stdlib.h>
 #include <string>
+#include <unistd.h>
+#include <vector>
 
 using namespace muduo;
 using namespace muduo::net;
 using namespace http;
 
-// 定义路由处理函数的类型
-using HttpHandler = std::function<void(const HttpRequest&, HttpResponse*)>;
-
 // 全局路由表：把 URL 字符串映射到具体的处理函数
 // 例如："/api/user/login" -> UserController::login
-std::map<std::string, HttpHandler> g_router;
+Router g_router;
 
-// ----------------------------------------------------------
-// 核心分发器：HttpServer 收到请求后会调用这个函数
-// ----------------------------------------------------------
-void dispatchRequest(const HttpRequest& req, HttpResponse* resp)
+// 从环境变量读取整数配置，没设置就用默认值
+static int getEnvInt(const char* name, int defaultValue)
 {
-    std::string path = req.path();
-    
-    // 打印日志，方便调试
-    LOG_INFO << "Received Request: " << req.method() << " " << path;
+    const char* value = ::getenv(name);
+    return value ? ::atoi(value) : defaultValue;
+}
 
-    // 在路由表里查找有没有对应的处理器
-    auto it = g_router.find(path);
-    if (it != g_router.end())
-    {
-        // 找到了！调用对应的函数（比如 UserController::login）
-        it->second(req, resp);
-    }
-    else
+// 逗号分隔的环境变量拆成列表 (去掉首尾空格，跳过空项)
+static std::vector<std::string> splitEnvList(const std::string& list)
+{
+    std::vector<std::string> items;
+    size_t start = 0;
+    while (start < list.size())
     {
-        // 没找到，返回 404
-        resp->setStatusCode(HttpResponse::k404NotFound);
-        resp->setStatusMessage("Not Found");
-        resp->setBody("404 Not Found: " + path);
-        resp->setCloseConnection(true);
+        size_t end = list.find(',', start);
+        if (end == std::string::npos)
+        {
+            end = list.size();
+        }
+        std::string item = list.substr(start, end - start);
+        item.erase(0, item.find_first_not_of(' '));
+        item.erase(item.find_last_not_of(' ') + 1);
+        if (!item.empty())
+        {
+            items.push_back(item);
+        }
+        start = end + 1;
     }
+    return items;
 }
 
 int main(int argc, char* argv[])
@@ -63,45 +86,549 @@ int main(int argc, char* argv[])
     // 注意：请确保你的 MySQL 容器正在运行，且密码是 123456
     // 参数顺序通常是: host, user, password, dbname, port, poolSize
     // 如果你的 init 函数参数不一样，请根据 DbConnectionPool.h 修改这里
+    // SENTINEL_DB_BACKEND=mock 时使用进程内的内存数据库 (压测/CI 不需要 MySQL)：
+    // 表结构和数据从 SENTINEL_DB_SEED (默认 sql/init.sql) 加载，
+    // SENTINEL_DB_LATENCY_US / SENTINEL_DB_JITTER_US 注入每次查询的延迟
+    // 读写分离：SENTINEL_DB_REPLICAS 配只读副本，MySQL 下是逗号分隔的地址 (如 tcp://127.0.0.1:3307)，
+    // 账号和库名同主库；mock 下是副本个数 (共享同一份内存数据)。副本复制延迟超过
+    // SENTINEL_DB_REPLICA_MAX_LAG 秒 (默认 5) 时不接读请求；SENTINEL_DB_REPLICA_LAG_QUERY 改查延迟的语句
+    // (MySQL 8.0.22 之前用 "SHOW SLAVE STATUS")
+    db::DbConnectionPool::ReplicaOptions replicaOptions;
+    replicaOptions.maxLagSeconds = getEnvInt("SENTINEL_DB_REPLICA_MAX_LAG", replicaOptions.maxLagSeconds);
+    if (const char* lagQuery = ::getenv("SENTINEL_DB_REPLICA_LAG_QUERY"))
+    {
+        replicaOptions.lagQuery = lagQuery;
+    }
+    const char* replicas = ::getenv("SENTINEL_DB_REPLICAS");
     try {
-        db::DbConnectionPool::getInstance().init(
-            "127.0.0.1",       // 数据库IP (因为用了 --network host)
-            "root",            // 用户名
-            "123456",          // 密码
-            "smart_sentinel_db", // 数据库名
-            10                 // 连接池大小
-        );
+        const char* backend = ::getenv("SENTINEL_DB_BACKEND");
+        if (backend && std::string(backend) == "mock")
+        {
+            const char* seed = ::getenv("SENTINEL_DB_SEED");
+            auto database = std::make_shared<db::MockDatabase>();
+            database->loadSeedFile(seed ? seed : "sql/init.sql");
+
+            db::MockBackend::Options options;
+            options.latencyUs = getEnvInt("SENTINEL_DB_LATENCY_US", 0);
+            options.jitterUs = getEnvInt("SENTINEL_DB_JITTER_US", 0);
+            db::DbConnectionPool::getInstance().init([database, options]
+            {
+                return std::make_shared<db::DbConnection>(
+                    std::unique_ptr<db::DbBackend>(new db::MockBackend(database, options)));
+            }, 10);
+
+            // 内存数据库没有复制，不查延迟
+            replicaOptions.lagQuery.clear();
+            int replicaCount = replicas ? ::atoi(replicas) : 0;
+            for (int i = 0; i < replicaCount; ++i)
+            {
+                db::DbConnectionPool::getInstance().addReplica("replica" + std::to_string(i + 1), [database, options]
+                {
+                    return std::make_shared<db::DbConnection>(
+                        std::unique_ptr<db::DbBackend>(new db::MockBackend(database, options)));
+                }, 10, replicaOptions);
+            }
+        }
+        else
+        {
+            db::DbConnectionPool::getInstance().init(
+                "127.0.0.1",       // 数据库IP (因为用了 --network host)
+                "root",            // 用户名
+                "123456",          // 密码
+                "smart_sentinel_db", // 数据库名
+                10                 // 连接池大小
+            );
+            for (const std::string& host : splitEnvList(replicas ? replicas : ""))
+            {
+                db::DbConnectionPool::getInstance().addReplica(
+                    host, host, "root", "123456", "smart_sentinel_db", 10, replicaOptions);
+            }
+        }
         LOG_INFO << "Database initialized successfully.";
     } catch (const std::exception& e) {
         LOG_FATAL << "Database init failed: " << e.what();
     }
 
+    // 查询结果缓存：SENTINEL_QUERY_CACHE=1 开启，DbConnectionPool::executeCachedQuery 的读在请求之间共享结果，
+    // 写语句按表让缓存失效；SENTINEL_QUERY_CACHE_MAX 限制条数
+    std::unique_ptr<db::QueryCache> queryCache;
+    if (getEnvInt("SENTINEL_QUERY_CACHE", 0) != 0)
+    {
+        db::QueryCache::Options options;
+        options.maxEntries = static_cast<size_t>(std::max(1, getEnvInt("SENTINEL_QUERY_CACHE_MAX", static_cast<int>(options.maxEntries))));
+        queryCache.reset(new db::QueryCache(options));
+        db::DbConnectionPool::getInstance().setQueryCache(queryCache.get());
+    }
+
     // ------------------------------------------------------
     // 2. 初始化 Controller (业务逻辑控制器)
     // ------------------------------------------------------
     UserController userController;
 
+    // 登录失败计数：同一用户名 SENTINEL_LOGIN_MAX_FAILURES 次 (默认 5)、同一 IP SENTINEL_LOGIN_MAX_IP_FAILURES 次
+    // (默认 20) 失败后，SENTINEL_LOGIN_FAILURE_WINDOW 秒 (默认 300) 的滑动窗口内直接回 429，不再查数据库
+    auth::LoginThrottle::Options throttleOptions;
+    throttleOptions.maxFailuresPerUser = getEnvInt("SENTINEL_LOGIN_MAX_FAILURES", throttleOptions.maxFailuresPerUser);
+    throttleOptions.maxFailuresPerIp = getEnvInt("SENTINEL_LOGIN_MAX_IP_FAILURES", throttleOptions.maxFailuresPerIp);
+    throttleOptions.windowSeconds = getEnvInt("SENTINEL_LOGIN_FAILURE_WINDOW", throttleOptions.windowSeconds);
+    auth::LoginThrottle loginThrottle(throttleOptions);
+    userController.setLoginThrottle(&loginThrottle);
+
+    // 密码哈希：scrypt 成本参数 SENTINEL_SCRYPT_LN / _R / _P (默认 14/8/1，约 16MB 内存、几十毫秒)，
+    // 用 sentinel_kdfbench 测每个参数下单核每秒能处理多少次登录再调。KDF 在单独的线程里算：
+    // SENTINEL_HASH_THREADS 个线程 (默认 CPU 数的一半) 同时算，最多排队 SENTINEL_HASH_QUEUE 个，满了回 503
+    auth::PasswordHasher::Params hashParams;
+    hashParams.logN = getEnvInt("SENTINEL_SCRYPT_LN", hashParams.logN);
+    hashParams.r = getEnvInt("SENTINEL_SCRYPT_R", hashParams.r);
+    hashParams.p = getEnvInt("SENTINEL_SCRYPT_P", hashParams.p);
+    auth::PasswordHasher passwordHasher(hashParams);
+    auth::HashExecutor::Options hashOptions;
+    hashOptions.threads = getEnvInt("SENTINEL_HASH_THREADS",
+                                    std::max(1, static_cast<int>(::sysconf(_SC_NPROCESSORS_ONLN)) / 2));
+    hashOptions.maxQueueSize = static_cast<size_t>(getEnvInt("SENTINEL_HASH_QUEUE", 64));
+    auth::HashExecutor hashExecutor(hashOptions);
+    hashExecutor.start();
+    userController.setPasswordHashing(&passwordHasher, &hashExecutor);
+
+    // 登录令牌：HMAC-SHA256 签名，密钥来自 SENTINEL_TOKEN_SECRET，有效期 SENTINEL_TOKEN_TTL 秒 (默认 1 天)。
+    // 多实例部署必须配置同一个密钥；不配置时随机生成，重启后所有令牌失效
+    auth::TokenService::Options tokenOptions;
+    const char* tokenSecret = ::getenv("SENTINEL_TOKEN_SECRET");
+    if (tokenSecret && *tokenSecret)
+    {
+        tokenOptions.secret = tokenSecret;
+    }
+    else
+    {
+        LOG_WARN << "SENTINEL_TOKEN_SECRET not set, using a random token key (tokens will not survive a restart)";
+    }
+    tokenOptions.ttlSeconds = getEnvInt("SENTINEL_TOKEN_TTL", tokenOptions.ttlSeconds);
+    auth::TokenService tokenService(tokenOptions);
+    userController.setTokenService(&tokenService);
+
+    // 服务端会话 (SENTINEL_SESSIONS=1 开启)：需要随时踢人下线的部署用，登录时另外下发会话 Cookie。
+    // SENTINEL_SESSION_SHARDS 个分片 (默认 16)，空闲 SENTINEL_SESSION_IDLE_TIMEOUT 秒 (默认 1800) 过期，
+    // 最多 SENTINEL_SESSION_MAX 个 (默认 100000，超过淘汰最久没用的)；
+    // 设置 SENTINEL_SESSION_SNAPSHOT=文件路径 后每 SENTINEL_SESSION_SNAPSHOT_INTERVAL 秒 (默认 60) 存一次盘，重启时读回
+    // 会话 Cookie 在开了 TLS (见下面的 SENTINEL_TLS_CERT) 时带 Secure；TLS 由前置代理终结时设置 SENTINEL_SESSION_SECURE_COOKIE=1
+    std::unique_ptr<auth::SessionStore> sessionStore;
+    if (getEnvInt("SENTINEL_SESSIONS", 0) != 0)
+    {
+        auth::SessionStore::Options options;
+        options.shards = getEnvInt("SENTINEL_SESSION_SHARDS", options.shards);
+        options.idleTimeoutSeconds = getEnvInt("SENTINEL_SESSION_IDLE_TIMEOUT", options.idleTimeoutSeconds);
+        options.maxSessions = static_cast<size_t>(getEnvInt("SENTINEL_SESSION_MAX", static_cast<int>(options.maxSessions)));
+        if (const char* snapshot = ::getenv("SENTINEL_SESSION_SNAPSHOT"))
+        {
+            options.snapshotPath = snapshot;
+        }
+        options.snapshotIntervalSeconds = getEnvInt("SENTINEL_SESSION_SNAPSHOT_INTERVAL", options.snapshotIntervalSeconds);
+        sessionStore.reset(new auth::SessionStore(options));
+        if (!options.snapshotPath.empty())
+        {
+            sessionStore->loadSnapshot(options.snapshotPath);
+        }
+        sessionStore->start();
+        bool tlsEnabled = ::getenv("SENTINEL_TLS_CERT") && ::getenv("SENTINEL_TLS_KEY");
+        userController.setSessionStore(sessionStore.get(), getEnvInt("SENTINEL_SESSION_SECURE_COOKIE", tlsEnabled ? 1 : 0) != 0);
+    }
+    auth::AuthGuard authGuard(&tokenService, sessionStore.get());
+
     // ------------------------------------------------------
     // 3. 注册路由 (手动把 URL 和函数绑定起来)
     // ------------------------------------------------------
     // 绑定 /api/user/login 到 userController.login
-    g_router["/api/user/login"] = std::bind(&UserController::login, &userController, std::placeholders::_1, std::placeholders::_2);
+    g_router.addRoute("/api/user/login", std::bind(&UserController::login, &userController, std::placeholders::_1, std::placeholders::_2));
+    // 需要登录的接口：AuthGuard 只验令牌签名，不查数据库
+    g_router.addRoute("/api/user/me", authGuard.protect(std::bind(&UserController::me, &userController, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3)));
+    g_router.addRoute("/api/user/logout", authGuard.protect(std::bind(&UserController::logout, &userController, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3)));
     
+    // 绑定 /metrics 到 Prometheus 文本格式的指标输出
+    g_router.addRoute("/metrics", [](const HttpRequest&, HttpResponse* resp)
+    {
+        resp->setStatusCode(HttpResponse::k200Ok);
+        resp->setStatusMessage("OK");
+        resp->setContentType("text/plain; version=0.0.4");
+        resp->setBody(metrics::MetricsRegistry::instance().renderPrometheus());
+    });
+
+    // 告警推送：检测端 POST 告警 JSON，广播给所有订阅 /ws/alerts 的看板，看板不用再轮询。
+    // 发布需要登录 (检测端带 Bearer 令牌)，否则任何人都能往所有看板上推假告警
+    websocket::WebSocketHub alertHub;
+    g_router.addRoute("/api/alert/publish", authGuard.protect([&alertHub](const HttpRequest& req, const auth::TokenClaims&,
+                                                                         HttpResponse* resp)
+    {
+        resp->setContentType("application/json");
+        if (req.method() != HttpRequest::kPost || req.getBody().empty())
+        {
+            resp->setStatusCode(HttpResponse::k400BadRequest);
+            resp->setStatusMessage("Bad Request");
+            resp->setBody("{\"code\":400,\"msg\":\"POST an alert body\"}");
+            return;
+        }
+        alertHub.broadcast(req.getBody());
+        resp->setStatusCode(HttpResponse::k200Ok);
+        resp->setStatusMessage("OK");
+        resp->setBody("{\"code\":200,\"subscribers\":" + std::to_string(alertHub.subscribers()) + "}");
+    }));
+
     // 如果你写了注册功能，可以在这里解开注释
-    // g_router["/api/user/register"] = std::bind(&UserController::registerUser, &userController, _1, _2);
+    // g_router.addRoute("/api/user/register", std::bind(&UserController::registerUser, &userController, _1, _2));
+
+    // ------------------------------------------------------
+    // 3.5 服务器用到的组件
+    // ------------------------------------------------------
+    // HttpServer 只保存这些对象的指针：都在 server 之前构造，退出时 server 先析构，
+    // 它的 I/O 线程停下之前这些对象一直有效。在下面按配置挂到 server 上
+
+    // 中间件链：横切的逻辑 (日志、异常兜底……) 统一在这里挂，不再写进各个业务函数。
+    // 链在启动时组装一次，请求路径上只是遍历函数指针数组；业务抛出的异常在链里回 500。
+    // SENTINEL_SLOW_REQUEST_MS (默认 1000，0 关闭)：超过这个耗时的请求记一条 WARN
+    MiddlewareChain middleware;
+    int slowRequestMs = getEnvInt("SENTINEL_SLOW_REQUEST_MS", 1000);
+    SlowRequestLogger slowRequestLogger(slowRequestMs);
+    if (slowRequestMs > 0)
+    {
+        middleware.use(&slowRequestLogger);
+    }
+
+    // 响应缓存：按路由开启，只缓存 GET 的 200 响应；并发未命中只执行一次业务，过期后先回旧内容再在后台刷新。
+    // /metrics 缓存 SENTINEL_METRICS_CACHE_MS 毫秒 (默认 1000，0 关闭)，多个抓取方同时来时只渲染一次；
+    // 以后读多写少的接口 (摄像头列表、看板汇总……) 在这里 addRoute，按用户区分的接口记得把 Authorization 放进 varyHeaders
+    // 缓存在后台刷新时直接调用路由，不经过它后面的中间件：responseCache 必须是最后 use 的中间件
+    ResponseCache responseCache(ResponseCache::Options(),
+                                std::bind(&Router::dispatch, &g_router, std::placeholders::_1, std::placeholders::_2));
+    int metricsCacheMs = getEnvInt("SENTINEL_METRICS_CACHE_MS", 1000);
+    if (metricsCacheMs > 0)
+    {
+        ResponseCache::RouteOptions metricsCache;
+        metricsCache.ttlMs = metricsCacheMs;
+        metricsCache.staleMs = metricsCacheMs;
+        responseCache.addRoute("/metrics", metricsCache);
+        middleware.use(&responseCache);
+    }
+
+    // CORS：预检请求在服务端直接回预先渲染好的响应，不进路由。
+    // SENTINEL_CORS=0 关闭；SENTINEL_CORS_ORIGINS 允许的来源，逗号分隔 (默认 "*")；
+    // SENTINEL_CORS_MAX_AGE 浏览器缓存预检结果的秒数 (默认 600)；SENTINEL_CORS_CREDENTIALS=1 允许带 Cookie (会话认证时需要)，
+    // 此时必须用 SENTINEL_CORS_ORIGINS 写明来源，否则拒绝启动
+    CorsFilter::Policy corsPolicy;
+    if (const char* origins = ::getenv("SENTINEL_CORS_ORIGINS"))
+    {
+        corsPolicy.origins = splitEnvList(origins);
+    }
+    corsPolicy.maxAgeSeconds = getEnvInt("SENTINEL_CORS_MAX_AGE", corsPolicy.maxAgeSeconds);
+    corsPolicy.credentials = getEnvInt("SENTINEL_CORS_CREDENTIALS", 0) != 0;
+    if (corsPolicy.credentials &&
+        std::find(corsPolicy.origins.begin(), corsPolicy.origins.end(), "*") != corsPolicy.origins.end())
+    {
+        LOG_FATAL << "SENTINEL_CORS_CREDENTIALS=1 requires SENTINEL_CORS_ORIGINS to list explicit origins";
+    }
+    CorsFilter cors(corsPolicy);
+    // 登录只接受 POST
+    CorsFilter::Policy loginCorsPolicy = corsPolicy;
+    loginCorsPolicy.methods = "POST, OPTIONS";
+    cors.setRoutePolicy("/api/user/login", loginCorsPolicy);
+
+    // 自适应并发限制：默认开启 (SENTINEL_ADAPTIVE_LIMIT=0 关闭)，SENTINEL_CONCURRENCY_MAX 为上限的上限。
+    // 指标接口永远放行；登录要等数据库，数据库变慢时最先被挡掉
+    ConcurrencyLimiter::Options limiterOptions;
+    limiterOptions.maxLimit = getEnvInt("SENTINEL_CONCURRENCY_MAX", limiterOptions.maxLimit);
+    ConcurrencyLimiter limiter(limiterOptions);
+    limiter.setRoutePriority("/metrics", ConcurrencyLimiter::kHigh);
+    limiter.setRoutePriority("/api/user/login", ConcurrencyLimiter::kLow);
+
+    // 按客户端 IP 限流：默认开启 (SENTINEL_RATE_LIMIT=0 关闭)。普通接口每个 IP 每秒
+    // SENTINEL_RATE_LIMIT_RPS 个请求、突发 SENTINEL_RATE_LIMIT_BURST 个；登录单独一个更紧的桶，
+    // 挡住撞库脚本，不让单个客户端占满数据库连接池
+    RateLimiter rateLimiter(RateLimiter::Rule{ static_cast<double>(getEnvInt("SENTINEL_RATE_LIMIT_RPS", 100)),
+                                               getEnvInt("SENTINEL_RATE_LIMIT_BURST", 200) });
+    rateLimiter.setRouteRule("/api/user/login",
+                             RateLimiter::Rule{ static_cast<double>(getEnvInt("SENTINEL_LOGIN_RATE_LIMIT_RPS", 5)),
+                                                getEnvInt("SENTINEL_LOGIN_RATE_LIMIT_BURST", 10) });
+
+    // 按环境变量可选开启的组件，在下面配置 server 的地方创建
+    std::unique_ptr<tls::TlsContext> tlsContext;
+    std::unique_ptr<AccessLog> accessLog;
+    std::unique_ptr<TrafficCapture> capture;
 
     // ------------------------------------------------------
     // 4. 启动 HTTP 服务器
     // ------------------------------------------------------
     EventLoop loop;
     InetAddress addr(8083); // 监听 8083 端口
-    HttpServer server(&loop, addr, "SmartSentinel");
+    // SENTINEL_REUSEPORT_LISTENERS > 1 时使用 SO_REUSEPORT 多 acceptor 模式：
+    // 每个 listener 一个 loop，accept 和 I/O 都不再经过单个主线程
+    int reusePortListeners = getEnvInt("SENTINEL_REUSEPORT_LISTENERS", 0);
+    HttpServer server(&loop, addr, "SmartSentinel",
+                      reusePortListeners > 1 ? TcpServer::kReusePort : TcpServer::kNoReusePort);
 
-    // 设置回调函数为上面的 dispatchRequest
-    server.setHttpCallback(dispatchRequest);
+    // 设置回调函数为路由表的分发函数
+    server.setHttpCallback(std::bind(&Router::dispatch, &g_router, std::placeholders::_1, std::placeholders::_2));
+    server.setRouteMatcher(std::bind(&Router::hasRoute, &g_router, std::placeholders::_1));
+    server.setMiddleware(&middleware);
+
+    if (getEnvInt("SENTINEL_CORS", 1) != 0)
+    {
+        server.setCors(&cors);
+    }
     
-    // 设置线程数 (根据你的 CPU 核心数调整，0 表示只有主线程)
-    server.setThreadNum(4); 
+    if (reusePortListeners > 1)
+    {
+        // SENTINEL_CPU_STEERING=1 时按收包 CPU 分配连接，并把 listener 绑核
+        server.setReusePortListeners(reusePortListeners,
+                                     getEnvInt("SENTINEL_CPU_STEERING", 0) != 0);
+    }
+    else
+    {
+        // 设置线程数 (根据你的 CPU 核心数调整，0 表示只有主线程)
+        server.setThreadNum(4); 
+    }
+
+    // 输出背压：单连接积压超过 64KB 就暂停读取，所有连接合计不超过 64MB
+    server.setHighWaterMark(64 * 1024);
+    server.setOutputBudget(64 * 1024 * 1024);
+
+    // 背压状态在 /metrics 抓取时读取
+    metrics::MetricsRegistry& registry = metrics::MetricsRegistry::instance();
+    registry.registerGauge("sentinel_output_pending_bytes", "Bytes queued in connection output buffers.",
+                           [&server] { return static_cast<double>(server.backpressureStats().pendingOutputBytes); });
+    registry.registerGauge("sentinel_output_paused_connections", "Connections paused by output backpressure.",
+                           [&server] { return static_cast<double>(server.backpressureStats().pausedConnections); });
+    registry.registerCounter("sentinel_output_high_water_mark_events_total", "Times a connection crossed the output high-water mark.",
+                             [&server] { return static_cast<double>(server.backpressureStats().highWaterMarkEvents); });
+    registry.registerCounter("sentinel_output_budget_exceeded_events_total", "Times the global output budget paused a connection.",
+                             [&server] { return static_cast<double>(server.backpressureStats().budgetExceededEvents); });
+
+    // WebSocket：看板连上 /ws/alerts 后订阅告警广播。
+    // 浏览器发起的握手必须来自本站 (Origin 和 Host 一致) 或 SENTINEL_WS_ORIGINS 列出的来源 (逗号分隔)，
+    // 防止别的网站借用户的 Cookie 订阅；不带 Origin 的非浏览器客户端不受影响
+    const char* wsOrigins = ::getenv("SENTINEL_WS_ORIGINS");
+    std::vector<std::string> webSocketOrigins = splitEnvList(wsOrigins ? wsOrigins : "");
+    websocket::WebSocketHandler alertHandler;
+    alertHandler.accept = [webSocketOrigins](const HttpRequest& req)
+    {
+        const std::string& origin = req.getHeader("Origin");
+        if (origin.empty())
+        {
+            return true;
+        }
+        const std::string& host = req.getHeader("Host");
+        if (!host.empty() && (origin == "http://" + host || origin == "https://" + host))
+        {
+            return true;
+        }
+        return std::find(webSocketOrigins.begin(), webSocketOrigins.end(), origin) != webSocketOrigins.end();
+    };
+    alertHandler.onOpen = [&alertHub](const websocket::WebSocketConnectionPtr& ws, const HttpRequest&)
+    {
+        alertHub.subscribe(ws);
+    };
+    alertHandler.onClose = [&alertHub](const websocket::WebSocketConnectionPtr& ws)
+    {
+        alertHub.unsubscribe(ws);
+    };
+    server.addWebSocketRoute("/ws/alerts", alertHandler);
+    registry.registerGauge("sentinel_websocket_connections", "Open WebSocket connections.",
+                           [&server] { return static_cast<double>(server.webSocketConnections()); });
+    registry.registerGauge("sentinel_alert_subscribers", "WebSocket connections subscribed to alerts.",
+                           [&alertHub] { return static_cast<double>(alertHub.subscribers()); });
+    registry.registerCounter("sentinel_alert_frames_delivered_total", "Alert frames written to subscribers.",
+                             [&alertHub] { return static_cast<double>(alertHub.delivered()); });
+    registry.registerCounter("sentinel_alert_frames_dropped_total", "Alert frames skipped for backlogged subscribers.",
+                             [&alertHub] { return static_cast<double>(alertHub.dropped()); });
+
+    // h2c：默认开启，SENTINEL_HTTP2=0 关闭
+    server.setHttp2Enabled(getEnvInt("SENTINEL_HTTP2", 1) != 0);
+    registry.registerGauge("sentinel_http2_connections", "Connections currently speaking HTTP/2.",
+                           [&server] { return static_cast<double>(server.http2Stats().activeConnections); });
+    registry.registerCounter("sentinel_http2_connections_total", "Connections switched to HTTP/2 (prior knowledge or Upgrade).",
+                             [&server] { return static_cast<double>(server.http2Stats().totalConnections); });
+    registry.registerCounter("sentinel_http2_streams_total", "HTTP/2 request streams served.",
+                             [&server] { return static_cast<double>(server.http2Stats().totalStreams); });
+
+    // 请求截止时间：默认 SENTINEL_REQUEST_TIMEOUT_MS (10 秒)，登录走数据库，单独用 SENTINEL_LOGIN_TIMEOUT_MS；
+    // 客户端可以用 X-Request-Timeout 头 (毫秒) 改得更短。等数据库连接超时回 503，查询超时回 504
+    server.setDefaultRequestTimeout(getEnvInt("SENTINEL_REQUEST_TIMEOUT_MS", 10000));
+    server.setRequestTimeout("/api/user/login", getEnvInt("SENTINEL_LOGIN_TIMEOUT_MS", 2000));
+    registry.registerCounter("sentinel_requests_expired_total", "Requests answered 503 because their deadline passed before dispatch.",
+                             [&server] { return static_cast<double>(server.expiredRequests()); });
+
+    if (getEnvInt("SENTINEL_ADAPTIVE_LIMIT", 1) != 0)
+    {
+        server.setConcurrencyLimiter(&limiter);
+    }
+    registry.registerGauge("sentinel_concurrency_limit", "Current adaptive concurrency limit.",
+                           [&limiter] { return static_cast<double>(limiter.limit()); });
+    registry.registerGauge("sentinel_concurrency_in_flight", "Requests currently admitted by the concurrency limiter.",
+                           [&limiter] { return static_cast<double>(limiter.inFlight()); });
+    registry.registerCounter("sentinel_concurrency_rejected_total", "Requests rejected with 503 by the concurrency limiter.",
+                             [&limiter] { return static_cast<double>(limiter.rejected()); });
+
+    if (getEnvInt("SENTINEL_RATE_LIMIT", 1) != 0)
+    {
+        server.setRateLimiter(&rateLimiter);
+    }
+    registry.registerCounter("sentinel_rate_limited_total", "Requests rejected with 429 by the per-client rate limiter.",
+                             [&rateLimiter] { return static_cast<double>(rateLimiter.rejected()); });
+    registry.registerCounter("sentinel_rate_limit_evictions_total", "Cold rate-limit buckets evicted to make room for new clients.",
+                             [&rateLimiter] { return static_cast<double>(rateLimiter.evictions()); });
+    registry.registerGauge("sentinel_password_hash_queued", "Password hashing jobs waiting for a hashing thread.",
+                           [&hashExecutor] { return static_cast<double>(hashExecutor.queued()); });
+    registry.registerCounter("sentinel_password_hash_rejected_total", "Logins answered 503 because the hashing queue was full.",
+                             [&hashExecutor] { return static_cast<double>(hashExecutor.rejected()); });
+    registry.registerCounter("sentinel_password_hash_timed_out_total", "Logins whose deadline passed while waiting for password hashing.",
+                             [&hashExecutor] { return static_cast<double>(hashExecutor.timedOut()); });
+    registry.registerCounter("sentinel_password_hash_failed_total", "Logins answered 503 because the password hashing task threw.",
+                             [&hashExecutor] { return static_cast<double>(hashExecutor.failed()); });
+    registry.registerCounter("sentinel_login_throttled_total", "Login attempts rejected with 429 after repeated failures.",
+                             [&loginThrottle] { return static_cast<double>(loginThrottle.blockedAttempts()); });
+    registry.registerCounter("sentinel_handler_exceptions_total", "Exceptions escaping handlers or middleware, answered with 500.",
+                             [&middleware] { return static_cast<double>(middleware.failures()); });
+    registry.registerCounter("sentinel_response_cache_hits_total", "Responses served from the route response cache (including coalesced waits).",
+                             [&responseCache] { return static_cast<double>(responseCache.hits()); });
+    registry.registerCounter("sentinel_response_cache_stale_total", "Stale cached responses served while a refresh ran in the background.",
+                             [&responseCache] { return static_cast<double>(responseCache.staleHits()); });
+    registry.registerCounter("sentinel_response_cache_misses_total", "Cacheable requests that ran the handler.",
+                             [&responseCache] { return static_cast<double>(responseCache.misses()); });
+    registry.registerCounter("sentinel_response_cache_coalesced_total", "Concurrent misses that waited for another request's result.",
+                             [&responseCache] { return static_cast<double>(responseCache.coalesced()); });
+    registry.registerCounter("sentinel_tokens_rejected_total", "Bearer tokens rejected as malformed, forged, expired or revoked.",
+                             [&tokenService] { return static_cast<double>(tokenService.rejectedTokens()); });
+    registry.registerCounter("sentinel_tokens_revoked_total", "Tokens revoked by logout.",
+                             [&tokenService] { return static_cast<double>(tokenService.revokedTokens()); });
+    db::DbConnectionPool* dbPool = &db::DbConnectionPool::getInstance();
+    registry.registerGauge("sentinel_db_replicas_available", "Read replicas currently accepting reads.",
+                           [dbPool]
+                           {
+                               int available = 0;
+                               for (const auto& replica : dbPool->replicaStatus())
+                               {
+                                   available += replica.available ? 1 : 0;
+                               }
+                               return static_cast<double>(available);
+                           });
+    registry.registerGauge("sentinel_db_replica_max_lag_seconds", "Largest replication lag among read replicas (-1 when unknown).",
+                           [dbPool]
+                           {
+                               int lag = 0;
+                               for (const auto& replica : dbPool->replicaStatus())
+                               {
+                                   if (replica.lagSeconds < 0)
+                                   {
+                                       return -1.0;
+                                   }
+                                   lag = std::max(lag, replica.lagSeconds);
+                               }
+                               return static_cast<double>(lag);
+                           });
+    registry.registerCounter("sentinel_db_replica_reads_total", "Read connections borrowed from replicas.",
+                             [dbPool]
+                           {
+                               uint64_t reads = 0;
+                               for (const auto& replica : dbPool->replicaStatus())
+                               {
+                                   reads += replica.reads;
+                               }
+                               return static_cast<double>(reads);
+                           });
+    registry.registerCounter("sentinel_db_replica_fallbacks_total", "Reads sent to the primary because no replica was usable.",
+                             [dbPool] { return static_cast<double>(dbPool->replicaFallbacks()); });
+    if (queryCache)
+    {
+        db::QueryCache* cache = queryCache.get();
+        registry.registerGauge("sentinel_query_cache_entries", "Query results currently cached.",
+                               [cache] { return static_cast<double>(cache->size()); });
+        registry.registerCounter("sentinel_query_cache_hits_total", "Cached queries answered without borrowing a connection.",
+                                 [cache] { return static_cast<double>(cache->hits()); });
+        registry.registerCounter("sentinel_query_cache_misses_total", "Cached queries that ran against the database.",
+                                 [cache] { return static_cast<double>(cache->misses()); });
+        registry.registerCounter("sentinel_query_cache_invalidations_total", "Cached query results dropped because a table they read was written.",
+                                 [cache] { return static_cast<double>(cache->invalidations()); });
+    }
+    if (sessionStore)
+    {
+        auth::SessionStore* sessions = sessionStore.get();
+        registry.registerGauge("sentinel_sessions", "Server-side sessions currently stored.",
+                               [sessions] { return static_cast<double>(sessions->size()); });
+        registry.registerCounter("sentinel_sessions_expired_total", "Server-side sessions removed after their idle timeout.",
+                                 [sessions] { return static_cast<double>(sessions->expiredSessions()); });
+        registry.registerCounter("sentinel_session_evictions_total", "Least recently used sessions evicted at the session cap.",
+                                 [sessions] { return static_cast<double>(sessions->evictions()); });
+    }
+
+    // 大量空闲长连接 (推送订阅、IoT 设备) 时 SENTINEL_COMPACT_IDLE=1，空闲连接的缓冲区缩回初始大小；
+    // 每连接的常驻内存用 sentinel_idlebench 测
+    server.setCompactIdleConnections(getEnvInt("SENTINEL_COMPACT_IDLE", 0) != 0);
+
+    // TLS：设置 SENTINEL_TLS_CERT / SENTINEL_TLS_KEY (PEM) 后 8083 改为 HTTPS，不再需要前置的 TLS 代理；
+    // SENTINEL_TLS_TICKETS=0 关闭 session ticket (只用服务端 session 缓存恢复)。
+    // 本地测试用 tools/tls/gen-self-signed.sh 生成自签名证书
+    const char* tlsCert = ::getenv("SENTINEL_TLS_CERT");
+    const char* tlsKey = ::getenv("SENTINEL_TLS_KEY");
+    if (tlsCert && tlsKey)
+    {
+        tls::TlsContext::Options options;
+        options.certFile = tlsCert;
+        options.keyFile = tlsKey;
+        options.sessionTickets = getEnvInt("SENTINEL_TLS_TICKETS", 1) != 0;
+        options.http2 = getEnvInt("SENTINEL_HTTP2", 1) != 0;
+        try {
+            tlsContext.reset(new tls::TlsContext(options));
+        } catch (const std::exception& e) {
+            LOG_FATAL << "TLS init failed: " << e.what();
+        }
+        server.setTlsContext(tlsContext.get());
+
+        tls::TlsContext* ctx = tlsContext.get();
+        registry.registerCounter("sentinel_tls_handshakes_total", "Completed TLS handshakes.",
+                                 [ctx] { return static_cast<double>(ctx->handshakes()); });
+        registry.registerCounter("sentinel_tls_resumed_handshakes_total", "TLS handshakes resumed from a session ID or ticket.",
+                                 [ctx] { return static_cast<double>(ctx->resumedHandshakes()); });
+        registry.registerCounter("sentinel_tls_handshake_failures_total", "Failed TLS handshakes.",
+                                 [ctx] { return static_cast<double>(ctx->failedHandshakes()); });
+        registry.registerGauge("sentinel_tls_cached_sessions", "Sessions in the server-side TLS session cache.",
+                               [ctx] { return static_cast<double>(ctx->cachedSessions()); });
+    }
+
+    // 访问日志：设置 SENTINEL_ACCESS_LOG=文件名前缀 开启，
+    // SENTINEL_ACCESS_LOG_SAMPLE=N 表示每 N 条记一条，SENTINEL_ACCESS_LOG_RATE 为每秒上限
+    if (const char* accessLogBase = ::getenv("SENTINEL_ACCESS_LOG"))
+    {
+        AccessLog::Options options;
+        options.basename = accessLogBase;
+        options.sampleEvery = getEnvInt("SENTINEL_ACCESS_LOG_SAMPLE", 1);
+        options.maxPerSecond = getEnvInt("SENTINEL_ACCESS_LOG_RATE", 0);
+        accessLog.reset(new AccessLog(options));
+        accessLog->start();
+        server.setAccessLog(accessLog.get());
+
+        AccessLog* log = accessLog.get();
+        registry.registerCounter("sentinel_access_log_written_total", "Access log records written.",
+                                 [log] { return static_cast<double>(log->written()); });
+        registry.registerCounter("sentinel_access_log_dropped_total", "Access log records skipped by sampling or rate cap.",
+                                 [log] { return static_cast<double>(log->dropped()); });
+    }
+
+    // 流量抓取：设置 SENTINEL_CAPTURE=文件名前缀 开启，SENTINEL_CAPTURE_SAMPLE=N 表示每 N 个请求抓一个，
+    // 产出的 JSONL 可以用 sentinel_replay 回放。凭证类请求头和登录/注册请求体里的密码默认脱敏，
+    // SENTINEL_CAPTURE_REDACT=0 原样抓取 (只在测试环境用)
+    if (const char* captureBase = ::getenv("SENTINEL_CAPTURE"))
+    {
+        TrafficCapture::Options options;
+        options.basename = captureBase;
+        options.sampleEvery = getEnvInt("SENTINEL_CAPTURE_SAMPLE", 1);
+        options.redact = getEnvInt("SENTINEL_CAPTURE_REDACT", 1) != 0;
+        capture.reset(new TrafficCapture(options));
+        capture->start();
+        server.setTrafficCapture(capture.get());
+
+        TrafficCapture* tap = capture.get();
+        registry.registerCounter("sentinel_capture_requests_total", "Requests written to the traffic capture.",
+                                 [tap] { return static_cast<double>(tap->captured()); });
+        registry.registerCounter("sentinel_capture_skipped_total", "Requests skipped by capture sampling or size limit.",
+                                 [tap] { return static_cast<double>(tap->skipped()); });
+    }
 
     server.start();
     
@@ -110,5 +637,7 @@ int main(int argc, char* argv[])
     // 进入事件循环 (死循环，直到程序退出)
     loop.loop();
 
+    // 先停哈希线程池：取消的登录要把结果投递回 I/O 线程，这时候 loop 都还在
+    hashExecutor.stop();
     return 0;
 }
\ No newline at end of file
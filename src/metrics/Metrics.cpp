@@ -0,0 +1,443 @@
+#include "../../include/metrics/Metrics.h"
+
+#include <algorithm>
+#include <map>
+#include <math.h>
+#include <stdio.h>
+
+namespace http
+{
+namespace metrics
+{
+
+namespace
+{
+
+// Prometheus histogram 输出的 le 边界 (微秒)
+const uint64_t kBucketBoundsUs[] = {
+    100, 250, 500, 1000, 2500, 5000, 10000, 25000, 50000,
+    100000, 250000, 500000, 1000000, 2500000, 5000000, 10000000,
+};
+
+const double kQuantiles[] = { 0.5, 0.9, 0.99, 0.999 };
+
+// 标签值转义：反斜杠、双引号、换行
+std::string escapeLabel(const std::string& value)
+{
+    std::string out;
+    out.reserve(value.size());
+    for (char c : value)
+    {
+        if (c == '\\' || c == '"')
+        {
+            out += '\\';
+            out += c;
+        }
+        else if (c == '\n')
+        {
+            out += "\\n";
+        }
+        else
+        {
+            out += c;
+        }
+    }
+    return out;
+}
+
+void appendSeconds(std::string* out, uint64_t us)
+{
+    char buf[32];
+    snprintf(buf, sizeof buf, "%.6f", static_cast<double>(us) / 1e6);
+    out->append(buf);
+}
+
+void appendUint(std::string* out, uint64_t value)
+{
+    out->append(std::to_string(value));
+}
+
+void appendHeader(std::string* out, const char* name, const char* type, const char* help)
+{
+    out->append("# HELP ").append(name).append(" ").append(help).append("\n");
+    out->append("# TYPE ").append(name).append(" ").append(type).append("\n");
+}
+
+// 输出一个 histogram 序列；labels 为空或形如 `route="/x",status="200"`
+void appendHistogram(std::string* out, const char* name, const std::string& labels,
+                     const LatencyHistogram::Snapshot& snapshot)
+{
+    std::string prefix = labels.empty() ? "" : labels + ",";
+    for (uint64_t bound : kBucketBoundsUs)
+    {
+        out->append(name).append("_bucket{").append(prefix).append("le=\"");
+        appendSeconds(out, bound);
+        out->append("\"} ");
+        appendUint(out, snapshot.countAtOrBelow(bound));
+        out->append("\n");
+    }
+    out->append(name).append("_bucket{").append(prefix).append("le=\"+Inf\"} ");
+    appendUint(out, snapshot.count);
+    out->append("\n");
+
+    std::string braces = labels.empty() ? "" : "{" + labels + "}";
+    out->append(name).append("_sum").append(braces).append(" ");
+    appendSeconds(out, snapshot.sum);
+    out->append("\n");
+    out->append(name).append("_count").append(braces).append(" ");
+    appendUint(out, snapshot.count);
+    out->append("\n");
+}
+
+} // namespace
+
+// ==========================================================
+// LatencyHistogram
+// ==========================================================
+LatencyHistogram::LatencyHistogram()
+    : counts_(new std::atomic<uint64_t>[kBucketCount])
+    , count_(0)
+    , sum_(0)
+    , max_(0)
+{
+    for (int i = 0; i < kBucketCount; ++i)
+    {
+        counts_[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+int LatencyHistogram::bucketIndex(uint64_t value)
+{
+    if (value < static_cast<uint64_t>(kSubBuckets))
+    {
+        return static_cast<int>(value); // 第一段每个值一个桶，精确
+    }
+    int exponent = 63 - __builtin_clzll(value);
+    if (exponent > kMaxExponent)
+    {
+        return kBucketCount - 1;
+    }
+    int shift = exponent - kSubBucketBits;
+    int sub = static_cast<int>(value >> shift) - kSubBuckets;
+    return kSubBuckets + shift * kSubBuckets + sub;
+}
+
+uint64_t LatencyHistogram::bucketUpperBound(int index)
+{
+    if (index < kSubBuckets)
+    {
+        return static_cast<uint64_t>(index);
+    }
+    int shift = (index - kSubBuckets) / kSubBuckets;
+    int sub = (index - kSubBuckets) % kSubBuckets;
+    uint64_t lower = static_cast<uint64_t>(kSubBuckets + sub) << shift;
+    return lower + (static_cast<uint64_t>(1) << shift) - 1;
+}
+
+void LatencyHistogram::record(uint64_t value)
+{
+    // 只有所属线程写，load + store 即可，不需要原子 RMW
+    std::atomic<uint64_t>& bucket = counts_[bucketIndex(value)];
+    bucket.store(bucket.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    count_.store(count_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    sum_.store(sum_.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+    if (value > max_.load(std::memory_order_relaxed))
+    {
+        max_.store(value, std::memory_order_relaxed);
+    }
+}
+
+void LatencyHistogram::snapshotInto(Snapshot* snapshot) const
+{
+    for (int i = 0; i < kBucketCount; ++i)
+    {
+        snapshot->counts[i] += counts_[i].load(std::memory_order_relaxed);
+    }
+    snapshot->count += count_.load(std::memory_order_relaxed);
+    snapshot->sum += sum_.load(std::memory_order_relaxed);
+    snapshot->max = std::max(snapshot->max, max_.load(std::memory_order_relaxed));
+}
+
+void LatencyHistogram::Snapshot::merge(const Snapshot& other)
+{
+    for (int i = 0; i < kBucketCount; ++i)
+    {
+        counts[i] += other.counts[i];
+    }
+    count += other.count;
+    sum += other.sum;
+    max = std::max(max, other.max);
+}
+
+uint64_t LatencyHistogram::Snapshot::percentile(double q) const
+{
+    if (count == 0)
+    {
+        return 0;
+    }
+    uint64_t target = static_cast<uint64_t>(ceil(q * static_cast<double>(count)));
+    target = std::max<uint64_t>(target, 1);
+    uint64_t seen = 0;
+    for (int i = 0; i < kBucketCount; ++i)
+    {
+        seen += counts[i];
+        if (seen >= target)
+        {
+            return std::min(bucketUpperBound(i), max);
+        }
+    }
+    return max;
+}
+
+uint64_t LatencyHistogram::Snapshot::countAtOrBelow(uint64_t value) const
+{
+    uint64_t total = 0;
+    for (int i = 0; i < kBucketCount && bucketUpperBound(i) <= value; ++i)
+    {
+        total += counts[i];
+    }
+    return total;
+}
+
+// ==========================================================
+// MetricsRegistry
+// ==========================================================
+MetricsRegistry::ThreadShard* MetricsRegistry::localShard()
+{
+    thread_local ThreadShard* shard = nullptr;
+    if (!shard)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        shards_.emplace_back(new ThreadShard);
+        shard = shards_.back().get();
+    }
+    return shard;
+}
+
+MetricsRegistry::RouteSeries* MetricsRegistry::findSeries(ThreadShard* shard,
+                                                          const std::string& route,
+                                                          int status)
+{
+    // 查找只在本线程进行，不用加锁；只有新增序列时才需要和抓取线程互斥
+    auto it = shard->routes.find(route);
+    if (it != shard->routes.end())
+    {
+        for (auto& series : it->second)
+        {
+            if (series->status == status)
+            {
+                return series.get();
+            }
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(shard->mutex);
+    std::unique_ptr<RouteSeries> series(new RouteSeries);
+    series->status = status;
+    RouteSeries* raw = series.get();
+    shard->routes[route].push_back(std::move(series));
+    return raw;
+}
+
+void MetricsRegistry::observeRequest(const std::string& route, int status, int64_t latencyUs,
+                                     size_t requestBytes, size_t responseBytes)
+{
+    RouteSeries* series = findSeries(localShard(), route, status);
+    series->latency.record(static_cast<uint64_t>(std::max<int64_t>(latencyUs, 0)));
+    series->requests.fetch_add(1, std::memory_order_relaxed);
+    series->requestBytes.fetch_add(requestBytes, std::memory_order_relaxed);
+    series->responseBytes.fetch_add(responseBytes, std::memory_order_relaxed);
+}
+
+void MetricsRegistry::incInFlight()
+{
+    localShard()->inFlight.fetch_add(1, std::memory_order_relaxed);
+}
+
+void MetricsRegistry::decInFlight()
+{
+    localShard()->inFlight.fetch_sub(1, std::memory_order_relaxed);
+}
+
+void MetricsRegistry::observeDbWait(int64_t us)
+{
+    localShard()->dbWait.record(static_cast<uint64_t>(std::max<int64_t>(us, 0)));
+}
+
+void MetricsRegistry::observeDbQuery(int64_t us)
+{
+    localShard()->dbQuery.record(static_cast<uint64_t>(std::max<int64_t>(us, 0)));
+}
+
+void MetricsRegistry::observeTlsHandshake(int64_t us)
+{
+    localShard()->tlsHandshake.record(static_cast<uint64_t>(std::max<int64_t>(us, 0)));
+}
+
+void MetricsRegistry::observePasswordHashWait(int64_t us)
+{
+    localShard()->passwordHashWait.record(static_cast<uint64_t>(std::max<int64_t>(us, 0)));
+}
+
+void MetricsRegistry::observePasswordHash(int64_t us)
+{
+    localShard()->passwordHash.record(static_cast<uint64_t>(std::max<int64_t>(us, 0)));
+}
+
+void MetricsRegistry::registerGauge(const std::string& name, const std::string& help,
+                                    const GaugeFunc& func)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    gauges_.push_back(Gauge { name, help, func, "gauge" });
+}
+
+void MetricsRegistry::registerCounter(const std::string& name, const std::string& help,
+                                      const GaugeFunc& func)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    gauges_.push_back(Gauge { name, help, func, "counter" });
+}
+
+std::string MetricsRegistry::renderPrometheus()
+{
+    struct Aggregate
+    {
+        LatencyHistogram::Snapshot latency;
+        uint64_t                   requests = 0;
+        uint64_t                   requestBytes = 0;
+        uint64_t                   responseBytes = 0;
+    };
+
+    std::vector<ThreadShard*> shards;
+    std::vector<Gauge> gauges;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto& shard : shards_)
+        {
+            shards.push_back(shard.get());
+        }
+        gauges = gauges_;
+    }
+
+    // 合并所有线程分片 (按 route/status 排序，输出稳定)
+    std::map<std::pair<std::string, int>, Aggregate> routes;
+    LatencyHistogram::Snapshot dbWait;
+    LatencyHistogram::Snapshot dbQuery;
+    LatencyHistogram::Snapshot tlsHandshake;
+    LatencyHistogram::Snapshot passwordHashWait;
+    LatencyHistogram::Snapshot passwordHash;
+    int64_t inFlight = 0;
+    for (ThreadShard* shard : shards)
+    {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        for (auto& entry : shard->routes)
+        {
+            for (auto& series : entry.second)
+            {
+                Aggregate& agg = routes[std::make_pair(entry.first, series->status)];
+                series->latency.snapshotInto(&agg.latency);
+                agg.requests += series->requests.load(std::memory_order_relaxed);
+                agg.requestBytes += series->requestBytes.load(std::memory_order_relaxed);
+                agg.responseBytes += series->responseBytes.load(std::memory_order_relaxed);
+            }
+        }
+        inFlight += shard->inFlight.load(std::memory_order_relaxed);
+        shard->dbWait.snapshotInto(&dbWait);
+        shard->dbQuery.snapshotInto(&dbQuery);
+        shard->tlsHandshake.snapshotInto(&tlsHandshake);
+        shard->passwordHashWait.snapshotInto(&passwordHashWait);
+        shard->passwordHash.snapshotInto(&passwordHash);
+    }
+
+    std::string out;
+    out.reserve(4096 + routes.size() * 2048);
+
+    appendHeader(&out, "sentinel_http_requests_total", "counter", "Total HTTP requests handled.");
+    for (auto& entry : routes)
+    {
+        out.append("sentinel_http_requests_total{route=\"").append(escapeLabel(entry.first.first))
+           .append("\",status=\"").append(std::to_string(entry.first.second)).append("\"} ");
+        appendUint(&out, entry.second.requests);
+        out.append("\n");
+    }
+
+    appendHeader(&out, "sentinel_http_request_bytes_total", "counter", "HTTP request bytes received.");
+    for (auto& entry : routes)
+    {
+        out.append("sentinel_http_request_bytes_total{route=\"").append(escapeLabel(entry.first.first))
+           .append("\",status=\"").append(std::to_string(entry.first.second)).append("\"} ");
+        appendUint(&out, entry.second.requestBytes);
+        out.append("\n");
+    }
+
+    appendHeader(&out, "sentinel_http_response_bytes_total", "counter", "HTTP response bytes sent.");
+    for (auto& entry : routes)
+    {
+        out.append("sentinel_http_response_bytes_total{route=\"").append(escapeLabel(entry.first.first))
+           .append("\",status=\"").append(std::to_string(entry.first.second)).append("\"} ");
+        appendUint(&out, entry.second.responseBytes);
+        out.append("\n");
+    }
+
+    appendHeader(&out, "sentinel_http_request_duration_seconds", "histogram",
+                 "HTTP request latency from receive to response.");
+    for (auto& entry : routes)
+    {
+        std::string labels = "route=\"" + escapeLabel(entry.first.first) +
+                             "\",status=\"" + std::to_string(entry.first.second) + "\"";
+        appendHistogram(&out, "sentinel_http_request_duration_seconds", labels, entry.second.latency);
+    }
+
+    appendHeader(&out, "sentinel_http_request_latency_seconds", "summary",
+                 "HTTP request latency quantiles from HDR histograms.");
+    for (auto& entry : routes)
+    {
+        std::string labels = "route=\"" + escapeLabel(entry.first.first) +
+                             "\",status=\"" + std::to_string(entry.first.second) + "\"";
+        for (double q : kQuantiles)
+        {
+            char quantile[16];
+            snprintf(quantile, sizeof quantile, "%g", q);
+            out.append("sentinel_http_request_latency_seconds{").append(labels)
+               .append(",quantile=\"").append(quantile).append("\"} ");
+            appendSeconds(&out, entry.second.latency.percentile(q));
+            out.append("\n");
+        }
+        out.append("sentinel_http_request_latency_seconds_sum{").append(labels).append("} ");
+        appendSeconds(&out, entry.second.latency.sum);
+        out.append("\n");
+        out.append("sentinel_http_request_latency_seconds_count{").append(labels).append("} ");
+        appendUint(&out, entry.second.latency.count);
+        out.append("\n");
+    }
+
+    appendHeader(&out, "sentinel_http_requests_in_flight", "gauge", "HTTP requests currently being handled.");
+    out.append("sentinel_http_requests_in_flight ").append(std::to_string(inFlight)).append("\n");
+
+    appendHeader(&out, "sentinel_db_pool_wait_seconds", "histogram", "Time spent waiting for a pooled DB connection.");
+    appendHistogram(&out, "sentinel_db_pool_wait_seconds", "", dbWait);
+
+    appendHeader(&out, "sentinel_db_query_duration_seconds", "histogram", "DB query execution time.");
+    appendHistogram(&out, "sentinel_db_query_duration_seconds", "", dbQuery);
+
+    appendHeader(&out, "sentinel_tls_handshake_duration_seconds", "histogram", "TLS handshake time, full or resumed.");
+    appendHistogram(&out, "sentinel_tls_handshake_duration_seconds", "", tlsHandshake);
+
+    appendHeader(&out, "sentinel_password_hash_queue_seconds", "histogram", "Time password hashing jobs wait for a hashing thread.");
+    appendHistogram(&out, "sentinel_password_hash_queue_seconds", "", passwordHashWait);
+
+    appendHeader(&out, "sentinel_password_hash_duration_seconds", "histogram", "Password KDF execution time.");
+    appendHistogram(&out, "sentinel_password_hash_duration_seconds", "", passwordHash);
+
+    for (auto& gauge : gauges)
+    {
+        appendHeader(&out, gauge.name.c_str(), gauge.type, gauge.help.c_str());
+        char value[32];
+        snprintf(value, sizeof value, "%.17g", gauge.func());
+        out.append(gauge.name).append(" ").append(value).append("\n");
+    }
+    return out;
+}
+
+} // namespace metrics
+} // namespace http
@@ -0,0 +1,181 @@
+#include "../../include/tls/TlsConnection.h"
+#include "../../include/tls/TlsContext.h"
+
+#include <muduo/base/Logging.h>
+
+#include <openssl/err.h>
+#include <openssl/ssl.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+namespace http
+{
+namespace tls
+{
+
+namespace
+{
+
+// 一次 SSL_read 最多解出一个记录 (16KB)
+const size_t kReadChunk = 16 * 1024;
+
+} // namespace
+
+TlsConnection::TlsConnection(TlsContext* context)
+    : context_(context)
+    , ssl_(context->newSsl())
+    , rbio_(::BIO_new(::BIO_s_mem()))
+    , wbio_(::BIO_new(::BIO_s_mem()))
+    , handshakeDone_(false)
+    , peerClosed_(false)
+{
+    if (!ssl_ || !rbio_ || !wbio_)
+    {
+        // 内存不够：把建好的那部分释放掉，ok() 返回 false，调用方关闭连接
+        LOG_ERROR << "Creating TLS state failed: " << ::ERR_reason_error_string(::ERR_peek_error());
+        ::ERR_clear_error();
+        ::SSL_free(ssl_);
+        ::BIO_free(rbio_);
+        ::BIO_free(wbio_);
+        ssl_ = nullptr;
+        rbio_ = nullptr;
+        wbio_ = nullptr;
+        return;
+    }
+    // SSL 接管两个 BIO 的所有权，SSL_free 时一起释放
+    ::SSL_set_bio(ssl_, rbio_, wbio_);
+}
+
+TlsConnection::~TlsConnection()
+{
+    ::SSL_free(ssl_);
+}
+
+bool TlsConnection::onData(Buffer* in, Buffer* out)
+{
+    if (!ssl_)
+    {
+        return false;
+    }
+    while (in->readableBytes() > 0)
+    {
+        int n = ::BIO_write(rbio_, in->peek(), static_cast<int>(in->readableBytes()));
+        if (n <= 0)
+        {
+            return false;
+        }
+        in->retrieve(n);
+    }
+
+    if (!handshakeDone_)
+    {
+        if (!handshakeStart_.valid())
+        {
+            handshakeStart_ = Timestamp::now();
+        }
+        int ret = ::SSL_do_handshake(ssl_);
+        if (ret != 1)
+        {
+            int error = ::SSL_get_error(ssl_, ret);
+            drain(out); // 握手的下一步消息，或者失败时的告警
+            if (error == SSL_ERROR_WANT_READ || error == SSL_ERROR_WANT_WRITE)
+            {
+                return true;
+            }
+            LOG_DEBUG << "TLS handshake failed: " << ::ERR_reason_error_string(::ERR_peek_error());
+            ::ERR_clear_error();
+            context_->onHandshakeFailure();
+            return false;
+        }
+        handshakeDone_ = true;
+        context_->onHandshake(::SSL_session_reused(ssl_) == 1,
+                              Timestamp::now().microSecondsSinceEpoch() -
+                              handshakeStart_.microSecondsSinceEpoch());
+    }
+
+    // 解密：直接读进 plaintext_ 的可写区，不经过临时缓冲区
+    for (;;)
+    {
+        plaintext_.ensureWritableBytes(kReadChunk);
+        int n = ::SSL_read(ssl_, plaintext_.beginWrite(), static_cast<int>(plaintext_.writableBytes()));
+        if (n > 0)
+        {
+            plaintext_.hasWritten(n);
+            continue;
+        }
+        int error = ::SSL_get_error(ssl_, n);
+        if (error == SSL_ERROR_WANT_READ)
+        {
+            break;
+        }
+        if (error == SSL_ERROR_ZERO_RETURN)
+        {
+            peerClosed_ = true;
+            break;
+        }
+        drain(out);
+        ::ERR_clear_error();
+        return false;
+    }
+    // TLS 1.3 握手后的 NewSessionTicket、对 key update 的回应等
+    drain(out);
+    return true;
+}
+
+void TlsConnection::encrypt(const char* data, size_t len, Buffer* out)
+{
+    if (!ssl_)
+    {
+        return;
+    }
+    // 写进内存 BIO 不会出现 WANT_WRITE，一次就能写完
+    while (len > 0)
+    {
+        int n = ::SSL_write(ssl_, data, static_cast<int>(len));
+        if (n <= 0)
+        {
+            LOG_ERROR << "SSL_write failed: " << ::SSL_get_error(ssl_, n);
+            ::ERR_clear_error();
+            break;
+        }
+        data += n;
+        len -= n;
+    }
+    drain(out);
+}
+
+void TlsConnection::shutdown(Buffer* out)
+{
+    if (handshakeDone_)
+    {
+        ::SSL_shutdown(ssl_);
+        drain(out);
+    }
+}
+
+std::string TlsConnection::alpn() const
+{
+    const unsigned char* data = nullptr;
+    unsigned int len = 0;
+    ::SSL_get0_alpn_selected(ssl_, &data, &len);
+    return std::string(reinterpret_cast<const char*>(data), data ? len : 0);
+}
+
+void TlsConnection::drain(Buffer* out)
+{
+    size_t pending;
+    while ((pending = ::BIO_ctrl_pending(wbio_)) > 0)
+    {
+        out->ensureWritableBytes(pending);
+        int n = ::BIO_read(wbio_, out->beginWrite(), static_cast<int>(pending));
+        if (n <= 0)
+        {
+            break;
+        }
+        out->hasWritten(n);
+    }
+}
+
+} // namespace tls
+} // namespace http
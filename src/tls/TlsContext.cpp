@@ -0,0 +1,143 @@
+#include "../../include/tls/TlsContext.h"
+#include "../../include/metrics/Metrics.h"
+
+#include <muduo/base/Logging.h>
+
+#include <openssl/err.h>
+#include <openssl/ssl.h>
+
+#include <stdexcept>
+
+namespace http
+{
+namespace tls
+{
+
+namespace
+{
+
+const unsigned char kSessionIdContext[] = "SmartSentinel";
+
+// 取出 OpenSSL 错误队列里的第一条错误，并清空队列
+std::string lastError()
+{
+    unsigned long code = ::ERR_get_error();
+    ::ERR_clear_error();
+    if (code == 0)
+    {
+        return "unknown error";
+    }
+    char buf[256];
+    ::ERR_error_string_n(code, buf, sizeof buf);
+    return buf;
+}
+
+// ALPN：按服务端的优先级在客户端列表里选；都不支持时不选，按 HTTP/1.1 处理
+int selectAlpn(SSL*, const unsigned char** out, unsigned char* outlen,
+               const unsigned char* in, unsigned int inlen, void* arg)
+{
+    const std::string* protocols = static_cast<const std::string*>(arg);
+    unsigned char* selected = nullptr;
+    if (::SSL_select_next_proto(&selected, outlen,
+                                reinterpret_cast<const unsigned char*>(protocols->data()),
+                                static_cast<unsigned int>(protocols->size()),
+                                in, inlen) != OPENSSL_NPN_NEGOTIATED)
+    {
+        return SSL_TLSEXT_ERR_NOACK;
+    }
+    *out = selected;
+    return SSL_TLSEXT_ERR_OK;
+}
+
+} // namespace
+
+TlsContext::TlsContext(const Options& options)
+    : ctx_(::SSL_CTX_new(::TLS_server_method()))
+    , handshakes_(0)
+    , resumed_(0)
+    , failures_(0)
+{
+    if (!ctx_)
+    {
+        throw std::runtime_error("SSL_CTX_new: " + lastError());
+    }
+
+    ::SSL_CTX_set_min_proto_version(ctx_, TLS1_2_VERSION);
+    // 空闲连接不占着读写记录用的缓冲区
+    ::SSL_CTX_set_mode(ctx_, SSL_MODE_RELEASE_BUFFERS);
+    ::SSL_CTX_set_options(ctx_, SSL_OP_CIPHER_SERVER_PREFERENCE | SSL_OP_NO_RENEGOTIATION);
+
+    if (::SSL_CTX_use_certificate_chain_file(ctx_, options.certFile.c_str()) != 1)
+    {
+        std::string error = lastError();
+        ::SSL_CTX_free(ctx_);
+        throw std::runtime_error("load certificate " + options.certFile + ": " + error);
+    }
+    if (::SSL_CTX_use_PrivateKey_file(ctx_, options.keyFile.c_str(), SSL_FILETYPE_PEM) != 1 ||
+        ::SSL_CTX_check_private_key(ctx_) != 1)
+    {
+        std::string error = lastError();
+        ::SSL_CTX_free(ctx_);
+        throw std::runtime_error("load private key " + options.keyFile + ": " + error);
+    }
+
+    // 会话恢复：session id 缓存 + session ticket，两者都挂在这个 SSL_CTX 上，所有 loop 共享
+    ::SSL_CTX_set_session_id_context(ctx_, kSessionIdContext, sizeof kSessionIdContext - 1);
+    ::SSL_CTX_set_session_cache_mode(ctx_, SSL_SESS_CACHE_SERVER);
+    ::SSL_CTX_sess_set_cache_size(ctx_, options.sessionCacheSize);
+    ::SSL_CTX_set_timeout(ctx_, options.sessionTimeout);
+    if (!options.sessionTickets)
+    {
+        ::SSL_CTX_set_options(ctx_, SSL_OP_NO_TICKET);
+    }
+
+    // ALPN 协议列表：每项前面一个长度字节
+    if (options.http2)
+    {
+        alpn_.append("\x02h2", 3);
+    }
+    alpn_.append("\x08http/1.1", 9);
+    ::SSL_CTX_set_alpn_select_cb(ctx_, selectAlpn, &alpn_);
+
+    LOG_INFO << "TLS enabled with " << options.certFile
+             << (options.sessionTickets ? ", session tickets on" : ", session tickets off")
+             << ", session cache " << options.sessionCacheSize;
+}
+
+TlsContext::~TlsContext()
+{
+    ::SSL_CTX_free(ctx_);
+}
+
+ssl_st* TlsContext::newSsl()
+{
+    SSL* ssl = ::SSL_new(ctx_);
+    if (ssl)
+    {
+        ::SSL_set_accept_state(ssl);
+    }
+    return ssl;
+}
+
+void TlsContext::onHandshake(bool resumed, int64_t latencyUs)
+{
+    handshakes_.fetch_add(1, std::memory_order_relaxed);
+    if (resumed)
+    {
+        resumed_.fetch_add(1, std::memory_order_relaxed);
+    }
+    metrics::MetricsRegistry::instance().observeTlsHandshake(latencyUs);
+}
+
+void TlsContext::onHandshakeFailure()
+{
+    failures_.fetch_add(1, std::memory_order_relaxed);
+}
+
+long TlsContext::cachedSessions() const
+{
+    return ::SSL_CTX_sess_number(ctx_);
+}
+
+} // namespace tls
+} // namespace http
@@ -0,0 +1,531 @@
+#include "../../include/websocket/WebSocketConnection.h"
+
+#include <muduo/base/Logging.h>
+#include <muduo/net/EventLoop.h>
+
+#include <openssl/evp.h>
+#include <openssl/sha.h>
+
+#include <algorithm>
+#include <string.h>
+#include <strings.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+namespace http
+{
+namespace websocket
+{
+
+namespace
+{
+
+const char kWebSocketGuid[] = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+
+// 消息拼好后如果缓冲区太大就释放掉，避免一次大消息让空闲连接一直占着内存
+const size_t kMessageKeepCapacity = 64 * 1024;
+
+const std::string* findHeaderIgnoreCase(const HttpRequest& req, const char* field)
+{
+    for (const auto& header : req.headers())
+    {
+        if (::strcasecmp(header.first.c_str(), field) == 0)
+        {
+            return &header.second;
+        }
+    }
+    return nullptr;
+}
+
+// 逗号分隔的头部值里是否有某个 token (忽略大小写)，比如 "keep-alive, Upgrade"
+bool headerHasToken(const std::string& value, const char* token)
+{
+    size_t tokenLength = ::strlen(token);
+    size_t pos = 0;
+    while (pos < value.size())
+    {
+        size_t end = value.find(',', pos);
+        if (end == std::string::npos)
+        {
+            end = value.size();
+        }
+        size_t begin = pos;
+        while (begin < end && (value[begin] == ' ' || value[begin] == '\t'))
+        {
+            ++begin;
+        }
+        size_t last = end;
+        while (last > begin && (value[last - 1] == ' ' || value[last - 1] == '\t'))
+        {
+            --last;
+        }
+        if (last - begin == tokenLength && ::strncasecmp(value.data() + begin, token, tokenLength) == 0)
+        {
+            return true;
+        }
+        pos = end + 1;
+    }
+    return false;
+}
+
+// 文本消息和 close 原因必须是合法的 UTF-8 (拒绝过长编码、代理项和超出 U+10FFFF 的码点)
+bool isValidUtf8(const char* data, size_t len)
+{
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(data);
+    const unsigned char* end = p + len;
+    while (p < end)
+    {
+        unsigned char c = *p;
+        if (c < 0x80)
+        {
+            ++p;
+            continue;
+        }
+        size_t n;
+        uint32_t cp;
+        if ((c & 0xe0) == 0xc0) { n = 1; cp = c & 0x1f; }
+        else if ((c & 0xf0) == 0xe0) { n = 2; cp = c & 0x0f; }
+        else if ((c & 0xf8) == 0xf0) { n = 3; cp = c & 0x07; }
+        else return false;
+
+        if (static_cast<size_t>(end - p) <= n)
+        {
+            return false;
+        }
+        for (size_t i = 1; i <= n; ++i)
+        {
+            if ((p[i] & 0xc0) != 0x80)
+            {
+                return false;
+            }
+            cp = (cp << 6) | (p[i] & 0x3f);
+        }
+        static const uint32_t kMinCodePoint[] = { 0, 0x80, 0x800, 0x10000 };
+        if (cp < kMinCodePoint[n] || cp > 0x10ffff || (cp >= 0xd800 && cp <= 0xdfff))
+        {
+            return false;
+        }
+        p += n + 1;
+    }
+    return true;
+}
+
+bool isValidCloseCode(uint16_t code)
+{
+    return (code >= 1000 && code <= 1003) || (code >= 1007 && code <= 1011) ||
+           (code >= 3000 && code <= 4999);
+}
+
+} // namespace
+
+WebSocketConnection::WebSocketConnection(const TcpConnectionPtr& conn,
+                                         const std::shared_ptr<const WebSocketHandler>& handler,
+                                         size_t maxMessageSize)
+    : conn_(conn)
+    , handler_(handler)
+    , loop_(conn->getLoop())
+    , name_(conn->name())
+    , maxMessageSize_(maxMessageSize)
+    , assembling_(false)
+    , messageOpcode_(kText)
+    , closeSent_(false)
+    , closed_(false)
+{
+}
+
+bool WebSocketConnection::isUpgradeRequest(const HttpRequest& req)
+{
+    if (req.method() != HttpRequest::kGet)
+    {
+        return false;
+    }
+    const std::string* upgrade = findHeaderIgnoreCase(req, "Upgrade");
+    const std::string* connection = findHeaderIgnoreCase(req, "Connection");
+    return upgrade && ::strcasecmp(upgrade->c_str(), "websocket") == 0 &&
+           connection && headerHasToken(*connection, "upgrade") &&
+           findHeaderIgnoreCase(req, "Sec-WebSocket-Key") != nullptr;
+}
+
+bool WebSocketConnection::handshake(const HttpRequest& req, Buffer* out)
+{
+    const std::string* version = findHeaderIgnoreCase(req, "Sec-WebSocket-Version");
+    const std::string* key = findHeaderIgnoreCase(req, "Sec-WebSocket-Key");
+    if (!version || *version != "13" || !key || key->empty())
+    {
+        return false;
+    }
+    out->append("HTTP/1.1 101 Switching Protocols\r\n"
+                "Upgrade: websocket\r\n"
+                "Connection: Upgrade\r\n"
+                "Sec-WebSocket-Accept: ");
+    out->append(acceptKey(*key));
+    out->append("\r\n\r\n");
+    return true;
+}
+
+std::string WebSocketConnection::acceptKey(const std::string& key)
+{
+    std::string input = key + kWebSocketGuid;
+    unsigned char digest[SHA_DIGEST_LENGTH];
+    ::SHA1(reinterpret_cast<const unsigned char*>(input.data()), input.size(), digest);
+
+    // 20 字节 base64 之后是 28 个字符，EVP_EncodeBlock 会再写一个 '\0'
+    unsigned char encoded[32];
+    int n = ::EVP_EncodeBlock(encoded, digest, SHA_DIGEST_LENGTH);
+    return std::string(reinterpret_cast<const char*>(encoded), n);
+}
+
+void WebSocketConnection::encodeFrame(Opcode opcode, const char* data, size_t len, std::string* out)
+{
+    char header[10];
+    size_t headerLength = 2;
+    header[0] = static_cast<char>(0x80 | opcode); // FIN，服务端不分片
+    if (len < 126)
+    {
+        header[1] = static_cast<char>(len);
+    }
+    else if (len <= 0xffff)
+    {
+        header[1] = 126;
+        header[2] = static_cast<char>(len >> 8);
+        header[3] = static_cast<char>(len);
+        headerLength = 4;
+    }
+    else
+    {
+        header[1] = 127;
+        for (int i = 0; i < 8; ++i)
+        {
+            header[2 + i] = static_cast<char>(static_cast<uint64_t>(len) >> (56 - 8 * i));
+        }
+        headerLength = 10;
+    }
+    out->reserve(out->size() + headerLength + len);
+    out->append(header, headerLength);
+    out->append(data, len);
+}
+
+void WebSocketConnection::applyMask(char* data, size_t len, const char mask[4], size_t offset)
+{
+    // 把 4 字节掩码按 offset 对齐后铺成 8 字节，主循环一次异或一个 uint64_t，
+    // memcpy 读写避免未对齐访问，-O2 下编译器会把这个循环向量化
+    unsigned char pattern[8];
+    for (size_t i = 0; i < 8; ++i)
+    {
+        pattern[i] = static_cast<unsigned char>(mask[(offset + i) & 3]);
+    }
+    uint64_t word;
+    ::memcpy(&word, pattern, sizeof word);
+
+    size_t i = 0;
+    for (; i + 8 <= len; i += 8)
+    {
+        uint64_t chunk;
+        ::memcpy(&chunk, data + i, sizeof chunk);
+        chunk ^= word;
+        ::memcpy(data + i, &chunk, sizeof chunk);
+    }
+    for (; i < len; ++i)
+    {
+        data[i] = static_cast<char>(data[i] ^ pattern[i & 7]);
+    }
+}
+
+void WebSocketConnection::onOpen(const HttpRequest& req)
+{
+    if (handler_->onOpen)
+    {
+        handler_->onOpen(shared_from_this(), req);
+    }
+}
+
+bool WebSocketConnection::onData(Buffer* in)
+{
+    while (in->readableBytes() >= 2)
+    {
+        const uint8_t* p = reinterpret_cast<const uint8_t*>(in->peek());
+        bool fin = (p[0] & 0x80) != 0;
+        uint8_t opcode = p[0] & 0x0f;
+        size_t headerLength = 2;
+        uint64_t length = p[1] & 0x7f;
+
+        // 扩展位没有协商过；客户端发来的帧必须带掩码
+        if ((p[0] & 0x70) != 0 || (p[1] & 0x80) == 0)
+        {
+            return failConnection(kProtocolError, "");
+        }
+        if (length == 126)
+        {
+            if (in->readableBytes() < 4)
+            {
+                break;
+            }
+            length = (static_cast<uint64_t>(p[2]) << 8) | p[3];
+            headerLength = 4;
+        }
+        else if (length == 127)
+        {
+            if (in->readableBytes() < 10)
+            {
+                break;
+            }
+            length = 0;
+            for (int i = 0; i < 8; ++i)
+            {
+                length = (length << 8) | p[2 + i];
+            }
+            headerLength = 10;
+        }
+        headerLength += 4; // masking key
+
+        // 控制帧不能分片，负载不超过 125 字节
+        if (opcode >= kClose && (!fin || length > 125))
+        {
+            return failConnection(kProtocolError, "");
+        }
+        if (length > maxMessageSize_)
+        {
+            return failConnection(kMessageTooBig, "");
+        }
+        if (in->readableBytes() < headerLength + length)
+        {
+            break;
+        }
+
+        const char* mask = in->peek() + headerLength - 4;
+        const char* payload = in->peek() + headerLength;
+        bool ok;
+        if (opcode >= kClose)
+        {
+            char control[125];
+            ::memcpy(control, payload, length);
+            applyMask(control, length, mask);
+            ok = onControlFrame(opcode, control, length);
+        }
+        else
+        {
+            // 数据帧：直接追加到消息缓冲区，在那里原地去掉掩码，只拷贝一次
+            if (opcode == kContinuation ? !assembling_ : (opcode > kBinary || assembling_))
+            {
+                return failConnection(kProtocolError, "");
+            }
+            if (opcode != kContinuation)
+            {
+                assembling_ = true;
+                messageOpcode_ = opcode;
+            }
+            if (message_.size() + length > maxMessageSize_)
+            {
+                return failConnection(kMessageTooBig, "");
+            }
+            size_t offset = message_.size();
+            message_.append(payload, length);
+            applyMask(&message_[offset], length, mask);
+            ok = onDataFrame(fin);
+        }
+        in->retrieve(headerLength + length);
+        if (!ok)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool WebSocketConnection::onDataFrame(bool fin)
+{
+    if (!fin)
+    {
+        return true; // 等后续的分片
+    }
+    assembling_ = false;
+    bool binary = messageOpcode_ == kBinary;
+    if (!binary && !isValidUtf8(message_.data(), message_.size()))
+    {
+        return failConnection(kInvalidPayload, "");
+    }
+    // 已经发了 close，后面来的数据帧丢掉
+    if (!closeSent_ && handler_->onMessage)
+    {
+        handler_->onMessage(shared_from_this(), message_, binary);
+    }
+    if (message_.capacity() > kMessageKeepCapacity)
+    {
+        std::string().swap(message_);
+    }
+    else
+    {
+        message_.clear();
+    }
+    return true;
+}
+
+bool WebSocketConnection::onControlFrame(uint8_t opcode, const char* payload, size_t len)
+{
+    switch (opcode)
+    {
+    case kPing:
+        sendFrame(kPong, payload, len);
+        return true;
+
+    case kPong:
+        return true;
+
+    case kClose:
+    {
+        if (len == 1)
+        {
+            return failConnection(kProtocolError, "");
+        }
+        if (len >= 2)
+        {
+            uint16_t code = static_cast<uint16_t>((static_cast<uint8_t>(payload[0]) << 8) |
+                                                  static_cast<uint8_t>(payload[1]));
+            if (!isValidCloseCode(code))
+            {
+                return failConnection(kProtocolError, "");
+            }
+            if (!isValidUtf8(payload + 2, len - 2))
+            {
+                return failConnection(kInvalidPayload, "");
+            }
+        }
+        // 回一个同样状态码的 close，然后由服务端关闭 TCP
+        if (!closeSent_)
+        {
+            closeSent_ = true;
+            sendFrame(kClose, payload, len >= 2 ? 2 : 0);
+        }
+        return false;
+    }
+
+    default:
+        return failConnection(kProtocolError, "");
+    }
+}
+
+bool WebSocketConnection::failConnection(CloseCode code, const std::string& reason)
+{
+    LOG_DEBUG << "WebSocket " << name_ << " closing with " << code;
+    if (!closeSent_)
+    {
+        closeSent_ = true;
+        std::string payload;
+        payload.push_back(static_cast<char>(code >> 8));
+        payload.push_back(static_cast<char>(code & 0xff));
+        payload.append(reason, 0, 123);
+        sendFrame(kClose, payload.data(), payload.size());
+    }
+    return false;
+}
+
+void WebSocketConnection::onClosed()
+{
+    if (closed_)
+    {
+        return;
+    }
+    closed_ = true;
+    if (handler_->onClose)
+    {
+        handler_->onClose(shared_from_this());
+    }
+}
+
+void WebSocketConnection::sendText(const std::string& message)
+{
+    sendFrame(kText, message.data(), message.size());
+}
+
+void WebSocketConnection::sendBinary(const std::string& message)
+{
+    sendFrame(kBinary, message.data(), message.size());
+}
+
+void WebSocketConnection::ping(const std::string& payload)
+{
+    sendFrame(kPing, payload.data(), std::min(payload.size(), static_cast<size_t>(125)));
+}
+
+void WebSocketConnection::close(CloseCode code, const std::string& reason)
+{
+    // closeSent_ 只在 I/O 线程里读写
+    std::weak_ptr<WebSocketConnection> weakSelf(shared_from_this());
+    loop_->runInLoop([weakSelf, code, reason]
+    {
+        WebSocketConnectionPtr self = weakSelf.lock();
+        if (self)
+        {
+            self->failConnection(code, reason);
+        }
+    });
+}
+
+bool WebSocketConnection::sendEncoded(const std::string& frame, size_t maxPendingBytes)
+{
+    loop_->assertInLoopThread();
+    TcpConnectionPtr conn = conn_.lock();
+    if (!conn || !conn->connected() || closeSent_)
+    {
+        return false;
+    }
+    if (conn->outputBuffer()->readableBytes() > maxPendingBytes)
+    {
+        return false;
+    }
+    if (writer_)
+    {
+        writer_(conn, frame.data(), frame.size());
+    }
+    else
+    {
+        conn->send(frame.data(), static_cast<int>(frame.size()));
+    }
+    return true;
+}
+
+bool WebSocketConnection::connected() const
+{
+    TcpConnectionPtr conn = conn_.lock();
+    return conn && conn->connected() && !closed_;
+}
+
+void WebSocketConnection::sendFrame(Opcode opcode, const char* data, size_t len)
+{
+    TcpConnectionPtr conn = conn_.lock();
+    if (!conn)
+    {
+        return;
+    }
+    std::string frame;
+    encodeFrame(opcode, data, len, &frame);
+    write(conn, frame);
+}
+
+void WebSocketConnection::write(const TcpConnectionPtr& conn, const std::string& frame)
+{
+    if (!writer_)
+    {
+        conn->send(frame); // TcpConnection::send 本身是线程安全的
+    }
+    else if (loop_->isInLoopThread())
+    {
+        writer_(conn, frame.data(), frame.size());
+    }
+    else
+    {
+        // writer (比如 TLS 加密) 只能在 I/O 线程里跑
+        Writer writer = writer_;
+        loop_->runInLoop([conn, writer, frame]
+        {
+            if (conn->connected())
+            {
+                writer(conn, frame.data(), frame.size());
+            }
+        });
+    }
+}
+
+} // namespace websocket
+} // namespace http
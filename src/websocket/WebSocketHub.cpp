@@ -0,0 +1,110 @@
+#include "../../include/websocket/WebSocketHub.h"
+
+using namespace muduo;
+using namespace muduo::net;
+
+namespace http
+{
+namespace websocket
+{
+
+WebSocketHub::WebSocketHub(size_t maxPendingBytes)
+    : maxPendingBytes_(maxPendingBytes)
+    , subscribers_(0)
+    , broadcasts_(0)
+    , delivered_(0)
+    , dropped_(0)
+{
+}
+
+WebSocketHub::ShardPtr WebSocketHub::shardFor(EventLoop* loop)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    ShardPtr& shard = shards_[loop];
+    if (!shard)
+    {
+        shard = std::make_shared<Shard>();
+        shard->loop = loop;
+    }
+    return shard;
+}
+
+void WebSocketHub::subscribe(const WebSocketConnectionPtr& conn)
+{
+    conn->loop()->assertInLoopThread();
+    ShardPtr shard = shardFor(conn->loop());
+    if (shard->members.emplace(conn.get(), conn).second)
+    {
+        ++subscribers_;
+    }
+}
+
+void WebSocketHub::unsubscribe(const WebSocketConnectionPtr& conn)
+{
+    conn->loop()->assertInLoopThread();
+    ShardPtr shard = shardFor(conn->loop());
+    if (shard->members.erase(conn.get()) > 0)
+    {
+        --subscribers_;
+    }
+}
+
+void WebSocketHub::broadcast(const std::string& message, bool binary)
+{
+    ++broadcasts_;
+    auto frame = std::make_shared<std::string>();
+    WebSocketConnection::encodeFrame(binary ? WebSocketConnection::kBinary : WebSocketConnection::kText,
+                                     message.data(), message.size(), frame.get());
+    std::shared_ptr<const std::string> shared = frame;
+
+    std::vector<ShardPtr> shards;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        shards.reserve(shards_.size());
+        for (const auto& entry : shards_)
+        {
+            shards.push_back(entry.second);
+        }
+    }
+
+    // 每个 loop 一个任务；用 queueInLoop 而不是 runInLoop，
+    // 避免在订阅者自己的回调里广播时一边遍历一边修改 members
+    for (const ShardPtr& shard : shards)
+    {
+        shard->loop->queueInLoop([this, shard, shared]
+        {
+            deliver(shard, shared);
+        });
+    }
+}
+
+void WebSocketHub::deliver(const ShardPtr& shard, const std::shared_ptr<const std::string>& frame)
+{
+    uint64_t delivered = 0;
+    uint64_t dropped = 0;
+    for (auto it = shard->members.begin(); it != shard->members.end(); )
+    {
+        WebSocketConnectionPtr conn = it->second.lock();
+        if (!conn)
+        {
+            // 连接已经析构但没退订，顺手清掉
+            it = shard->members.erase(it);
+            --subscribers_;
+            continue;
+        }
+        if (conn->sendEncoded(*frame, maxPendingBytes_))
+        {
+            ++delivered;
+        }
+        else
+        {
+            ++dropped;
+        }
+        ++it;
+    }
+    delivered_.fetch_add(delivered, std::memory_order_relaxed);
+    dropped_.fetch_add(dropped, std::memory_order_relaxed);
+}
+
+} // namespace websocket
+} // namespace http
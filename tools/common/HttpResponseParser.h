@@ -0,0 +1,148 @@
+#pragma once
+
+#include <muduo/net/Buffer.h>
+
+#include <algorithm>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+namespace http
+{
+namespace tools
+{
+
+/**
+ * @brief 压测/回放工具用的最小 HTTP/1.1 响应解析器
+ *
+ * 只关心状态码、Content-Length 和 Connection: close，响应体直接跳过不拷贝。
+ * 一个连接上可以连续解析多个 (pipelining 的) 响应。
+ */
+class HttpResponseParser
+{
+public:
+    enum Result
+    {
+        kNeedMore,  // 数据不够，等下一次 onMessage
+        kComplete,  // 解析出一个完整响应
+        kError,     // 格式错误
+    };
+
+    HttpResponseParser() { reset(); }
+
+    void reset()
+    {
+        inBody_ = false;
+        status_ = 0;
+        contentLength_ = 0;
+        close_ = false;
+        untilEof_ = false;
+        bytes_ = 0;
+    }
+
+    Result parse(muduo::net::Buffer* buf)
+    {
+        if (!inBody_)
+        {
+            // 等到整个头部 (\r\n\r\n) 都到齐再解析
+            const char* begin = buf->peek();
+            const char* end = begin + buf->readableBytes();
+            static const char kHeaderEnd[] = "\r\n\r\n";
+            const char* headerEnd = std::search(begin, end, kHeaderEnd, kHeaderEnd + 4);
+            if (headerEnd == end)
+            {
+                return kNeedMore;
+            }
+            if (!parseHeaders(begin, headerEnd))
+            {
+                return kError;
+            }
+            bytes_ = headerEnd + 4 - begin;
+            buf->retrieveUntil(headerEnd + 4);
+            inBody_ = true;
+        }
+
+        if (untilEof_)
+        {
+            // 没有 Content-Length 的短连接响应：响应体一直读到对端关闭
+            bytes_ += buf->readableBytes();
+            buf->retrieveAll();
+            return kNeedMore;
+        }
+        if (buf->readableBytes() < contentLength_)
+        {
+            return kNeedMore;
+        }
+        buf->retrieve(contentLength_);
+        bytes_ += contentLength_;
+        inBody_ = false;
+        return kComplete;
+    }
+
+    // 连接关闭时调用：如果正在读一个"读到 EOF 为止"的响应体，它就此完整
+    bool completeOnEof()
+    {
+        bool complete = inBody_ && untilEof_;
+        inBody_ = false;
+        untilEof_ = false;
+        return complete;
+    }
+
+    int status() const { return status_; }
+    bool closeConnection() const { return close_; }
+    size_t bytes() const { return bytes_; }
+
+private:
+    bool parseHeaders(const char* begin, const char* end)
+    {
+        // 状态行: HTTP/1.1 200 OK
+        if (end - begin < 12 || memcmp(begin, "HTTP/1.", 7) != 0)
+        {
+            return false;
+        }
+        status_ = atoi(begin + 9);
+        contentLength_ = 0;
+        close_ = false;
+        bool hasContentLength = false;
+
+        const char* line = std::find(begin, end, '\n');
+        while (line < end)
+        {
+            ++line;
+            const char* lineEnd = std::find(line, end, '\r');
+            const char* colon = std::find(line, lineEnd, ':');
+            if (colon < lineEnd)
+            {
+                size_t nameLen = colon - line;
+                const char* value = colon + 1;
+                while (value < lineEnd && *value == ' ')
+                {
+                    ++value;
+                }
+                if (nameLen == 14 && strncasecmp(line, "Content-Length", 14) == 0)
+                {
+                    contentLength_ = strtoul(value, nullptr, 10);
+                    hasContentLength = true;
+                }
+                else if (nameLen == 10 && strncasecmp(line, "Connection", 10) == 0)
+                {
+                    close_ = (lineEnd - value == 5 && strncasecmp(value, "close", 5) == 0);
+                }
+            }
+            line = std::find(lineEnd, end, '\n');
+        }
+        untilEof_ = close_ && !hasContentLength;
+        return status_ >= 100;
+    }
+
+private:
+    bool   inBody_;
+    int    status_;
+    size_t contentLength_;
+    bool   close_;
+    bool   untilEof_;
+    size_t bytes_;
+};
+
+} // namespace tools
+} // namespace http
@@ -0,0 +1,305 @@
+// SmartSentinel 空闲连接内存基准：建立大量 keep-alive 连接，每个连接走完一个请求后保持空闲，
+// 读服务器进程的 VmRSS，报告每个空闲连接的常驻内存 (并折算成每 10 万连接)。
+//
+// 服务器要和本工具跑在同一台机器上 (读 /proc/<pid>/status)。单个源地址只有约 2.8 万个临时端口，
+// 连接数更多时用 --sources 轮流绑定 127.0.0.1 ~ 127.0.0.N (只适用于连本机回环地址)。
+//
+// 例子：
+//   SENTINEL_COMPACT_IDLE=1 SmartSentinel &
+//   sentinel_idlebench --pid $(pidof SmartSentinel) --connections 100000 --sources 4
+//   sentinel_idlebench --pid 1234 --connections 20000 --request '' --json
+
+#include <muduo/net/Buffer.h>
+
+#include "../common/HttpResponseParser.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <getopt.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+using namespace muduo::net;
+using http::tools::HttpResponseParser;
+
+namespace
+{
+
+struct Options
+{
+    std::string host = "127.0.0.1";
+    uint16_t    port = 8083;
+    int         pid = 0;               // 服务器进程号
+    int         connections = 100000;
+    int         sources = 1;           // 轮流绑定的回环源地址个数
+    std::string request = "GET /metrics"; // 每个连接先发的请求，空串表示只建连不发请求
+    double      settle = 2;            // 建完连接后等多久再采样 (秒)
+    double      hold = 0;              // 采样后连接再保持多久 (秒)，方便手工观察
+    bool        json = false;
+};
+
+// 读 /proc/<pid>/status 里的 VmRSS，单位 KB，失败返回 -1
+long readRssKb(int pid)
+{
+    char path[64];
+    snprintf(path, sizeof path, "/proc/%d/status", pid);
+    FILE* fp = ::fopen(path, "r");
+    if (!fp)
+    {
+        return -1;
+    }
+    long rss = -1;
+    char line[256];
+    while (::fgets(line, sizeof line, fp))
+    {
+        if (::strncmp(line, "VmRSS:", 6) == 0)
+        {
+            rss = ::atol(line + 6);
+            break;
+        }
+    }
+    ::fclose(fp);
+    return rss;
+}
+
+// 打开文件数上限调到够用 (不超过硬上限)
+void raiseFileLimit(int connections)
+{
+    struct rlimit limit;
+    if (::getrlimit(RLIMIT_NOFILE, &limit) == 0)
+    {
+        rlim_t wanted = static_cast<rlim_t>(connections) + 64;
+        if (limit.rlim_cur < wanted)
+        {
+            limit.rlim_cur = std::min(wanted, limit.rlim_max);
+            ::setrlimit(RLIMIT_NOFILE, &limit);
+        }
+    }
+}
+
+int connectOne(const Options& options, const struct sockaddr_in& server, int index)
+{
+    int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+    {
+        return -1;
+    }
+    if (options.sources > 1)
+    {
+        struct sockaddr_in local;
+        ::memset(&local, 0, sizeof local);
+        local.sin_family = AF_INET;
+        local.sin_addr.s_addr = htonl(INADDR_LOOPBACK + index % options.sources);
+        if (::bind(fd, reinterpret_cast<const struct sockaddr*>(&local), sizeof local) < 0)
+        {
+            ::close(fd);
+            return -1;
+        }
+    }
+    if (::connect(fd, reinterpret_cast<const struct sockaddr*>(&server), sizeof server) < 0)
+    {
+        ::close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// 把 "METHOD PATH" 渲染成 keep-alive 请求
+std::string renderRequest(const Options& options)
+{
+    std::string method = "GET";
+    std::string path = options.request;
+    size_t space = options.request.find(' ');
+    if (space != std::string::npos)
+    {
+        method = options.request.substr(0, space);
+        path = options.request.substr(space + 1);
+    }
+    return method + " " + path + " HTTP/1.1\r\nHost: " + options.host +
+           "\r\nConnection: keep-alive\r\n\r\n";
+}
+
+// 阻塞读完一个响应；失败或服务器要求关闭连接时返回 false
+bool readResponse(int fd)
+{
+    HttpResponseParser parser;
+    Buffer buf;
+    char chunk[16 * 1024];
+    for (;;)
+    {
+        ssize_t n = ::read(fd, chunk, sizeof chunk);
+        if (n <= 0)
+        {
+            return false;
+        }
+        buf.append(chunk, n);
+        HttpResponseParser::Result result = parser.parse(&buf);
+        if (result == HttpResponseParser::kComplete)
+        {
+            return !parser.closeConnection();
+        }
+        if (result == HttpResponseParser::kError)
+        {
+            return false;
+        }
+    }
+}
+
+void usage(const char* prog)
+{
+    fprintf(stderr,
+            "Usage: %s --pid PID [options]\n"
+            "  --pid PID                server process to sample VmRSS from (required)\n"
+            "  --host HOST              server address (default 127.0.0.1)\n"
+            "  --port PORT              server port (default 8083)\n"
+            "  --connections N          idle connections to open (default 100000)\n"
+            "  --sources N              bind source addresses 127.0.0.1..N in turn (default 1)\n"
+            "  --request 'M PATH'       request sent once per connection, '' for none (default GET /metrics)\n"
+            "  --settle S               seconds to wait before sampling (default 2)\n"
+            "  --hold S                 seconds to keep connections open after sampling (default 0)\n"
+            "  --json                   print the report as JSON\n",
+            prog);
+}
+
+bool parseOptions(int argc, char* argv[], Options* options)
+{
+    static const struct option longOptions[] = {
+        { "pid", required_argument, nullptr, 'P' },
+        { "host", required_argument, nullptr, 'h' },
+        { "port", required_argument, nullptr, 'p' },
+        { "connections", required_argument, nullptr, 'c' },
+        { "sources", required_argument, nullptr, 's' },
+        { "request", required_argument, nullptr, 'r' },
+        { "settle", required_argument, nullptr, 'S' },
+        { "hold", required_argument, nullptr, 'H' },
+        { "json", no_argument, nullptr, 'j' },
+        { nullptr, 0, nullptr, 0 },
+    };
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "P:h:p:c:s:r:S:H:j", longOptions, nullptr)) != -1)
+    {
+        switch (opt)
+        {
+        case 'P': options->pid = atoi(optarg); break;
+        case 'h': options->host = optarg; break;
+        case 'p': options->port = static_cast<uint16_t>(atoi(optarg)); break;
+        case 'c': options->connections = atoi(optarg); break;
+        case 's': options->sources = atoi(optarg); break;
+        case 'r': options->request = optarg; break;
+        case 'S': options->settle = atof(optarg); break;
+        case 'H': options->hold = atof(optarg); break;
+        case 'j': options->json = true; break;
+        default: return false;
+        }
+    }
+    return options->pid > 0 && options->connections > 0 && options->sources > 0;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    Options options;
+    if (!parseOptions(argc, argv, &options))
+    {
+        usage(argv[0]);
+        return 1;
+    }
+
+    struct sockaddr_in server;
+    ::memset(&server, 0, sizeof server);
+    server.sin_family = AF_INET;
+    server.sin_port = htons(options.port);
+    if (::inet_pton(AF_INET, options.host.c_str(), &server.sin_addr) != 1)
+    {
+        fprintf(stderr, "invalid host %s\n", options.host.c_str());
+        return 1;
+    }
+
+    long baselineKb = readRssKb(options.pid);
+    if (baselineKb < 0)
+    {
+        fprintf(stderr, "cannot read /proc/%d/status\n", options.pid);
+        return 1;
+    }
+    raiseFileLimit(options.connections);
+
+    // 先全部建连，再统一发请求、收响应：服务器同时持有所有连接的状态
+    std::vector<int> fds;
+    fds.reserve(options.connections);
+    for (int i = 0; i < options.connections; ++i)
+    {
+        int fd = connectOne(options, server, i);
+        if (fd < 0)
+        {
+            fprintf(stderr, "connect #%d failed: %s, stopping at %zu connections\n",
+                    i, ::strerror(errno), fds.size());
+            break;
+        }
+        fds.push_back(fd);
+        if ((i + 1) % 10000 == 0)
+        {
+            fprintf(stderr, "connected %d\n", i + 1);
+        }
+    }
+
+    int failed = 0;
+    if (!options.request.empty())
+    {
+        std::string request = renderRequest(options);
+        for (int fd : fds)
+        {
+            if (::write(fd, request.data(), request.size()) != static_cast<ssize_t>(request.size()))
+            {
+                ++failed;
+            }
+        }
+        for (int fd : fds)
+        {
+            if (!readResponse(fd))
+            {
+                ++failed;
+            }
+        }
+    }
+
+    ::usleep(static_cast<useconds_t>(options.settle * 1e6));
+    long idleKb = readRssKb(options.pid);
+    size_t opened = fds.size();
+    double bytesPerConnection = opened > 0 ? (idleKb - baselineKb) * 1024.0 / opened : 0;
+    double mbPer100k = bytesPerConnection * 100000 / (1024 * 1024);
+
+    if (options.json)
+    {
+        printf("{\"connections\":%zu,\"failed\":%d,\"baseline_rss_kb\":%ld,\"idle_rss_kb\":%ld,"
+               "\"bytes_per_connection\":%.1f,\"mb_per_100k\":%.1f}\n",
+               opened, failed, baselineKb, idleKb, bytesPerConnection, mbPer100k);
+    }
+    else
+    {
+        printf("%zu idle connections (%d failed requests)\n", opened, failed);
+        printf("  server RSS   %ld KB -> %ld KB\n", baselineKb, idleKb);
+        printf("  per conn     %.1f bytes\n", bytesPerConnection);
+        printf("  per 100k     %.1f MB\n", mbPer100k);
+    }
+
+    if (options.hold > 0)
+    {
+        ::usleep(static_cast<useconds_t>(options.hold * 1e6));
+    }
+    for (int fd : fds)
+    {
+        ::close(fd);
+    }
+    return 0;
+}
@@ -0,0 +1,540 @@
+// SmartSentinel 压测工具：基于 muduo 的 HTTP/1.1 负载生成器
+//
+// 闭环模式 (默认)：每个连接保持 depth 个请求在途，收到一个响应就补发一个。
+// 开环模式 (--rate)：按固定速率安排请求的"预定发送时间"，连接忙不过来时请求积压，
+//                    延迟从预定时间算起，避免 coordinated omission 把排队时间藏掉。
+//
+// 例子：
+//   sentinel_loadgen --connections 64 --threads 4 --duration 30
+//   sentinel_loadgen --rate 20000 --depth 4 --request 'GET /metrics'
+//   sentinel_loadgen --request 'POST /api/user/login {"username":"admin","password":"123"}'
+
+#include <muduo/base/CountDownLatch.h>
+#include <muduo/base/Logging.h>
+#include <muduo/base/Timestamp.h>
+#include <muduo/net/EventLoop.h>
+#include <muduo/net/EventLoopThreadPool.h>
+#include <muduo/net/InetAddress.h>
+#include <muduo/net/TcpClient.h>
+
+#include "metrics/Metrics.h"
+#include "../common/HttpResponseParser.h"
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace muduo;
+using namespace muduo::net;
+using http::metrics::LatencyHistogram;
+using http::tools::HttpResponseParser;
+
+namespace
+{
+
+struct Options
+{
+    std::string              host = "127.0.0.1";
+    uint16_t                 port = 8083;
+    std::vector<std::string> requests;            // 每条形如 "METHOD PATH [BODY]"，轮流发送
+    std::vector<std::string> headers;             // 额外请求头 "Key: Value"
+    int                      connections = 16;
+    int                      threads = 4;
+    int                      depth = 1;           // 每个连接的 pipelining 深度
+    double                   rate = 0;            // 总目标速率 (req/s)，0 表示闭环
+    double                   duration = 10;       // 测量时长 (秒)
+    double                   warmup = 1;          // 预热时长 (秒)，期间的样本不计入
+    int64_t                  expectedIntervalUs = 0; // 闭环模式下的 CO 修正间隔
+    bool                     json = false;
+};
+
+int64_t nowUs()
+{
+    return Timestamp::now().microSecondsSinceEpoch();
+}
+
+// 把 "METHOD PATH [BODY]" 渲染成完整的请求报文，只做一次
+std::string renderRequest(const std::string& spec, const Options& options)
+{
+    std::string method = "GET";
+    std::string path = "/";
+    std::string body;
+
+    size_t space = spec.find(' ');
+    if (space == std::string::npos)
+    {
+        path = spec;
+    }
+    else
+    {
+        method = spec.substr(0, space);
+        size_t pathEnd = spec.find(' ', space + 1);
+        if (pathEnd == std::string::npos)
+        {
+            path = spec.substr(space + 1);
+        }
+        else
+        {
+            path = spec.substr(space + 1, pathEnd - space - 1);
+            body = spec.substr(pathEnd + 1);
+        }
+    }
+
+    std::string req = method + " " + path + " HTTP/1.1\r\n";
+    req += "Host: " + options.host + ":" + std::to_string(options.port) + "\r\n";
+    for (const auto& header : options.headers)
+    {
+        req += header + "\r\n";
+    }
+    if (!body.empty() || method == "POST" || method == "PUT")
+    {
+        req += "Content-Type: application/json\r\n";
+        req += "Content-Length: " + std::to_string(body.size()) + "\r\n";
+    }
+    req += "\r\n";
+    req += body;
+    return req;
+}
+
+class LoadConnection : noncopyable
+{
+public:
+    LoadConnection(EventLoop* loop,
+                   const InetAddress& serverAddr,
+                   int id,
+                   const std::vector<std::string>* requests,
+                   const Options& options,
+                   int64_t startUs,
+                   int64_t measureStartUs)
+        : loop_(loop)
+        , client_(loop, serverAddr, "loadgen-" + std::to_string(id))
+        , requests_(requests)
+        , options_(options)
+        , nextRequest_(id % requests->size())
+        , measureStartUs_(measureStartUs)
+        , intervalUs_(0)
+        , nextIntendedUs_(0)
+        , stopped_(false)
+        , completed_(0)
+        , errors_(0)
+        , bytes_(0)
+    {
+        for (int i = 0; i < 6; ++i)
+        {
+            statusClasses_[i] = 0;
+        }
+        if (options_.rate > 0)
+        {
+            intervalUs_ = 1e6 * options_.connections / options_.rate;
+            // 各连接的起始时间错开，避免整齐划一地突发
+            nextIntendedUs_ = static_cast<double>(startUs) + intervalUs_ * id / options_.connections;
+        }
+        client_.setConnectionCallback(std::bind(&LoadConnection::onConnection, this, _1));
+        client_.setMessageCallback(std::bind(&LoadConnection::onMessage, this, _1, _2, _3));
+        client_.enableRetry();
+    }
+
+    EventLoop* getLoop() const { return loop_; }
+
+    void start()
+    {
+        client_.connect();
+    }
+
+    // 在所属 loop 线程里调用
+    void stop()
+    {
+        stopped_ = true;
+        client_.disconnect();
+    }
+
+    // 开环模式：每毫秒由 loop 的定时器调用，把到期的请求放进积压队列
+    void tick(int64_t now)
+    {
+        if (stopped_)
+        {
+            return;
+        }
+        while (nextIntendedUs_ <= static_cast<double>(now))
+        {
+            pending_.push_back(static_cast<int64_t>(nextIntendedUs_));
+            nextIntendedUs_ += intervalUs_;
+        }
+        pump();
+    }
+
+    const LatencyHistogram& histogram() const { return histogram_; }
+    uint64_t completed() const { return completed_; }
+    uint64_t errors() const { return errors_; }
+    uint64_t bytes() const { return bytes_; }
+    uint64_t statusClass(int i) const { return statusClasses_[i]; }
+    size_t backlog() const { return pending_.size(); }
+
+private:
+    void onConnection(const TcpConnectionPtr& conn)
+    {
+        if (conn->connected())
+        {
+            conn->setTcpNoDelay(true);
+            conn_ = conn;
+            parser_.reset();
+            if (options_.rate <= 0)
+            {
+                // 闭环：一上来就把 pipelining 窗口填满
+                int64_t now = nowUs();
+                for (int i = 0; i < options_.depth; ++i)
+                {
+                    inflight_.push_back(now);
+                    send();
+                }
+            }
+            else
+            {
+                pump();
+            }
+        }
+        else
+        {
+            if (!stopped_ && parser_.completeOnEof())
+            {
+                complete(nowUs());
+            }
+            // 在途的请求没有等到响应，算作错误；开环模式下积压的请求保留，重连后继续发
+            if (!stopped_)
+            {
+                errors_ += inflight_.size();
+            }
+            inflight_.clear();
+            conn_.reset();
+        }
+    }
+
+    void onMessage(const TcpConnectionPtr& conn, Buffer* buf, Timestamp)
+    {
+        while (!stopped_)
+        {
+            HttpResponseParser::Result result = parser_.parse(buf);
+            if (result == HttpResponseParser::kNeedMore)
+            {
+                break;
+            }
+            if (result == HttpResponseParser::kError)
+            {
+                ++errors_;
+                conn->forceClose();
+                break;
+            }
+            if (complete(nowUs()))
+            {
+                break; // 服务端会关闭连接，TcpClient 自动重连
+            }
+        }
+    }
+
+    // 返回 true 表示服务端要关闭这个连接
+    bool complete(int64_t now)
+    {
+        int64_t intended = inflight_.empty() ? now : inflight_.front();
+        if (!inflight_.empty())
+        {
+            inflight_.pop_front();
+        }
+
+        if (intended >= measureStartUs_)
+        {
+            record(now - intended);
+            ++completed_;
+            bytes_ += parser_.bytes();
+            int cls = parser_.status() / 100;
+            ++statusClasses_[(cls >= 1 && cls <= 5) ? cls : 0];
+        }
+        bool closing = parser_.closeConnection();
+        parser_.reset();
+
+        // 连接要关了就不再往上面发，重连后再补
+        if (stopped_ || closing)
+        {
+            return closing;
+        }
+        if (options_.rate <= 0)
+        {
+            inflight_.push_back(now);
+            send();
+        }
+        else
+        {
+            pump();
+        }
+        return false;
+    }
+
+    void record(int64_t latencyUs)
+    {
+        histogram_.record(static_cast<uint64_t>(latencyUs));
+        // 闭环模式的 CO 修正 (同 HdrHistogram recordValueWithExpectedInterval)：
+        // 一个慢请求挡住了本该按间隔发出的请求，把这些"错过"的样本补上
+        if (options_.rate <= 0 && options_.expectedIntervalUs > 0)
+        {
+            for (int64_t missing = latencyUs - options_.expectedIntervalUs;
+                 missing >= options_.expectedIntervalUs;
+                 missing -= options_.expectedIntervalUs)
+            {
+                histogram_.record(static_cast<uint64_t>(missing));
+            }
+        }
+    }
+
+    // 开环：窗口有空位就把积压的请求发出去，延迟仍从预定时间算起
+    void pump()
+    {
+        while (conn_ && static_cast<int>(inflight_.size()) < options_.depth && !pending_.empty())
+        {
+            inflight_.push_back(pending_.front());
+            pending_.pop_front();
+            send();
+        }
+    }
+
+    void send()
+    {
+        const std::string& req = (*requests_)[nextRequest_];
+        nextRequest_ = (nextRequest_ + 1) % requests_->size();
+        conn_->send(req.data(), static_cast<int>(req.size()));
+    }
+
+private:
+    EventLoop*                      loop_;
+    TcpClient                       client_;
+    TcpConnectionPtr                conn_;
+    const std::vector<std::string>* requests_;
+    const Options&                  options_;
+    size_t                          nextRequest_;
+    int64_t                         measureStartUs_;
+    double                          intervalUs_;
+    double                          nextIntendedUs_;
+    std::deque<int64_t>             pending_;  // 到期但还没发出去的请求 (预定时间)
+    std::deque<int64_t>             inflight_; // 已发出等待响应的请求 (预定时间)
+    HttpResponseParser              parser_;
+    LatencyHistogram                histogram_;
+    bool                            stopped_;
+    uint64_t                        completed_;
+    uint64_t                        errors_;
+    uint64_t                        bytes_;
+    uint64_t                        statusClasses_[6]; // 0 为无法识别，其余为 1xx..5xx
+};
+
+void usage(const char* prog)
+{
+    fprintf(stderr,
+            "Usage: %s [options]\n"
+            "  --host HOST              server address (default 127.0.0.1)\n"
+            "  --port PORT              server port (default 8083)\n"
+            "  --request 'M PATH [BODY]' request to send, repeatable (default login)\n"
+            "  --header 'K: V'          extra request header, repeatable\n"
+            "  --connections N          concurrent connections (default 16)\n"
+            "  --threads N              I/O threads (default 4)\n"
+            "  --depth N                pipelining depth per connection (default 1)\n"
+            "  --rate R                 open-loop target rate in req/s (default closed loop)\n"
+            "  --duration S             measured seconds (default 10)\n"
+            "  --warmup S               warmup seconds excluded from stats (default 1)\n"
+            "  --expected-interval US   closed-loop coordinated omission correction\n"
+            "  --json                   print the report as JSON\n",
+            prog);
+}
+
+bool parseOptions(int argc, char* argv[], Options* options)
+{
+    static const struct option longOptions[] = {
+        { "host", required_argument, nullptr, 'h' },
+        { "port", required_argument, nullptr, 'p' },
+        { "request", required_argument, nullptr, 'r' },
+        { "header", required_argument, nullptr, 'H' },
+        { "connections", required_argument, nullptr, 'c' },
+        { "threads", required_argument, nullptr, 't' },
+        { "depth", required_argument, nullptr, 'd' },
+        { "rate", required_argument, nullptr, 'R' },
+        { "duration", required_argument, nullptr, 'D' },
+        { "warmup", required_argument, nullptr, 'w' },
+        { "expected-interval", required_argument, nullptr, 'e' },
+        { "json", no_argument, nullptr, 'j' },
+        { nullptr, 0, nullptr, 0 },
+    };
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "h:p:r:H:c:t:d:R:D:w:e:j", longOptions, nullptr)) != -1)
+    {
+        switch (opt)
+        {
+        case 'h': options->host = optarg; break;
+        case 'p': options->port = static_cast<uint16_t>(atoi(optarg)); break;
+        case 'r': options->requests.push_back(optarg); break;
+        case 'H': options->headers.push_back(optarg); break;
+        case 'c': options->connections = atoi(optarg); break;
+        case 't': options->threads = atoi(optarg); break;
+        case 'd': options->depth = atoi(optarg); break;
+        case 'R': options->rate = atof(optarg); break;
+        case 'D': options->duration = atof(optarg); break;
+        case 'w': options->warmup = atof(optarg); break;
+        case 'e': options->expectedIntervalUs = atoll(optarg); break;
+        case 'j': options->json = true; break;
+        default: return false;
+        }
+    }
+    if (options->requests.empty())
+    {
+        options->requests.push_back("POST /api/user/login {\"username\":\"admin\",\"password\":\"123\"}");
+    }
+    return options->connections > 0 && options->depth > 0 && options->threads >= 0 &&
+           options->duration > 0;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    Options options;
+    if (!parseOptions(argc, argv, &options))
+    {
+        usage(argv[0]);
+        return 1;
+    }
+    Logger::setLogLevel(Logger::WARN);
+
+    std::vector<std::string> requests;
+    for (const auto& spec : options.requests)
+    {
+        requests.push_back(renderRequest(spec, options));
+    }
+
+    EventLoop loop;
+    EventLoopThreadPool pool(&loop, "loadgen");
+    pool.setThreadNum(options.threads);
+    pool.start();
+    std::vector<EventLoop*> loops = pool.getAllLoops();
+
+    InetAddress serverAddr(options.host, options.port);
+    int64_t startUs = nowUs();
+    int64_t measureStartUs = startUs + static_cast<int64_t>(options.warmup * 1e6);
+
+    std::vector<std::unique_ptr<LoadConnection>> connections;
+    std::vector<std::vector<LoadConnection*>> connectionsByLoop(loops.size());
+    for (int i = 0; i < options.connections; ++i)
+    {
+        size_t loopIndex = i % loops.size();
+        connections.emplace_back(new LoadConnection(loops[loopIndex], serverAddr, i, &requests,
+                                                    options, startUs, measureStartUs));
+        connectionsByLoop[loopIndex].push_back(connections.back().get());
+    }
+
+    if (options.rate > 0)
+    {
+        for (size_t i = 0; i < loops.size(); ++i)
+        {
+            std::vector<LoadConnection*> owned = connectionsByLoop[i];
+            loops[i]->runEvery(0.001, [owned]
+            {
+                int64_t now = nowUs();
+                for (LoadConnection* conn : owned)
+                {
+                    conn->tick(now);
+                }
+            });
+        }
+    }
+    for (auto& conn : connections)
+    {
+        conn->start();
+    }
+
+    // 到点后在各自的 loop 线程里停掉连接，全部停完再汇总
+    loop.runAfter(options.warmup + options.duration, [&]
+    {
+        CountDownLatch latch(static_cast<int>(connections.size()));
+        for (auto& conn : connections)
+        {
+            LoadConnection* c = conn.get();
+            c->getLoop()->runInLoop([c, &latch]
+            {
+                c->stop();
+                latch.countDown();
+            });
+        }
+        latch.wait();
+        loop.quit();
+    });
+    loop.loop();
+    int64_t elapsedUs = nowUs() - measureStartUs;
+
+    LatencyHistogram::Snapshot snapshot;
+    uint64_t completed = 0;
+    uint64_t errors = 0;
+    uint64_t bytes = 0;
+    uint64_t statusClasses[6] = { 0 };
+    size_t backlog = 0;
+    for (auto& conn : connections)
+    {
+        LatencyHistogram::Snapshot one;
+        conn->histogram().snapshotInto(&one);
+        snapshot.merge(one);
+        completed += conn->completed();
+        errors += conn->errors();
+        bytes += conn->bytes();
+        backlog += conn->backlog();
+        for (int i = 0; i < 6; ++i)
+        {
+            statusClasses[i] += conn->statusClass(i);
+        }
+    }
+
+    double seconds = elapsedUs / 1e6;
+    double throughput = completed / seconds;
+    const double quantiles[] = { 0.5, 0.9, 0.99, 0.999, 0.9999 };
+    if (options.json)
+    {
+        printf("{\"mode\":\"%s\",\"connections\":%d,\"depth\":%d,\"target_rate\":%.1f,"
+               "\"seconds\":%.3f,\"completed\":%llu,\"errors\":%llu,\"backlog\":%zu,"
+               "\"throughput\":%.1f,\"bytes\":%llu,\"status\":{\"1xx\":%llu,\"2xx\":%llu,"
+               "\"3xx\":%llu,\"4xx\":%llu,\"5xx\":%llu,\"other\":%llu},\"latency_us\":{",
+               options.rate > 0 ? "open" : "closed", options.connections, options.depth,
+               options.rate, seconds,
+               static_cast<unsigned long long>(completed), static_cast<unsigned long long>(errors),
+               backlog, throughput, static_cast<unsigned long long>(bytes),
+               static_cast<unsigned long long>(statusClasses[1]),
+               static_cast<unsigned long long>(statusClasses[2]),
+               static_cast<unsigned long long>(statusClasses[3]),
+               static_cast<unsigned long long>(statusClasses[4]),
+               static_cast<unsigned long long>(statusClasses[5]),
+               static_cast<unsigned long long>(statusClasses[0]));
+        for (double q : quantiles)
+        {
+            printf("\"p%g\":%llu,", q * 100, static_cast<unsigned long long>(snapshot.percentile(q)));
+        }
+        printf("\"max\":%llu,\"mean\":%.1f}}\n", static_cast<unsigned long long>(snapshot.max),
+               snapshot.count ? static_cast<double>(snapshot.sum) / snapshot.count : 0.0);
+    }
+    else
+    {
+        printf("%s loop, %d connections, depth %d, %.1f s\n",
+               options.rate > 0 ? "Open" : "Closed", options.connections, options.depth, seconds);
+        printf("  requests   %llu (%.1f req/s), errors %llu, unsent backlog %zu\n",
+               static_cast<unsigned long long>(completed), throughput,
+               static_cast<unsigned long long>(errors), backlog);
+        printf("  status     2xx %llu, 3xx %llu, 4xx %llu, 5xx %llu\n",
+               static_cast<unsigned long long>(statusClasses[2]),
+               static_cast<unsigned long long>(statusClasses[3]),
+               static_cast<unsigned long long>(statusClasses[4]),
+               static_cast<unsigned long long>(statusClasses[5]));
+        printf("  latency%s\n", options.rate > 0 ? " (from intended send time)" : "");
+        for (double q : quantiles)
+        {
+            printf("    p%-7g %10.3f ms\n", q * 100, snapshot.percentile(q) / 1000.0);
+        }
+        printf("    max      %10.3f ms\n", snapshot.max / 1000.0);
+    }
+    return 0;
+}
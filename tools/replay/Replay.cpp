@@ -0,0 +1,705 @@
+// SmartSentinel 流量回放工具：把 HttpServer 抓取的 JSONL (SENTINEL_CAPTURE) 重新打到服务器上
+//
+// 按抓取时的时间间隔安排每个请求的"预定发送时间"，--speed 控制快慢 (2 表示两倍速)，
+// --speed 0 表示不管原始间隔、尽快发完。延迟从预定时间算起 (和 sentinel_loadgen 的开环模式一样)，
+// 服务端跟不上时排队时间也计入延迟；--speed 0 时从实际发送时间算起。
+// 结果按路由分组输出延迟分布。
+//
+// 例子：
+//   sentinel_replay --input capture.20240101-120000.host.1234.log
+//   sentinel_replay --input capture.log --speed 4 --connections 64 --json
+
+#include <muduo/base/CountDownLatch.h>
+#include <muduo/base/Logging.h>
+#include <muduo/base/Timestamp.h>
+#include <muduo/net/EventLoop.h>
+#include <muduo/net/EventLoopThreadPool.h>
+#include <muduo/net/InetAddress.h>
+#include <muduo/net/TcpClient.h>
+
+#include "metrics/Metrics.h"
+#include "../common/HttpResponseParser.h"
+#include "../../src/base/json.hpp"
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <strings.h>
+
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace muduo;
+using namespace muduo::net;
+using http::metrics::LatencyHistogram;
+using http::tools::HttpResponseParser;
+using json = nlohmann::json;
+
+namespace
+{
+
+struct Options
+{
+    std::string              host = "127.0.0.1";
+    uint16_t                 port = 8083;
+    std::vector<std::string> inputs;           // 抓取文件，按顺序拼接
+    double                   speed = 1.0;      // 回放倍速，0 表示尽快发
+    int                      connections = 16;
+    int                      threads = 4;
+    int                      depth = 1;        // 每个连接的 pipelining 深度
+    int                      loops = 1;        // 整个抓取文件重复回放几遍
+    size_t                   maxRoutes = 64;   // 超过这个数的路由统一归到 "other"
+    double                   timeout = 0;      // 总超时 (秒)，0 表示回放时长 + 30 秒
+    bool                     json = false;
+};
+
+// 一个待回放的请求
+struct Record
+{
+    int64_t     offsetUs;   // 相对第一个请求的时间
+    size_t      route;      // 路由下标
+    std::string raw;        // 渲染好的请求报文
+};
+
+int64_t nowUs()
+{
+    return Timestamp::now().microSecondsSinceEpoch();
+}
+
+std::string decodeBase64(const std::string& in)
+{
+    static int table[256];
+    static bool initialized = false;
+    if (!initialized)
+    {
+        const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+        for (int i = 0; i < 256; ++i)
+        {
+            table[i] = -1;
+        }
+        for (int i = 0; i < 64; ++i)
+        {
+            table[static_cast<unsigned char>(alphabet[i])] = i;
+        }
+        initialized = true;
+    }
+
+    std::string out;
+    uint32_t bits = 0;
+    int count = 0;
+    for (char ch : in)
+    {
+        int v = table[static_cast<unsigned char>(ch)];
+        if (v < 0)
+        {
+            continue; // 跳过 '=' 和空白
+        }
+        bits = (bits << 6) | v;
+        count += 6;
+        if (count >= 8)
+        {
+            count -= 8;
+            out.push_back(static_cast<char>((bits >> count) & 0xff));
+        }
+    }
+    return out;
+}
+
+// 把一条抓取记录渲染成请求报文：Host 改成回放目标，Content-Length 按实际请求体重算
+std::string renderRecord(const json& record, const Options& options)
+{
+    std::string method = record.value("method", "GET");
+    std::string target = record.value("path", "/");
+    std::string query = record.value("query", "");
+    if (!query.empty())
+    {
+        target += "?" + query;
+    }
+    std::string version = record.value("version", "HTTP/1.1");
+    std::string body = record.count("body_b64") ? decodeBase64(record["body_b64"].get<std::string>())
+                                                : record.value("body", "");
+
+    std::string req = method + " " + target + " " + version + "\r\n";
+    req += "Host: " + options.host + ":" + std::to_string(options.port) + "\r\n";
+    if (record.count("headers"))
+    {
+        for (auto it = record["headers"].begin(); it != record["headers"].end(); ++it)
+        {
+            const std::string& key = it.key();
+            if (::strcasecmp(key.c_str(), "Host") == 0 ||
+                ::strcasecmp(key.c_str(), "Content-Length") == 0)
+            {
+                continue;
+            }
+            req += key + ": " + it.value().get<std::string>() + "\r\n";
+        }
+    }
+    if (!body.empty() || method == "POST" || method == "PUT")
+    {
+        req += "Content-Length: " + std::to_string(body.size()) + "\r\n";
+    }
+    req += "\r\n";
+    req += body;
+    return req;
+}
+
+// 读取抓取文件，返回按时间排好序的请求；routes 收集路由名
+bool loadRecords(const Options& options, std::vector<Record>* records, std::vector<std::string>* routes)
+{
+    std::map<std::string, size_t> routeIndex;
+    int64_t firstTs = -1;
+    size_t badLines = 0;
+    for (const std::string& path : options.inputs)
+    {
+        std::ifstream in(path);
+        if (!in)
+        {
+            fprintf(stderr, "cannot open %s\n", path.c_str());
+            return false;
+        }
+        std::string line;
+        while (std::getline(in, line))
+        {
+            if (line.empty())
+            {
+                continue;
+            }
+            json record;
+            try
+            {
+                record = json::parse(line);
+            }
+            catch (const std::exception&)
+            {
+                ++badLines;
+                continue;
+            }
+
+            int64_t ts = record.value("ts", static_cast<int64_t>(0));
+            if (firstTs < 0)
+            {
+                firstTs = ts;
+            }
+
+            std::string route = record.value("path", "/");
+            auto it = routeIndex.find(route);
+            if (it == routeIndex.end())
+            {
+                // 路由太多 (比如扫描器的随机路径) 时后来的都归到 other
+                if (routeIndex.size() >= options.maxRoutes)
+                {
+                    it = routeIndex.find("other");
+                    if (it == routeIndex.end())
+                    {
+                        it = routeIndex.emplace("other", routes->size()).first;
+                        routes->push_back("other");
+                    }
+                }
+                else
+                {
+                    it = routeIndex.emplace(route, routes->size()).first;
+                    routes->push_back(route);
+                }
+            }
+            records->push_back({ ts - firstTs, it->second, renderRecord(record, options) });
+        }
+    }
+    if (badLines > 0)
+    {
+        fprintf(stderr, "skipped %zu malformed lines\n", badLines);
+    }
+
+    // 多个文件或多个线程写出的记录不一定严格有序
+    std::stable_sort(records->begin(), records->end(),
+                     [](const Record& a, const Record& b) { return a.offsetUs < b.offsetUs; });
+    if (!records->empty() && records->front().offsetUs != 0)
+    {
+        int64_t base = records->front().offsetUs;
+        for (Record& record : *records)
+        {
+            record.offsetUs -= base;
+        }
+    }
+    return !records->empty();
+}
+
+// 一个回放连接：按预定时间依次发送分给它的请求
+class ReplayConnection : noncopyable
+{
+public:
+    ReplayConnection(EventLoop* loop,
+                     const InetAddress& serverAddr,
+                     int id,
+                     const Options& options,
+                     size_t routeCount,
+                     std::atomic<size_t>* remaining,
+                     EventLoop* mainLoop)
+        : loop_(loop)
+        , client_(loop, serverAddr, "replay-" + std::to_string(id))
+        , options_(options)
+        , histograms_(routeCount)
+        , remaining_(remaining)
+        , mainLoop_(mainLoop)
+        , stopped_(false)
+        , completed_(0)
+        , errors_(0)
+        , bytes_(0)
+    {
+        for (int i = 0; i < 6; ++i)
+        {
+            statusClasses_[i] = 0;
+        }
+        client_.setConnectionCallback(std::bind(&ReplayConnection::onConnection, this, _1));
+        client_.setMessageCallback(std::bind(&ReplayConnection::onMessage, this, _1, _2, _3));
+        client_.enableRetry();
+    }
+
+    EventLoop* getLoop() const { return loop_; }
+
+    // 开始前由主线程调用，把请求分给这个连接 (intendedUs 为预定发送时间)
+    void assign(const Record* record, int64_t intendedUs)
+    {
+        schedule_.push_back({ record, intendedUs });
+    }
+
+    void start()
+    {
+        client_.connect();
+    }
+
+    // 在所属 loop 线程里调用
+    void stop()
+    {
+        stopped_ = true;
+        client_.disconnect();
+    }
+
+    // 每毫秒由 loop 的定时器调用，把到期的请求放进待发队列
+    void tick(int64_t now)
+    {
+        if (stopped_)
+        {
+            return;
+        }
+        while (!schedule_.empty() && schedule_.front().intendedUs <= now)
+        {
+            pending_.push_back(schedule_.front());
+            schedule_.pop_front();
+        }
+        pump();
+    }
+
+    const LatencyHistogram* histogram(size_t route) const { return histograms_[route].get(); }
+    uint64_t completed() const { return completed_; }
+    uint64_t errors() const { return errors_; }
+    uint64_t bytes() const { return bytes_; }
+    uint64_t statusClass(int i) const { return statusClasses_[i]; }
+
+private:
+    struct Scheduled
+    {
+        const Record* record;
+        int64_t       intendedUs;
+    };
+
+    void onConnection(const TcpConnectionPtr& conn)
+    {
+        if (conn->connected())
+        {
+            conn->setTcpNoDelay(true);
+            conn_ = conn;
+            parser_.reset();
+            pump();
+        }
+        else
+        {
+            if (!stopped_ && parser_.completeOnEof())
+            {
+                complete(nowUs());
+            }
+            // 在途的请求没有等到响应，算作错误，不再重发
+            if (!stopped_)
+            {
+                errors_ += inflight_.size();
+                finish(inflight_.size());
+            }
+            inflight_.clear();
+            conn_.reset();
+        }
+    }
+
+    void onMessage(const TcpConnectionPtr& conn, Buffer* buf, Timestamp)
+    {
+        while (!stopped_)
+        {
+            HttpResponseParser::Result result = parser_.parse(buf);
+            if (result == HttpResponseParser::kNeedMore)
+            {
+                break;
+            }
+            if (result == HttpResponseParser::kError)
+            {
+                ++errors_;
+                conn->forceClose();
+                break;
+            }
+            if (complete(nowUs()))
+            {
+                break; // 服务端会关闭连接，TcpClient 自动重连
+            }
+        }
+    }
+
+    // 返回 true 表示服务端要关闭这个连接
+    bool complete(int64_t now)
+    {
+        if (inflight_.empty())
+        {
+            parser_.reset();
+            return false;
+        }
+        Scheduled done = inflight_.front();
+        inflight_.pop_front();
+
+        std::unique_ptr<LatencyHistogram>& histogram = histograms_[done.record->route];
+        if (!histogram)
+        {
+            histogram.reset(new LatencyHistogram);
+        }
+        histogram->record(static_cast<uint64_t>(std::max<int64_t>(now - done.intendedUs, 0)));
+        ++completed_;
+        bytes_ += parser_.bytes();
+        int cls = parser_.status() / 100;
+        ++statusClasses_[(cls >= 1 && cls <= 5) ? cls : 0];
+
+        bool closing = parser_.closeConnection();
+        parser_.reset();
+        finish(1);
+        if (!stopped_ && !closing)
+        {
+            pump();
+        }
+        return closing;
+    }
+
+    // 有空位就把到期的请求发出去
+    void pump()
+    {
+        while (conn_ && static_cast<int>(inflight_.size()) < options_.depth && !pending_.empty())
+        {
+            Scheduled next = pending_.front();
+            pending_.pop_front();
+            if (options_.speed <= 0)
+            {
+                next.intendedUs = nowUs(); // 尽快发模式：延迟从实际发送时间算起
+            }
+            inflight_.push_back(next);
+            conn_->send(next.record->raw.data(), static_cast<int>(next.record->raw.size()));
+        }
+    }
+
+    // 所有连接的请求都有了结果 (完成或失败) 时通知主循环退出
+    void finish(size_t count)
+    {
+        if (count > 0 && remaining_->fetch_sub(count) == count)
+        {
+            mainLoop_->queueInLoop([this] { mainLoop_->quit(); });
+        }
+    }
+
+private:
+    EventLoop*                                     loop_;
+    TcpClient                                      client_;
+    TcpConnectionPtr                               conn_;
+    const Options&                                 options_;
+    std::deque<Scheduled>                          schedule_; // 还没到时间的请求
+    std::deque<Scheduled>                          pending_;  // 到期但还没发出去的请求
+    std::deque<Scheduled>                          inflight_; // 已发出等待响应的请求
+    HttpResponseParser                             parser_;
+    std::vector<std::unique_ptr<LatencyHistogram>> histograms_; // 按路由下标
+    std::atomic<size_t>*                           remaining_;
+    EventLoop*                                     mainLoop_;
+    bool                                           stopped_;
+    uint64_t                                       completed_;
+    uint64_t                                       errors_;
+    uint64_t                                       bytes_;
+    uint64_t                                       statusClasses_[6]; // 0 为无法识别，其余为 1xx..5xx
+};
+
+void usage(const char* prog)
+{
+    fprintf(stderr,
+            "Usage: %s --input FILE [options]\n"
+            "  --input FILE             capture file (JSONL), repeatable\n"
+            "  --host HOST              server address (default 127.0.0.1)\n"
+            "  --port PORT              server port (default 8083)\n"
+            "  --speed X                replay speed factor, 0 = as fast as possible (default 1)\n"
+            "  --connections N          concurrent connections (default 16)\n"
+            "  --threads N              I/O threads (default 4)\n"
+            "  --depth N                pipelining depth per connection (default 1)\n"
+            "  --loops N                replay the capture N times back to back (default 1)\n"
+            "  --max-routes N           per-route stats limit, the rest go to 'other' (default 64)\n"
+            "  --timeout S              give up after S seconds (default replay time + 30)\n"
+            "  --json                   print the report as JSON\n",
+            prog);
+}
+
+bool parseOptions(int argc, char* argv[], Options* options)
+{
+    static const struct option longOptions[] = {
+        { "input", required_argument, nullptr, 'i' },
+        { "host", required_argument, nullptr, 'h' },
+        { "port", required_argument, nullptr, 'p' },
+        { "speed", required_argument, nullptr, 's' },
+        { "connections", required_argument, nullptr, 'c' },
+        { "threads", required_argument, nullptr, 't' },
+        { "depth", required_argument, nullptr, 'd' },
+        { "loops", required_argument, nullptr, 'l' },
+        { "max-routes", required_argument, nullptr, 'm' },
+        { "timeout", required_argument, nullptr, 'T' },
+        { "json", no_argument, nullptr, 'j' },
+        { nullptr, 0, nullptr, 0 },
+    };
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "i:h:p:s:c:t:d:l:m:T:j", longOptions, nullptr)) != -1)
+    {
+        switch (opt)
+        {
+        case 'i': options->inputs.push_back(optarg); break;
+        case 'h': options->host = optarg; break;
+        case 'p': options->port = static_cast<uint16_t>(atoi(optarg)); break;
+        case 's': options->speed = atof(optarg); break;
+        case 'c': options->connections = atoi(optarg); break;
+        case 't': options->threads = atoi(optarg); break;
+        case 'd': options->depth = atoi(optarg); break;
+        case 'l': options->loops = atoi(optarg); break;
+        case 'm': options->maxRoutes = static_cast<size_t>(atoi(optarg)); break;
+        case 'T': options->timeout = atof(optarg); break;
+        case 'j': options->json = true; break;
+        default: return false;
+        }
+    }
+    return !options->inputs.empty() && options->connections > 0 && options->depth > 0 &&
+           options->threads >= 0 && options->loops > 0 && options->speed >= 0 && options->maxRoutes > 0;
+}
+
+void printQuantiles(const LatencyHistogram::Snapshot& snapshot, bool json)
+{
+    const double quantiles[] = { 0.5, 0.9, 0.99, 0.999 };
+    for (double q : quantiles)
+    {
+        if (json)
+        {
+            printf("\"p%g\":%llu,", q * 100, static_cast<unsigned long long>(snapshot.percentile(q)));
+        }
+        else
+        {
+            printf(" %10.3f", snapshot.percentile(q) / 1000.0);
+        }
+    }
+    if (json)
+    {
+        printf("\"max\":%llu", static_cast<unsigned long long>(snapshot.max));
+    }
+    else
+    {
+        printf(" %10.3f\n", snapshot.max / 1000.0);
+    }
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    Options options;
+    if (!parseOptions(argc, argv, &options))
+    {
+        usage(argv[0]);
+        return 1;
+    }
+    Logger::setLogLevel(Logger::WARN);
+
+    std::vector<Record> records;
+    std::vector<std::string> routes;
+    if (!loadRecords(options, &records, &routes))
+    {
+        fprintf(stderr, "no requests to replay\n");
+        return 1;
+    }
+    int64_t captureSpanUs = records.back().offsetUs;
+
+    EventLoop loop;
+    EventLoopThreadPool pool(&loop, "replay");
+    pool.setThreadNum(options.threads);
+    pool.start();
+    std::vector<EventLoop*> loops = pool.getAllLoops();
+
+    InetAddress serverAddr(options.host, options.port);
+    size_t total = records.size() * options.loops;
+    std::atomic<size_t> remaining(total);
+
+    std::vector<std::unique_ptr<ReplayConnection>> connections;
+    std::vector<std::vector<ReplayConnection*>> connectionsByLoop(loops.size());
+    for (int i = 0; i < options.connections; ++i)
+    {
+        size_t loopIndex = i % loops.size();
+        connections.emplace_back(new ReplayConnection(loops[loopIndex], serverAddr, i, options,
+                                                      routes.size(), &remaining, &loop));
+        connectionsByLoop[loopIndex].push_back(connections.back().get());
+    }
+
+    // 按原始间隔 (除以倍速) 安排预定发送时间，请求轮流分给各个连接；
+    // 留 100ms 给连接建立
+    double speed = options.speed > 0 ? options.speed : 0;
+    int64_t startUs = nowUs() + 100 * 1000;
+    int64_t loopSpanUs = captureSpanUs + 1;
+    size_t next = 0;
+    for (int l = 0; l < options.loops; ++l)
+    {
+        for (const Record& record : records)
+        {
+            int64_t offset = static_cast<int64_t>(l) * loopSpanUs + record.offsetUs;
+            int64_t intended = speed > 0 ? startUs + static_cast<int64_t>(offset / speed) : startUs;
+            connections[next++ % connections.size()]->assign(&record, intended);
+        }
+    }
+    double replaySeconds = speed > 0 ? loopSpanUs * options.loops / speed / 1e6 : 0;
+
+    for (size_t i = 0; i < loops.size(); ++i)
+    {
+        std::vector<ReplayConnection*> owned = connectionsByLoop[i];
+        loops[i]->runEvery(0.001, [owned]
+        {
+            int64_t now = nowUs();
+            for (ReplayConnection* conn : owned)
+            {
+                conn->tick(now);
+            }
+        });
+    }
+    for (auto& conn : connections)
+    {
+        conn->start();
+    }
+
+    bool timedOut = false;
+    double timeout = options.timeout > 0 ? options.timeout : replaySeconds + 30;
+    loop.runAfter(timeout, [&]
+    {
+        timedOut = true;
+        loop.quit();
+    });
+    loop.loop();
+    int64_t elapsedUs = nowUs() - startUs;
+
+    // 在各自的 loop 线程里停掉连接，全部停完再汇总
+    CountDownLatch latch(static_cast<int>(connections.size()));
+    for (auto& conn : connections)
+    {
+        ReplayConnection* c = conn.get();
+        c->getLoop()->runInLoop([c, &latch]
+        {
+            c->stop();
+            latch.countDown();
+        });
+    }
+    latch.wait();
+
+    LatencyHistogram::Snapshot overall;
+    std::vector<LatencyHistogram::Snapshot> perRoute(routes.size());
+    uint64_t completed = 0;
+    uint64_t errors = 0;
+    uint64_t bytes = 0;
+    uint64_t statusClasses[6] = { 0 };
+    for (auto& conn : connections)
+    {
+        for (size_t r = 0; r < routes.size(); ++r)
+        {
+            if (const LatencyHistogram* histogram = conn->histogram(r))
+            {
+                LatencyHistogram::Snapshot one;
+                histogram->snapshotInto(&one);
+                perRoute[r].merge(one);
+                overall.merge(one);
+            }
+        }
+        completed += conn->completed();
+        errors += conn->errors();
+        bytes += conn->bytes();
+        for (int i = 0; i < 6; ++i)
+        {
+            statusClasses[i] += conn->statusClass(i);
+        }
+    }
+
+    double seconds = elapsedUs / 1e6;
+    double capturedRate = captureSpanUs > 0 ? records.size() * 1e6 / captureSpanUs : 0;
+    if (options.json)
+    {
+        printf("{\"requests\":%zu,\"completed\":%llu,\"errors\":%llu,\"timed_out\":%s,"
+               "\"speed\":%g,\"seconds\":%.3f,\"throughput\":%.1f,\"captured_rate\":%.1f,"
+               "\"bytes\":%llu,\"status\":{\"1xx\":%llu,\"2xx\":%llu,\"3xx\":%llu,\"4xx\":%llu,"
+               "\"5xx\":%llu,\"other\":%llu},\"latency_us\":{",
+               total, static_cast<unsigned long long>(completed), static_cast<unsigned long long>(errors),
+               timedOut ? "true" : "false", options.speed, seconds, completed / seconds, capturedRate,
+               static_cast<unsigned long long>(bytes),
+               static_cast<unsigned long long>(statusClasses[1]),
+               static_cast<unsigned long long>(statusClasses[2]),
+               static_cast<unsigned long long>(statusClasses[3]),
+               static_cast<unsigned long long>(statusClasses[4]),
+               static_cast<unsigned long long>(statusClasses[5]),
+               static_cast<unsigned long long>(statusClasses[0]));
+        printQuantiles(overall, true);
+        printf("},\"routes\":{");
+        bool first = true;
+        for (size_t r = 0; r < routes.size(); ++r)
+        {
+            if (perRoute[r].count == 0)
+            {
+                continue;
+            }
+            printf("%s%s:{\"count\":%llu,", first ? "" : ",", json(routes[r]).dump().c_str(),
+                   static_cast<unsigned long long>(perRoute[r].count));
+            printQuantiles(perRoute[r], true);
+            printf("}");
+            first = false;
+        }
+        printf("}}\n");
+    }
+    else
+    {
+        char speedText[32];
+        snprintf(speedText, sizeof speedText, "%gx speed", options.speed);
+        printf("Replayed %zu requests at %s in %.1f s%s\n", total,
+               options.speed > 0 ? speedText : "max speed", seconds, timedOut ? " (timed out)" : "");
+        printf("  completed  %llu (%.1f req/s, captured %.1f req/s), errors %llu\n",
+               static_cast<unsigned long long>(completed), completed / seconds, capturedRate,
+               static_cast<unsigned long long>(errors));
+        printf("  status     2xx %llu, 3xx %llu, 4xx %llu, 5xx %llu\n",
+               static_cast<unsigned long long>(statusClasses[2]),
+               static_cast<unsigned long long>(statusClasses[3]),
+               static_cast<unsigned long long>(statusClasses[4]),
+               static_cast<unsigned long long>(statusClasses[5]));
+        printf("  latency ms%s\n", options.speed > 0 ? " (from intended send time)" : "");
+        printf("    %-32s %8s %10s %10s %10s %10s %10s\n", "route", "count", "p50", "p90", "p99", "p99.9", "max");
+        printf("    %-32s %8llu", "(all)", static_cast<unsigned long long>(overall.count));
+        printQuantiles(overall, false);
+        for (size_t r = 0; r < routes.size(); ++r)
+        {
+            if (perRoute[r].count == 0)
+            {
+                continue;
+            }
+            printf("    %-32.32s %8llu", routes[r].c_str(), static_cast<unsigned long long>(perRoute[r].count));
+            printQuantiles(perRoute[r], false);
+        }
+    }
+    return timedOut ? 2 : 0;
+}
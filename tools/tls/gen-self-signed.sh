@@ -0,0 +1,15 @@
+#!/bin/sh
+# 生成本地测试用的自签名证书 (CN=localhost，带 127.0.0.1 的 SAN)
+#
+# 用法：tools/tls/gen-self-signed.sh [输出目录，默认 certs]
+#   SENTINEL_TLS_CERT=certs/server.crt SENTINEL_TLS_KEY=certs/server.key ./bin/SmartSentinel
+#   curl -k https://127.0.0.1:8083/metrics
+set -e
+
+OUT=${1:-certs}
+mkdir -p "$OUT"
+openssl req -x509 -newkey ec -pkeyopt ec_paramgen_curve:prime256v1 -nodes \
+    -keyout "$OUT/server.key" -out "$OUT/server.crt" -days 365 \
+    -subj "/CN=localhost" \
+    -addext "subjectAltName=DNS:localhost,IP:127.0.0.1"
+echo "wrote $OUT/server.crt and $OUT/server.key"